@@ -0,0 +1,354 @@
+/*
+ * Fledge Base64 encoding and decoding
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <base64.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BASE64_X86	1
+#else
+#define BASE64_X86	0
+#endif
+
+/*
+ * The vectorised encoder and decoder follow the approach of
+ * Wojciech Muła and Daniel Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions". Each block of input is reshuffled
+ * so that every 32 bit lane holds the bits of one group of four
+ * characters, the 6 bit fields are then separated or merged with
+ * multiplies and translated to or from ASCII with byte shuffles used
+ * as lookup tables.
+ *
+ * The vector loops stop short of the end of the data so they never
+ * read or write beyond the buffers, the remainder and any padding is
+ * handled by the scalar code. A block that contains a character outside
+ * the base64 alphabet is also left to the scalar code, this gives the
+ * same result as the scalar decoder for any input.
+ */
+
+typedef size_t (*ENCODE_FN)(const uint8_t *, size_t, char *);
+typedef size_t (*DECODE_FN)(const char *, size_t, uint8_t *, size_t, size_t *);
+
+/**
+ * Encode whole groups of three bytes
+ */
+static size_t encodeScalar(const uint8_t *data, size_t length, char *out)
+{
+	size_t i;
+	for (i = 0; i + 3 <= length; i += 3)
+	{
+		uint32_t triple = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+		*out++ = encodingTable[(triple >> 18) & 0x3F];
+		*out++ = encodingTable[(triple >> 12) & 0x3F];
+		*out++ = encodingTable[(triple >> 6) & 0x3F];
+		*out++ = encodingTable[triple & 0x3F];
+	}
+	return i;
+}
+
+/**
+ * Decode complete groups of four characters. Padding characters
+ * are decoded as zero bits.
+ */
+static void decodeScalar(const char *encoded, size_t length, uint8_t *out, size_t maxLength, size_t i, size_t j)
+{
+	while (i + 4 <= length && j < maxLength)
+	{
+		uint32_t a = encoded[i] == '=' ? 0 : decodingTable[(uint8_t)encoded[i]];
+		uint32_t b = encoded[i + 1] == '=' ? 0 : decodingTable[(uint8_t)encoded[i + 1]];
+		uint32_t c = encoded[i + 2] == '=' ? 0 : decodingTable[(uint8_t)encoded[i + 2]];
+		uint32_t d = encoded[i + 3] == '=' ? 0 : decodingTable[(uint8_t)encoded[i + 3]];
+		i += 4;
+
+		uint32_t triple = (a << 18) + (b << 12) + (c << 6) + d;
+
+		out[j++] = (triple >> 16) & 0xFF;
+		if (j < maxLength)
+			out[j++] = (triple >> 8) & 0xFF;
+		if (j < maxLength)
+			out[j++] = triple & 0xFF;
+	}
+}
+
+/**
+ * Vectorised decoding, no vector support. Returns the number of
+ * characters consumed and the number of bytes written in written.
+ */
+static size_t decodeNone(const char *, size_t, uint8_t *, size_t, size_t *written)
+{
+	*written = 0;
+	return 0;
+}
+
+#if BASE64_X86
+/**
+ * Encode 12 bytes at a time with SSSE3
+ */
+__attribute__((target("ssse3")))
+static size_t encodeSSSE3(const uint8_t *data, size_t length, char *out)
+{
+	const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i shiftLUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'+' - 62, '/' - 63, 'A', 0, 0);
+	size_t i = 0;
+	// Each block reads 16 bytes of which 12 are encoded
+	for (; i + 16 <= length; i += 12)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i *)(data + i));
+		in = _mm_shuffle_epi8(in, shuffle);
+		__m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+		__m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		__m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+		__m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		__m128i indices = _mm_or_si128(t1, t3);
+
+		__m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		__m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+		result = _mm_add_epi8(_mm_shuffle_epi8(shiftLUT, result), indices);
+		_mm_storeu_si128((__m128i *)out, result);
+		out += 16;
+	}
+	return i + encodeScalar(data + i, length - i, out);
+}
+
+/**
+ * Encode 24 bytes at a time with AVX2
+ */
+__attribute__((target("avx2")))
+static size_t encodeAVX2(const uint8_t *data, size_t length, char *out)
+{
+	const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i shiftLUT = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'+' - 62, '/' - 63, 'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'+' - 62, '/' - 63, 'A', 0, 0);
+	size_t i = 0;
+	// Each block reads 28 bytes of which 24 are encoded, 12 per lane
+	for (; i + 28 <= length; i += 24)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(data + i + 12));
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		in = _mm256_shuffle_epi8(in, shuffle);
+		__m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+		__m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		__m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+		__m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		__m256i indices = _mm256_or_si256(t1, t3);
+
+		__m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		__m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+		result = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLUT, result), indices);
+		_mm256_storeu_si256((__m256i *)out, result);
+		out += 32;
+	}
+	return i + encodeScalar(data + i, length - i, out);
+}
+
+/**
+ * Decode 16 characters at a time with SSSE3
+ */
+__attribute__((target("ssse3")))
+static size_t decodeSSSE3(const char *encoded, size_t length, uint8_t *out, size_t maxLength, size_t *written)
+{
+	const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	size_t i = 0, j = 0;
+	// Each block writes 16 bytes of which 12 are decoded
+	for (; i + 16 <= length && j + 16 <= maxLength; i += 16, j += 12)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i *)(encoded + i));
+		__m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask);
+		__m128i loNibbles = _mm_and_si128(in, mask);
+		__m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+		__m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+		__m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+		if (_mm_movemask_epi8(invalid) != 0xFFFF)
+		{
+			break;
+		}
+		__m128i eq2F = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+		__m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+		in = _mm_add_epi8(in, roll);
+		__m128i merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+		merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+		merged = _mm_shuffle_epi8(merged, pack);
+		_mm_storeu_si128((__m128i *)(out + j), merged);
+	}
+	*written = j;
+	return i;
+}
+
+/**
+ * Decode 32 characters at a time with AVX2
+ */
+__attribute__((target("avx2")))
+static size_t decodeAVX2(const char *encoded, size_t length, uint8_t *out, size_t maxLength, size_t *written)
+{
+	const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	size_t i = 0, j = 0;
+	// Each block writes 32 bytes of which 24 are decoded
+	for (; i + 32 <= length && j + 32 <= maxLength; i += 32, j += 24)
+	{
+		__m256i in = _mm256_loadu_si256((const __m256i *)(encoded + i));
+		__m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask);
+		__m256i loNibbles = _mm256_and_si256(in, mask);
+		__m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+		__m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+		if (!_mm256_testz_si256(lo, hi))
+		{
+			break;
+		}
+		__m256i eq2F = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+		__m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+		in = _mm256_add_epi8(in, roll);
+		__m256i merged = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+		merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+		merged = _mm256_shuffle_epi8(merged, pack);
+		merged = _mm256_permutevar8x32_epi32(merged, lanes);
+		_mm256_storeu_si256((__m256i *)(out + j), merged);
+	}
+	*written = j;
+	return i;
+}
+#endif
+
+/**
+ * The block encoder and decoder selected for the CPU
+ */
+typedef struct {
+	ENCODE_FN	encode;
+	DECODE_FN	decode;
+	const char	*name;
+} Base64Dispatch;
+
+/**
+ * Select the encoder and decoder supported by the CPU
+ */
+static Base64Dispatch selectImplementation()
+{
+#if BASE64_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return { encodeAVX2, decodeAVX2, "avx2" };
+	}
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		return { encodeSSSE3, decodeSSSE3, "ssse3" };
+	}
+#endif
+	return { encodeScalar, decodeNone, "scalar" };
+}
+
+/**
+ * Return the implementation to use, the selection is made on first use
+ */
+static const Base64Dispatch& dispatch()
+{
+	static const Base64Dispatch selected = selectImplementation();
+	return selected;
+}
+
+/**
+ * Return the length of the base64 encoding of a number of bytes
+ *
+ * @param length	The number of bytes to encode
+ * @return size_t	The number of characters in the encoding
+ */
+size_t base64EncodedLength(size_t length)
+{
+	return 4 * ((length + 2) / 3);
+}
+
+/**
+ * Base64 encode a buffer. The output buffer must be able to
+ * hold base64EncodedLength(length) characters, no terminating
+ * null is added.
+ *
+ * @param data		The data to encode
+ * @param length	The number of bytes to encode
+ * @param out		The buffer to encode into
+ * @return size_t	The number of characters written
+ */
+size_t base64Encode(const void *data, size_t length, char *out)
+{
+	const uint8_t *src = (const uint8_t *)data;
+	size_t done = dispatch().encode(src, length, out);
+	char *p = out + (done / 3) * 4;
+	size_t remaining = length - done;
+	if (remaining)
+	{
+		src += done;
+		*p++ = encodingTable[(src[0] >> 2) & 0x3F];
+		if (remaining == 1)
+		{
+			*p++ = encodingTable[(src[0] & 0x3) << 4];
+			*p++ = '=';
+		}
+		else
+		{
+			*p++ = encodingTable[((src[0] & 0x3) << 4) | ((src[1] & 0xF0) >> 4)];
+			*p++ = encodingTable[(src[1] & 0xF) << 2];
+		}
+		*p++ = '=';
+	}
+	return p - out;
+}
+
+/**
+ * Decode a base64 encoded buffer. Decoding stops when the output
+ * buffer is full. Any trailing characters that do not form a group
+ * of four are ignored.
+ *
+ * @param encoded	The encoded characters
+ * @param length	The number of encoded characters
+ * @param out		The buffer to decode into
+ * @param maxLength	The size of the output buffer
+ */
+void base64Decode(const char *encoded, size_t length, void *out, size_t maxLength)
+{
+	size_t written;
+	size_t consumed = dispatch().decode(encoded, length, (uint8_t *)out, maxLength, &written);
+	decodeScalar(encoded, length, (uint8_t *)out, maxLength, consumed, written);
+}
+
+/**
+ * Return the name of the base64 implementation in use
+ */
+const char *base64Implementation()
+{
+	return dispatch().name;
+}
@@ -33,24 +33,7 @@ Base64DataBuffer::Base64DataBuffer(const string& encoded)
 	{
 		throw runtime_error("Base64DataBuffer insufficient memory to store data");
 	}
-	uint8_t *data = (uint8_t *)m_data;
-
-	for (size_t i = 0, j = 0; i < in_len;)
-	{
-		uint32_t a = encoded[i] == '=' ? 0 & i++ : decodingTable[static_cast<int>(encoded[i++])];
-		uint32_t b = encoded[i] == '=' ? 0 & i++ : decodingTable[static_cast<int>(encoded[i++])];
-		uint32_t c = encoded[i] == '=' ? 0 & i++ : decodingTable[static_cast<int>(encoded[i++])];
-		uint32_t d = encoded[i] == '=' ? 0 & i++ : decodingTable[static_cast<int>(encoded[i++])];
-
-		uint32_t triple = (a << 3 * 6) + (b << 2 * 6) + (c << 1 * 6) + (d << 0 * 6);
-
-		if (j < maxLen)
-			data[j++] = (triple >> 2 * 8) & 0xFF;
-		if (j < maxLen)
-			data[j++] = (triple >> 1 * 8) & 0xFF;
-		if (j < maxLen)
-			data[j++] = (triple >> 0 * 8) & 0xFF;
-	}
+	base64Decode(encoded.c_str() + 1, in_len, m_data, maxLen);
 }
 
 /**
@@ -59,39 +42,10 @@ Base64DataBuffer::Base64DataBuffer(const string& encoded)
  */
 string Base64DataBuffer::encode()
 {
-
 	size_t nBytes = m_itemSize * m_len;
-	size_t encoded = 4 * ((nBytes + 2) / 3);
-	char *ret = (char *)malloc(encoded + 1);
-	char *p = ret;
-	*p++ = m_itemSize + '0';
-	uint8_t *data = (uint8_t *)m_data;
-	int i;
-	for (i = 0; i < m_len - 2; i += 3)
-	{
-		*p++ = encodingTable[(*data >> 2) & 0x3F];
-		*p++ = encodingTable[((*data & 0x3) << 4) | ((int) (*(data + 1) & 0xF0) >> 4)];
-		*p++ = encodingTable[((*(data + 1) & 0xF) << 2) | ((int) (*(data + 2) & 0xC0) >> 6)];
-		*p++ = encodingTable[*(data + 2) & 0x3F];
-		data += 3;
-	}
-	if (i < nBytes)
-	{
-		*p++ = encodingTable[(*data >> 2) & 0x3F];
-		if (i == (nBytes - 1))
-		{
-			*p++ = encodingTable[((*data & 0x3) << 4)];
-			*p++ = '=';
-		}
-		else
-		{
-			*p++ = encodingTable[((*data & 0x3) << 4) | ((int) (*(data + 1) & 0xF0) >> 4)];
-			*p++ = encodingTable[((*(data + 1) & 0xF) << 2)];
-		}
-		*p++ = '=';
-	}
-	*p = '\0';
-	string r =  string(ret);
-	free(ret);
+	string r;
+	r.resize(base64EncodedLength(nBytes) + 1);
+	r[0] = m_itemSize + '0';
+	base64Encode(m_data, nBytes, &r[1]);
 	return r;
 }
@@ -11,6 +11,11 @@
 #include "bearer_token.h"
 #include <rapidjson/document.h>
 #include <logger.h>
+#include <base64.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include <time.h>
 
 using namespace rapidjson;
 using namespace std;
@@ -103,23 +108,37 @@ bool BearerToken::verify(const string& response)
 		return false;
 	}
 
+	return setClaims(doc, response);
+}
+
+/**
+ * Set the token claims from the claims of a verified token
+ *
+ * @param claims	The claims of the token
+ * @param json		The JSON document holding the claims, used for logging
+ * @return		True if the claims are valid
+ */
+bool BearerToken::setClaims(const Value& claims, const string& json)
+{
+	Logger *log = Logger::getLogger();
+
 	// Check JSON claim items
-	if (doc.HasMember("aud") &&
-	    doc.HasMember("sub") &&
-	    doc.HasMember("iss") &&
-	    doc.HasMember("exp"))
+	if (claims.HasMember("aud") &&
+	    claims.HasMember("sub") &&
+	    claims.HasMember("iss") &&
+	    claims.HasMember("exp"))
 	{
 		// Set token claims in the input map
-		if (doc["aud"].IsString() &&
-		    doc["sub"].IsString() &&
-		    doc["iss"].IsString() &&
-		    doc["exp"].IsUint())
+		if (claims["aud"].IsString() &&
+		    claims["sub"].IsString() &&
+		    claims["iss"].IsString() &&
+		    claims["exp"].IsUint())
 		{
 			// Valid data: set claim values, expiration and verified
-			m_audience = doc["aud"].GetString();
-			m_subject = doc["sub"].GetString();
-			m_issuer = doc["iss"].GetString();
-			m_expiration = doc["exp"].GetUint();
+			m_audience = claims["aud"].GetString();
+			m_subject = claims["sub"].GetString();
+			m_issuer = claims["iss"].GetString();
+			m_expiration = claims["exp"].GetUint();
 
 			m_verified = true;
 
@@ -131,13 +150,114 @@ bool BearerToken::verify(const string& response)
 		else
 		{
 			log->error("Token claims do not contain valid values: %s",
-				response.c_str());
+				json.c_str());
 		}
 	}
 	else
 	{
-		log->error("Needed token claims not found: %s", response.c_str());
+		log->error("Needed token claims not found: %s", json.c_str());
 	}
 
 	return m_verified;
 }
+
+/**
+ * Decode a base64url encoded token segment
+ *
+ * @param encoded	The encoded segment
+ * @param decoded	The decoded data
+ */
+static void base64UrlDecode(const string& encoded, string& decoded)
+{
+	string b64 = encoded;
+	for (auto& c : b64)
+	{
+		if (c == '-')
+			c = '+';
+		else if (c == '_')
+			c = '/';
+	}
+	size_t length = (b64.length() / 4) * 3;
+	switch (b64.length() % 4)
+	{
+	case 2:
+		b64.append("==");
+		length += 1;
+		break;
+	case 3:
+		b64.append("=");
+		length += 2;
+		break;
+	}
+	decoded.resize(length);
+	if (length)
+	{
+		base64Decode(b64.c_str(), b64.length(), &decoded[0], length);
+	}
+}
+
+/**
+ * Validate the bearer token locally, without a call to the core.
+ * The signature of the token is checked using the key the core
+ * signs tokens with and the token must not have expired.
+ *
+ * @param key		The key used to sign service tokens
+ * @return		True if the token is valid
+ */
+bool BearerToken::verifyLocal(const string& key)
+{
+	if (m_bearer_token.length() == 0 || key.empty())
+	{
+		return false;
+	}
+
+	size_t first = m_bearer_token.find('.');
+	size_t second = first == string::npos ? string::npos : m_bearer_token.find('.', first + 1);
+	if (second == string::npos)
+	{
+		return false;
+	}
+
+	string header, payload, signature;
+	base64UrlDecode(m_bearer_token.substr(0, first), header);
+	base64UrlDecode(m_bearer_token.substr(first + 1, second - first - 1), payload);
+	base64UrlDecode(m_bearer_token.substr(second + 1), signature);
+
+	Document doc;
+	doc.Parse(header.c_str());
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("alg") || !doc["alg"].IsString()
+			|| strcmp(doc["alg"].GetString(), BEARER_TOKEN_ALGORITHM) != 0)
+	{
+		return false;
+	}
+
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digestLength = 0;
+	if (!HMAC(EVP_sha512(), key.data(), (int)key.length(),
+			(const unsigned char *)m_bearer_token.data(), second,
+			digest, &digestLength))
+	{
+		return false;
+	}
+	if (signature.length() != digestLength ||
+			CRYPTO_memcmp(digest, signature.data(), digestLength) != 0)
+	{
+		return false;
+	}
+
+	doc.Parse(payload.c_str());
+	if (doc.HasParseError() || !doc.IsObject())
+	{
+		return false;
+	}
+	if (!setClaims(doc, payload))
+	{
+		return false;
+	}
+	if ((unsigned long)time(NULL) >= m_expiration)
+	{
+		m_verified = false;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * Fledge references to out of line datapoint data
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <blob_reference.h>
+#include <logger.h>
+#include <algorithm>
+
+using namespace std;
+
+vector<shared_ptr<BlobReference::Fetcher>>	BlobReference::m_fetchers;
+mutex		BlobReference::m_mutex;
+condition_variable	BlobReference::m_idle;
+thread_local bool	BlobReference::m_references = false;
+
+/**
+ * Register a callback used to fetch the data of a blob. Several
+ * callbacks may be registered, they are tried in the order in which
+ * they were registered.
+ *
+ * @param fetch		The callback to fetch the blob data
+ * @param data		Data passed to the callback
+ */
+void BlobReference::registerFetch(BLOB_FETCH_CB fetch, void *data)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_fetchers.push_back(make_shared<Fetcher>(fetch, data));
+}
+
+/**
+ * Remove the registration of a fetch callback. Waits for any fetch
+ * that is calling the callback to complete, so that the caller may
+ * then destroy the client the callback refers to.
+ *
+ * @param data		The data the callback was registered with
+ */
+void BlobReference::unregisterFetch(void *data)
+{
+	unique_lock<mutex> lock(m_mutex);
+	vector<shared_ptr<Fetcher>> removed;
+	for (auto it = m_fetchers.begin(); it != m_fetchers.end(); )
+	{
+		if ((*it)->m_data == data)
+		{
+			removed.push_back(*it);
+			it = m_fetchers.erase(it);
+		}
+		else
+			++it;
+	}
+	for (auto& fetcher : removed)
+	{
+		m_idle.wait(lock, [&fetcher]() { return fetcher->m_active == 0; });
+	}
+}
+
+/**
+ * Fetch the data of a blob into a buffer. The mutex is only held to
+ * find the next callback to try, not whilst the callback fetches the
+ * blob, so that fetches from several threads run concurrently. A
+ * callback that is in use is not unregistered, and the client it refers
+ * to destroyed, until the fetch has returned from it.
+ *
+ * @param blob		The reference of the blob
+ * @param buffer	The buffer to populate
+ * @param length	The length of the blob data
+ * @return bool		True if the buffer was populated
+ */
+bool BlobReference::fetch(const string& blob, void *buffer, size_t length)
+{
+	vector<shared_ptr<Fetcher>> fetchers;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		fetchers = m_fetchers;
+	}
+	if (fetchers.empty())
+	{
+		Logger::getLogger()->error("Unable to fetch the data of blob %s as there is no storage service connection",
+				blob.c_str());
+		return false;
+	}
+	for (auto& fetcher : fetchers)
+	{
+		{
+			lock_guard<mutex> guard(m_mutex);
+			if (find(m_fetchers.begin(), m_fetchers.end(), fetcher) == m_fetchers.end())
+				continue;	// Unregistered since the list was copied
+			fetcher->m_active++;
+		}
+		bool fetched = (*fetcher->m_fetch)(fetcher->m_data, blob, buffer, length);
+		{
+			lock_guard<mutex> guard(m_mutex);
+			fetcher->m_active--;
+		}
+		m_idle.notify_all();
+		if (fetched)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -9,6 +9,8 @@
  */
 
 #include <databuffer.h>
+#include <blob_reference.h>
+#include <logger.h>
 #include <exception>
 #include <stdexcept>
 #include <stdlib.h>
@@ -28,6 +30,19 @@ DataBuffer::DataBuffer(size_t itemSize, size_t len) : m_itemSize(itemSize), m_le
 		throw runtime_error("Insufficient memory to create buffer");
 }
 
+/**
+ * Buffer constructor for a buffer held in the blob store. The data
+ * is not fetched until it is accessed.
+ *
+ * @param itemSize	The size of each item in the buffer
+ * @param len		The length of the buffer, i.e. how many items can it hold
+ * @param blob		The reference of the blob that holds the data
+ */
+DataBuffer::DataBuffer(size_t itemSize, size_t len, const string& blob) : m_itemSize(itemSize),
+	m_len(len), m_data(NULL), m_blob(blob)
+{
+}
+
 /**
  * DataBuffer destructor
  */
@@ -47,6 +62,13 @@ DataBuffer::DataBuffer(const DataBuffer& rhs)
 {
 	m_itemSize = rhs.m_itemSize;
 	m_len = rhs.m_len;
+	m_blob = rhs.m_blob;
+	if (!rhs.m_data)
+	{
+		// Data is held in the blob store and has not been fetched
+		m_data = NULL;
+		return;
+	}
 	m_data = calloc(m_len, m_itemSize);
 	if (m_data)
 		memcpy(m_data, rhs.m_data, m_itemSize * m_len);
@@ -63,5 +85,34 @@ DataBuffer::DataBuffer(const DataBuffer& rhs)
 void DataBuffer::populate(void *src, int len)
 {
 	size_t toCopy = min((size_t)len, m_len * m_itemSize);
-	memcpy(m_data, src, toCopy);
+	memcpy(getData(), src, toCopy);
+}
+
+/**
+ * Fetch the data from the blob store if it has not already been
+ * fetched. The blob reference is discarded as the caller may go on
+ * to modify the data.
+ *
+ * @throws runtime_error	If the data could not be fetched, the buffer
+ *				continues to refer to the blob
+ */
+void DataBuffer::materialise()
+{
+	if (!m_data)
+	{
+		m_data = calloc(m_len, m_itemSize);
+		if (m_data == NULL)
+		{
+			throw runtime_error("Insufficient memory to create buffer");
+		}
+		if (!BlobReference::fetch(m_blob, m_data, m_len * m_itemSize))
+		{
+			free(m_data);
+			m_data = NULL;
+			Logger::getLogger()->error("Unable to fetch the buffer data held in blob %s",
+					m_blob.c_str());
+			throw runtime_error("Unable to fetch the buffer data held in blob " + m_blob);
+		}
+	}
+	m_blob.clear();
 }
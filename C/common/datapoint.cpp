@@ -18,6 +18,10 @@
 #include <exception>
 #include <base64databuffer.h>
 #include <base64dpimage.h>
+#include <blob_reference.h>
+#include <string_utils.h>
+#include <cmath>
+#include <algorithm>
 
  /**
  * Return the value as a string
@@ -26,108 +30,185 @@
  */
 std::string DatapointValue::toString() const
 {
-	std::ostringstream ss;
+	std::string	s;
+
+	toString(s);
+	return s;
+}
+
+/**
+ * Make room in a buffer for a number of further characters. The buffer
+ * is only grown, and then at least doubled, so that the calls made for
+ * each value of a reading do not defeat the geometric growth of the
+ * buffer or, with some implementations, shrink it.
+ *
+ * @param s	The buffer
+ * @param extra	The number of characters that will be appended
+ */
+static void reserveAppend(std::string& s, size_t extra)
+{
+	size_t needed = s.size() + extra;
+	if (s.capacity() < needed)
+	{
+		s.reserve(std::max(needed, 2 * s.capacity()));
+	}
+}
+
+/**
+ * Append the value as a string to a buffer. Nested values are
+ * appended directly to the same buffer, so a reading can be serialised
+ * without creating a string per value.
+ *
+ * @param s	The buffer to append to
+ */
+void DatapointValue::toString(std::string& s) const
+{
+	char		tmpBuffer[NUMBER_BUFFER_LEN + 100];
+	size_t		len;
 
 	switch (m_type)
 	{
 	case T_INTEGER:
-		ss << m_value.i;
-		return ss.str();
+		len = FormatLong(tmpBuffer, m_value.i);
+		s.append(tmpBuffer, len);
+		return;
 	case T_FLOAT:
-		{
-			char tmpBuffer[100];
-			std::string s;
-
-			snprintf(tmpBuffer, sizeof(tmpBuffer), "%.10f", m_value.f);
-			s= tmpBuffer;
-
-			// remove trailing 0's
-			if (s[s.size()-1]== '0') {
-				s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-
-				// add '0' i
-				if (s[s.size()-1]== '.')
-					s.append("0");
-
-			}
-
-			return s;
-		}
+		// Fixed point with 10 decimal places, trailing 0's removed
+		len = FormatDouble(tmpBuffer, sizeof(tmpBuffer), m_value.f, 10);
+		s.append(tmpBuffer, len);
+		return;
 	case T_FLOAT_ARRAY:
-		ss << "[";
+		reserveAppend(s, 2 + m_value.a->size() * 12);
+		s.push_back('[');
 		for (auto it = m_value.a->begin();
 		     it != m_value.a->end();
 		     ++it)
 		{
 			if (it != m_value.a->begin())
 			{
-				ss << ", ";
+				s.append(", ", 2);
 			}
-			ss << *it;
+			appendArrayElement(s, *it);
 		}
-		ss << "]";
-		return ss.str();
+		s.push_back(']');
+		return;
 	case T_DP_DICT:
 	case T_DP_LIST:
-		ss << ((m_type==T_DP_DICT)?'{':'[');
+		s.push_back((m_type==T_DP_DICT)?'{':'[');
 		for (auto it = m_value.dpa->begin(); // std::vector<Datapoint *>*	dpa;
 		     it != m_value.dpa->end();
 		     ++it)
 		{
 			if (it != m_value.dpa->begin())
 			{
-				ss << ", ";
+				s.append(", ", 2);
 			}
-			ss << ((m_type==T_DP_DICT)?(*it)->toJSONProperty():(*it)->getData().toString());
+			if (m_type == T_DP_DICT)
+				(*it)->toJSONProperty(s);
+			else
+				(*it)->getData().toString(s);
 		}
-		ss << ((m_type==T_DP_DICT)?'}':']');
-		return ss.str();
+		s.push_back((m_type==T_DP_DICT)?'}':']');
+		return;
 	case T_STRING:
-		ss << "\"";
-		ss << escape(*m_value.str);
-		ss << "\"";
-		return ss.str();
+		reserveAppend(s, m_value.str->size() + 2);
+		s.push_back('"');
+		StringAppendEscapedQuotes(s, *m_value.str);
+		s.push_back('"');
+		return;
 	case T_DATABUFFER:
-		ss << "\"__DATABUFFER:" 
-			<< ((Base64DataBuffer *)m_value.dataBuffer)->encode()
-			<< "\"";
-		return ss.str();
+		if (!m_value.dataBuffer->getBlob().empty() && BlobReference::serialiseReferences())
+		{
+			// The data is held in the blob store
+			len = snprintf(tmpBuffer, sizeof(tmpBuffer), "\"" BLOB_PREFIX "DATABUFFER:%lu,%lu:",
+					(unsigned long)m_value.dataBuffer->getItemSize(),
+					(unsigned long)m_value.dataBuffer->getItemCount());
+			s.append(tmpBuffer, len);
+			s.append(m_value.dataBuffer->getBlob());
+			s.push_back('"');
+			return;
+		}
+		// Fetch the data if it is only held in the blob store
+		(void)m_value.dataBuffer->getData();
+		s.append("\"__DATABUFFER:");
+		s.append(((Base64DataBuffer *)m_value.dataBuffer)->encode());
+		s.push_back('"');
+		return;
 	case T_IMAGE:
-		ss << "\"__DPIMAGE:" 
-			<< ((Base64DPImage *)m_value.image)->encode()
-			<< "\"";
-		return ss.str();
+		if (!m_value.image->getBlob().empty() && BlobReference::serialiseReferences())
+		{
+			// The image is held in the blob store
+			len = snprintf(tmpBuffer, sizeof(tmpBuffer), "\"" BLOB_PREFIX "DPIMAGE:%d,%d,%d:",
+					m_value.image->getWidth(),
+					m_value.image->getHeight(),
+					m_value.image->getDepth());
+			s.append(tmpBuffer, len);
+			s.append(m_value.image->getBlob());
+			s.push_back('"');
+			return;
+		}
+		// Fetch the image if it is only held in the blob store
+		(void)m_value.image->getData();
+		s.append("\"__DPIMAGE:");
+		s.append(((Base64DPImage *)m_value.image)->encode());
+		s.push_back('"');
+		return;
 	case T_2D_FLOAT_ARRAY:
 		{
-		ss << "[ ";
+		s.append("[ ", 2);
 		bool first = true;
 		for (auto row : *(m_value.a2d))
 		{
 			if (first)
 				first = false;
 			else
-				ss << ", ";
-			ss << "[";
+				s.append(", ", 2);
+			s.push_back('[');
 			for (auto it = row->begin();
 			     it != row->end();
 			     ++it)
 			{
 				if (it != row->begin())
 				{
-					ss << ", ";
+					s.append(", ", 2);
 				}
-				ss << *it;
+				appendArrayElement(s, *it);
 			}
-			ss << "]";
+			s.push_back(']');
 		}
-		ss << " ]";
-		return ss.str();
+		s.append(" ]", 2);
+		return;
 		}
 	default:
 		throw std::runtime_error("No string representation for datapoint type");
 	}
 }
 
+/**
+ * Append a single element of a floating point array to a string.
+ * The element is formatted the same way as the default stream
+ * formatting of a double, i.e. %g with 6 significant digits.
+ *
+ * @param s	The string to append to
+ * @param value	The array element to append
+ */
+void DatapointValue::appendArrayElement(std::string& s, double value) const
+{
+	char	tmpBuffer[NUMBER_BUFFER_LEN];
+	size_t	len;
+
+	if (value > -1e6 && value < 1e6 && value == (double)(long)value
+			&& !(value == 0.0 && std::signbit(value)))
+	{
+		len = FormatLong(tmpBuffer, (long)value);
+	}
+	else
+	{
+		len = snprintf(tmpBuffer, sizeof(tmpBuffer), "%g", value);
+	}
+	s.append(tmpBuffer, len);
+}
+
 /**
  * Delete the DatapointValue along with possibly nested Datapoint objects
  */
@@ -325,28 +406,9 @@ DatapointValue& DatapointValue::operator=(const DatapointValue& rhs)
 const std::string DatapointValue::escape(const std::string& str) const
 {
 std::string rval;
-int bscount = 0;
 
-	for (size_t i = 0; i < str.length(); i++)
-	{
-		if (str[i] == '\\')
-		{
-			bscount++;
-		}
-		else if (str[i] == '\"')
-		{
-			if ((bscount & 1) == 0)	// not already escaped
-			{
-				rval += "\\";	// Add escape of "
-			}
-			bscount = 0;
-		}
-		else
-		{
-			bscount = 0;
-		}
-		rval += str[i];
-	}
+	rval.reserve(str.length());
+	StringAppendEscapedQuotes(rval, str);
 	return rval;
 }
 
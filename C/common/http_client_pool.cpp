@@ -0,0 +1,267 @@
+/*
+ * Fledge storage client HTTP client pool.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <http_client_pool.h>
+#include <atomic>
+
+using namespace std;
+using namespace std::chrono;
+
+static atomic<unsigned long> nextPoolId(1);
+
+/**
+ * The clients of the pools used by a thread. Pools are identified by
+ * a unique id rather than their address as a pool may be destroyed and
+ * another created at the same address. When the thread exits the clients
+ * are returned to the pools that still exist.
+ */
+class HttpThreadClients {
+	public:
+		~HttpThreadClients()
+		{
+			for (auto& tc : m_clients)
+			{
+				shared_ptr<HttpClientPool> pool = tc.owner.lock();
+				if (pool)
+				{
+					pool->checkin(tc.client, tc.seqnum);
+				}
+			}
+		};
+		vector<HttpClientPool::ThreadClient>	m_clients;
+};
+
+static thread_local HttpThreadClients threadClients;
+
+/**
+ * Create a pool of clients
+ *
+ * @param url	The host and port of the storage service
+ */
+shared_ptr<HttpClientPool> HttpClientPool::create(const string& url)
+{
+	return shared_ptr<HttpClientPool>(new HttpClientPool(url));
+}
+
+/**
+ * Constructor for the pool of clients
+ *
+ * @param url	The host and port of the storage service
+ */
+HttpClientPool::HttpClientPool(const string& url) : m_url(url), m_id(nextPoolId++), m_seqnum(0)
+{
+}
+
+/**
+ * Destructor for the pool, deletes all the clients of the pool
+ */
+HttpClientPool::~HttpClientPool()
+{
+	for (auto client : m_clients)
+	{
+		delete client;
+	}
+}
+
+/**
+ * Return the client of the calling thread, the thread is given a
+ * client the first time it calls
+ *
+ * @return HttpClient*	The client of the calling thread
+ */
+HttpClient *HttpClientPool::client()
+{
+	return lookup()->client;
+}
+
+/**
+ * Return the next sequence number for a request sent by the calling
+ * thread. The storage service uses the sequence number to discard
+ * repeated requests from a thread.
+ *
+ * @return int	The sequence number
+ */
+int HttpClientPool::nextSequence()
+{
+	return ++lookup()->seqnum;
+}
+
+/**
+ * Use the given client for the calling thread. The pool takes ownership
+ * of the client.
+ *
+ * @param client	The client to use
+ */
+void HttpClientPool::adopt(HttpClient *client)
+{
+	int seqnum;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_clients.insert(client);
+		seqnum = m_seqnum;
+	}
+	for (auto it = threadClients.m_clients.begin(); it != threadClients.m_clients.end(); ++it)
+	{
+		if (it->pool == m_id)
+		{
+			HttpClient *previous = it->client;
+			it->client = client;
+			checkin(previous, it->seqnum);
+			return;
+		}
+	}
+	attach(client, seqnum);
+}
+
+/**
+ * Delete the client of the calling thread. The thread will be given a
+ * new client the next time it uses the pool.
+ *
+ * @return bool	False if the thread did not have a client
+ */
+bool HttpClientPool::remove()
+{
+	for (auto it = threadClients.m_clients.begin(); it != threadClients.m_clients.end(); ++it)
+	{
+		if (it->pool == m_id)
+		{
+			lock_guard<mutex> guard(m_mutex);
+			m_clients.erase(it->client);
+			delete it->client;
+			if (it->seqnum > m_seqnum)
+				m_seqnum = it->seqnum;
+			threadClients.m_clients.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Return the number of clients owned by the pool
+ */
+size_t HttpClientPool::size()
+{
+	lock_guard<mutex> guard(m_mutex);
+	return m_clients.size();
+}
+
+/**
+ * Return the number of idle clients held by the pool
+ */
+size_t HttpClientPool::idle()
+{
+	lock_guard<mutex> guard(m_mutex);
+	return m_idle.size();
+}
+
+/**
+ * Find the client of the calling thread, taking one from the pool
+ * if the thread does not yet have a client
+ *
+ * @return ThreadClient*	The client of the calling thread
+ */
+HttpClientPool::ThreadClient *HttpClientPool::lookup()
+{
+	for (auto& tc : threadClients.m_clients)
+	{
+		if (tc.pool == m_id)
+		{
+			return &tc;
+		}
+	}
+	int seqnum;
+	HttpClient *client = checkout(seqnum);
+	return attach(client, seqnum);
+}
+
+/**
+ * Record the client of the calling thread in thread local storage,
+ * discarding the clients of pools that no longer exist
+ *
+ * @param client	The client
+ * @param seqnum	The sequence number to continue from
+ * @return ThreadClient*	The client of the calling thread
+ */
+HttpClientPool::ThreadClient *HttpClientPool::attach(HttpClient *client, int seqnum)
+{
+	vector<ThreadClient>& clients = threadClients.m_clients;
+	for (auto it = clients.begin(); it != clients.end(); )
+	{
+		if (it->owner.expired())
+			it = clients.erase(it);
+		else
+			++it;
+	}
+	ThreadClient tc;
+	tc.pool = m_id;
+	tc.owner = shared_from_this();
+	tc.client = client;
+	tc.seqnum = seqnum;
+	clients.push_back(tc);
+	return &clients.back();
+}
+
+/**
+ * Take a client from the pool, creating one if there is no idle client
+ * that can be used. The most recently returned client is used first,
+ * clients that have been idle for too long are deleted.
+ *
+ * Thread ids may be reused, so the sequence numbers of a thread start
+ * after the highest sequence number of the threads that have left the
+ * pool.
+ *
+ * @param seqnum	The sequence number to continue from
+ * @return HttpClient*	The client
+ */
+HttpClient *HttpClientPool::checkout(int& seqnum)
+{
+	lock_guard<mutex> guard(m_mutex);
+	seqnum = m_seqnum;
+	if (!m_idle.empty())
+	{
+		auto last = m_idle.back();
+		if (steady_clock::now() - last.second < seconds(HTTP_CLIENT_IDLE_TIMEOUT))
+		{
+			m_idle.pop_back();
+			return last.first;
+		}
+		// All the idle clients have timed out
+		for (auto& idle : m_idle)
+		{
+			m_clients.erase(idle.first);
+			delete idle.first;
+		}
+		m_idle.clear();
+	}
+	HttpClient *client = new HttpClient(m_url);
+	m_clients.insert(client);
+	return client;
+}
+
+/**
+ * Return a client to the pool, the client is deleted if the pool
+ * already holds the maximum number of idle clients
+ *
+ * @param client	The client
+ * @param seqnum	The last sequence number used with the client
+ */
+void HttpClientPool::checkin(HttpClient *client, int seqnum)
+{
+	lock_guard<mutex> guard(m_mutex);
+	if (seqnum > m_seqnum)
+		m_seqnum = seqnum;
+	if (m_clients.find(client) == m_clients.end())
+		return;
+	if (m_idle.size() >= HTTP_CLIENT_POOL_SIZE)
+	{
+		m_clients.erase(client);
+		delete client;
+		return;
+	}
+	m_idle.push_back(make_pair(client, steady_clock::now()));
+}
@@ -8,6 +8,7 @@
  * Author: Mark Riddoch
  */
 #include <dpimage.h>
+#include <blob_reference.h>
 #include <logger.h>
 #include <string.h>
 #include <exception>
@@ -38,6 +39,21 @@ DPImage::DPImage(int width, int height, int depth, void *data) : m_width(width),
 	}
 }
 
+/**
+ * DPImage constructor for an image held in the blob store. The
+ * image data is not fetched until it is accessed.
+ *
+ * @param width		The image width
+ * @param height	The image height
+ * @param depth		The image depth
+ * @param blob		The reference of the blob that holds the image data
+ */
+DPImage::DPImage(int width, int height, int depth, const string& blob) : m_width(width),
+	m_height(height), m_depth(depth), m_pixels(NULL), m_blob(blob)
+{
+	m_byteSize = width * height * (depth / 8);
+}
+
 /**
  * Copy constructor
  *
@@ -48,8 +64,15 @@ DPImage::DPImage(const DPImage& rhs)
 	m_width = rhs.m_width;
 	m_height = rhs.m_height;
 	m_depth = rhs.m_depth;
+	m_blob = rhs.m_blob;
 
 	m_byteSize = m_width * m_height * (m_depth / 8);
+	if (!rhs.m_pixels)
+	{
+		// Image is held in the blob store and has not been fetched
+		m_pixels = NULL;
+		return;
+	}
 	m_pixels = (void *)malloc(m_byteSize);
 	if (m_pixels)
 	{
@@ -74,8 +97,14 @@ DPImage& DPImage::operator=(const DPImage& rhs)
 	m_width = rhs.m_width;
 	m_height = rhs.m_height;
 	m_depth = rhs.m_depth;
+	m_blob = rhs.m_blob;
 
 	m_byteSize = m_width * m_height * (m_depth / 8);
+	if (!rhs.m_pixels)
+	{
+		m_pixels = NULL;
+		return *this;
+	}
 	m_pixels = (void *)malloc(m_byteSize);
 	if (m_pixels)
 	{
@@ -97,3 +126,32 @@ DPImage::~DPImage()
 		free(m_pixels);
 	m_pixels = NULL;
 }
+
+/**
+ * Fetch the image data from the blob store if it has not already been
+ * fetched. The blob reference is discarded as the caller may go on to
+ * modify the image.
+ *
+ * @throws runtime_error	If the data could not be fetched, the image
+ *				continues to refer to the blob
+ */
+void DPImage::materialise()
+{
+	if (!m_pixels)
+	{
+		m_pixels = calloc(1, m_byteSize);
+		if (!m_pixels)
+		{
+			throw runtime_error("Insufficient memory to store image");
+		}
+		if (!BlobReference::fetch(m_blob, m_pixels, m_byteSize))
+		{
+			free(m_pixels);
+			m_pixels = NULL;
+			Logger::getLogger()->error("Unable to fetch the image data held in blob %s",
+					m_blob.c_str());
+			throw runtime_error("Unable to fetch the image data held in blob " + m_blob);
+		}
+	}
+	m_blob.clear();
+}
@@ -9,6 +9,18 @@
  *
  * Author: Mark Riddoch
  */
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Base64 encoding and decoding of buffers. Vectorised implementations
+ * are used if the CPU supports them, the implementation is selected
+ * at runtime.
+ */
+size_t		base64EncodedLength(size_t length);
+size_t		base64Encode(const void *data, size_t length, char *out);
+void		base64Decode(const char *encoded, size_t length, void *out, size_t maxLength);
+const char	*base64Implementation();
 
 static const char encodingTable[] = {
       'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
@@ -10,16 +10,19 @@
  * Author: Massimiliano Pinto
  */
 #include <server_http.hpp>
+#include <rapidjson/document.h>
 #include <string>
 
 #define AUTH_HEADER "Authorization"
 #define BEARER_SCHEMA "Bearer "
+#define BEARER_TOKEN_ALGORITHM "HS512"	// Signature algorithm of service bearer tokens
 
 /**
  * This class represents a JWT bearer token
  *
- * The claims are stored after verification to core service API endpoint
- *
+ * The claims are stored after verification to core service API endpoint,
+ * or after the signature and expiry of the token have been validated
+ * locally using the key that the core uses to sign the tokens.
  */
 class BearerToken
 {
@@ -35,6 +38,7 @@ class BearerToken
 		const std::string&
 				token() { return m_bearer_token; };
 		bool		verify(const std::string& serverResponse);
+		bool		verifyLocal(const std::string& key);
 		unsigned long	getExpiration() { return m_expiration; };
 		// Return string references
 		const std::string&
@@ -45,6 +49,7 @@ class BearerToken
 				getIssuer() { return m_issuer; };
 
 	private:
+		bool		setClaims(const rapidjson::Value& claims, const std::string& json);
 		bool		m_verified;
 		unsigned long	m_expiration;
 		std::string	m_bearer_token;
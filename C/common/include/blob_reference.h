@@ -0,0 +1,84 @@
+#ifndef _BLOB_REFERENCE_H
+#define _BLOB_REFERENCE_H
+/*
+ * Fledge references to out of line datapoint data
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#define BLOB_PREFIX		"__BLOB:"	// Prefix of a serialised blob reference
+#define BLOB_PREFIX_LEN		7		// Length of the blob reference prefix
+
+typedef bool (*BLOB_FETCH_CB)(void *, const std::string&, void *, size_t);
+
+/**
+ * The data of large image and data buffer datapoints may be held out
+ * of line in the blob store of the storage service rather than within
+ * the reading. The reading then holds a reference to the blob, which
+ * is the SHA-256 digest of the data, and the data is only fetched when
+ * it is accessed.
+ *
+ * A process that may access blobs registers a fetch callback, this is
+ * normally done by the storage client of the process. Each storage
+ * client registers a callback, a fetch tries them in the order they
+ * were registered until one returns the data.
+ *
+ * Datapoints are only serialised as blob references when they are
+ * appended to the storage service, within a BlobReference::Scope.
+ * Any other serialisation, for example by a north plugin, fetches
+ * the data of the blob and serialises the data.
+ */
+class BlobReference {
+	public:
+		static void	registerFetch(BLOB_FETCH_CB fetch, void *data);
+		static void	unregisterFetch(void *data);
+		static bool	fetch(const std::string& blob, void *buffer, size_t length);
+		/**
+		 * Return true if datapoints held in the blob store should
+		 * be serialised as a reference to the blob by this thread
+		 */
+		static bool	serialiseReferences() { return m_references; };
+		/**
+		 * Whilst a Scope exists the datapoints serialised by the
+		 * thread that created it are serialised as blob references
+		 */
+		class Scope {
+			public:
+				Scope() : m_previous(m_references) { m_references = true; };
+				~Scope() { m_references = m_previous; };
+			private:
+				bool	m_previous;
+		};
+	private:
+		/**
+		 * A registered fetch callback and the number of fetches
+		 * currently calling it
+		 */
+		class Fetcher {
+			public:
+				Fetcher(BLOB_FETCH_CB fetch, void *data) :
+					m_fetch(fetch), m_data(data), m_active(0) {};
+				BLOB_FETCH_CB	m_fetch;
+				void		*m_data;
+				int		m_active;
+		};
+		static std::vector<std::shared_ptr<Fetcher>>
+					m_fetchers;
+		static std::mutex	m_mutex;
+		static std::condition_variable
+					m_idle;
+		static thread_local bool
+					m_references;
+};
+
+#endif
@@ -10,15 +10,23 @@
  * Author: Mark Riddoch
  */
 #include <unistd.h>
+#include <string>
 
 /**
  * Buffer type for storage of arbitrary buffers of data within a datapoint.
  * A DataBuffer is essentially a 1 dimensional array of a memory primitive of
  * itemSize.
+ *
+ * The data of a buffer may be held in the blob store of the storage
+ * service, in which case the buffer holds a reference to the blob and
+ * the data is fetched the first time it is accessed. As the caller
+ * may modify the data once it has been accessed the reference is then
+ * discarded.
  */
 class DataBuffer {
 	public:
 		DataBuffer(size_t itemSize, size_t len);
+		DataBuffer(size_t itemSize, size_t len, const std::string& blob);
 		DataBuffer(const DataBuffer& rhs);
 		DataBuffer& operator=(const DataBuffer& rhs);
 		~DataBuffer();
@@ -34,12 +42,29 @@ class DataBuffer {
 		/**
 		 * Return a pointer to the raw data in the data buffer
 		 */
-		void		*getData() { return m_data; };
+		void		*getData()
+				{
+					if (!m_blob.empty())
+						materialise();
+					return m_data;
+				};
+		/**
+		 * Return the reference of the blob that holds the data,
+		 * an empty string if the data is held in the buffer
+		 */
+		const std::string&
+				getBlob() const { return m_blob; };
+		/**
+		 * Set the reference of the blob that holds a copy of the data
+		 */
+		void		setBlob(const std::string& blob) { m_blob = blob; };
 	protected:
 		DataBuffer()	{};
+		void		materialise();
 		size_t		m_itemSize;
 		size_t		m_len;
 		void		*m_data;
+		std::string	m_blob;
 };
 
 #endif
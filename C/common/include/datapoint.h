@@ -191,6 +191,11 @@ class DatapointValue {
 		 */
 		std::string	toString() const;
 
+		/**
+		 * Append the value as a string to a buffer
+		 */
+		void		toString(std::string& s) const;
+
 		/**
 		 * Return string value without trailing/leading quotes
 		 */
@@ -286,6 +291,7 @@ class DatapointValue {
 
 	private:
 		void deleteNestedDPV();
+		void appendArrayElement(std::string& s, double value) const;
 		const std::string	escape(const std::string& str) const;
 		union data_t {
 			std::string*		str;
@@ -325,16 +331,28 @@ class Datapoint {
 		 */
 		std::string	toJSONProperty()
 		{
-			std::string rval = "\"" + m_name + "\":";
-			rval += m_value.toString();
+			std::string rval;
 
+			toJSONProperty(rval);
 			return rval;
 		}
 
+		/**
+		 * Append asset reading data point as a JSON
+		 * property to a buffer
+		 */
+		void		toJSONProperty(std::string& s) const
+		{
+			s.push_back('"');
+			s.append(m_name);
+			s.append("\":", 2);
+			m_value.toString(s);
+		}
+
 		/**
 		 * Return the Datapoint name
 		 */
-		const std::string getName() const
+		const std::string& getName() const
 		{
 			return m_name;
 		}
@@ -9,6 +9,7 @@
  *
  * Author: Mark Riddoch
  */
+#include <string>
 
 /**
  * Simple Image class that will be used within data points to store image data.
@@ -17,11 +18,16 @@
  * complex functionality will be supported elsewhere. Images within the class
  * are stored as a simple, single area of memory the size of which is defined
  * by the width, hieght and depth of the image.
+ *
+ * The image may be held in the blob store of the storage service, in
+ * which case only a reference to the blob is held until the image data
+ * is first accessed.
  */
 class DPImage {
 	public:
 		DPImage() : m_width(0), m_height(0), m_depth(0), m_pixels(0), m_byteSize(0) {};
 		DPImage(int width, int height, int depth, void *data);
+		DPImage(int width, int height, int depth, const std::string& blob);
 		DPImage(const DPImage& rhs);
 		DPImage& operator=(const DPImage& rhs);
 		~DPImage();
@@ -40,13 +46,34 @@ class DPImage {
 		/**
 		 * Return a pointer to the raw data of the image
 		 */
-		void		*getData() { return m_pixels; };
+		void		*getData()
+				{
+					if (!m_blob.empty())
+						materialise();
+					return m_pixels;
+				};
+		/**
+		 * Return the reference of the blob that holds the image,
+		 * an empty string if the image is held in memory
+		 */
+		const std::string&
+				getBlob() const { return m_blob; };
+		/**
+		 * Set the reference of the blob that holds a copy of the image
+		 */
+		void		setBlob(const std::string& blob) { m_blob = blob; };
+		/**
+		 * Return the size of the image data in bytes
+		 */
+		int		getByteSize() { return m_byteSize; };
 	protected:
+		void		materialise();
 		int		m_width;
 		int		m_height;
 		int		m_depth;
 		void		*m_pixels;
 		int		m_byteSize;
+		std::string	m_blob;
 };
 
 #endif
@@ -26,6 +26,11 @@ class Expression {
 		{
 			m_value.ival = value;
 		};
+		Expression(const std::string& column, const std::string& op, long value) :
+			m_column(column), m_op(op), m_type(INT_COLUMN)
+		{
+			m_value.ival = value;
+		};
 		Expression(const std::string& column, const std::string& op, double value) :
 			m_column(column), m_op(op), m_type(NUMBER_COLUMN)
 		{
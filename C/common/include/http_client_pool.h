@@ -0,0 +1,84 @@
+#ifndef _HTTP_CLIENT_POOL_H
+#define _HTTP_CLIENT_POOL_H
+/*
+ * Fledge storage client HTTP client pool.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <client_http.hpp>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <chrono>
+
+using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
+
+#define HTTP_CLIENT_POOL_SIZE		8	// Idle clients retained for reuse by new threads
+#define HTTP_CLIENT_IDLE_TIMEOUT	50	// Seconds an idle client is reused, the storage service closes idle connections after 60
+
+class HttpThreadClients;
+
+/**
+ * The HTTP clients used by the threads of a storage client. Each thread
+ * has a client of its own, and so a persistent connection of its own to
+ * the storage service.
+ *
+ * The client of a thread is cached in thread local storage, finding it
+ * takes no lock. The pool lock is only taken the first time a thread
+ * uses the pool and when the thread exits.
+ *
+ * The pool owns the clients. When a thread exits its client is returned
+ * to the pool and handed to the next thread that uses the pool, up to
+ * HTTP_CLIENT_POOL_SIZE idle clients are kept. A client that has been
+ * idle for longer than HTTP_CLIENT_IDLE_TIMEOUT is not reused, as the
+ * storage service will have closed its connection.
+ *
+ * Pools are created with create() as the thread local storage of each
+ * thread refers back to the pool.
+ */
+class HttpClientPool : public std::enable_shared_from_this<HttpClientPool> {
+	public:
+		static std::shared_ptr<HttpClientPool>
+				create(const std::string& url);
+		~HttpClientPool();
+		HttpClient	*client();
+		void		adopt(HttpClient *client);
+		bool		remove();
+		int		nextSequence();
+		size_t		size();
+		size_t		idle();
+	private:
+		friend class HttpThreadClients;
+		/**
+		 * The client used by a thread, held in the thread local
+		 * storage of the thread
+		 */
+		class ThreadClient {
+			public:
+				unsigned long			pool;
+				std::weak_ptr<HttpClientPool>	owner;
+				HttpClient			*client;
+				int				seqnum;
+		};
+		HttpClientPool(const std::string& url);
+		ThreadClient	*lookup();
+		ThreadClient	*attach(HttpClient *client, int seqnum);
+		HttpClient	*checkout(int& seqnum);
+		void		checkin(HttpClient *client, int seqnum);
+		const std::string
+				m_url;
+		const unsigned long
+				m_id;
+		std::mutex	m_mutex;
+		std::set<HttpClient *>
+				m_clients;
+		std::vector<std::pair<HttpClient *, std::chrono::steady_clock::time_point>>
+				m_idle;
+		int		m_seqnum;
+};
+
+#endif
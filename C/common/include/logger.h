@@ -11,9 +11,19 @@
  */
 
 #include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <time.h>
+#include <stdarg.h>
 
 #define PRINT_FUNC	Logger::getLogger()->info("%s:%d", __FUNCTION__, __LINE__);
 
+#define LOG_BUFFER_SIZE		256	// Number of messages that may be waiting to be written
+#define LOG_MESSAGE_SIZE	1000	// Maximum length of a log message
+#define LOG_REPEAT_INTERVAL	10	// Seconds over which repeated messages are suppressed
+
 /**
  * Fledge Logger class used to log to syslog
  *
@@ -22,6 +32,16 @@
  * call debug, info, warn etc. using the instance
  * of the class. TO get that instance call the static
  * method getLogger.
+ *
+ * Messages below the minimum level are rejected before
+ * any formatting is done. Other messages are formatted
+ * into a lock free ring buffer and written to syslog by
+ * a background thread, so a thread that logs never waits
+ * for syslog. If the buffer is full the message is
+ * discarded and the number of discarded messages is
+ * reported once there is space. Identical messages that
+ * are repeated within LOG_REPEAT_INTERVAL seconds are
+ * written once, followed by a count of the repeats.
  */
 class Logger {
 	public:
@@ -36,11 +56,47 @@ class Logger {
 		void fatal(const std::string& msg, ...);
 		void setMinLevel(const std::string& level);
 		std::string& getMinLevel() { return levelString; }
+		void flush();
+		void writeThread();
 	private:
-		std::string 	*format(const std::string& msg, va_list ap);
+		/**
+		 * A message in the ring buffer. The sequence number
+		 * determines if the slot is free or holds a message
+		 * ready to be written.
+		 */
+		struct LogRecord {
+			std::atomic<unsigned long>	sequence;
+			int				priority;
+			char				message[LOG_MESSAGE_SIZE];
+		};
+		bool		log(int priority, const char *prefix, const std::string& msg, va_list ap);
+		bool		writeRecord();
+		void		write(int priority, const char *message);
+		void		writeRepeats();
+		void		writeDiscarded();
 		static Logger   *instance;
 		std::string     levelString;
 		int		m_level;
+		LogRecord	*m_ring;
+		std::atomic<unsigned long>
+				m_enqueue;
+		unsigned long	m_dequeue;
+		std::atomic<unsigned long>
+				m_discarded;
+		std::thread	*m_thread;
+		std::atomic<bool>
+				m_running;
+		std::atomic<bool>
+				m_waiting;
+		std::mutex	m_writeMutex;
+		std::mutex	m_waitMutex;
+		std::condition_variable
+				m_cv;
+		// Suppression of repeated messages
+		char		m_last[LOG_MESSAGE_SIZE];
+		int		m_lastPriority;
+		time_t		m_lastTime;
+		unsigned int	m_repeats;
 };
 
 #endif
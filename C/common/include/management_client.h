@@ -17,7 +17,10 @@
 #include <logger.h>
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
 #include <rapidjson/document.h>
 #include <asset_tracking.h>
 #include <json_utils.h>
@@ -122,6 +125,8 @@ class ManagementClient {
 		bool			clearAlert(const std::string& key);
 
 	private:
+		bool			fetchTokenKey(std::string& key);
+		bool			verifyRemoteBearerToken(BearerToken& bearerToken);
 		std::ostringstream 			m_urlbase;
 		std::map<std::thread::id, HttpClient *> m_client_map;
 		HttpClient				*m_client;
@@ -133,8 +138,16 @@ class ManagementClient {
 		std::string				m_bearer_token;
 		// Map of received and verified access bearer tokens from other microservices
 		std::map<std::string, BearerToken> 	m_received_tokens;
-		// m_received_tokens lock
+		// m_received_tokens lock, also guards the members below
 		std::mutex 				m_mtx_rTokens;
+		// Signalled when the verification of a token completes
+		std::condition_variable			m_cv_rTokens;
+		// Tokens currently being verified
+		std::set<std::string>			m_verifying_tokens;
+		// The key used to validate service bearer tokens locally
+		std::string				m_token_key;
+		bool					m_token_key_fetched;
+		bool					m_token_key_fetching;
 		// m_client_map lock
 		std::mutex				m_mtx_client_map;
 		// Get and set bearer token mutex
@@ -27,9 +27,11 @@ class PythonReading : public Reading {
 		static bool		doneNumPyImport;
 
 	private:
-		PyObject		*convertDatapoint(Datapoint *dp, bool bytesString = false);
-		DatapointValue		*getDatapointValue(PyObject *object);
-		void 			fixQuoting(std::string& str);
-		int			InitNumPy();
+		static PyObject		*convertDatapoint(Datapoint *dp, bool bytesString = false);
+		static DatapointValue	*getDatapointValue(PyObject *object);
+		static void 		fixQuoting(std::string& str);
+		static int		InitNumPy();
+
+		friend class PythonReadingSet;
 };
 #endif
@@ -16,13 +16,25 @@
 /**
  * A wrapper class for the ReadingSet class that allows conversion
  * to and from Python objects.
+ *
+ * As well as a list with a dict per reading the readings may be
+ * converted to a columnar form. This is a list of blocks, each of
+ * which holds consecutive readings of a single asset that have the
+ * same datapoints. Integer and floating point datapoints of a block
+ * are passed as numpy arrays, so no Python object is created for
+ * each value.
  */
 class PythonReadingSet : public ReadingSet {
 	public:
 		PythonReadingSet(PyObject *pySet);
 		~PythonReadingSet() {};
 		PyObject	*toPython(bool changeKeys = false);
+		PyObject	*toColumns();
+		static bool	isColumns(PyObject *pySet);
 	private:
 		void setReadingAttr(Reading* newReading, PyObject *readingList, bool fillIfMissing);
+		bool		sameLayout(Reading *first, Reading *reading);
+		PyObject	*columnBlock(size_t start, size_t end);
+		void		fromColumnBlock(PyObject *block);
 };
 #endif
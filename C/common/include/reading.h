@@ -37,12 +37,14 @@ class Reading {
 		Reading(const std::string& asset, std::vector<Datapoint *> values, const std::string& ts);
 		Reading(const std::string& asset, const std::string& datapoints);
 		Reading(const Reading& orig);
+		Reading(Reading&& orig);
 
 		~Reading();	// This should bbe virtual
 		void				addDatapoint(Datapoint *value);
 		Datapoint			*removeDatapoint(const std::string& name);
 		Datapoint			*getDatapoint(const std::string& name) const;
 		std::string			toJSON(bool minimal = false) const;
+		void				toJSON(std::string& convert, bool minimal = false) const;
 		std::string			getDatapointsJSON() const;
 		// Return AssetName
 		const std::string&              getAssetName() const { return m_asset; };
@@ -80,6 +82,8 @@ class Reading {
 		Reading() {};
 		Reading&			operator=(Reading const&);
 		void				stringToTimestamp(const std::string& timestamp, struct timeval *ts);
+		size_t				formatTimestamp(const struct timeval& tv, char *buffer,
+							readingTimeFormat dateFormat, bool addMS) const;
 		const std::string		escape(const std::string& str) const;
 		std::vector<Datapoint *>	*JSONtoDatapoints(const rapidjson::Value& json);
 		unsigned long			m_id;
@@ -27,6 +27,7 @@ class ReadingSet {
 	public:
 		ReadingSet();
 		ReadingSet(const std::string& json);
+		ReadingSet(const char *block, size_t length);
 		ReadingSet(const std::vector<Reading *>* readings);
 		virtual ~ReadingSet();
 
@@ -47,6 +48,8 @@ class ReadingSet {
 		
 		// Return the reading id of the last  data element
 		unsigned long			getLastId() const { return m_last_id; };
+		// Set the reading id the set accounts for, when its readings have no ids
+		void				setLastId(unsigned long id) { m_last_id = id; };
 		unsigned long			getReadingId(uint32_t pos);
 		void				append(ReadingSet *);
 		void				append(ReadingSet&);
@@ -72,6 +75,9 @@ class ReadingSet {
 class JSONReading : public Reading {
 	public:
 		JSONReading(const rapidjson::Value& json);
+		JSONReading(unsigned long id, const std::string& asset,
+				const struct timeval& userTs, const struct timeval& ts,
+				const char *payload);
 		~JSONReading() {};
 
 		// Return the reading id
@@ -79,7 +85,8 @@ class JSONReading : public Reading {
 
 	private:
 		Datapoint 	*datapoint(const std::string& name, const rapidjson::Value& json);
-                void 		escapeCharacter(std::string& stringToEvaluate, std::string pattern);
+		Datapoint	*blobDatapoint(const std::string& name, const std::string& reference);
+		void		readingValue(const rapidjson::Value& reading);
 };
 
 class ReadingSetException : public std::exception
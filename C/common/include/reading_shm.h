@@ -0,0 +1,116 @@
+#ifndef _READING_SHM_H
+#define _READING_SHM_H
+/*
+ * Fledge storage shared memory reading transport.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+#define SHM_RING_MAGIC		0x52444d52
+#define SHM_RING_SIZE		(4 * 1024 * 1024)	// Size of the data area of each ring
+#define SHM_TIMEOUT		30000			// Milliseconds to wait for a response
+#define SHM_ALIGN(x)		(((x) + 7) & ~((size_t)7))
+
+/**
+ * The message types exchanged over a shared memory channel
+ */
+enum ShmMessageType {
+	ShmPad = 0,		// Padding to the end of the ring
+	ShmAppend,		// Append readings, payload is ShmAppendHeader and ReadingStream records
+	ShmFetch,		// Fetch readings, payload is ShmFetchRequest
+	ShmAppendResult,	// Result of an append, payload is ShmResult
+	ShmFetchResult,		// Result of a fetch, payload is an RDSFetchHeader block
+	ShmError		// Request failed, payload is ShmResult
+};
+
+typedef struct {
+	uint32_t	type;
+	uint32_t	length;		// Length of the payload that follows
+} ShmMessage;
+
+typedef struct {
+	uint32_t	count;
+	uint32_t	pad;
+} ShmAppendHeader;
+
+typedef struct {
+	uint64_t	id;
+	uint32_t	count;
+	uint32_t	pad;
+} ShmFetchRequest;
+
+typedef struct {
+	int32_t		status;
+	uint32_t	pad;
+} ShmResult;
+
+/**
+ * The control header at the start of each ring. The head and tail
+ * are byte positions that only ever increase, the offset in the ring
+ * is the position modulo the ring size.
+ */
+typedef struct {
+	uint32_t		magic;
+	uint32_t		size;
+	std::atomic<uint64_t>	head;
+	std::atomic<uint64_t>	tail;
+} ShmRingHeader;
+
+/**
+ * A single producer, single consumer ring of variable length messages
+ * held in shared memory. Messages are always contiguous in the ring,
+ * a padding message is used to skip the end of the ring if a message
+ * will not fit in the remaining space.
+ */
+class ShmRing {
+	public:
+		ShmRing(void *base, bool initialise);
+		void		*reserve(uint32_t type, uint32_t length);
+		void		commit();
+		ShmMessage	*peek();
+		void		release();
+		size_t		capacity() const { return m_header->size - sizeof(ShmMessage); };
+		static size_t	mappedSize() { return sizeof(ShmRingHeader) + SHM_RING_SIZE; };
+	private:
+		ShmRingHeader	*m_header;
+		char		*m_data;
+		uint64_t	m_reserved;
+};
+
+/**
+ * A shared memory channel between the storage service and a
+ * co-located client. The channel is a memfd holding a request ring
+ * and a response ring, with an eventfd used to signal each of them.
+ * The storage service creates the channel and passes the descriptors
+ * to the client over a Unix domain socket.
+ */
+class ShmChannel {
+	public:
+		ShmChannel();
+		~ShmChannel();
+		bool		create();
+		bool		attach(int memfd, int requestfd, int responsefd);
+		bool		sendDescriptors(int socket);
+		static bool	receiveDescriptors(int socket, int *memfd, int *requestfd, int *responsefd);
+		ShmRing		*request() { return m_request; };
+		ShmRing		*response() { return m_response; };
+		int		requestEvent() { return m_requestfd; };
+		int		responseEvent() { return m_responsefd; };
+		void		signal(int eventfd);
+		bool		wait(int eventfd, int timeout);
+	private:
+		bool		map();
+		int		m_memfd;
+		int		m_requestfd;
+		int		m_responsefd;
+		void		*m_base;
+		ShmRing		*m_request;
+		ShmRing		*m_response;
+};
+#endif
@@ -15,6 +15,7 @@
 #define	RDS_READING_MAGIC	0x52444947
 #define RDS_ACK_MAGIC		0x4241434b
 #define RDS_NACK_MAGIC		0x4e41434b
+#define RDS_FETCH_MAGIC		0x52444654
 
 typedef struct {
 	uint32_t	magic;
@@ -46,5 +47,25 @@ typedef struct {
 	char		assetCode[1];
 } ReadingStream;
 
+/*
+ * Binary block of readings returned by a readings fetch. The block
+ * starts with an RDSFetchHeader and is followed by count records,
+ * each an RDSFetchReading immediately followed by the asset code and
+ * the reading payload. The asset and payload lengths include a
+ * terminating null. Records are packed, with no alignment padding.
+ */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	count;
+} RDSFetchHeader;
+
+typedef struct {
+	uint64_t	id;
+	struct timeval	userTs;
+	struct timeval	ts;
+	uint32_t	assetLength;
+	uint32_t	payloadLength;
+} RDSFetchReading;
+
 #endif
 
@@ -0,0 +1,31 @@
+#ifndef _RESULT_STREAM_H
+#define _RESULT_STREAM_H
+/*
+ * Fledge storage streamed query result definitions.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <stddef.h>
+
+#define RESULT_STREAM_ROWS	500	// Rows passed to the result stream callback in each call
+
+/**
+ * Callback used by a storage plugin to pass the rows of a query result
+ * to the storage service as the plugin iterates over the result. The
+ * rows are passed as a comma separated sequence of JSON row objects.
+ *
+ * The callback returns false if the query should be abandoned, for
+ * example because the client is no longer connected.
+ *
+ * @param data		The data registered with the callback
+ * @param rows		The JSON row objects
+ * @param length	The length of the rows
+ * @param count		The number of rows
+ */
+typedef bool (*RESULT_STREAM_CB)(void *data, const char *rows, size_t length, unsigned int count);
+
+#endif
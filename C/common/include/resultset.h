@@ -28,9 +28,21 @@ typedef enum column_type {
 
 /**
  * Result set
+ *
+ * A result set may be constructed with one of two layouts. The Rows
+ * layout creates a ColumnValue for every cell as the result set is
+ * constructed. The Columns layout retains the parsed response document
+ * and gives access to the cells via a ColumnView per column, the view
+ * refers to the values within the document rather than copying them.
+ * The views are created when a column is first accessed and are
+ * allocated from the allocator of the document, which therefore acts
+ * as a single arena for the result set. The row API may still be used
+ * with the Columns layout, the rows are then created on first use.
  */
 class ResultSet {
 	public:
+		enum Layout { Rows, Columns };
+
 		class ColumnValue {
 			public:
 				ColumnValue(const std::string& value)
@@ -116,10 +128,39 @@ class ResultSet {
 				const ResultSet				*m_resultSet;
 		};
 
+		/**
+		 * A typed view of a single column of a result set
+		 * constructed with the Columns layout.
+		 */
+		class ColumnView {
+			public:
+				ColumnView(const std::string& name, ColumnType type,
+						const rapidjson::Value **cells, unsigned int count) :
+						m_name(name), m_type(type), m_cells(cells), m_count(count) {};
+				const std::string&	getName() const { return m_name; };
+				ColumnType		getType() const { return m_type; };
+				unsigned int		size() const { return m_count; };
+				bool			isNull(unsigned int row) const;
+				long			getInteger(unsigned int row) const;
+				double			getNumber(unsigned int row) const;
+				const char		*getString(unsigned int row) const;
+				const rapidjson::Value	*getJSON(unsigned int row) const;
+			private:
+				ColumnView(const ColumnView&);
+				ColumnView&		operator=(ColumnView const&);
+				const rapidjson::Value	*cell(unsigned int row) const;
+				const std::string	m_name;
+				ColumnType		m_type;
+				const rapidjson::Value	**m_cells;
+				unsigned int		m_count;
+		};
+
 		typedef std::vector<Row *>::iterator RowIterator;
 
 		ResultSet(const std::string& json);
+		ResultSet(const std::string& json, Layout layout);
 		~ResultSet();
+		Layout				layout() const { return m_layout; };
 		unsigned int			rowCount() const { return m_rowCount; };
 		unsigned int			columnCount() const { return m_columns.size(); };
 		const std::string&		columnName(unsigned int column) const;
@@ -131,12 +172,18 @@ class ResultSet {
 		bool				hasNextRow(RowIterator it) const;
 		unsigned int			findColumn(const std::string& name) const;
 		const Row *			operator[] (unsigned long rowNo) {
+							materialiseRows();
 							return m_rows[rowNo];
 						};
+		const ColumnView&		column(unsigned int column);
+		const ColumnView&		column(const std::string& name);
 
 	private:
 		ResultSet(const ResultSet &);
 		ResultSet&			operator=(ResultSet const&);
+		void				parse(rapidjson::Document& doc);
+		void				appendRow(const rapidjson::Value& row);
+		void				materialiseRows();
 		class Column {
 			public:
 				Column(const std::string& name, ColumnType type) : m_name(name), m_type(type) {};
@@ -151,6 +198,12 @@ class ResultSet {
 		unsigned int				m_rowCount;
 		std::vector<ResultSet::Column *>	m_columns;
 		std::vector<ResultSet::Row *>		m_rows;
+		Layout					m_layout;
+		char					*m_buffer;	// In situ parse buffer of m_doc
+		rapidjson::Document			*m_doc;		// Retained document of the Columns layout
+		const rapidjson::Value			*m_docRows;
+		bool					m_materialised;
+		std::vector<ResultSet::ColumnView *>	m_views;
 
 };
 
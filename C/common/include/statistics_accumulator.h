@@ -0,0 +1,84 @@
+#ifndef _STATISTICS_ACCUMULATOR_H
+#define _STATISTICS_ACCUMULATOR_H
+/*
+ * Fledge statistics accumulator
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <storage_client.h>
+#include <logger.h>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define STATS_DEFAULT_FLUSH_INTERVAL	5	// Seconds between flushes of the statistics
+#define STATS_DEFAULT_FAIL_THRESHOLD	3	// Failed flushes before the statistics rows are recreated
+
+/**
+ * Accumulate increments to the counters held in the statistics table
+ * and write them to the storage service as a single multi-row update.
+ *
+ * The pending increments are flushed when the flush interval expires,
+ * or earlier if a flush count has been set and the total of the pending
+ * increments reaches that count. After a failed flush the flush count
+ * is ignored until the next flush interval, so a storage service that
+ * is failing is not retried continuously. Counters that are defined with a
+ * description have their row created in the statistics table, if it
+ * does not already exist, before they are first updated.
+ *
+ * A single accumulator is shared by all the threads of a service that
+ * update statistics.
+ */
+class StatisticsAccumulator {
+	public:
+		StatisticsAccumulator(StorageClient *storage, const std::string& table = "statistics");
+		~StatisticsAccumulator();
+		void		define(const std::string& key, const std::string& description);
+		void		increment(const std::string& key, unsigned long value = 1);
+		void		setFlushInterval(unsigned int seconds) { m_interval = seconds; };
+		void		setFlushCount(unsigned long count);
+		void		setFailureThreshold(int threshold) { m_failureThreshold = threshold; };
+		unsigned long	pending();
+		bool		flush();
+		void		start();
+		void		stop();
+		void		flushThread();
+	private:
+		void		createRows(const std::map<std::string, unsigned long> *counters);
+		bool		createRow(const std::string& key, const std::string& description);
+	private:
+		StorageClient	*m_storage;
+		const std::string
+				m_table;
+		Logger		*m_logger;
+		// Pending increments and their total
+		std::map<std::string, unsigned long>
+				m_pending;
+		unsigned long	m_pendingCount;
+		// Counters to create and their descriptions
+		std::unordered_map<std::string, std::string>
+				m_definitions;
+		// Counters known to exist in the statistics table
+		std::unordered_set<std::string>
+				m_created;
+		std::mutex	m_mutex;
+		std::mutex	m_flushMutex;
+		std::condition_variable
+				m_cv;
+		std::thread	*m_thread;
+		bool		m_running;
+		unsigned int	m_interval;
+		unsigned long	m_flushCount;
+		int		m_failures;
+		bool		m_backoff;	// The last flush failed
+		int		m_failureThreshold;
+};
+#endif
@@ -23,6 +23,12 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <reading_shm.h>
+#include <storage_query_stream.h>
+#include <http_client_pool.h>
+#include <memory>
 
 using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
 
@@ -35,6 +41,8 @@ using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
 
 #define DEFAULT_SCHEMA 	"fledge"
 
+#define BLOB_THRESHOLD		(64 * 1024)	// Image and buffer datapoints of this size or larger are sent to the blob store
+
 class ManagementClient;
 
 /**
@@ -47,7 +55,13 @@ class StorageClient {
 		~StorageClient();
 		ResultSet	*queryTable(const std::string& schema, const std::string& tablename, const Query& query);
 		ResultSet	*queryTable(const std::string& tablename, const Query& query);
+		ResultSet	*queryTable(const std::string& schema, const std::string& tablename,
+					const Query& query, ResultSet::Layout layout);
+		ResultSet	*queryTable(const std::string& tablename, const Query& query,
+					ResultSet::Layout layout);
 		ReadingSet	*queryTableToReadings(const std::string& tableName, const Query& query);
+		long		queryTableRows(const std::string& tableName, const Query& query,
+					STORAGE_ROW_CB callback, void *data);
 		int 		insertTable(const std::string& schema, const std::string& tableName, const InsertValues& values);
 		int             insertTable(const std::string& schema, const std::string& tableName,
                                                 const std::vector<InsertValues>& values);
@@ -86,11 +100,15 @@ class StorageClient {
 					const UpdateModifier *modifier = NULL);
 
 		int		deleteTable(const std::string& tableName, const Query& query);
+		int		statisticsHistory();
+		int		statisticsHistoryPurge(unsigned long age, unsigned int limit);
 		bool		readingAppend(Reading& reading);
 		bool		readingAppend(const std::vector<Reading *> & readings);
+		bool		lastAppendIndeterminate();
 		ResultSet	*readingQuery(const Query& query);
 		ReadingSet 	*readingQueryToReadings(const Query& query);
 		ReadingSet	*readingFetch(const unsigned long readingId, const unsigned long count);
+		ReadingSet	*readingFetchBinary(const unsigned long readingId, const unsigned long count);
 		PurgeResult	readingPurgeByAge(unsigned long age, unsigned long sent, bool purgeUnsent);
 		PurgeResult	readingPurgeBySize(unsigned long size, unsigned long sent, bool purgeUnsent);
 		PurgeResult	readingPurgeByAsset(const std::string& asset);
@@ -103,8 +121,11 @@ class StorageClient {
 		bool		unregisterTableNotification(const std::string& tableName, const std::string& key, 
 								std::vector<std::string> keyValues, const std::string& operation, const std::string& callbackUrl);
 		void		registerManagement(ManagementClient *mgmnt) { m_management = mgmnt; };
+		void		setSharedMemory(bool enable);
 		bool 		createSchema(const std::string&);
 		bool		deleteHttpClient();
+		std::string	putBlob(const void *data, size_t length);
+		bool		getBlob(const std::string& blob, void *buffer, size_t length);
 
 	private:
 		void		handleUnexpectedResponse(const char *operation,
@@ -118,20 +139,35 @@ class StorageClient {
 		HttpClient 	*getHttpClient(void);
 		bool		openStream();
 		bool		streamReadings(const std::vector<Reading *> & readings);
+		bool		openShmChannel();
+		void		closeShmChannel();
+		ShmMessage	*shmExchange();
+		int		shmAppend(const std::vector<Reading *>& readings);
+		ReadingSet	*shmFetch(const unsigned long readingId, const unsigned long count, bool& handled);
+		void		externaliseBlobs(const std::vector<Reading *>& readings);
+		long		streamRows(const char *operation, const std::string& url,
+					const std::string& payload, STORAGE_ROW_CB callback, void *data);
 
 		std::ostringstream 			m_urlbase;
 		std::string				m_host;
-		std::map<std::thread::id, HttpClient *> m_client_map;
-		std::map<std::thread::id, std::atomic<int>> m_seqnum_map;
+		std::shared_ptr<HttpClientPool>		m_clients;
 		Logger					*m_logger;
 		pid_t					m_pid;
 		bool					m_streaming;
+		std::atomic<bool>			m_binaryFetch;
+		ShmChannel				*m_shm;
+		int					m_shmSocket;
+		bool					m_shmEnabled;
+		bool					m_shmAttempted;
+		bool					m_shmFetch;
+		std::mutex				m_shmMutex;
 		int					m_stream;
 		uint32_t				m_readingBlock;
 		std::string				m_lastException;
 		int					m_exRepeat;
 		int					m_backoff;
 		ManagementClient			*m_management;
+		bool					m_blobStore;
 };
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef _STORAGE_QUERY_STREAM_H
+#define _STORAGE_QUERY_STREAM_H
+/*
+ * Fledge storage service client
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <string>
+#include <rapidjson/document.h>
+
+#define QUERY_STREAM_BUFFER	(64 * 1024)	// Size of the receive buffer of a streamed query
+#define QUERY_STREAM_TIMEOUT	60		// Seconds to wait for data from the storage service
+
+/**
+ * Callback used to pass the rows of a streamed query to the caller
+ *
+ * @param data	The data passed with the query
+ * @param row	The row of the result
+ * @return bool	False if the query should be abandoned
+ */
+typedef bool (*STORAGE_ROW_CB)(void *data, const rapidjson::Value& row);
+
+/**
+ * A query of the storage service whose result rows are passed to a
+ * callback as they are received, rather than once the whole result
+ * has been received and parsed.
+ *
+ * The storage service sends the result using chunked transfer encoding
+ * if the storage plugin supports streamed results. The chunks are parsed
+ * incrementally and only a single row of the result is held in memory
+ * at any time. A result sent with a content length is parsed in the same
+ * way as it arrives.
+ *
+ * The class also acts as the rapidjson input stream over the body of the
+ * response.
+ */
+class StorageQueryStream {
+	public:
+		StorageQueryStream(const std::string& host, unsigned short port);
+		~StorageQueryStream();
+		long			query(const std::string& method, const std::string& url,
+						const std::string& payload,
+						STORAGE_ROW_CB callback, void *data);
+		const std::string&	getStatus() const { return m_status; };
+		const std::string&	getBody() const { return m_body; };
+
+		// rapidjson input stream
+		typedef char Ch;
+		Ch			Peek();
+		Ch			Take();
+		size_t			Tell() const { return m_tell; };
+		Ch			*PutBegin() { return 0; };
+		void			Put(Ch) {};
+		void			Flush() {};
+		size_t			PutEnd(Ch *) { return 0; };
+	private:
+		bool			connect();
+		bool			sendRequest(const std::string& method, const std::string& url,
+						const std::string& payload);
+		bool			readHeaders();
+		bool			readLine(std::string& line);
+		bool			fill();
+		bool			nextChunk();
+		long			parseRows(STORAGE_ROW_CB callback, void *data);
+		std::string		m_host;
+		unsigned short		m_port;
+		int			m_socket;
+		char			m_buffer[QUERY_STREAM_BUFFER];
+		size_t			m_pos;
+		size_t			m_length;
+		bool			m_chunked;
+		bool			m_firstChunk;
+		size_t			m_remaining;	// Bytes of the body or current chunk not yet read
+		bool			m_end;
+		size_t			m_tell;
+		std::string		m_status;
+		std::string		m_body;
+};
+
+#endif
@@ -35,6 +35,10 @@ void StringStripQuotes(std::string& StringToManage);
 std::string urlEncode(const std::string& s);
 std::string urlDecode(const std::string& s);
 void StringEscapeQuotes(std::string& s);
+size_t StringScan(const char *str, size_t length, char c1, char c2);
+void StringAppendEscapedQuotes(std::string& out, const std::string& str);
+std::string StringEscapeJSON(const std::string& str);
+std::string StringEscapeSQL(const std::string& str);
 
 char *trim(char *str);
 std::string StringLTrim(const std::string& str);
@@ -46,5 +50,11 @@ bool IsRegex(const std::string &str);
 std::string StringAround(const std::string& str, unsigned int pos,
 		unsigned int after = 30, unsigned int before = 10);
 
+#define NUMBER_BUFFER_LEN	32
+
+size_t FormatUnsignedLong(char *buffer, unsigned long value, unsigned int width = 0);
+size_t FormatLong(char *buffer, long value);
+size_t FormatDouble(char *buffer, size_t size, double value, int precision, bool trim = true);
+
 
 #endif
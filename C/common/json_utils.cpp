@@ -12,6 +12,7 @@
 #include <string>
 #include <vector>
 #include "json_utils.h"
+#include "string_utils.h"
 #include "rapidjson/document.h"
 
 using namespace std;
@@ -96,34 +97,44 @@ string escaped = subject;
 std::string JSONunescape(const std::string& input)
 {
 	std::string output;
+	const char *p = input.data();
 	size_t inputSize = input.size();
 	output.reserve(inputSize);
 
-	for (size_t i = 0; i < inputSize; ++i)
+	// skip leading "
+	size_t i = (inputSize && p[0] == '"') ? 1 : 0;
+	while (i < inputSize)
 	{
-		// skip leading or trailing "
-		if ((i == 0 || i == inputSize -1) && input[i] == '"')
+		// Copy everything up to the next backslash as a whole
+		size_t pos = i + StringScan(p + i, inputSize - i, '\\', '\\');
+		if (pos == inputSize)
 		{
-			continue;
+			// skip trailing "
+			size_t end = p[inputSize - 1] == '"' ? inputSize - 1 : inputSize;
+			output.append(p + i, end - i);
+			break;
 		}
+		output.append(p + i, pos - i);
+		i = pos;
 
 		// \\\" -> \"
-		if (input[i] == '\\' && i + 3 < inputSize && input[i + 1] == '\\' && input[i + 2] == '\\' && input[i + 3] == '"')
+		if (i + 3 < inputSize && p[i + 1] == '\\' && p[i + 2] == '\\' && p[i + 3] == '"')
 		{
 			output.push_back('\\');
 			output.push_back('"');
-			i += 3;
+			i += 4;
 		}
 		// \\" -> \"
 		// \" -> "
-		else if (input[i] == '\\' && i + 1 < inputSize && input[i + 1] == '"')
+		else if (i + 1 < inputSize && p[i + 1] == '"')
 		{
 			output.push_back('"');
-			++i;
+			i += 2;
 		}
 		else
 		{
-			output.push_back(input[i]);
+			output.push_back('\\');
+			i++;
 		}
 	}
 
@@ -9,12 +9,14 @@
  */
 #include <logger.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <syslog.h>
 #include <stdarg.h>
 #include <memory>
 #include <string.h>
 #include <sys/time.h>
+#include <chrono>
 
 using namespace std;
 
@@ -30,9 +32,20 @@ inline long getCurrTimeUsec()
 
 Logger *Logger::instance = 0;
 
+/**
+ * Thread entry point for the thread that writes to syslog
+ *
+ * @param logger	The logger whose messages are written
+ */
+static void loggerThread(Logger *logger)
+{
+	logger->writeThread();
+}
+
 Logger::Logger(const string& application)
 {
 static char ident[80];
+static bool registered = false;
 
 	/* Prepend "Fledge " in all casaes other than Fledge itelf and Fledge Storage..
 	 */
@@ -47,14 +60,49 @@ static char ident[80];
 	openlog(ident, LOG_PID|LOG_CONS, LOG_USER);
 	instance = this;
 	m_level = LOG_WARNING;
+
+	m_ring = new LogRecord[LOG_BUFFER_SIZE];
+	for (unsigned long i = 0; i < LOG_BUFFER_SIZE; i++)
+	{
+		m_ring[i].sequence.store(i, memory_order_relaxed);
+	}
+	m_enqueue = 0;
+	m_dequeue = 0;
+	m_discarded = 0;
+	m_last[0] = 0;
+	m_lastPriority = -1;
+	m_lastTime = 0;
+	m_repeats = 0;
+	m_waiting = false;
+	m_running = true;
+	m_thread = new thread(loggerThread, this);
+
+	if (!registered)
+	{
+		// Write any queued messages when the process exits
+		atexit([]() {
+			if (instance)
+				instance->flush();
+		});
+		registered = true;
+	}
 }
 
 Logger::~Logger()
 {
+	{
+		lock_guard<mutex> guard(m_waitMutex);
+		m_running = false;
+	}
+	m_cv.notify_all();
+	m_thread->join();
+	delete m_thread;
+	flush();
 	closelog();
 	// Stop the getLogger() call returning a deleted instance
 	if (instance == this)
 		instance = NULL;
+	delete[] m_ring;
 }
 
 Logger *Logger::getLogger()
@@ -100,15 +148,13 @@ void Logger::setMinLevel(const string& level)
 
 void Logger::debug(const string& msg, ...)
 {
-	if (m_level == LOG_ERR || m_level == LOG_WARNING || m_level == LOG_INFO)
+	if (LOG_DEBUG > m_level)
 	{
 		return;
 	}
 	va_list args;
 	va_start(args, msg);
-	string *fmt = format(msg, args);
-	syslog(LOG_DEBUG, "DEBUG: %s", fmt->c_str());
-	delete fmt;
+	log(LOG_DEBUG, "DEBUG: ", msg, args);
 	va_end(args);
 }
 
@@ -123,19 +169,19 @@ void Logger::printLongString(const string& s)
 
 void Logger::info(const string& msg, ...)
 {
-	if (m_level == LOG_ERR || m_level == LOG_WARNING)
+	if (LOG_INFO > m_level)
 	{
 		return;
 	}
 	va_list args;
 	va_start(args, msg);
-	string *fmt = format(msg, args);
 #ifdef ADD_USEC_TS
-	syslog(LOG_INFO, "[.%06ld] INFO: %s", getCurrTimeUsec(), fmt->c_str());
+	char prefix[40];
+	snprintf(prefix, sizeof(prefix), "[.%06ld] INFO: ", getCurrTimeUsec());
+	log(LOG_INFO, prefix, msg, args);
 #else
-	syslog(LOG_INFO, "INFO: %s", fmt->c_str());
+	log(LOG_INFO, "INFO: ", msg, args);
 #endif
-	delete fmt;
 	va_end(args);
 }
 
@@ -143,9 +189,7 @@ void Logger::warn(const string& msg, ...)
 {
 	va_list args;
 	va_start(args, msg);
-	string *fmt = format(msg, args);
-	syslog(LOG_WARNING, "WARNING: %s", fmt->c_str());
-	delete fmt;
+	log(LOG_WARNING, "WARNING: ", msg, args);
 	va_end(args);
 }
 
@@ -153,30 +197,206 @@ void Logger::error(const string& msg, ...)
 {
 	va_list args;
 	va_start(args, msg);
-	string *fmt = format(msg, args);
 #ifdef ADD_USEC_TS
-		syslog(LOG_ERR, "[.%06ld] ERROR: %s", getCurrTimeUsec(), fmt->c_str());
+	char prefix[40];
+	snprintf(prefix, sizeof(prefix), "[.%06ld] ERROR: ", getCurrTimeUsec());
+	log(LOG_ERR, prefix, msg, args);
 #else
-		syslog(LOG_ERR, "ERROR: %s", fmt->c_str());
+	log(LOG_ERR, "ERROR: ", msg, args);
 #endif
-	delete fmt;
 	va_end(args);
 }
 
+/**
+ * Log a fatal message. As the process may be about to terminate
+ * the message, and any queued before it, are written before
+ * returning.
+ */
 void Logger::fatal(const string& msg, ...)
 {
 	va_list args;
 	va_start(args, msg);
-	string *fmt = format(msg, args);
-	syslog(LOG_CRIT, "FATAL: %s", fmt->c_str());
-	delete fmt;
+	if (!log(LOG_CRIT, "FATAL: ", msg, args))
+	{
+		va_end(args);
+		va_start(args, msg);
+		char buf[LOG_MESSAGE_SIZE];
+		vsnprintf(buf, sizeof(buf), msg.c_str(), args);
+		syslog(LOG_CRIT, "FATAL: %s", buf);
+	}
 	va_end(args);
+
+	// Do not wait if the writer is held, we may be called from a
+	// signal handler that has interrupted the thread that holds it
+	unique_lock<mutex> lck(m_writeMutex, try_to_lock);
+	if (lck.owns_lock())
+	{
+		while (writeRecord());
+		writeRepeats();
+		writeDiscarded();
+	}
+}
+
+/**
+ * Format a message into the next free slot of the ring buffer.
+ * Slots are claimed without locking, if the buffer is full the
+ * message is discarded rather than waiting for the writer.
+ *
+ * @param priority	The syslog priority of the message
+ * @param prefix	The level prefix of the message
+ * @param msg		The printf format of the message
+ * @param ap		The arguments of the message
+ * @return bool		True if the message was queued
+ */
+bool Logger::log(int priority, const char *prefix, const string& msg, va_list ap)
+{
+	unsigned long pos = m_enqueue.load(memory_order_relaxed);
+	LogRecord *record;
+	for (;;)
+	{
+		record = &m_ring[pos % LOG_BUFFER_SIZE];
+		unsigned long seq = record->sequence.load(memory_order_acquire);
+		long diff = (long)seq - (long)pos;
+		if (diff == 0)
+		{
+			if (m_enqueue.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// The writer has not yet freed this slot
+			m_discarded++;
+			return false;
+		}
+		else
+		{
+			pos = m_enqueue.load(memory_order_relaxed);
+		}
+	}
+
+	record->priority = priority;
+	int len = snprintf(record->message, LOG_MESSAGE_SIZE, "%s", prefix);
+	if (len < 0 || len >= LOG_MESSAGE_SIZE)
+		len = 0;
+	vsnprintf(record->message + len, LOG_MESSAGE_SIZE - len, msg.c_str(), ap);
+	record->sequence.store(pos + 1, memory_order_release);
+
+	if (m_waiting.load(memory_order_acquire))
+	{
+		m_cv.notify_one();
+	}
+	return true;
+}
+
+/**
+ * Write the oldest queued message, if it is ready, to syslog.
+ * The caller must hold m_writeMutex.
+ *
+ * @return bool	True if a message was written
+ */
+bool Logger::writeRecord()
+{
+	LogRecord *record = &m_ring[m_dequeue % LOG_BUFFER_SIZE];
+	if (record->sequence.load(memory_order_acquire) != m_dequeue + 1)
+	{
+		return false;
+	}
+	write(record->priority, record->message);
+	record->sequence.store(m_dequeue + LOG_BUFFER_SIZE, memory_order_release);
+	m_dequeue++;
+	return true;
+}
+
+/**
+ * Write a message to syslog, suppressing messages that repeat the
+ * previous message within LOG_REPEAT_INTERVAL seconds
+ *
+ * @param priority	The syslog priority of the message
+ * @param message	The formatted message
+ */
+void Logger::write(int priority, const char *message)
+{
+	time_t now = time(0);
+	if (priority == m_lastPriority && now - m_lastTime < LOG_REPEAT_INTERVAL
+			&& strcmp(message, m_last) == 0)
+	{
+		m_repeats++;
+		return;
+	}
+	writeRepeats();
+	syslog(priority, "%s", message);
+	strncpy(m_last, message, LOG_MESSAGE_SIZE);
+	m_last[LOG_MESSAGE_SIZE - 1] = 0;
+	m_lastPriority = priority;
+	m_lastTime = now;
+}
+
+/**
+ * Report the number of times the previous message has been suppressed
+ */
+void Logger::writeRepeats()
+{
+	if (m_repeats)
+	{
+		syslog(m_lastPriority, "%s (repeated %u times)", m_last, m_repeats);
+		m_repeats = 0;
+	}
+}
+
+/**
+ * Report the number of messages discarded because the ring buffer was full
+ */
+void Logger::writeDiscarded()
+{
+	unsigned long discarded = m_discarded.exchange(0);
+	if (discarded)
+	{
+		syslog(LOG_WARNING, "WARNING: %lu log messages were discarded as the log buffer was full",
+				discarded);
+	}
 }
 
-string *Logger::format( const std::string& format, va_list args)
+/**
+ * Write all the queued messages to syslog before returning
+ */
+void Logger::flush()
 {
-char	buf[1000];
+	lock_guard<mutex> guard(m_writeMutex);
+	while (writeRecord());
+	writeRepeats();
+	writeDiscarded();
+}
 
-	  vsnprintf(buf, sizeof(buf), format.c_str(), args);
-	  return new string(buf);
+/**
+ * The thread that writes queued messages to syslog
+ */
+void Logger::writeThread()
+{
+	while (m_running)
+	{
+		bool written = false;
+		{
+			lock_guard<mutex> guard(m_writeMutex);
+			while (writeRecord())
+			{
+				written = true;
+			}
+			writeDiscarded();
+			if (!written && m_repeats && time(0) - m_lastTime >= LOG_REPEAT_INTERVAL)
+			{
+				writeRepeats();
+				m_lastPriority = -1;
+			}
+		}
+		if (!written)
+		{
+			unique_lock<mutex> lck(m_waitMutex);
+			m_waiting = true;
+			if (m_running)
+			{
+				m_cv.wait_for(lck, chrono::milliseconds(100));
+			}
+			m_waiting = false;
+		}
+	}
 }
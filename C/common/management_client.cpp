@@ -32,7 +32,8 @@ using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
  * @param hostname	The hostname of the Fledge core micro service
  * @param port		The port of the management service API listener in the Fledge core
  */
-ManagementClient::ManagementClient(const string& hostname, const unsigned short port) : m_uuid(0)
+ManagementClient::ManagementClient(const string& hostname, const unsigned short port) : m_uuid(0),
+	m_token_key_fetched(false), m_token_key_fetching(false)
 {
 ostringstream urlbase;
 
@@ -1134,6 +1135,12 @@ bool ManagementClient::refreshBearerToken(const string& currentToken,
  * Input token internal data will be set
  * with new values or cached ones
  *
+ * Tokens that are not in the cache are validated locally using
+ * the key fetched from the core, or by the core if the key is not
+ * available or the token fails local validation. If several threads
+ * receive the same new token only one of them verifies it, the others
+ * wait for the result. The lock is not held whilst a token is verified.
+ *
  * @param bearerToken	The bearer token object
  * @return		True on success, false otherwise
  */
@@ -1146,82 +1153,193 @@ bool ManagementClient::verifyBearerToken(BearerToken& bearerToken)
 	}
 
 	bool ret = true;
-	const string& token = bearerToken.token();
-
-	// Check token already exists in cache:
-	map<string, BearerToken>::iterator item;
-	// Acquire lock
-	m_mtx_rTokens.lock();
+	const string token = bearerToken.token();
+	bool waited = false;
 
-	item = m_received_tokens.find(token);
-	if (item  == m_received_tokens.end())
+	unique_lock<mutex> lck(m_mtx_rTokens);
+	while (true)
 	{
-		// Token is not in the cache
-		bool verified = false;
-		// Token does not exist:
-		// Verify it by calling Fledge management endpoint
-		string url = "/fledge/service/verify_token";
-                string payload;
-                SimpleWeb::CaseInsensitiveMultimap header;
-                header.emplace("Authorization", "Bearer " + token);
-                auto res = this->getHttpClient()->request("POST", url.c_str(), payload, header);
-		string response = res->content.string();
-
-		// Parse JSON message and store claims in input token object
-		verified = bearerToken.verify(response);
-		if (verified)
+		// Check token already exists in cache
+		map<string, BearerToken>::iterator item = m_received_tokens.find(token);
+		if (item != m_received_tokens.end())
 		{
-			// Token verified, store the token object
-			m_received_tokens.emplace(token, bearerToken);
+			// Token is in the cache
+			unsigned long expiration = (*item).second.getExpiration();
+			unsigned long now = time(NULL);
+
+			// Set input token object as per cached data
+			bearerToken = (*item).second;
+
+			// Check expiration
+			if (now >= expiration)
+			{
+				ret = false;
+				// Remove token from received ones
+				m_received_tokens.erase(item);
+
+				m_logger->error("Micro service bearer token expired.");
+			}
+
+#ifdef DEBUG_BEARER_TOKEN
+			m_logger->debug("Existing token already verified %d, claims %s:%s:%s:%ld",
+					ret,
+					bearerToken.getAudience().c_str(),
+					bearerToken.getSubject().c_str(),
+					bearerToken.getIssuer().c_str(),
+					bearerToken.getExpiration());
+#endif
+			return ret;
 		}
-		else
+		if (m_verifying_tokens.find(token) == m_verifying_tokens.end())
 		{
-			ret = false;
-			m_logger->error("Micro service bearer token '%s' not verified.",
-					token.c_str());
+			if (waited)
+			{
+				// Another thread has just failed to verify the token
+				m_logger->error("Micro service bearer token '%s' not verified.",
+						token.c_str());
+				return false;
+			}
+			break;
 		}
-#ifdef DEBUG_BEARER_TOKEN
-		m_logger->debug("New token verified by core API endpoint %d, claims %s:%s:%s:%ld",
-				ret,
-				bearerToken.getAudience().c_str(),
-				bearerToken.getSubject().c_str(),
-				bearerToken.getIssuer().c_str(),
-				bearerToken.getExpiration());
-#endif
+		// Another thread is verifying the token, wait for the result
+		m_cv_rTokens.wait(lck);
+		waited = true;
 	}
-	else
+
+	// Token is not in the cache, this thread verifies it
+	m_verifying_tokens.insert(token);
+	bool fetchKey = !m_token_key_fetched && !m_token_key_fetching;
+	if (fetchKey)
 	{
-		// Token is in the cache
-		unsigned long expiration = (*item).second.getExpiration();
-		unsigned long now = time(NULL);
+		m_token_key_fetching = true;
+	}
+	string key = m_token_key;
+	lck.unlock();
 
-		// Check expiration
-		if (now >= expiration)
+	bool verified = false;
+	try {
+		if (fetchKey)
 		{
-			ret = false;
-			// Remove token from received ones
-			m_received_tokens.erase(token);
+			bool fetched = fetchTokenKey(key);
+			lck.lock();
+			m_token_key = key;
+			m_token_key_fetched = fetched;
+			m_token_key_fetching = false;
+			lck.unlock();
+		}
 
-			m_logger->error("Micro service bearer token expired.");
+		verified = bearerToken.verifyLocal(key);
+		if (!verified)
+		{
+			// Verify it by calling Fledge management endpoint
+			verified = verifyRemoteBearerToken(bearerToken);
 		}
+	} catch (...) {
+		lck.lock();
+		if (fetchKey && m_token_key_fetching)
+		{
+			m_token_key_fetching = false;
+		}
+		m_verifying_tokens.erase(token);
+		lck.unlock();
+		m_cv_rTokens.notify_all();
+		throw;
+	}
 
-		// Set input token object as per cached data
-		bearerToken = (*item).second;
+	lck.lock();
+	if (verified)
+	{
+		// Token verified, store the token object
+		m_received_tokens.emplace(token, bearerToken);
+	}
+	m_verifying_tokens.erase(token);
+	lck.unlock();
+	m_cv_rTokens.notify_all();
 
+	if (!verified)
+	{
+		m_logger->error("Micro service bearer token '%s' not verified.",
+				token.c_str());
+	}
 #ifdef DEBUG_BEARER_TOKEN
-		m_logger->debug("Existing token already verified %d, claims %s:%s:%s:%ld",
-				ret,
-				(*item).second.getAudience().c_str(),
-				(*item).second.getSubject().c_str(),
-				(*item).second.getIssuer().c_str(),
-				(*item).second.getExpiration());
+	m_logger->debug("New token verified %d, claims %s:%s:%s:%ld",
+			verified,
+			bearerToken.getAudience().c_str(),
+			bearerToken.getSubject().c_str(),
+			bearerToken.getIssuer().c_str(),
+			bearerToken.getExpiration());
 #endif
-	}
+	return verified;
+}
 
-	// Release lock
-	m_mtx_rTokens.unlock();
+/**
+ * Verify a bearer token by calling the core token verification endpoint
+ *
+ * @param bearerToken	The bearer token object
+ * @return		True if the token was verified
+ */
+bool ManagementClient::verifyRemoteBearerToken(BearerToken& bearerToken)
+{
+	string url = "/fledge/service/verify_token";
+	string payload;
+	SimpleWeb::CaseInsensitiveMultimap header;
+	header.emplace("Authorization", "Bearer " + bearerToken.token());
+	auto res = this->getHttpClient()->request("POST", url.c_str(), payload, header);
+	string response = res->content.string();
 
-	return ret;
+	// Parse JSON message and store claims in input token object
+	return bearerToken.verify(response);
+}
+
+/**
+ * Fetch the key used to validate service bearer tokens from the core.
+ * The key is requested using the bearer token of this service.
+ *
+ * @param key		Set to the key, or an empty string if the core does
+ *			not make the key available
+ * @return bool		False if the key could not be requested and the
+ *			request should be tried again later
+ */
+bool ManagementClient::fetchTokenKey(string& key)
+{
+	key.clear();
+	string bearer = getRegistrationBearerToken();
+	if (bearer.empty())
+	{
+		return false;
+	}
+	try {
+		SimpleWeb::CaseInsensitiveMultimap header;
+		header.emplace("Authorization", "Bearer " + bearer);
+		auto res = this->getHttpClient()->request("GET", "/fledge/service/token_key", "", header);
+		string response = res->content.string();
+		if (res->status_code.compare("200 OK") != 0)
+		{
+			m_logger->info("Service bearer tokens will be verified by the core: %s",
+					res->status_code.c_str());
+			return true;
+		}
+		Document doc;
+		doc.Parse(response.c_str());
+		if (doc.HasParseError() || !doc.HasMember("algorithm") || !doc["algorithm"].IsString()
+				|| !doc.HasMember("key") || !doc["key"].IsString())
+		{
+			m_logger->error("Failed to parse the service bearer token key: %s",
+					response.c_str());
+			return true;
+		}
+		if (strcmp(doc["algorithm"].GetString(), BEARER_TOKEN_ALGORITHM) != 0)
+		{
+			m_logger->info("Service bearer tokens use the unsupported algorithm %s, they will be verified by the core",
+					doc["algorithm"].GetString());
+			return true;
+		}
+		key = doc["key"].GetString();
+		return true;
+	} catch (exception& e) {
+		m_logger->error("Failed to fetch the service bearer token key: %s", e.what());
+	}
+	return false;
 }
 
 /**
@@ -10,9 +10,73 @@
 #include <pythonreadingset.h>
 #include <pythonreading.h>
 #include <stdexcept>
+#include <math.h>
+
+// The numpy API is imported once, by PythonReading::InitNumPy
+#define PY_ARRAY_UNIQUE_SYMBOL  PyArray_API_FLEDGE
+#define NO_IMPORT_ARRAY
+#include <numpy/npy_common.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/ndarraytypes.h>
+#include <numpy/ndarrayobject.h>
 
 using namespace std;
 
+/**
+ * Convert a timeval to the number of seconds since the epoch
+ *
+ * @param tv	The timeval to convert
+ * @return	The seconds since the epoch
+ */
+static double timevalToSeconds(const struct timeval& tv)
+{
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Convert a number of seconds since the epoch to a timeval
+ *
+ * @param seconds	The seconds since the epoch
+ * @return		The timeval
+ */
+static struct timeval secondsToTimeval(double seconds)
+{
+	struct timeval tv;
+	tv.tv_sec = (time_t)floor(seconds);
+	tv.tv_usec = (suseconds_t)llround((seconds - (double)tv.tv_sec) * 1000000.0);
+	if (tv.tv_usec >= 1000000)
+	{
+		tv.tv_sec++;
+		tv.tv_usec -= 1000000;
+	}
+	return tv;
+}
+
+/**
+ * Convert a Python object to a one dimensional, contiguous numpy
+ * array of the given type
+ *
+ * @param obj	The Python object, a numpy array or a sequence
+ * @param type	The numpy type required
+ * @param rows	The number of rows the array must have
+ * @return	A new reference to the array
+ */
+static PyArrayObject *columnArray(PyObject *obj, int type, npy_intp rows)
+{
+	PyArrayObject *array = (PyArrayObject *)PyArray_FROMANY(obj, type, 1, 1,
+					NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+	if (!array)
+	{
+		throw runtime_error(PythonReading::errorMessage());
+	}
+	if (PyArray_DIMS(array)[0] != rows)
+	{
+		Py_DECREF(array);
+		throw runtime_error("The columns of a block of readings must all have the same length");
+	}
+	return array;
+}
+
 
 /**
  * Set id, uuid, ts and user_ts in the reading object
@@ -106,7 +170,15 @@ PythonReadingSet::PythonReadingSet(PyObject *set)
 		Logger::getLogger()->debug("PythonReadingSet c'tor: DICT of size %d", PyDict_Size(set));
 	}
     
-	if (PyList_Check(set))
+	if (isColumns(set))
+	{
+		Py_ssize_t listSize = PyList_Size(set);
+		for (Py_ssize_t i = 0; i < listSize; i++)
+		{
+			fromColumnBlock(PyList_GetItem(set, i));
+		}
+	}
+	else if (PyList_Check(set))
 	{
 		Py_ssize_t listSize = PyList_Size(set);
 		for (Py_ssize_t i = 0; i < listSize; i++)
@@ -154,3 +226,344 @@ PyObject *PythonReadingSet::toPython(bool changeKeys)
 	return set;
 }
 
+
+/**
+ * Check if a Python object holds readings in the columnar form
+ * returned by toColumns
+ *
+ * @param pySet		The Python object to check
+ * @return bool		True if the object is a list of blocks of columns
+ */
+bool PythonReadingSet::isColumns(PyObject *pySet)
+{
+	if (!PyList_Check(pySet) || PyList_Size(pySet) == 0)
+	{
+		return false;
+	}
+	PyObject *block = PyList_GetItem(pySet, 0);
+	return PyDict_Check(block) && PyDict_GetItemString(block, "columns") != NULL;
+}
+
+/**
+ * Convert the ReadingSet to a list of blocks of columns. Each block is a
+ * Python dict that holds consecutive readings of a single asset that have
+ * the same datapoints, with the keys
+ *
+ *	asset_code	The asset name of the readings
+ *	id		A numpy array of the reading ids
+ *	ts		A numpy array of the timestamps, in seconds since the epoch
+ *	user_ts		A numpy array of the user timestamps, in seconds since the epoch
+ *	columns		A dict with a column per datapoint
+ *
+ * Integer and floating point datapoints are numpy arrays of int64 and
+ * float64 values, other datapoints are a list with the value of the
+ * datapoint in each reading.
+ *
+ * @return A Python object that contains the readings as a list of blocks
+ */
+PyObject *PythonReadingSet::toColumns()
+{
+	PythonReading::InitNumPy();
+	PyObject *blocks = PyList_New(0);
+	size_t start = 0;
+	while (start < m_readings.size())
+	{
+		size_t end = start + 1;
+		while (end < m_readings.size() && sameLayout(m_readings[start], m_readings[end]))
+		{
+			end++;
+		}
+		PyObject *block = columnBlock(start, end);
+		PyList_Append(blocks, block);
+		Py_CLEAR(block);
+		start = end;
+	}
+	return blocks;
+}
+
+/**
+ * Check if two readings may be placed in the same block of columns
+ *
+ * @param first		The first reading in the block
+ * @param reading	The reading to check
+ * @return bool		True if the readings have the same asset and datapoints
+ */
+bool PythonReadingSet::sameLayout(Reading *first, Reading *reading)
+{
+	if (first->getAssetName().compare(reading->getAssetName()) != 0)
+	{
+		return false;
+	}
+	vector<Datapoint *>& firstData = first->getReadingData();
+	vector<Datapoint *>& data = reading->getReadingData();
+	if (firstData.size() != data.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		if (firstData[i]->getData().getType() != data[i]->getData().getType()
+				|| firstData[i]->getName().compare(data[i]->getName()) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Create a block of columns from a range of readings that have the
+ * same layout
+ *
+ * @param start		The index of the first reading in the block
+ * @param end		The index after the last reading in the block
+ * @return		A new reference to the Python dict of the block
+ */
+PyObject *PythonReadingSet::columnBlock(size_t start, size_t end)
+{
+	npy_intp rows = end - start;
+	PyObject *block = PyDict_New();
+
+	PyObject *value = PyUnicode_FromString(m_readings[start]->getAssetName().c_str());
+	PyDict_SetItemString(block, "asset_code", value);
+	Py_CLEAR(value);
+
+	PyObject *ids = PyArray_SimpleNew(1, &rows, NPY_UINT64);
+	PyObject *ts = PyArray_SimpleNew(1, &rows, NPY_DOUBLE);
+	PyObject *userTs = PyArray_SimpleNew(1, &rows, NPY_DOUBLE);
+	npy_uint64 *idData = (npy_uint64 *)PyArray_DATA((PyArrayObject *)ids);
+	double *tsData = (double *)PyArray_DATA((PyArrayObject *)ts);
+	double *userTsData = (double *)PyArray_DATA((PyArrayObject *)userTs);
+	for (npy_intp i = 0; i < rows; i++)
+	{
+		Reading *reading = m_readings[start + i];
+		struct timeval tv;
+		idData[i] = reading->getId();
+		reading->getTimestamp(&tv);
+		tsData[i] = timevalToSeconds(tv);
+		reading->getUserTimestamp(&tv);
+		userTsData[i] = timevalToSeconds(tv);
+	}
+	PyDict_SetItemString(block, "id", ids);
+	PyDict_SetItemString(block, "ts", ts);
+	PyDict_SetItemString(block, "user_ts", userTs);
+	Py_CLEAR(ids);
+	Py_CLEAR(ts);
+	Py_CLEAR(userTs);
+
+	PyObject *columns = PyDict_New();
+	vector<Datapoint *>& layout = m_readings[start]->getReadingData();
+	for (size_t col = 0; col < layout.size(); col++)
+	{
+		PyObject *column;
+		DatapointValue::dataTagType type = layout[col]->getData().getType();
+		if (type == DatapointValue::dataTagType::T_INTEGER)
+		{
+			column = PyArray_SimpleNew(1, &rows, NPY_INT64);
+			npy_int64 *data = (npy_int64 *)PyArray_DATA((PyArrayObject *)column);
+			for (npy_intp i = 0; i < rows; i++)
+			{
+				data[i] = m_readings[start + i]->getReadingData()[col]->getData().toInt();
+			}
+		}
+		else if (type == DatapointValue::dataTagType::T_FLOAT)
+		{
+			column = PyArray_SimpleNew(1, &rows, NPY_DOUBLE);
+			double *data = (double *)PyArray_DATA((PyArrayObject *)column);
+			for (npy_intp i = 0; i < rows; i++)
+			{
+				data[i] = m_readings[start + i]->getReadingData()[col]->getData().toDouble();
+			}
+		}
+		else
+		{
+			column = PyList_New(rows);
+			for (npy_intp i = 0; i < rows; i++)
+			{
+				PyObject *item = PythonReading::convertDatapoint(
+						m_readings[start + i]->getReadingData()[col]);
+				if (!item)
+				{
+					Py_INCREF(Py_None);
+					item = Py_None;
+				}
+				PyList_SetItem(column, i, item);
+			}
+		}
+		PyDict_SetItemString(columns, layout[col]->getName().c_str(), column);
+		Py_CLEAR(column);
+	}
+	PyDict_SetItemString(block, "columns", columns);
+	Py_CLEAR(columns);
+
+	return block;
+}
+
+/**
+ * Add the readings in a block of columns to the reading set. The
+ * block has the form created by columnBlock, the id and timestamps
+ * are optional. Columns may be numpy arrays or Python sequences.
+ *
+ * @param block		The Python dict of the block
+ */
+void PythonReadingSet::fromColumnBlock(PyObject *block)
+{
+	PythonReading::InitNumPy();
+	if (!PyDict_Check(block))
+	{
+		throw runtime_error("Expected a Python dict as a block of reading columns");
+	}
+	PyObject *assetCode = PyDict_GetItemString(block, "asset_code");
+	PyObject *columns = PyDict_GetItemString(block, "columns");
+	if (!assetCode || !PyUnicode_Check(assetCode))
+	{
+		throw runtime_error("Block of reading columns has no asset code element.");
+	}
+	if (!columns || !PyDict_Check(columns))
+	{
+		throw runtime_error("The columns element of a block of readings should be a Python DICT.");
+	}
+	string asset = PyUnicode_AsUTF8(assetCode);
+
+	// The number of rows is taken from the timestamps or the first column
+	PyObject *userTs = PyDict_GetItemString(block, "user_ts");
+	PyObject *ts = PyDict_GetItemString(block, "ts");
+	PyObject *ids = PyDict_GetItemString(block, "id");
+	Py_ssize_t rows = -1;
+	PyObject *key, *column;
+	Py_ssize_t pos = 0;
+	if (userTs)
+	{
+		rows = PyObject_Length(userTs);
+	}
+	else if (PyDict_Next(columns, &pos, &key, &column))
+	{
+		rows = PyObject_Length(column);
+	}
+	if (rows <= 0)
+	{
+		PyErr_Clear();
+		return;
+	}
+
+	vector<Reading *> readings;
+	readings.reserve(rows);
+	for (Py_ssize_t i = 0; i < rows; i++)
+	{
+		readings.push_back(new Reading(asset, vector<Datapoint *>()));
+	}
+
+	try {
+		pos = 0;
+		while (PyDict_Next(columns, &pos, &key, &column))
+		{
+			const char *keyName = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : PyBytes_AsString(key);
+			if (!keyName)
+			{
+				// A column name that is not a string, log the Python error and skip the column
+				if (!PyErr_Occurred())
+				{
+					PyErr_SetString(PyExc_TypeError, "The name of a column of a block of readings must be a string");
+				}
+				Logger::getLogger()->warn("Ignoring a column of a block of readings of asset %s whose name is not a string: %s",
+						asset.c_str(), PythonReading::errorMessage().c_str());
+				continue;
+			}
+			string name = keyName;
+			if (PyArray_Check(column) && PyArray_ISINTEGER((PyArrayObject *)column))
+			{
+				PyArrayObject *array = columnArray(column, NPY_INT64, rows);
+				npy_int64 *data = (npy_int64 *)PyArray_DATA(array);
+				for (Py_ssize_t i = 0; i < rows; i++)
+				{
+					DatapointValue value((long)data[i]);
+					readings[i]->addDatapoint(new Datapoint(name, value));
+				}
+				Py_DECREF(array);
+			}
+			else if (PyArray_Check(column) && PyArray_ISFLOAT((PyArrayObject *)column))
+			{
+				PyArrayObject *array = columnArray(column, NPY_DOUBLE, rows);
+				double *data = (double *)PyArray_DATA(array);
+				for (Py_ssize_t i = 0; i < rows; i++)
+				{
+					DatapointValue value(data[i]);
+					readings[i]->addDatapoint(new Datapoint(name, value));
+				}
+				Py_DECREF(array);
+			}
+			else
+			{
+				if (PyObject_Length(column) != rows)
+				{
+					PyErr_Clear();
+					throw runtime_error("The columns of a block of readings must all have the same length");
+				}
+				for (Py_ssize_t i = 0; i < rows; i++)
+				{
+					PyObject *item = PySequence_GetItem(column, i);
+					DatapointValue *value = item ? PythonReading::getDatapointValue(item) : NULL;
+					Py_CLEAR(item);
+					if (value)
+					{
+						readings[i]->addDatapoint(new Datapoint(name, *value));
+						delete value;
+					}
+				}
+			}
+		}
+
+		if (userTs)
+		{
+			PyArrayObject *array = columnArray(userTs, NPY_DOUBLE, rows);
+			double *data = (double *)PyArray_DATA(array);
+			for (Py_ssize_t i = 0; i < rows; i++)
+			{
+				readings[i]->setUserTimestamp(secondsToTimeval(data[i]));
+			}
+			Py_DECREF(array);
+		}
+		if (ts)
+		{
+			PyArrayObject *array = columnArray(ts, NPY_DOUBLE, rows);
+			double *data = (double *)PyArray_DATA(array);
+			for (Py_ssize_t i = 0; i < rows; i++)
+			{
+				readings[i]->setTimestamp(secondsToTimeval(data[i]));
+			}
+			Py_DECREF(array);
+		}
+		else if (userTs)
+		{
+			for (auto& reading : readings)
+			{
+				struct timeval tv;
+				reading->getUserTimestamp(&tv);
+				reading->setTimestamp(tv);
+			}
+		}
+		if (ids)
+		{
+			PyArrayObject *array = columnArray(ids, NPY_UINT64, rows);
+			npy_uint64 *data = (npy_uint64 *)PyArray_DATA(array);
+			for (Py_ssize_t i = 0; i < rows; i++)
+			{
+				readings[i]->setId(data[i]);
+			}
+			Py_DECREF(array);
+		}
+	} catch (...) {
+		for (auto& reading : readings)
+		{
+			delete reading;
+		}
+		throw;
+	}
+
+	for (auto& reading : readings)
+	{
+		m_readings.push_back(reading);
+		m_count++;
+		m_last_id = reading->getId();
+	}
+}
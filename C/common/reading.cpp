@@ -16,6 +16,7 @@
 #include <time.h>
 #include <string.h>
 #include <logger.h>
+#include <string_utils.h>
 #include <rapidjson/document.h>
 
 using namespace std;
@@ -154,6 +155,22 @@ Reading::Reading(const Reading& orig) : m_asset(orig.m_asset),
 	}
 }
 
+/**
+ * Move constructor for Reading class. The datapoints are taken
+ * from the original reading rather than copied, leaving the
+ * original with no datapoints.
+ *
+ * @param orig	The reading to move from
+ */
+Reading::Reading(Reading&& orig) : m_asset(std::move(orig.m_asset)),
+	m_timestamp(orig.m_timestamp),
+	m_userTimestamp(orig.m_userTimestamp),
+	m_has_id(orig.m_has_id), m_id(orig.m_id),
+	m_values(std::move(orig.m_values))
+{
+	orig.m_values.clear();
+}
+
 /**
  * Destructor for Reading class
  */
@@ -234,36 +251,57 @@ Datapoint *rval;
  */
 string Reading::toJSON(bool minimal) const
 {
-ostringstream convert;
+string	convert;
+
+	convert.reserve(128 + m_asset.size() + m_values.size() * 32);
+	toJSON(convert, minimal);
+	return convert;
+}
+
+/**
+ * Append the asset reading as a JSON structure to a buffer. The
+ * reading is written directly into the buffer, so that a block of
+ * readings can be serialised into a single buffer.
+ *
+ * @param convert	The buffer to append the reading to
+ * @param minimal	Omit the ts property of the reading
+ */
+void Reading::toJSON(string& convert, bool minimal) const
+{
+char	dateTime[DATE_TIME_BUFFER_LEN + 20];
+size_t	len;
 
-	convert << "{\"asset_code\":\"";
-	convert << escape(m_asset);
-	convert << "\",\"user_ts\":\"";
+	convert.append("{\"asset_code\":\"");
+	StringAppendEscapedQuotes(convert, m_asset);
+	convert.append("\",\"user_ts\":\"");
 
 	// Add date_time with microseconds + timezone UTC:
 	// YYYY-MM-DD HH24:MM:SS.MS+00:00
-	convert << getAssetDateUserTime(FMT_DEFAULT) << "+00:00";
+	len = formatTimestamp(m_userTimestamp, dateTime, FMT_DEFAULT, true);
+	convert.append(dateTime, len);
+	convert.append("+00:00");
 	if (!minimal)
 	{
-		convert << "\",\"ts\":\"";
+		convert.append("\",\"ts\":\"");
 
 		// Add date_time with microseconds + timezone UTC:
 		// YYYY-MM-DD HH24:MM:SS.MS+00:00
-		convert << getAssetDateTime(FMT_DEFAULT) << "+00:00";
+		len = formatTimestamp(m_timestamp, dateTime, FMT_DEFAULT, true);
+		convert.append(dateTime, len);
+		convert.append("+00:00");
 	}
 
 	// Add values
-	convert << "\",\"reading\":{";
+	convert.append("\",\"reading\":{");
 	for (auto it = m_values.cbegin(); it != m_values.cend(); it++)
 	{
 		if (it != m_values.cbegin())
 		{
-			convert << ",";
+			convert.push_back(',');
 		}
-		convert << (*it)->toJSONProperty();
+		(*it)->toJSONProperty(convert);
 	}
-	convert << "}}";
-	return convert.str();
+	convert.append("}}");
 }
 
 /**
@@ -272,41 +310,53 @@ ostringstream convert;
  */
 string Reading::getDatapointsJSON() const
 {
-ostringstream convert;
+string convert;
 
-	convert << "{";
+	convert.reserve(2 + m_values.size() * 32);
+	convert.push_back('{');
 	for (auto it = m_values.cbegin(); it != m_values.cend(); it++)
 	{
 		if (it != m_values.cbegin())
 		{
-			convert << ",";
+			convert.push_back(',');
 		}
-		convert << (*it)->toJSONProperty();
+		(*it)->toJSONProperty(convert);
 	}
-	convert << "}";
-	return convert.str();
+	convert.push_back('}');
+	return convert;
 }
 
 /**
  * Convert time since epoch to a formatted m_timestamp DataTime in UTC 
  * and use a cache to speed it up
+ *
+ * The cache is held per thread and per date format, so readings in a
+ * block that share the same second only pay for gmtime_r and strftime
+ * once and no lock is required to access the cache.
+ *
  * @param tv_sec	Seconds since epoch
  * @param date_time	Buffer in which to return the formatted timestamp
  * @param dateFormat	Format: FMT_DEFAULT or FMT_STANDARD
  */
 void Reading::getFormattedDateTimeStr(const time_t *tv_sec, char *date_time, readingTimeFormat dateFormat) const
 {
-	static unsigned long cached_sec_since_epoch = 0;
-	static char cached_date_time_str[DATE_TIME_BUFFER_LEN] = "";
-	static readingTimeFormat cachedDateFormat = (readingTimeFormat) 0xff;
-	static std::mutex mtx;
-
-	std::unique_lock<std::mutex> lck(mtx);
+	struct DateTimeCache {
+		time_t	sec;
+		bool	valid;
+		size_t	len;
+		char	str[DATE_TIME_BUFFER_LEN];
+	};
+	static thread_local DateTimeCache cache[FMT_ISO8601MS + 1];
+
+	if (dateFormat < FMT_DEFAULT || dateFormat > FMT_ISO8601MS)
+	{
+		dateFormat = FMT_DEFAULT;
+	}
+	DateTimeCache& entry = cache[dateFormat];
 
-	if(*cached_date_time_str && cached_sec_since_epoch && *tv_sec == cached_sec_since_epoch && cachedDateFormat == dateFormat)
+	if (entry.valid && entry.sec == *tv_sec)
 	{
-		strncpy(date_time, cached_date_time_str, DATE_TIME_BUFFER_LEN);
-		date_time[DATE_TIME_BUFFER_LEN-1] = '\0';
+		memcpy(date_time, entry.str, entry.len + 1);
 		return;
 	}
 
@@ -320,60 +370,70 @@ void Reading::getFormattedDateTimeStr(const time_t *tv_sec, char *date_time, rea
 	 */
 
 	// Create datetime with seconds
-	std::strftime(date_time, DATE_TIME_BUFFER_LEN,
+	size_t len = std::strftime(date_time, DATE_TIME_BUFFER_LEN,
 	      m_dateTypes[dateFormat].c_str(),
                   &timeinfo);
+	date_time[len] = 0;
 
 	// update cache
-	strncpy(cached_date_time_str, date_time, DATE_TIME_BUFFER_LEN);
-	cached_date_time_str[DATE_TIME_BUFFER_LEN-1] = '\0';
-	cached_sec_since_epoch = *tv_sec;
-	cachedDateFormat = dateFormat;
+	memcpy(entry.str, date_time, len + 1);
+	entry.len = len;
+	entry.sec = *tv_sec;
+	entry.valid = true;
 }
 
-
 /**
- * Return a formatted m_timestamp DataTime in UTC
- * @param dateFormat    Format: FMT_DEFAULT or FMT_STANDARD
- * @return              The formatted datetime string
+ * Format a timestamp into a caller supplied buffer, optionally appending
+ * the microseconds. The seconds part comes from the cached per second
+ * prefix returned by getFormattedDateTimeStr, the microseconds are written
+ * directly into the buffer.
+ *
+ * @param tv		The timestamp to format
+ * @param buffer	Buffer of at least DATE_TIME_BUFFER_LEN + 20 bytes
+ * @param dateFormat	The format of the date and time
+ * @param addMS		Append the microseconds to the time
+ * @return		The length of the formatted timestamp
  */
-const string Reading::getAssetDateTime(readingTimeFormat dateFormat, bool addMS) const
+size_t Reading::formatTimestamp(const struct timeval& tv, char *buffer, readingTimeFormat dateFormat, bool addMS) const
 {
-char date_time[DATE_TIME_BUFFER_LEN];
-char micro_s[10];
-char  assetTime[DATE_TIME_BUFFER_LEN + 20];
+char	date_time[DATE_TIME_BUFFER_LEN];
 
-	getFormattedDateTimeStr(&m_timestamp.tv_sec, date_time, dateFormat);
+	getFormattedDateTimeStr(&tv.tv_sec, date_time, dateFormat);
+	size_t len = strlen(date_time);
 
-	if (dateFormat != FMT_ISO8601 && addMS)
+	if (dateFormat == FMT_ISO8601 || !addMS)
 	{
-		// Add microseconds
-		snprintf(micro_s,
-			 sizeof(micro_s),
-			 ".%06lu",
-			 m_timestamp.tv_usec);
-
-		// Add date_time + microseconds
-		if (dateFormat != FMT_ISO8601MS)
-		{
-			snprintf(assetTime, sizeof(assetTime), "%s%s", date_time, micro_s);
-		}
-		else
-		{
-			string dt(date_time);
-			size_t pos = dt.find_first_of("+");
-			pos--;
-			snprintf(assetTime, sizeof(assetTime), "%s%s%s",
-					dt.substr(0, pos).c_str(),
-				       	micro_s, dt.substr(pos).c_str());
-		}
-		return string(assetTime);
+		memcpy(buffer, date_time, len + 1);
+		return len;
 	}
-	else
+
+	// Microseconds are inserted before the timezone for FMT_ISO8601MS
+	size_t pos = len;
+	if (dateFormat == FMT_ISO8601MS)
 	{
-		return string(date_time);
+		const char *tz = strchr(date_time, '+');
+		if (tz && tz > date_time)
+			pos = (tz - date_time) - 1;
 	}
+	memcpy(buffer, date_time, pos);
+	buffer[pos] = '.';
+	size_t msLen = FormatUnsignedLong(&buffer[pos + 1], (unsigned long)tv.tv_usec, 6);
+	size_t end = pos + 1 + msLen;
+	memcpy(&buffer[end], &date_time[pos], len - pos + 1);
+	return end + len - pos;
+}
 
+/**
+ * Return a formatted m_timestamp DataTime in UTC
+ * @param dateFormat    Format: FMT_DEFAULT or FMT_STANDARD
+ * @return              The formatted datetime string
+ */
+const string Reading::getAssetDateTime(readingTimeFormat dateFormat, bool addMS) const
+{
+char  assetTime[DATE_TIME_BUFFER_LEN + 20];
+
+	size_t len = formatTimestamp(m_timestamp, assetTime, dateFormat, addMS);
+	return string(assetTime, len);
 }
 
 /**
@@ -383,40 +443,10 @@ char  assetTime[DATE_TIME_BUFFER_LEN + 20];
  */
 const string Reading::getAssetDateUserTime(readingTimeFormat dateFormat, bool addMS) const
 {
-	char date_time[DATE_TIME_BUFFER_LEN+10];
-	char micro_s[10];
-	char  assetTime[DATE_TIME_BUFFER_LEN + 20];
+char  assetTime[DATE_TIME_BUFFER_LEN + 20];
 
-	getFormattedDateTimeStr(&m_userTimestamp.tv_sec, date_time, dateFormat);
-	
-	if (dateFormat != FMT_ISO8601 && addMS)
-	{
-		// Add microseconds
-		snprintf(micro_s,
-			 sizeof(micro_s),
-			 ".%06lu",
-			 m_userTimestamp.tv_usec);
-
-		// Add date_time + microseconds
-		if (dateFormat != FMT_ISO8601MS)
-		{
-			snprintf(assetTime, sizeof(assetTime), "%s%s", date_time, micro_s);
-		}
-		else
-		{
-			string dt(date_time);
-			size_t pos = dt.find_first_of("+");
-			pos--;
-			snprintf(assetTime, sizeof(assetTime), "%s%s%s",
-					dt.substr(0, pos).c_str(),
-				       	micro_s, dt.substr(pos).c_str());
-		}
-		return string(assetTime);
-	}
-	else
-	{
-		return string(date_time);
-	}
+	size_t len = formatTimestamp(m_userTimestamp, assetTime, dateFormat, addMS);
+	return string(assetTime, len);
 }
 
 /**
@@ -542,28 +572,9 @@ void Reading::stringToTimestamp(const string& timestamp, struct timeval *ts)
 const string Reading::escape(const string& str) const
 {
 string rval;
-int bscount = 0;
 
-	for (size_t i = 0; i < str.length(); i++)
-	{
-		if (str[i] == '\\')
-		{
-			bscount++;
-		}
-		else if (str[i] == '\"')
-		{
-			if ((bscount & 1) == 0)	// not already escaped
-			{
-				rval += "\\";	// Add escape of "
-			}
-			bscount = 0;
-		}
-		else
-		{
-			bscount = 0;
-		}
-		rval += str[i];
-	}
+	rval.reserve(str.length());
+	StringAppendEscapedQuotes(rval, str);
 	return rval;
 }
 
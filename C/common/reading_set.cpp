@@ -8,6 +8,7 @@
  * Author: Mark Riddoch, Massimiliano Pinto
  */
 #include <reading_set.h>
+#include <reading_stream.h>
 #include <string>
 #include <rapidjson/document.h>
 #include <sstream>
@@ -17,8 +18,9 @@
 #include <logger.h>
 #include <base64databuffer.h>
 #include <base64dpimage.h>
-
-#include <boost/algorithm/string/replace.hpp>
+#include <blob_reference.h>
+#include <string.h>
+#include <string_utils.h>
 
 #define ASSET_NAME_INVALID_READING "error_invalid_reading"
 
@@ -28,12 +30,6 @@ static const char* kTypeNames[] =
 using namespace std;
 using namespace rapidjson;
 
-// List of characters to be escaped in JSON
-const vector<string> JSON_characters_to_be_escaped = {
-	"\\",
-	"\""
-};
-
 /**
  * Construct an empty reading set
  */
@@ -149,6 +145,73 @@ ReadingSet::ReadingSet(const std::string& json) : m_last_id(0)
 	}
 }
 
+/**
+ * Construct a reading set from a binary block of readings returned
+ * by the binary readings fetch of the Fledge storage service. The
+ * block format is defined by RDSFetchHeader and RDSFetchReading in
+ * reading_stream.h.
+ *
+ * @param block		The binary block of readings
+ * @param length	The length of the binary block
+ */
+ReadingSet::ReadingSet(const char *block, size_t length) : m_count(0), m_last_id(0)
+{
+	RDSFetchHeader header;
+	RDSFetchReading record;
+
+	if (length < sizeof(header))
+	{
+		throw new ReadingSetException("Binary reading block is too short");
+	}
+	memcpy(&header, block, sizeof(header));
+	if (header.magic != RDS_FETCH_MAGIC)
+	{
+		throw new ReadingSetException("Binary reading block has an invalid header");
+	}
+	m_readings.reserve(header.count);
+
+	size_t offset = sizeof(header);
+	try {
+		for (uint32_t i = 0; i < header.count; i++)
+		{
+			if (offset + sizeof(record) > length)
+			{
+				throw new ReadingSetException("Binary reading block is truncated");
+			}
+			// Records are packed so may not be aligned
+			memcpy(&record, block + offset, sizeof(record));
+			offset += sizeof(record);
+			if (record.assetLength == 0 || record.payloadLength == 0
+				|| offset + record.assetLength + record.payloadLength > length)
+			{
+				throw new ReadingSetException("Binary reading block is truncated");
+			}
+			const char *asset = block + offset;
+			offset += record.assetLength;
+			const char *payload = block + offset;
+			offset += record.payloadLength;
+			if (asset[record.assetLength - 1] != '\0'
+				|| payload[record.payloadLength - 1] != '\0')
+			{
+				throw new ReadingSetException("Binary reading block has an unterminated string");
+			}
+
+			m_readings.push_back(new JSONReading(record.id,
+						string(asset, record.assetLength - 1),
+						record.userTs, record.ts, payload));
+			m_last_id = record.id;
+		}
+	} catch (...) {
+		// The destructor is not run if the constructor throws
+		for (auto reading : m_readings)
+		{
+			delete reading;
+		}
+		throw;
+	}
+	m_count = m_readings.size();
+}
+
 /**
  * Destructor for a result set
  */
@@ -467,73 +530,163 @@ JSONReading::JSONReading(const Value& json)
 	}
 	else if (json.HasMember("reading"))
 	{
-		if (json["reading"].IsObject())
+		readingValue(json["reading"]);
+	}
+	else
+	{
+		Logger::getLogger()->error("Missing reading property for JSON reading, %s", m_asset.c_str());
+	}
+}
+
+/**
+ * Create a reading from a record in a binary block of readings.
+ * Only the stored reading payload is parsed, the remainder of
+ * the reading is passed in its binary form.
+ *
+ * The payload is interpreted in the same way as the storage service
+ * JSON readings fetch would, numbers and payloads that are not valid
+ * JSON are treated as strings.
+ *
+ * @param id		The reading id
+ * @param asset		The asset code of the reading
+ * @param userTs	The user timestamp of the reading
+ * @param ts		The timestamp at which the reading was stored
+ * @param payload	The reading payload as stored
+ */
+JSONReading::JSONReading(unsigned long id, const string& asset,
+			const struct timeval& userTs, const struct timeval& ts,
+			const char *payload)
+{
+	m_id = id;
+	m_has_id = true;
+	m_asset = asset;
+	m_userTimestamp = userTs;
+	m_timestamp = ts;
+
+	Document doc;
+	if (doc.Parse(payload).HasParseError() || doc.IsNumber()
+		|| strcmp(payload, "null") == 0)
+	{
+		Value value(StringRef(payload));
+		readingValue(value);
+	}
+	else
+	{
+		readingValue(doc);
+	}
+}
+
+/**
+ * Add the datapoints for the reading property of a reading. The
+ * reading property is normally an object of datapoints, if it is
+ * not the reading is added to an invalid reading asset.
+ *
+ * @param reading	The reading property of the reading
+ */
+void JSONReading::readingValue(const Value& reading)
+{
+	if (reading.IsObject())
+	{
+		// Add 'reading' values
+		for (auto &m : reading.GetObject())
 		{
-			// Add 'reading' values
-			for (auto &m : json["reading"].GetObject())
+			Datapoint *dp = datapoint(m.name.GetString(), m.value);
+			if (dp)
 			{
-				Datapoint *dp = datapoint(m.name.GetString(), m.value);
-				if (dp)
-				{
-					addDatapoint(dp);
-				}
+				addDatapoint(dp);
 			}
 		}
-		else
+	}
+	else
+	{
+		// The reading should be an object at this stage, it is and invalid one if not
+		// the asset name ASSET_NAME_INVALID_READING will be created in the PI-Server containing the
+		// invalid asset_name/values.
+		if (reading.IsString())
 		{
-			// The reading should be an object at this stage, it is and invalid one if not
-			// the asset name ASSET_NAME_INVALID_READING will be created in the PI-Server containing the
-			// invalid asset_name/values.
-			if (json["reading"].IsString())
-			{
-				string tmp_reading1 = json["reading"].GetString();
-
-				// Escape specific character for to be properly manage as JSON
-				for (const string &item : JSON_characters_to_be_escaped)
-				{
-
-					escapeCharacter(tmp_reading1, item);
-				}
-
-				Logger::getLogger()->error(
-					"Invalid reading: Asset name |%s| reading value |%s| converted value |%s|",
-					m_asset.c_str(),
-					json["reading"].GetString(),
-					tmp_reading1.c_str());
-
-				DatapointValue value(tmp_reading1);
-				this->addDatapoint(new Datapoint(m_asset, value));
-
-			} else if (json["reading"].IsInt() ||
-				   json["reading"].IsUint() ||
-				   json["reading"].IsInt64() ||
-				   json["reading"].IsUint64()) {
-
-				DatapointValue *value;
+			// Escape specific character for to be properly manage as JSON
+			string tmp_reading1 = StringEscapeJSON(reading.GetString());
+
+			Logger::getLogger()->error(
+				"Invalid reading: Asset name |%s| reading value |%s| converted value |%s|",
+				m_asset.c_str(),
+				reading.GetString(),
+				tmp_reading1.c_str());
+
+			DatapointValue value(tmp_reading1);
+			this->addDatapoint(new Datapoint(m_asset, value));
+
+		} else if (reading.IsInt() ||
+			   reading.IsUint() ||
+			   reading.IsInt64() ||
+			   reading.IsUint64()) {
+
+			DatapointValue *value;
+
+			if (reading.IsInt() ||
+			    reading.IsUint()) {
+				value = new DatapointValue((long) reading.GetInt());
+			} else {
+				value = new DatapointValue((long) reading.GetInt64());
+			}
+			this->addDatapoint(new Datapoint(m_asset, *value));
+			delete value;
 
-				if (json["reading"].IsInt() ||
-				    json["reading"].IsUint()) {
-					value = new DatapointValue((long) json["reading"].GetInt());
-				} else {
-					value = new DatapointValue((long) json["reading"].GetInt64());
-				}
-				this->addDatapoint(new Datapoint(m_asset, *value));
-				delete value;
+		} else if (reading.IsDouble())
+		{
+			DatapointValue value(reading.GetDouble());
+			this->addDatapoint(new Datapoint(m_asset, value));
 
-			} else if (json["reading"].IsDouble())
-			{
-				DatapointValue value(json["reading"].GetDouble());
-				this->addDatapoint(new Datapoint(m_asset, value));
+		}
 
-			}
+		m_asset = string(ASSET_NAME_INVALID_READING) + string("_") + m_asset.c_str();
+	}
+}
 
-			m_asset = string(ASSET_NAME_INVALID_READING) + string("_") + m_asset.c_str();
+/**
+ * Create a Datapoint for an image or data buffer that is held in the
+ * blob store. The reference has the form
+ *	__BLOB:DATABUFFER:<item size>,<item count>:<blob>
+ * or
+ *	__BLOB:DPIMAGE:<width>,<height>,<depth>:<blob>
+ * The data is not fetched from the blob store until it is accessed.
+ *
+ * @param name		The name of the datapoint
+ * @param reference	The blob reference
+ * @return Datapoint*	The new datapoint or NULL if the reference is invalid
+ */
+Datapoint *JSONReading::blobDatapoint(const string& name, const string& reference)
+{
+	size_t pos = reference.find_last_of(':');
+	if (pos == string::npos || pos + 1 >= reference.length())
+	{
+		Logger::getLogger()->error("Unable to create datapoint %s as the blob reference %s is incorrect",
+				name.c_str(), reference.c_str());
+		return NULL;
+	}
+	string blob = reference.substr(pos + 1);
+	const char *type = reference.c_str() + BLOB_PREFIX_LEN;
+	if (strncmp(type, "DATABUFFER:", 11) == 0)
+	{
+		unsigned long itemSize, count;
+		if (sscanf(type + 11, "%lu,%lu:", &itemSize, &count) == 2)
+		{
+			DatapointValue value(new DataBuffer(itemSize, count, blob));
+			return new Datapoint(name, value);
 		}
 	}
-	else
+	else if (strncmp(type, "DPIMAGE:", 8) == 0)
 	{
-		Logger::getLogger()->error("Missing reading property for JSON reading, %s", m_asset.c_str());
+		int width, height, depth;
+		if (sscanf(type + 8, "%d,%d,%d:", &width, &height, &depth) == 3)
+		{
+			DatapointValue value(new DPImage(width, height, depth, blob));
+			return new Datapoint(name, value);
+		}
 	}
+	Logger::getLogger()->error("Unable to create datapoint %s as the blob reference %s is incorrect",
+			name.c_str(), reference.c_str());
+	return NULL;
 }
 
 /**
@@ -556,7 +709,11 @@ Datapoint *rval = NULL;
 			{
 				// special encoded type
 				size_t pos = str.find_first_of(':');
-				if (str.compare(2, 10, "DATABUFFER") == 0)
+				if (str.compare(0, BLOB_PREFIX_LEN, BLOB_PREFIX) == 0)
+				{
+					rval = blobDatapoint(name, str);
+				}
+				else if (str.compare(2, 10, "DATABUFFER") == 0)
 				{
 					try {
 						DataBuffer *databuffer = new Base64DataBuffer(str.substr(pos + 1));
@@ -704,14 +861,3 @@ Datapoint *rval = NULL;
 	}
 	return rval;
 }
-
-/**
- * Escapes a character in a string to be properly handled as JSON
- *
- */
-void JSONReading::escapeCharacter(string& stringToEvaluate, string pattern)
-{
-	string escaped = "\\" + pattern;
-
-	boost::replace_all(stringToEvaluate, pattern, escaped);
-}
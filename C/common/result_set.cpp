@@ -22,7 +22,8 @@ using namespace rapidjson;
  *
  * @param json	The JSON document to construct the result set from
  */
-ResultSet::ResultSet(const std::string& json)
+ResultSet::ResultSet(const std::string& json) : m_layout(Rows), m_buffer(NULL),
+	m_doc(NULL), m_docRows(NULL), m_materialised(true)
 {
 	Document doc;
 	doc.Parse(json.c_str());
@@ -30,6 +31,61 @@ ResultSet::ResultSet(const std::string& json)
 	{
 		throw new ResultException("Unable to parse results json document");
 	}
+	parse(doc);
+}
+
+/**
+ * Construct a result set with the given layout from a JSON document
+ * returned from the Fledge storage service.
+ *
+ * With the Columns layout the document is parsed in situ into a copy
+ * of the JSON and retained for the lifetime of the result set, no
+ * values are copied out of the document until they are accessed.
+ *
+ * @param json		The JSON document to construct the result set from
+ * @param layout	The layout of the result set
+ */
+ResultSet::ResultSet(const std::string& json, Layout layout) : m_layout(layout), m_buffer(NULL),
+	m_doc(NULL), m_docRows(NULL), m_materialised(layout == Rows)
+{
+	if (layout == Rows)
+	{
+		Document doc;
+		doc.Parse(json.c_str());
+		if (doc.HasParseError())
+		{
+			throw new ResultException("Unable to parse results json document");
+		}
+		parse(doc);
+		return;
+	}
+	m_buffer = strdup(json.c_str());
+	m_doc = new Document();
+	m_doc->ParseInsitu(m_buffer);
+	if (m_doc->HasParseError())
+	{
+		delete m_doc;
+		free(m_buffer);
+		throw new ResultException("Unable to parse results json document");
+	}
+	try {
+		parse(*m_doc);
+	} catch (...) {
+		delete m_doc;
+		free(m_buffer);
+		throw;
+	}
+}
+
+/**
+ * Determine the columns of the result set from the parsed document.
+ * With the Rows layout the rows are also created, with the Columns
+ * layout the rows array of the document is retained.
+ *
+ * @param doc	The parsed result set document
+ */
+void ResultSet::parse(Document& doc)
+{
 	if (doc.HasMember("count") && doc["count"].IsUint())
 	{
 		m_rowCount = doc["count"].GetUint();
@@ -78,48 +134,22 @@ ResultSet::ResultSet(const std::string& json)
 					}
 					m_columns.push_back(new Column(string(itr->name.GetString()), type));
 				}
-				// Process every rows and create the result set
-				for (auto& row : rows.GetArray())
+				if (m_layout == Columns)
 				{
-					if (!row.IsObject())
+					for (auto& row : rows.GetArray())
 					{
-						throw new ResultException("Expected row to be an object");
-					}
-					ResultSet::Row	*rowValue = new ResultSet::Row(this);
-					unsigned int colNo = 0;
-					for (Value::ConstMemberIterator item = row.MemberBegin(); item != row.MemberEnd(); ++item)
-					{
-						switch (m_columns[colNo]->getType())
+						if (!row.IsObject())
 						{
-						case STRING_COLUMN:
-							if (item->value.IsBool())
-							{
-								rowValue->append(new ColumnValue(item->value.IsTrue() ? "true" : "false"));
-							}
-							else
-							{
-								rowValue->append(new ColumnValue(string(item->value.GetString())));
-							}
-							break;
-						case INT_COLUMN:
-							rowValue->append(new ColumnValue((long)(item->value.GetInt64())));
-							break;
-						case NUMBER_COLUMN:
-							rowValue->append(new ColumnValue(item->value.GetDouble()));
-							break;
-						case JSON_COLUMN:
-							rowValue->append(new ColumnValue(item->value));
-							break;
-						case BOOL_COLUMN:
-							if (item->value.IsString())
-								rowValue->append(new ColumnValue(string(item->value.GetString())));
-							else
-								rowValue->append(new ColumnValue(item->value.IsTrue() ? "true" : "false"));
-							break;
+							throw new ResultException("Expected row to be an object");
 						}
-						colNo++;
 					}
-					m_rows.push_back(rowValue);
+					m_docRows = &rows;
+					return;
+				}
+				// Process every rows and create the result set
+				for (auto& row : rows.GetArray())
+				{
+					appendRow(row);
 				}
 			}
 			else
@@ -134,6 +164,74 @@ ResultSet::ResultSet(const std::string& json)
 	}
 }
 
+/**
+ * Create the row and column values for a row of the result set document
+ *
+ * @param row	The row within the result set document
+ */
+void ResultSet::appendRow(const Value& row)
+{
+	if (!row.IsObject())
+	{
+		throw new ResultException("Expected row to be an object");
+	}
+	ResultSet::Row	*rowValue = new ResultSet::Row(this);
+	unsigned int colNo = 0;
+	for (Value::ConstMemberIterator item = row.MemberBegin(); item != row.MemberEnd(); ++item)
+	{
+		switch (m_columns[colNo]->getType())
+		{
+		case STRING_COLUMN:
+			if (item->value.IsBool())
+			{
+				rowValue->append(new ColumnValue(item->value.IsTrue() ? "true" : "false"));
+			}
+			else
+			{
+				rowValue->append(new ColumnValue(string(item->value.GetString())));
+			}
+			break;
+		case INT_COLUMN:
+			rowValue->append(new ColumnValue((long)(item->value.GetInt64())));
+			break;
+		case NUMBER_COLUMN:
+			rowValue->append(new ColumnValue(item->value.GetDouble()));
+			break;
+		case JSON_COLUMN:
+			rowValue->append(new ColumnValue(item->value));
+			break;
+		case BOOL_COLUMN:
+			if (item->value.IsString())
+				rowValue->append(new ColumnValue(string(item->value.GetString())));
+			else
+				rowValue->append(new ColumnValue(item->value.IsTrue() ? "true" : "false"));
+			break;
+		}
+		colNo++;
+	}
+	m_rows.push_back(rowValue);
+}
+
+/**
+ * Create the rows of a result set with the Columns layout from the
+ * retained document. This is only done when the row API is first used.
+ */
+void ResultSet::materialiseRows()
+{
+	if (m_materialised)
+	{
+		return;
+	}
+	m_materialised = true;
+	if (m_docRows)
+	{
+		for (auto& row : m_docRows->GetArray())
+		{
+			appendRow(row);
+		}
+	}
+}
+
 /**
  * Destructor for a result set
  */
@@ -149,6 +247,13 @@ ResultSet::~ResultSet()
 	{
 		delete *it;
 	}
+	/* Delete the column views, their cells belong to the document */
+	for (auto it = m_views.cbegin(); it != m_views.cend(); it++)
+	{
+		delete *it;
+	}
+	delete m_doc;
+	free(m_buffer);
 }
 
 /**
@@ -205,6 +310,7 @@ ColumnType ResultSet::columnType(const string& name) const
  */
 ResultSet::RowIterator ResultSet::firstRow()
 {
+	materialiseRows();
 	return m_rows.begin();
 }
 
@@ -375,3 +481,171 @@ char *ResultSet::ColumnValue::getString() const
 		throw new ResultIncorrectTypeException();
 	}
 }
+
+/**
+ * Return the view of a column of a result set with the Columns layout.
+ * The view is created when the column is first accessed, the array of
+ * cells of the view is allocated from the allocator of the retained
+ * document and refers to the values within the document.
+ *
+ * @param column	The column number, columns are numbered from 0
+ * @return ColumnView&	The view of the column
+ * @throw ResultNoSuchColumnException	The specified column does not exist in the result set
+ * @throw ResultException		The result set does not have the Columns layout
+ */
+const ResultSet::ColumnView& ResultSet::column(unsigned int column)
+{
+	if (column >= m_columns.size())
+	{
+		throw new ResultNoSuchColumnException();
+	}
+	if (m_layout != Columns)
+	{
+		throw new ResultException("Column views require a result set with the Columns layout");
+	}
+	if (m_views.empty())
+	{
+		m_views.resize(m_columns.size(), NULL);
+	}
+	if (m_views[column])
+	{
+		return *m_views[column];
+	}
+
+	const string& name = m_columns[column]->getName();
+	unsigned int count = m_docRows->Size();
+	const Value **cells = (const Value **)m_doc->GetAllocator().Malloc(count * sizeof(Value *));
+	unsigned int i = 0;
+	for (auto& row : m_docRows->GetArray())
+	{
+		// Rows normally have the same member order as the first row
+		const Value *cell = NULL;
+		if (row.MemberCount() > column)
+		{
+			Value::ConstMemberIterator item = row.MemberBegin() + column;
+			if (item->name.GetStringLength() == name.length()
+					&& memcmp(item->name.GetString(), name.c_str(), name.length()) == 0)
+			{
+				cell = &item->value;
+			}
+		}
+		if (!cell)
+		{
+			Value::ConstMemberIterator item = row.FindMember(name.c_str());
+			if (item != row.MemberEnd())
+			{
+				cell = &item->value;
+			}
+		}
+		cells[i++] = cell;
+	}
+	m_views[column] = new ColumnView(name, m_columns[column]->getType(), cells, count);
+	return *m_views[column];
+}
+
+/**
+ * Return the view of a column of a result set with the Columns layout.
+ *
+ * @param name		The name of the column
+ * @return ColumnView&	The view of the column
+ * @throw ResultNoSuchColumnException	The named column does not exist in the result set
+ * @throw ResultException		The result set does not have the Columns layout
+ */
+const ResultSet::ColumnView& ResultSet::column(const string& name)
+{
+	return column(findColumn(name));
+}
+
+/**
+ * Return the cell of the given row of the column view
+ *
+ * @param row		The row number, rows are numbered from 0
+ * @return Value*	The value in the document or NULL if the row has no value for the column
+ * @throw ResultNoMoreRowsException	The row does not exist in the result set
+ */
+const Value *ResultSet::ColumnView::cell(unsigned int row) const
+{
+	if (row >= m_count)
+	{
+		throw new ResultNoMoreRowsException();
+	}
+	return m_cells[row];
+}
+
+/**
+ * Return if the value of the column is null for the given row
+ *
+ * @param row	The row number, rows are numbered from 0
+ * @return bool	True if the value is null or missing
+ */
+bool ResultSet::ColumnView::isNull(unsigned int row) const
+{
+	const Value *value = cell(row);
+	return value == NULL || value->IsNull();
+}
+
+/**
+ * Retrieve the value of the column in the given row as an integer
+ *
+ * @param row	The row number, rows are numbered from 0
+ * @return long Integer value
+ * @throw ResultIncorrectTypeException	The value can not be returned as an integer
+ */
+long ResultSet::ColumnView::getInteger(unsigned int row) const
+{
+	const Value *value = cell(row);
+	if (value && value->IsInt64())
+		return (long)value->GetInt64();
+	if (value && value->IsNumber())
+		return (long)value->GetDouble();
+	throw new ResultIncorrectTypeException();
+}
+
+/**
+ * Retrieve the value of the column in the given row as a floating point number
+ *
+ * @param row	The row number, rows are numbered from 0
+ * @return double Floating point value
+ * @throw ResultIncorrectTypeException	The value can not be returned as a double
+ */
+double ResultSet::ColumnView::getNumber(unsigned int row) const
+{
+	const Value *value = cell(row);
+	if (value && value->IsNumber())
+		return value->GetDouble();
+	throw new ResultIncorrectTypeException();
+}
+
+/**
+ * Retrieve the value of the column in the given row as a string. The
+ * string is held within the document of the result set and is valid
+ * for the lifetime of the result set.
+ *
+ * @param row	The row number, rows are numbered from 0
+ * @return char* The string value
+ * @throw ResultIncorrectTypeException	The value can not be returned as a string
+ */
+const char *ResultSet::ColumnView::getString(unsigned int row) const
+{
+	const Value *value = cell(row);
+	if (value && value->IsString())
+		return value->GetString();
+	if (value && value->IsBool())
+		return value->IsTrue() ? "true" : "false";
+	throw new ResultIncorrectTypeException();
+}
+
+/**
+ * Retrieve the value of the column in the given row as JSON
+ *
+ * @param row	The row number, rows are numbered from 0
+ * @return Value* The JSON value within the document of the result set
+ * @throw ResultIncorrectTypeException	The value is not a JSON object or array
+ */
+const Value *ResultSet::ColumnView::getJSON(unsigned int row) const
+{
+	const Value *value = cell(row);
+	if (value && (value->IsObject() || value->IsArray()))
+		return value;
+	throw new ResultIncorrectTypeException();
+}
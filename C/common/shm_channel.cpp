@@ -0,0 +1,335 @@
+/*
+ * Fledge storage shared memory reading transport.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <reading_shm.h>
+#include <logger.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+using namespace std;
+
+/**
+ * Construct a ring over an area of shared memory
+ *
+ * @param base		The start of the ring header in shared memory
+ * @param initialise	The caller created the memory and the ring should be initialised
+ */
+ShmRing::ShmRing(void *base, bool initialise) : m_reserved(0)
+{
+	m_header = (ShmRingHeader *)base;
+	m_data = (char *)base + sizeof(ShmRingHeader);
+	if (initialise)
+	{
+		m_header->magic = SHM_RING_MAGIC;
+		m_header->size = SHM_RING_SIZE;
+		m_header->head.store(0);
+		m_header->tail.store(0);
+	}
+}
+
+/**
+ * Reserve space in the ring for a message. The message is not visible to
+ * the consumer until commit is called. If the message does not fit in the
+ * space before the end of the ring a padding message is written and the
+ * message is placed at the start of the ring.
+ *
+ * @param type		The message type
+ * @param length	The length of the message payload
+ * @return void*	The payload area of the message or NULL if there is no room
+ */
+void *ShmRing::reserve(uint32_t type, uint32_t length)
+{
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+	size_t total = SHM_ALIGN(sizeof(ShmMessage) + length);
+	size_t offset = head % m_header->size;
+	size_t toEnd = m_header->size - offset;
+	size_t pad = (toEnd < total) ? toEnd : 0;
+
+	if (m_header->size - (head - tail) < pad + total)
+	{
+		return NULL;
+	}
+	if (pad)
+	{
+		ShmMessage *msg = (ShmMessage *)(m_data + offset);
+		msg->type = ShmPad;
+		msg->length = pad - sizeof(ShmMessage);
+		offset = 0;
+	}
+	ShmMessage *msg = (ShmMessage *)(m_data + offset);
+	msg->type = type;
+	msg->length = length;
+	m_reserved = head + pad + total;
+	return msg + 1;
+}
+
+/**
+ * Make the message previously reserved visible to the consumer
+ */
+void ShmRing::commit()
+{
+	m_header->head.store(m_reserved, std::memory_order_release);
+}
+
+/**
+ * Return the next message in the ring without removing it
+ *
+ * @return ShmMessage*	The next message or NULL if the ring is empty
+ */
+ShmMessage *ShmRing::peek()
+{
+	while (true)
+	{
+		uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+		uint64_t head = m_header->head.load(std::memory_order_acquire);
+		if (tail == head)
+		{
+			return NULL;
+		}
+		ShmMessage *msg = (ShmMessage *)(m_data + (tail % m_header->size));
+		if (msg->type != ShmPad)
+		{
+			return msg;
+		}
+		m_header->tail.store(tail + sizeof(ShmMessage) + msg->length, std::memory_order_release);
+	}
+}
+
+/**
+ * Remove the message returned by peek from the ring
+ */
+void ShmRing::release()
+{
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	ShmMessage *msg = (ShmMessage *)(m_data + (tail % m_header->size));
+	m_header->tail.store(tail + SHM_ALIGN(sizeof(ShmMessage) + msg->length), std::memory_order_release);
+}
+
+/**
+ * Construct an unconnected shared memory channel
+ */
+ShmChannel::ShmChannel() : m_memfd(-1), m_requestfd(-1), m_responsefd(-1),
+			m_base(MAP_FAILED), m_request(NULL), m_response(NULL)
+{
+}
+
+/**
+ * Destroy the shared memory channel, unmapping the memory and closing
+ * the descriptors
+ */
+ShmChannel::~ShmChannel()
+{
+	delete m_request;
+	delete m_response;
+	if (m_base != MAP_FAILED)
+		munmap(m_base, 2 * ShmRing::mappedSize());
+	if (m_memfd != -1)
+		close(m_memfd);
+	if (m_requestfd != -1)
+		close(m_requestfd);
+	if (m_responsefd != -1)
+		close(m_responsefd);
+}
+
+/**
+ * Create a new shared memory channel. This is called by the storage
+ * service, which owns the channel.
+ *
+ * @return bool	True if the channel was created
+ */
+bool ShmChannel::create()
+{
+	if ((m_memfd = memfd_create("fledge-storage", MFD_CLOEXEC)) == -1)
+	{
+		Logger::getLogger()->error("Failed to create shared memory for storage channel: %s", strerror(errno));
+		return false;
+	}
+	if (ftruncate(m_memfd, 2 * ShmRing::mappedSize()) == -1)
+	{
+		Logger::getLogger()->error("Failed to size shared memory for storage channel: %s", strerror(errno));
+		return false;
+	}
+	m_requestfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	m_responsefd = eventfd(0, EFD_CLOEXEC);
+	if (m_requestfd == -1 || m_responsefd == -1)
+	{
+		Logger::getLogger()->error("Failed to create events for storage channel: %s", strerror(errno));
+		return false;
+	}
+	if (!map())
+	{
+		return false;
+	}
+	m_request = new ShmRing(m_base, true);
+	m_response = new ShmRing((char *)m_base + ShmRing::mappedSize(), true);
+	return true;
+}
+
+/**
+ * Attach to a shared memory channel created by the storage service
+ * using the descriptors that were passed to us.
+ *
+ * @param memfd		The shared memory descriptor
+ * @param requestfd	The event used to signal requests
+ * @param responsefd	The event used to signal responses
+ * @return bool		True if the channel was attached
+ */
+bool ShmChannel::attach(int memfd, int requestfd, int responsefd)
+{
+	m_memfd = memfd;
+	m_requestfd = requestfd;
+	m_responsefd = responsefd;
+	if (!map())
+	{
+		return false;
+	}
+	m_request = new ShmRing(m_base, false);
+	m_response = new ShmRing((char *)m_base + ShmRing::mappedSize(), false);
+	if (((ShmRingHeader *)m_base)->magic != SHM_RING_MAGIC)
+	{
+		Logger::getLogger()->error("Storage shared memory channel has an invalid header");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Map the shared memory of the channel
+ */
+bool ShmChannel::map()
+{
+	m_base = mmap(NULL, 2 * ShmRing::mappedSize(), PROT_READ | PROT_WRITE, MAP_SHARED, m_memfd, 0);
+	if (m_base == MAP_FAILED)
+	{
+		Logger::getLogger()->error("Failed to map storage shared memory channel: %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Pass the descriptors of the channel to the peer over a Unix domain socket
+ *
+ * @param socket	The connected Unix domain socket
+ * @return bool		True if the descriptors were sent
+ */
+bool ShmChannel::sendDescriptors(int socket)
+{
+	struct msghdr	msg;
+	struct iovec	iov;
+	char		control[CMSG_SPACE(3 * sizeof(int))];
+	uint32_t	magic = SHM_RING_MAGIC;
+	int		fds[3] = { m_memfd, m_requestfd, m_responsefd };
+
+	memset(&msg, 0, sizeof(msg));
+	memset(control, 0, sizeof(control));
+	iov.iov_base = &magic;
+	iov.iov_len = sizeof(magic);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(socket, &msg, 0) != (ssize_t)sizeof(magic))
+	{
+		Logger::getLogger()->error("Failed to send storage channel descriptors: %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Receive the descriptors of a channel over a Unix domain socket
+ *
+ * @param socket	The connected Unix domain socket
+ * @param memfd		Returns the shared memory descriptor
+ * @param requestfd	Returns the request event descriptor
+ * @param responsefd	Returns the response event descriptor
+ * @return bool		True if the descriptors were received
+ */
+bool ShmChannel::receiveDescriptors(int socket, int *memfd, int *requestfd, int *responsefd)
+{
+	struct msghdr	msg;
+	struct iovec	iov;
+	char		control[CMSG_SPACE(3 * sizeof(int))];
+	uint32_t	magic = 0;
+	int		fds[3];
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &magic;
+	iov.iov_len = sizeof(magic);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	if (recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(magic) || magic != SHM_RING_MAGIC)
+	{
+		Logger::getLogger()->error("Failed to receive storage channel descriptors: %s", strerror(errno));
+		return false;
+	}
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+	{
+		Logger::getLogger()->error("Storage channel descriptors are missing");
+		return false;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+	*memfd = fds[0];
+	*requestfd = fds[1];
+	*responsefd = fds[2];
+	return true;
+}
+
+/**
+ * Signal the peer via one of the channel events
+ *
+ * @param eventfd	The event descriptor to signal
+ */
+void ShmChannel::signal(int eventfd)
+{
+	uint64_t one = 1;
+	if (write(eventfd, &one, sizeof(one)) != sizeof(one))
+	{
+		Logger::getLogger()->warn("Failed to signal storage channel: %s", strerror(errno));
+	}
+}
+
+/**
+ * Wait for one of the channel events to be signalled and clear it
+ *
+ * @param eventfd	The event descriptor to wait on
+ * @param timeout	The maximum time to wait in milliseconds
+ * @return bool		True if the event was signalled
+ */
+bool ShmChannel::wait(int eventfd, int timeout)
+{
+	struct pollfd pfd;
+	pfd.fd = eventfd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int rval;
+	while ((rval = poll(&pfd, 1, timeout)) == -1 && errno == EINTR)
+		;
+	if (rval <= 0)
+	{
+		return false;
+	}
+	uint64_t count;
+	return read(eventfd, &count, sizeof(count)) == sizeof(count);
+}
@@ -0,0 +1,330 @@
+/*
+ * Fledge statistics accumulator
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <statistics_accumulator.h>
+#include <chrono>
+
+using namespace std;
+
+/**
+ * Thread entry point for the statistics flush thread
+ *
+ * @param accumulator	The statistics accumulator to flush
+ */
+static void statisticsFlushThread(StatisticsAccumulator *accumulator)
+{
+	accumulator->flushThread();
+}
+
+/**
+ * Constructor for the statistics accumulator
+ *
+ * @param storage	The storage client used to update the statistics
+ * @param table		The name of the statistics table
+ */
+StatisticsAccumulator::StatisticsAccumulator(StorageClient *storage, const string& table) :
+	m_storage(storage), m_table(table), m_pendingCount(0), m_thread(NULL),
+	m_running(false), m_interval(STATS_DEFAULT_FLUSH_INTERVAL), m_flushCount(0),
+	m_failures(0), m_backoff(false), m_failureThreshold(STATS_DEFAULT_FAIL_THRESHOLD)
+{
+	m_logger = Logger::getLogger();
+}
+
+/**
+ * Destructor for the statistics accumulator. Any pending
+ * increments are flushed to the storage service.
+ */
+StatisticsAccumulator::~StatisticsAccumulator()
+{
+	stop();
+}
+
+/**
+ * Define a counter whose row should be created in the statistics
+ * table if it does not already exist
+ *
+ * @param key		The statistics key
+ * @param description	The description to give the row if it is created
+ */
+void StatisticsAccumulator::define(const string& key, const string& description)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_definitions[key] = description;
+}
+
+/**
+ * Set the total of the pending increments that causes them to be
+ * flushed before the flush interval expires
+ *
+ * @param count		The flush count, 0 to flush on the interval only
+ */
+void StatisticsAccumulator::setFlushCount(unsigned long count)
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_flushCount = count;
+	}
+	m_cv.notify_all();
+}
+
+/**
+ * Add an increment to a statistics counter. The increment is
+ * held in memory until the next flush.
+ *
+ * @param key		The statistics key
+ * @param value		The value to add to the counter
+ */
+void StatisticsAccumulator::increment(const string& key, unsigned long value)
+{
+	bool notify;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_pending[key] += value;
+		m_pendingCount += value;
+		notify = m_flushCount && !m_backoff && m_pendingCount >= m_flushCount;
+	}
+	if (notify)
+	{
+		m_cv.notify_all();
+	}
+}
+
+/**
+ * Return the total of the increments waiting to be flushed
+ *
+ * @return unsigned long	The total of the pending increments
+ */
+unsigned long StatisticsAccumulator::pending()
+{
+	lock_guard<mutex> guard(m_mutex);
+	return m_pendingCount;
+}
+
+/**
+ * Write the pending increments to the statistics table as a single
+ * multi-row update. If the update fails the increments are retained
+ * and will be included in the next flush.
+ *
+ * @return bool		True if the pending increments were written
+ */
+bool StatisticsAccumulator::flush()
+{
+	lock_guard<mutex> flushGuard(m_flushMutex);
+	map<string, unsigned long> counters;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		counters.swap(m_pending);
+		m_pendingCount = 0;
+	}
+	if (counters.empty())
+	{
+		return true;
+	}
+
+	int rv = -1;
+	if (m_storage)
+	{
+		createRows(&counters);
+
+		vector<pair<ExpressionValues *, Where *>> updates;
+		const Condition conditionStat(Equals);
+		for (auto& counter : counters)
+		{
+			// Prepare "WHERE key = name
+			Where *wStat = new Where("key", conditionStat, counter.first);
+			// Prepare value = value + inc
+			ExpressionValues *updateValue = new ExpressionValues;
+			updateValue->push_back(Expression("value", "+", (long) counter.second));
+			updates.emplace_back(updateValue, wStat);
+		}
+
+		try {
+			rv = m_storage->updateTable(m_table, updates);
+		} catch (...) {
+			rv = -1;
+		}
+		for (auto& update : updates)
+		{
+			delete update.first;
+			delete update.second;
+		}
+	}
+
+	if (rv >= 0)
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_failures = 0;
+		m_backoff = false;
+		return true;
+	}
+
+	// Keep the increments for the next flush
+	lock_guard<mutex> guard(m_mutex);
+	m_backoff = true;
+	for (auto& counter : counters)
+	{
+		m_pending[counter.first] += counter.second;
+		m_pendingCount += counter.second;
+	}
+	if (++m_failures > m_failureThreshold)
+	{
+		m_logger->warn("Update of statistics failure has persisted, attempting recovery");
+		m_created.clear();
+		m_failures = 0;
+	}
+	else if (m_failures == 1)
+	{
+		m_logger->warn("Update of statistics failed");
+	}
+	else
+	{
+		m_logger->warn("Update of statistics still failing");
+	}
+	return false;
+}
+
+/**
+ * Start the thread that periodically flushes the statistics. The
+ * rows of all the defined counters are created when the thread starts.
+ */
+void StatisticsAccumulator::start()
+{
+	lock_guard<mutex> guard(m_mutex);
+	if (m_thread == NULL)
+	{
+		m_running = true;
+		m_thread = new thread(statisticsFlushThread, this);
+	}
+}
+
+/**
+ * Stop the flush thread and flush any pending increments
+ */
+void StatisticsAccumulator::stop()
+{
+	thread *flusher;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_running = false;
+		flusher = m_thread;
+		m_thread = NULL;
+	}
+	if (flusher)
+	{
+		m_cv.notify_all();
+		flusher->join();
+		delete flusher;
+	}
+	flush();
+}
+
+/**
+ * The flush thread. Flushes the pending increments when the flush
+ * interval expires or the flush count is reached. The flush count
+ * is not used while backing off after a failed flush.
+ */
+void StatisticsAccumulator::flushThread()
+{
+	createRows(NULL);
+
+	unique_lock<mutex> lck(m_mutex);
+	while (m_running)
+	{
+		m_cv.wait_for(lck, chrono::seconds(m_interval), [this] {
+				return !m_running || (m_flushCount && !m_backoff
+						&& m_pendingCount >= m_flushCount);
+				});
+		lck.unlock();
+		flush();
+		lck.lock();
+	}
+}
+
+/**
+ * Create the statistics rows for the defined counters that are not
+ * yet known to exist.
+ *
+ * @param counters	Only create rows for these counters, or all
+ *			the defined counters if NULL
+ */
+void StatisticsAccumulator::createRows(const map<string, unsigned long> *counters)
+{
+	vector<pair<string, string>> rows;
+	{
+		lock_guard<mutex> guard(m_mutex);
+		for (auto& definition : m_definitions)
+		{
+			if (m_created.find(definition.first) == m_created.end()
+				&& (counters == NULL || counters->find(definition.first) != counters->end()))
+			{
+				rows.emplace_back(definition.first, definition.second);
+			}
+		}
+	}
+	for (auto& row : rows)
+	{
+		if (createRow(row.first, row.second))
+		{
+			lock_guard<mutex> guard(m_mutex);
+			m_created.insert(row.first);
+		}
+	}
+}
+
+/**
+ * Create a row in the statistics table if it does not already exist
+ *
+ * @param key		The statistics key to create
+ * @param description	The description of the statistic
+ * @return bool		True if the row exists or was created
+ */
+bool StatisticsAccumulator::createRow(const string& key, const string& description)
+{
+	if (!m_storage)
+	{
+		return false;
+	}
+	try {
+		// SELECT * FROM fledge.statistics WHERE key = statistics_key
+		const Condition conditionKey(Equals);
+		Where *wKey = new Where("key", conditionKey, key);
+		Query qKey(wKey);
+
+		ResultSet *result = m_storage->queryTable(m_table, qKey);
+		if (!result)
+		{
+			return false;
+		}
+		bool exists = result->rowCount() > 0;
+		delete result;
+		if (exists)
+		{
+			return true;
+		}
+
+		InsertValues values;
+		values.push_back(InsertValue("key", key));
+		values.push_back(InsertValue("description", description));
+		values.push_back(InsertValue("value", 0));
+		values.push_back(InsertValue("previous_value", 0));
+		if (m_storage->insertTable(m_table, values) != 1)
+		{
+			m_logger->error("Failed to insert a new row into the '%s' table, key '%s'",
+					m_table.c_str(), key.c_str());
+			return false;
+		}
+		m_logger->info("New row added into '%s' table, key '%s'",
+				m_table.c_str(), key.c_str());
+		return true;
+	} catch (...) {
+		m_logger->error("Unable to create new row in '%s' table with key '%s'",
+				m_table.c_str(), key.c_str());
+	}
+	return false;
+}
@@ -21,7 +21,11 @@
 #include <thread>
 #include <map>
 #include <string_utils.h>
+#include <blob_reference.h>
 #include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
 #include <errno.h>
 #include <stdarg.h>
 
@@ -40,32 +44,49 @@ using namespace std;
 using namespace rapidjson;
 using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
 
-// handles m_client_map access
-std::mutex sto_mtx_client_map;
+/**
+ * Set if the last append of readings by this thread failed without
+ * it being known if the readings were stored
+ */
+static thread_local bool appendIndeterminate = false;
+
+/**
+ * Callback used to fetch the data of datapoints held in the blob store
+ *
+ * @param client	The storage client
+ * @param blob		The reference of the blob
+ * @param buffer	The buffer to populate
+ * @param length	The length of the blob data
+ */
+static bool fetchBlob(void *client, const string& blob, void *buffer, size_t length)
+{
+	return ((StorageClient *)client)->getBlob(blob, buffer, length);
+}
 
 /**
  * Storage Client constructor
  */
-StorageClient::StorageClient(const string& hostname, const unsigned short port) : m_streaming(false), m_management(NULL)
+StorageClient::StorageClient(const string& hostname, const unsigned short port) : m_streaming(false), m_binaryFetch(true), m_shm(NULL), m_shmSocket(-1),
+		m_shmEnabled(false), m_shmAttempted(false), m_shmFetch(true), m_management(NULL), m_blobStore(true)
 {
 	m_host = hostname;
 	m_pid = getpid();
 	m_logger = Logger::getLogger();
 	m_urlbase << hostname << ":" << port;
+	m_clients = HttpClientPool::create(m_urlbase.str());
+	BlobReference::registerFetch(fetchBlob, this);
 }
 
 /**
  * Storage Client constructor
- * stores the provided HttpClient into the map
+ * uses the provided HttpClient for the calling thread
  */
-StorageClient::StorageClient(HttpClient *client) : m_streaming(false), m_management(NULL)
+StorageClient::StorageClient(HttpClient *client) : m_streaming(false), m_binaryFetch(true), m_shm(NULL), m_shmSocket(-1),
+		m_shmEnabled(false), m_shmAttempted(false), m_shmFetch(true), m_management(NULL), m_blobStore(true)
 {
-
-	std::thread::id thread_id = std::this_thread::get_id();
-
-	sto_mtx_client_map.lock();
-	m_client_map[thread_id] = client;
-	sto_mtx_client_map.unlock();
+	m_clients = HttpClientPool::create(m_urlbase.str());
+	m_clients->adopt(client);
+	BlobReference::registerFetch(fetchBlob, this);
 }
 
 
@@ -74,13 +95,8 @@ StorageClient::StorageClient(HttpClient *client) : m_streaming(false), m_managem
  */
 StorageClient::~StorageClient()
 {
-	std::map<std::thread::id, HttpClient *>::iterator item;
-
-	// Deletes all the HttpClient objects created in the map
-	for (item  = m_client_map.begin() ; item  != m_client_map.end() ; ++item)
-	{
-		delete item->second;
-	}
+	BlobReference::unregisterFetch(this);
+	closeShmChannel();
 }
 
 
@@ -89,54 +105,17 @@ StorageClient::~StorageClient()
  */
 bool StorageClient::deleteHttpClient()
 {
-	std::thread::id thread_id = std::this_thread::get_id();
-
-	lock_guard<mutex> guard(sto_mtx_client_map);
-
-	if(m_client_map.find(thread_id) == m_client_map.end())
-		return false;
-
-	ostringstream ss;
-	ss << thread_id;
-	Logger::getLogger()->debug("Storage client deleting HttpClient object @ %p for thread %s", m_client_map[thread_id], ss.str().c_str());
-	
-	delete m_client_map[thread_id];
-	m_client_map.erase(thread_id);
-
-	return true;
+	return m_clients->remove();
 }
 
 
 /**
- * Creates a HttpClient object for each thread
- * it stores/retrieves the reference to the HttpClient and the associated thread id in a map
+ * Return the HttpClient of the calling thread, each thread has a client
+ * of its own that is held in the pool of clients
  */
 HttpClient *StorageClient::getHttpClient(void) {
 
-	std::map<std::thread::id, HttpClient *>::iterator item;
-	HttpClient *client;
-
-	std::thread::id thread_id = std::this_thread::get_id();
-
-	sto_mtx_client_map.lock();
-	item = m_client_map.find(thread_id);
-
-	if (item  == m_client_map.end() ) {
-
-		// Adding a new HttpClient
-		client = new HttpClient(m_urlbase.str());
-		m_client_map[thread_id] = client;
-		m_seqnum_map[thread_id].store(0);
-		std::ostringstream ss;
-		ss << std::this_thread::get_id();
-	}
-	else
-	{
-		client = item->second;
-	}
-	sto_mtx_client_map.unlock();
-
-	return (client);
+	return m_clients->client();
 }
 
 /**
@@ -144,13 +123,16 @@ HttpClient *StorageClient::getHttpClient(void) {
  */
 bool StorageClient::readingAppend(Reading& reading)
 {
+	externaliseBlobs(vector<Reading *>(1, &reading));
+	BlobReference::Scope references;
 	try {
-		ostringstream convert;
+		string convert;
 
-		convert << "{ \"readings\" : [ ";
-		convert << reading.toJSON();
-		convert << " ] }";
-		auto res = this->getHttpClient()->request("POST", "/storage/reading", convert.str());
+		convert.reserve(256);
+		convert.append("{ \"readings\" : [ ");
+		reading.toJSON(convert);
+		convert.append(" ] }");
+		auto res = this->getHttpClient()->request("POST", "/storage/reading", convert);
 		if (res->status_code.compare("200 OK") == 0)
 		{
 			return true;
@@ -165,6 +147,18 @@ bool StorageClient::readingAppend(Reading& reading)
 	return false;
 }
 
+/**
+ * Return true if the last append of readings made by the calling thread
+ * failed in a way that leaves it unknown if the readings were stored,
+ * such as a timeout waiting for the response. The channel that timed out
+ * is closed, so a resend of the readings uses the HTTP interface, but
+ * may store them twice.
+ */
+bool StorageClient::lastAppendIndeterminate()
+{
+	return appendIndeterminate;
+}
+
 /**
  * Append multiple readings
  *
@@ -175,10 +169,18 @@ bool StorageClient::readingAppend(const vector<Reading *>& readings)
 #if INSTRUMENT
 	struct timeval	start, t1, t2;
 #endif
+	appendIndeterminate = false;
+	externaliseBlobs(readings);
+	BlobReference::Scope references;
 	if (m_streaming)
 	{
 		return streamReadings(readings);
 	}
+	int shmResult = shmAppend(readings);
+	if (shmResult != -1)
+	{
+		return shmResult == 1;
+	}
 	// See if we should switch to stream mode
 	struct timeval tmFirst, tmLast, dur;
 	readings[0]->getUserTimestamp(&tmFirst);
@@ -199,36 +201,43 @@ bool StorageClient::readingAppend(const vector<Reading *>& readings)
 		m_logger->warn("Failed to switch to streaming mode");
 	}
 #endif
-	static HttpClient *httpClient = this->getHttpClient(); // to initialize m_seqnum_map[thread_id] for this thread
 	try {
-		std::thread::id thread_id = std::this_thread::get_id();
 		ostringstream ss;
-		sto_mtx_client_map.lock();
-		m_seqnum_map[thread_id].fetch_add(1);
-		ss << m_pid << "#" << thread_id << "_" << m_seqnum_map[thread_id].load();
-		sto_mtx_client_map.unlock();
+		ss << m_pid << "#" << std::this_thread::get_id() << "_" << m_clients->nextSequence();
 
 		SimpleWeb::CaseInsensitiveMultimap headers = {{"SeqNum", ss.str()}};
 
 #if INSTRUMENT
 		gettimeofday(&start, NULL);
 #endif
-		ostringstream convert;
-		convert << "{ \"readings\" : [ ";
+		/*
+		 * The readings are serialised into a single buffer. The buffer
+		 * is sized for the whole block from the size of the first
+		 * reading, so it is rarely reallocated.
+		 */
+		string convert;
+		convert.reserve(256);
+		convert.append("{ \"readings\" : [ ");
 		for (vector<Reading *>::const_iterator it = readings.cbegin();
 						 it != readings.cend(); ++it)
 		{
 			if (it != readings.cbegin())
 			{
-				convert << ", ";
+				convert.append(", ", 2);
+			}
+			size_t start = convert.size();
+			(*it)->toJSON(convert);
+			if (it == readings.cbegin())
+			{
+				size_t estimate = (convert.size() - start + 2) * readings.size();
+				convert.reserve(start + estimate + estimate / 8 + 8);
 			}
-			convert << (*it)->toJSON();
 		}
-		convert << " ] }";
+		convert.append(" ] }");
 #if INSTRUMENT
 		gettimeofday(&t1, NULL);
 #endif
-		auto res = this->getHttpClient()->request("POST", "/storage/reading", convert.str(), headers);
+		auto res = this->getHttpClient()->request("POST", "/storage/reading", convert, headers);
 #if INSTRUMENT
 		gettimeofday(&t2, NULL);
 #endif
@@ -365,6 +374,60 @@ ReadingSet *StorageClient::readingFetch(const unsigned long readingId, const uns
 	return 0;
 }
 
+/**
+ * Fetch a block of readings from the storage service as a binary
+ * block rather than a JSON document. If the storage plugin does not
+ * support binary fetches the JSON fetch is used instead, for this
+ * and all subsequent calls.
+ *
+ * @param readingId	The ID of the reading which should be the first one to send
+ * @param count		Maximum number if readings to return
+ * @return ReadingSet	The set of readings
+ */
+ReadingSet *StorageClient::readingFetchBinary(const unsigned long readingId, const unsigned long count)
+{
+	bool handled;
+	ReadingSet *shmResult = shmFetch(readingId, count, handled);
+	if (handled)
+	{
+		return shmResult;
+	}
+	if (!m_binaryFetch)
+	{
+		return readingFetch(readingId, count);
+	}
+	try {
+
+		char url[256];
+		snprintf(url, sizeof(url), "/storage/reading/binary?id=%lu&count=%lu",
+				readingId, count);
+
+		auto res = this->getHttpClient()->request("GET", url);
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		if (res->status_code.compare("200 OK") == 0)
+		{
+			string block = resultPayload.str();
+			return new ReadingSet(block.data(), block.length());
+		}
+		if (res->status_code.compare(0, 3, "501") == 0)
+		{
+			m_logger->info("The storage plugin does not support binary reading fetch, JSON fetch will be used");
+			m_binaryFetch = false;
+			return readingFetch(readingId, count);
+		}
+		handleUnexpectedResponse("Fetch binary readings", res->status_code, resultPayload.str());
+	} catch (exception& ex) {
+		handleException(ex, "fetch binary readings");
+		throw;
+	} catch (exception* ex) {
+		handleException(*ex, "fetch binary readings");
+		delete ex;
+		throw exception();
+	}
+	return 0;
+}
+
 /**
  * Purge the readings by age
  *
@@ -468,7 +531,20 @@ PurgeResult StorageClient::readingPurgeByAsset(const string& asset)
  */
 ResultSet *StorageClient::queryTable(const std::string& tableName, const Query& query)
 {
-	return queryTable(DEFAULT_SCHEMA, tableName, query);
+	return queryTable(DEFAULT_SCHEMA, tableName, query, ResultSet::Rows);
+}
+
+/**
+ * Query a table and return a result set with the given layout
+ *
+ * @param tablename	The name of the table to query
+ * @param query		The query payload
+ * @param layout	The layout of the result set
+ * @return ResultSet*	The resultset of the query
+ */
+ResultSet *StorageClient::queryTable(const std::string& tableName, const Query& query, ResultSet::Layout layout)
+{
+	return queryTable(DEFAULT_SCHEMA, tableName, query, layout);
 }
 
 /**
@@ -480,6 +556,24 @@ ResultSet *StorageClient::queryTable(const std::string& tableName, const Query&
  * @return ResultSet*	The resultset of the query
  */
 ResultSet *StorageClient::queryTable(const std::string& schema, const std::string& tableName, const Query& query)
+{
+	return queryTable(schema, tableName, query, ResultSet::Rows);
+}
+
+/**
+ * Query a table and return a result set with the given layout. The
+ * Columns layout should be used for queries that return a large number
+ * of rows, the values are then accessed via the column views of the
+ * result set rather than being copied into the rows of the result set.
+ *
+ * @param schema	The name of the schema to query
+ * @param tablename	The name of the table to query
+ * @param query		The query payload
+ * @param layout	The layout of the result set
+ * @return ResultSet*	The resultset of the query
+ */
+ResultSet *StorageClient::queryTable(const std::string& schema, const std::string& tableName,
+		const Query& query, ResultSet::Layout layout)
 {
 	try {
 		ostringstream convert;
@@ -492,7 +586,7 @@ ResultSet *StorageClient::queryTable(const std::string& schema, const std::strin
 		resultPayload << res->content.rdbuf();
 		if (res->status_code.compare("200 OK") == 0)
 		{
-			ResultSet *result = new ResultSet(resultPayload.str().c_str());
+			ResultSet *result = new ResultSet(resultPayload.str(), layout);
 			return result;
 		}
 		handleUnexpectedResponse("Query table", res->status_code, resultPayload.str());
@@ -507,6 +601,57 @@ ResultSet *StorageClient::queryTable(const std::string& schema, const std::strin
 	return 0;
 }
 
+/**
+ * Query a table and pass each row of the result to a callback as it is
+ * received from the storage service. The whole result is never held in
+ * memory, which makes this suitable for queries that return a large
+ * number of rows.
+ *
+ * @param tableName	The name of the table to query
+ * @param query		The query payload
+ * @param callback	The callback to pass each row to, returning false abandons the query
+ * @param data		Data to pass to the callback
+ * @return long		The number of rows passed to the callback or -1 on error
+ */
+long StorageClient::queryTableRows(const std::string& tableName, const Query& query,
+		STORAGE_ROW_CB callback, void *data)
+{
+	char url[128];
+	snprintf(url, sizeof(url), "/storage/table/%s/query?stream=true", tableName.c_str());
+	return streamRows("Query table", url, query.toJSON(), callback, data);
+}
+
+/**
+ * Send a query to the storage service on a connection of its own and
+ * pass the rows of the result to the callback as they are received.
+ *
+ * @param operation	The operation, used in error reports
+ * @param url		The URL of the query
+ * @param payload	The query payload
+ * @param callback	The callback to pass each row to
+ * @param data		Data to pass to the callback
+ * @return long		The number of rows passed to the callback or -1 on error
+ */
+long StorageClient::streamRows(const char *operation, const string& url, const string& payload,
+		STORAGE_ROW_CB callback, void *data)
+{
+	string address = m_urlbase.str();
+	size_t colon = address.rfind(':');
+	if (colon == string::npos)
+	{
+		m_logger->error("%s: the address of the storage service is not known", operation);
+		return -1;
+	}
+	StorageQueryStream stream(address.substr(0, colon),
+			(unsigned short)strtoul(address.c_str() + colon + 1, NULL, 10));
+	long rows = stream.query("PUT", url, payload, callback, data);
+	if (rows < 0 && !stream.getStatus().empty() && stream.getStatus().compare(0, 3, "200") != 0)
+	{
+		handleUnexpectedResponse(operation, stream.getStatus(), stream.getBody());
+	}
+	return rows;
+}
+
 /**
  * Query a table and return a ReadingSet pointer
  *
@@ -631,14 +776,9 @@ int StorageClient::updateTable(const string& tableName, const InsertValues& valu
  */
 int StorageClient::updateTable(const string& schema, const string& tableName, const InsertValues& values, const Where& where, const UpdateModifier *modifier)
 {
-	static HttpClient *httpClient = this->getHttpClient(); // to initialize m_seqnum_map[thread_id] for this thread
 	try {
-		std::thread::id thread_id = std::this_thread::get_id();
 		ostringstream ss;
-		sto_mtx_client_map.lock();
-		m_seqnum_map[thread_id].fetch_add(1);
-		ss << m_pid << "#" << thread_id << "_" << m_seqnum_map[thread_id].load();
-		sto_mtx_client_map.unlock();
+		ss << m_pid << "#" << std::this_thread::get_id() << "_" << m_clients->nextSequence();
 
 		SimpleWeb::CaseInsensitiveMultimap headers = {{"SeqNum", ss.str()}};
 
@@ -716,14 +856,9 @@ int StorageClient::updateTable(const string& tableName, const ExpressionValues&
  */
 int StorageClient::updateTable(const string& schema, const string& tableName, const ExpressionValues& values, const Where& where, const UpdateModifier *modifier)
 {
-	static HttpClient *httpClient = this->getHttpClient(); // to initialize m_seqnum_map[thread_id] for this thread
 	try {
-		std::thread::id thread_id = std::this_thread::get_id();
 		ostringstream ss;
-		sto_mtx_client_map.lock();
-		m_seqnum_map[thread_id].fetch_add(1);
-		ss << m_pid << "#" << thread_id << "_" << m_seqnum_map[thread_id].load();
-		sto_mtx_client_map.unlock();
+		ss << m_pid << "#" << std::this_thread::get_id() << "_" << m_clients->nextSequence();
 
 		SimpleWeb::CaseInsensitiveMultimap headers = {{"SeqNum", ss.str()}};
 		
@@ -799,14 +934,9 @@ int StorageClient::updateTable(const string& tableName, vector<pair<ExpressionVa
  */
 int StorageClient::updateTable(const string& schema, const string& tableName, vector<pair<ExpressionValues *, Where *>>& updates, const UpdateModifier *modifier)
 {
-	static HttpClient *httpClient = this->getHttpClient(); // to initialize m_seqnum_map[thread_id] for this thread
 	try {
-		std::thread::id thread_id = std::this_thread::get_id();
 		ostringstream ss;
-		sto_mtx_client_map.lock();
-		m_seqnum_map[thread_id].fetch_add(1);
-		ss << m_pid << "#" << thread_id << "_" << m_seqnum_map[thread_id].load();
-		sto_mtx_client_map.unlock();
+		ss << m_pid << "#" << std::this_thread::get_id() << "_" << m_clients->nextSequence();
 
 		SimpleWeb::CaseInsensitiveMultimap headers = {{"SeqNum", ss.str()}};
 		
@@ -1159,6 +1289,217 @@ int StorageClient::deleteTable(const std::string& schema, const std::string& tab
 	return -1;
 }
 
+/**
+ * Snapshot the statistics into the statistics history table and roll
+ * the previous values of the statistics forward, as a single operation
+ * in the storage service.
+ *
+ * @return int		The number of statistics snapshot, or -1 if the
+ *			operation failed or is not supported by the
+ *			storage plugin
+ */
+int StorageClient::statisticsHistory()
+{
+	try {
+		auto res = this->getHttpClient()->request("POST", "/storage/statistics/history");
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		if (res->status_code.compare("200 OK") == 0)
+		{
+			Document doc;
+			doc.Parse(resultPayload.str().c_str());
+			if (doc.HasParseError() || !doc.HasMember("rows_affected"))
+			{
+				m_logger->error("Failed to parse result of statistics history. %s",
+						resultPayload.str().c_str());
+				return -1;
+			}
+			return doc["rows_affected"].GetInt();
+		}
+		if (res->status_code.compare(0, 3, "501") == 0)
+		{
+			m_logger->info("The storage plugin does not support the statistics history operation");
+			return -1;
+		}
+		handleUnexpectedResponse("Statistics history", res->status_code, resultPayload.str());
+	} catch (exception& ex) {
+		handleException(ex, "statistics history");
+		throw;
+	}
+	return -1;
+}
+
+/**
+ * Move the statistics history older than a given age into the daily
+ * statistics history table, as a set of batch operations within the
+ * storage service.
+ *
+ * @param age		The age in seconds of the statistics history to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return int		The number of statistics history rows moved, or -1 if
+ *			the operation failed or is not supported by the
+ *			storage plugin
+ */
+int StorageClient::statisticsHistoryPurge(unsigned long age, unsigned int limit)
+{
+	try {
+		ostringstream convert;
+		convert << "/storage/statistics/history/purge?age=" << age << "&limit=" << limit;
+		auto res = this->getHttpClient()->request("PUT", convert.str());
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		if (res->status_code.compare("200 OK") == 0)
+		{
+			Document doc;
+			doc.Parse(resultPayload.str().c_str());
+			if (doc.HasParseError() || !doc.HasMember("rows_affected"))
+			{
+				m_logger->error("Failed to parse result of statistics history purge. %s",
+						resultPayload.str().c_str());
+				return -1;
+			}
+			return doc["rows_affected"].GetInt();
+		}
+		if (res->status_code.compare(0, 3, "501") == 0)
+		{
+			m_logger->info("The storage plugin does not support the statistics history purge operation");
+			return -1;
+		}
+		handleUnexpectedResponse("Statistics history purge", res->status_code, resultPayload.str());
+	} catch (exception& ex) {
+		handleException(ex, "statistics history purge");
+		throw;
+	}
+	return -1;
+}
+
+/**
+ * Store a block of data in the blob store of the storage service
+ *
+ * @param data		The data to store
+ * @param length	The length of the data
+ * @return string	The reference of the blob or an empty string if
+ *			the data could not be stored
+ */
+string StorageClient::putBlob(const void *data, size_t length)
+{
+	if (!m_blobStore)
+	{
+		return "";
+	}
+	try {
+		string content((const char *)data, length);
+		SimpleWeb::CaseInsensitiveMultimap headers = {{"Content-Type", "application/octet-stream"}};
+		auto res = this->getHttpClient()->request("POST", "/storage/blob", content, headers);
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		if (res->status_code.compare("200 OK") == 0)
+		{
+			Document doc;
+			doc.Parse(resultPayload.str().c_str());
+			if (doc.HasParseError() || !doc.HasMember("blob") || !doc["blob"].IsString())
+			{
+				m_logger->error("Failed to parse result of blob store. %s",
+						resultPayload.str().c_str());
+				return "";
+			}
+			return doc["blob"].GetString();
+		}
+		if (res->status_code.compare(0, 3, "404") == 0 || res->status_code.compare(0, 3, "501") == 0)
+		{
+			m_logger->info("The storage service does not support a blob store, large datapoints will be sent inline");
+			m_blobStore = false;
+			return "";
+		}
+		handleUnexpectedResponse("Store blob", res->status_code, resultPayload.str());
+	} catch (exception& ex) {
+		handleException(ex, "store blob");
+	}
+	return "";
+}
+
+/**
+ * Fetch the content of a blob from the blob store of the storage service
+ *
+ * @param blob		The reference of the blob
+ * @param buffer	The buffer to populate with the blob data
+ * @param length	The expected length of the blob
+ * @return bool		True if the buffer was populated
+ */
+bool StorageClient::getBlob(const string& blob, void *buffer, size_t length)
+{
+	try {
+		string url = "/storage/blob/" + blob;
+		auto res = this->getHttpClient()->request("GET", url);
+		if (res->status_code.compare("200 OK") == 0)
+		{
+			size_t size = res->content.size();
+			if (size != length)
+			{
+				m_logger->error("Blob %s has a length of %lu, expected %lu",
+						blob.c_str(), (unsigned long)size, (unsigned long)length);
+				return false;
+			}
+			res->content.read((char *)buffer, length);
+			return true;
+		}
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		handleUnexpectedResponse("Fetch blob", res->status_code, resultPayload.str());
+	} catch (exception& ex) {
+		handleException(ex, "fetch blob %s", blob.c_str());
+	}
+	return false;
+}
+
+/**
+ * Move the data of large image and data buffer datapoints to the
+ * blob store of the storage service. The datapoints retain their data
+ * but are serialised as a reference to the blob.
+ *
+ * @param readings	The readings that are about to be appended
+ */
+void StorageClient::externaliseBlobs(const vector<Reading *>& readings)
+{
+	if (!m_blobStore)
+	{
+		return;
+	}
+	for (auto reading : readings)
+	{
+		for (auto dp : reading->getReadingData())
+		{
+			DatapointValue& value = dp->getData();
+			if (value.getType() == DatapointValue::T_DATABUFFER)
+			{
+				DataBuffer *buffer = value.getDataBuffer();
+				size_t size = buffer->getItemSize() * buffer->getItemCount();
+				if (buffer->getBlob().empty() && size >= BLOB_THRESHOLD)
+				{
+					string blob = putBlob(buffer->getData(), size);
+					if (!blob.empty())
+						buffer->setBlob(blob);
+				}
+			}
+			else if (value.getType() == DatapointValue::T_IMAGE)
+			{
+				DPImage *image = value.getImage();
+				size_t size = image->getByteSize();
+				if (image->getBlob().empty() && size >= BLOB_THRESHOLD)
+				{
+					string blob = putBlob(image->getData(), size);
+					if (!blob.empty())
+						image->setBlob(blob);
+				}
+			}
+			if (!m_blobStore)
+			{
+				return;
+			}
+		}
+	}
+}
+
 /**
  * Standard logging method for all interactions
  *
@@ -1343,6 +1684,285 @@ bool StorageClient::registerTableNotification(const string& tableName, const str
 	return false;
 }
 
+/**
+ * Negotiate a shared memory channel with the storage service. This is
+ * only possible if the storage service is running on the same host, if
+ * the negotiation fails the HTTP interface continues to be used.
+ *
+ * Must be called with the shared memory mutex held.
+ *
+ * @return bool	True if the shared memory channel is available
+ */
+bool StorageClient::openShmChannel()
+{
+	m_shmAttempted = true;
+	try {
+		auto res = this->getHttpClient()->request("POST", "/storage/reading/shm");
+		ostringstream resultPayload;
+		resultPayload << res->content.rdbuf();
+		if (res->status_code.compare("200 OK") != 0)
+		{
+			m_logger->info("Shared memory transport is not available, using HTTP: %s",
+					res->status_code.c_str());
+			return false;
+		}
+		Document doc;
+		doc.Parse(resultPayload.str().c_str());
+		if (doc.HasParseError() || !doc.HasMember("socket") || !doc.HasMember("token"))
+		{
+			m_logger->error("Invalid response to shared memory channel creation: %s",
+					resultPayload.str().c_str());
+			return false;
+		}
+		string name = doc["socket"].GetString();
+		uint32_t token = doc["token"].GetUint();
+
+		int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (sock == -1)
+		{
+			m_logger->error("Unable to create shared memory channel socket: %s", strerror(errno));
+			return false;
+		}
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(&address.sun_path[1], name.c_str(), sizeof(address.sun_path) - 2);
+		socklen_t len = offsetof(struct sockaddr_un, sun_path) + 1 + name.length();
+		if (connect(sock, (struct sockaddr *)&address, len) < 0)
+		{
+			// Expected if the storage service is on another host
+			m_logger->info("Unable to connect to storage shared memory channel, using HTTP: %s",
+					strerror(errno));
+			close(sock);
+			return false;
+		}
+		RDSConnectHeader conhdr;
+		conhdr.magic = RDS_CONNECTION_MAGIC;
+		conhdr.token = token;
+		int memfd, requestfd, responsefd;
+		if (write(sock, &conhdr, sizeof(conhdr)) != sizeof(conhdr)
+			|| !ShmChannel::receiveDescriptors(sock, &memfd, &requestfd, &responsefd))
+		{
+			m_logger->warn("Failed to establish the storage shared memory channel");
+			close(sock);
+			return false;
+		}
+		m_shm = new ShmChannel();
+		if (!m_shm->attach(memfd, requestfd, responsefd))
+		{
+			delete m_shm;
+			m_shm = NULL;
+			close(sock);
+			return false;
+		}
+		// The socket is kept open so the storage service knows when we go away
+		m_shmSocket = sock;
+		m_logger->info("Storage shared memory channel established");
+		return true;
+	} catch (exception& ex) {
+		m_logger->warn("Failed to create storage shared memory channel: %s", ex.what());
+	}
+	return false;
+}
+
+/**
+ * Enable or disable the use of a shared memory channel for reading
+ * appends and binary fetches. The channel is only used if the storage
+ * service runs on the same host, otherwise the HTTP interface is used.
+ * It is disabled by default.
+ *
+ * @param enable	Use the shared memory channel if it is available
+ */
+void StorageClient::setSharedMemory(bool enable)
+{
+	lock_guard<mutex> guard(m_shmMutex);
+	if (enable == m_shmEnabled)
+		return;
+	m_shmEnabled = enable;
+	if (enable)
+	{
+		// Negotiate a channel on the next request
+		m_shmAttempted = false;
+	}
+	else
+	{
+		closeShmChannel();
+	}
+}
+
+/**
+ * Close the shared memory channel, all further requests will use
+ * the HTTP interface.
+ *
+ * Must be called with the shared memory mutex held.
+ */
+void StorageClient::closeShmChannel()
+{
+	delete m_shm;
+	m_shm = NULL;
+	if (m_shmSocket != -1)
+	{
+		close(m_shmSocket);
+		m_shmSocket = -1;
+	}
+}
+
+/**
+ * Send the request that has been committed to the request ring and
+ * wait for the response from the storage service.
+ *
+ * Must be called with the shared memory mutex held.
+ *
+ * @return ShmMessage*	The response message or NULL if the channel failed
+ */
+ShmMessage *StorageClient::shmExchange()
+{
+	m_shm->signal(m_shm->requestEvent());
+	ShmMessage *msg = NULL;
+	if (m_shm->wait(m_shm->responseEvent(), SHM_TIMEOUT))
+	{
+		msg = m_shm->response()->peek();
+	}
+	if (!msg)
+	{
+		m_logger->error("No response on storage shared memory channel, reverting to HTTP");
+		closeShmChannel();
+	}
+	return msg;
+}
+
+/**
+ * Append readings via the shared memory channel. The readings are written
+ * into the request ring in the layout of the ReadingStream structure so
+ * that the storage service can pass them directly to the storage plugin.
+ *
+ * @param readings	The readings to append
+ * @return int		1 if the readings were appended, 0 if the append
+ *			failed and -1 if the HTTP interface should be used.
+ *			If no response is received the append is reported
+ *			as indeterminate, see lastAppendIndeterminate
+ */
+int StorageClient::shmAppend(const vector<Reading *>& readings)
+{
+	lock_guard<mutex> guard(m_shmMutex);
+	if (!m_shmEnabled || (!m_shm && (m_shmAttempted || !openShmChannel())))
+	{
+		return -1;
+	}
+
+	vector<string> payloads;
+	payloads.reserve(readings.size());
+	size_t length = sizeof(ShmAppendHeader);
+	for (auto reading : readings)
+	{
+		payloads.push_back(reading->getDatapointsJSON());
+		length += SHM_ALIGN(offsetof(ReadingStream, assetCode)
+				+ reading->getAssetName().length() + 1
+				+ payloads.back().length() + 1);
+	}
+	if (length > m_shm->request()->capacity())
+	{
+		return -1;
+	}
+	char *ptr = (char *)m_shm->request()->reserve(ShmAppend, length);
+	if (!ptr)
+	{
+		// Storage service is not consuming requests
+		closeShmChannel();
+		return -1;
+	}
+
+	ShmAppendHeader *hdr = (ShmAppendHeader *)ptr;
+	hdr->count = readings.size();
+	hdr->pad = 0;
+	ptr += sizeof(ShmAppendHeader);
+	for (size_t i = 0; i < readings.size(); i++)
+	{
+		ReadingStream *rs = (ReadingStream *)ptr;
+		const string& asset = readings[i]->getAssetName();
+		rs->assetCodeLength = asset.length() + 1;
+		rs->payloadLength = payloads[i].length() + 1;
+		readings[i]->getUserTimestamp(&rs->userTs);
+		memcpy(rs->assetCode, asset.c_str(), rs->assetCodeLength);
+		memcpy(&rs->assetCode[rs->assetCodeLength], payloads[i].c_str(), rs->payloadLength);
+		ptr += SHM_ALIGN(offsetof(ReadingStream, assetCode) + rs->assetCodeLength + rs->payloadLength);
+	}
+	m_shm->request()->commit();
+
+	ShmMessage *msg = shmExchange();
+	if (!msg)
+	{
+		// The readings may have been appended, let the caller decide
+		appendIndeterminate = true;
+		return 0;
+	}
+	ShmResult *result = (ShmResult *)(msg + 1);
+	int rval = (msg->type == ShmAppendResult && result->status == 0) ? 1 : 0;
+	if (!rval)
+	{
+		m_logger->error("Append readings via shared memory failed: %d", result->status);
+	}
+	m_shm->response()->release();
+	return rval;
+}
+
+/**
+ * Fetch a block of readings via the shared memory channel
+ *
+ * @param readingId	The ID of the first reading to fetch
+ * @param count		Maximum number if readings to return
+ * @param handled	Set if the fetch was handled by the shared memory channel
+ * @return ReadingSet*	The set of readings
+ */
+ReadingSet *StorageClient::shmFetch(const unsigned long readingId, const unsigned long count, bool& handled)
+{
+	lock_guard<mutex> guard(m_shmMutex);
+	handled = false;
+	if (!m_shmEnabled || !m_shmFetch || (!m_shm && (m_shmAttempted || !openShmChannel())))
+	{
+		return NULL;
+	}
+
+	ShmFetchRequest *req = (ShmFetchRequest *)m_shm->request()->reserve(ShmFetch, sizeof(ShmFetchRequest));
+	if (!req)
+	{
+		closeShmChannel();
+		return NULL;
+	}
+	req->id = readingId;
+	req->count = count;
+	req->pad = 0;
+	m_shm->request()->commit();
+
+	ShmMessage *msg = shmExchange();
+	if (!msg)
+	{
+		return NULL;
+	}
+	ReadingSet *readings = NULL;
+	if (msg->type == ShmFetchResult)
+	{
+		handled = true;
+		try {
+			readings = new ReadingSet((const char *)(msg + 1), msg->length);
+		} catch (...) {
+			m_shm->response()->release();
+			throw;
+		}
+	}
+	else
+	{
+		ShmResult *result = (ShmResult *)(msg + 1);
+		if (result->status == -ENOTSUP)
+		{
+			m_logger->info("The storage plugin does not support binary reading fetch, fetches will use HTTP");
+			m_shmFetch = false;
+		}
+	}
+	m_shm->response()->release();
+	return readings;
+}
+
 /**
  * Unregister interest for a table name
  *
@@ -1778,14 +2398,9 @@ bool StorageClient::createSchema(const std::string& payload)
  */
 int StorageClient::updateTable(const string& schema, const string& tableName, std::vector<std::pair<InsertValue*, Where*> >& updates, const UpdateModifier *modifier)
 {
-        static HttpClient *httpClient = this->getHttpClient(); // to initialize m_seqnum_map[thread_id] for this thread
         try {
-                std::thread::id thread_id = std::this_thread::get_id();
                 ostringstream ss;
-                sto_mtx_client_map.lock();
-                m_seqnum_map[thread_id].fetch_add(1);
-                ss << m_pid << "#" << thread_id << "_" << m_seqnum_map[thread_id].load();
-                sto_mtx_client_map.unlock();
+                ss << m_pid << "#" << std::this_thread::get_id() << "_" << m_clients->nextSequence();
 
                 SimpleWeb::CaseInsensitiveMultimap headers = {{"SeqNum", ss.str()}};
 
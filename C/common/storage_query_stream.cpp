@@ -0,0 +1,498 @@
+/*
+ * Fledge storage service client
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <storage_query_stream.h>
+#include <logger.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/error/en.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <stdint.h>
+
+using namespace std;
+using namespace rapidjson;
+
+/**
+ * Handler for the parse of a query result that locates the start of
+ * each row object within the rows array of the result
+ */
+class RowLocator : public BaseReaderHandler<UTF8<>, RowLocator> {
+	public:
+		RowLocator() : m_depth(0), m_inRows(false), m_rowStarted(false) {};
+		bool	Default() { return true; };
+		bool	Key(const char *str, SizeType length, bool)
+		{
+			if (m_depth == 1)
+				m_key.assign(str, length);
+			return true;
+		};
+		bool	StartObject()
+		{
+			m_depth++;
+			if (m_inRows && m_depth == 3)
+				m_rowStarted = true;
+			return true;
+		};
+		bool	EndObject(SizeType)
+		{
+			m_depth--;
+			return true;
+		};
+		bool	StartArray()
+		{
+			m_depth++;
+			if (m_depth == 2 && m_key.compare("rows") == 0)
+				m_inRows = true;
+			return true;
+		};
+		bool	EndArray(SizeType)
+		{
+			if (m_depth == 2)
+				m_inRows = false;
+			m_depth--;
+			return true;
+		};
+		int		m_depth;
+		bool		m_inRows;
+		bool		m_rowStarted;
+		std::string	m_key;
+};
+
+/**
+ * Handler that passes the events of the parse of a single row on to the
+ * document the row is built in and tracks the end of the row
+ */
+class RowForwarder {
+	public:
+		RowForwarder(Document& document) : m_document(document), m_depth(1) {};
+		bool	Null() { return m_document.Null(); };
+		bool	Bool(bool b) { return m_document.Bool(b); };
+		bool	Int(int i) { return m_document.Int(i); };
+		bool	Uint(unsigned u) { return m_document.Uint(u); };
+		bool	Int64(int64_t i) { return m_document.Int64(i); };
+		bool	Uint64(uint64_t u) { return m_document.Uint64(u); };
+		bool	Double(double d) { return m_document.Double(d); };
+		bool	RawNumber(const char *str, SizeType length, bool copy)
+		{
+			return m_document.RawNumber(str, length, copy);
+		};
+		bool	String(const char *str, SizeType length, bool copy)
+		{
+			return m_document.String(str, length, copy);
+		};
+		bool	Key(const char *str, SizeType length, bool copy)
+		{
+			return m_document.Key(str, length, copy);
+		};
+		bool	StartObject() { m_depth++; return m_document.StartObject(); };
+		bool	EndObject(SizeType count) { m_depth--; return m_document.EndObject(count); };
+		bool	StartArray() { m_depth++; return m_document.StartArray(); };
+		bool	EndArray(SizeType count) { m_depth--; return m_document.EndArray(count); };
+		int	depth() const { return m_depth; };
+	private:
+		Document&	m_document;
+		int		m_depth;
+};
+
+/**
+ * Generator used to populate a document with a row of the result. The
+ * start of the row object has already been consumed by the RowLocator.
+ */
+class RowGenerator {
+	public:
+		RowGenerator(Reader& reader, StorageQueryStream& stream) :
+			m_reader(reader), m_stream(stream), m_ok(true) {};
+		bool	operator()(Document& document)
+		{
+			RowForwarder forwarder(document);
+			document.StartObject();
+			while (forwarder.depth() > 0)
+			{
+				if (!m_reader.IterativeParseNext<kParseDefaultFlags>(m_stream, forwarder))
+				{
+					m_ok = false;
+					return false;
+				}
+			}
+			return true;
+		};
+		bool	ok() const { return m_ok; };
+	private:
+		Reader&			m_reader;
+		StorageQueryStream&	m_stream;
+		bool			m_ok;
+};
+
+/**
+ * Construct a streamed query of the storage service
+ *
+ * @param host	The host of the storage service
+ * @param port	The port of the storage service
+ */
+StorageQueryStream::StorageQueryStream(const string& host, unsigned short port) :
+	m_host(host), m_port(port), m_socket(-1), m_pos(0), m_length(0), m_chunked(false),
+	m_firstChunk(true), m_remaining(0), m_end(false), m_tell(0)
+{
+}
+
+/**
+ * Destructor for the streamed query, closes the connection
+ */
+StorageQueryStream::~StorageQueryStream()
+{
+	if (m_socket >= 0)
+	{
+		close(m_socket);
+	}
+}
+
+/**
+ * Send the query to the storage service and pass each row of the
+ * result to the callback as it is received.
+ *
+ * If the storage service does not return a 200 status the body of
+ * the response is available from getBody().
+ *
+ * @param method	The HTTP method of the query
+ * @param url		The URL of the query
+ * @param payload	The query payload
+ * @param callback	The callback to pass each row to
+ * @param data		Data to pass to the callback
+ * @return long		The number of rows passed to the callback or -1 on error
+ */
+long StorageQueryStream::query(const string& method, const string& url, const string& payload,
+		STORAGE_ROW_CB callback, void *data)
+{
+	if (!connect() || !sendRequest(method, url, payload) || !readHeaders())
+	{
+		return -1;
+	}
+	if (m_status.compare(0, 3, "200") != 0)
+	{
+		while (Peek() != '\0')
+		{
+			m_body += Take();
+		}
+		return -1;
+	}
+	return parseRows(callback, data);
+}
+
+/**
+ * Parse the body of the response and pass each row to the callback
+ * as soon as the row has been received.
+ *
+ * @param callback	The callback to pass each row to
+ * @param data		Data to pass to the callback
+ * @return long		The number of rows passed to the callback or -1 on error
+ */
+long StorageQueryStream::parseRows(STORAGE_ROW_CB callback, void *data)
+{
+	Reader reader;
+	RowLocator locator;
+	long rows = 0;
+
+	reader.IterativeParseInit();
+	while (!reader.IterativeParseComplete())
+	{
+		if (!reader.IterativeParseNext<kParseDefaultFlags>(*this, locator))
+		{
+			Logger::getLogger()->error("Unable to parse streamed query result: %s at offset %u",
+					GetParseError_En(reader.GetParseErrorCode()),
+					(unsigned int)reader.GetErrorOffset());
+			return -1;
+		}
+		if (locator.m_rowStarted)
+		{
+			locator.m_rowStarted = false;
+			Document row;
+			RowGenerator generator(reader, *this);
+			row.Populate(generator);
+			if (!generator.ok())
+			{
+				Logger::getLogger()->error("Unable to parse row %ld of streamed query result: %s at offset %u",
+						rows,
+						GetParseError_En(reader.GetParseErrorCode()),
+						(unsigned int)reader.GetErrorOffset());
+				return -1;
+			}
+			// The generator consumed the end of the row object
+			locator.m_depth--;
+			rows++;
+			if (!(*callback)(data, row))
+			{
+				break;
+			}
+		}
+	}
+	return rows;
+}
+
+/**
+ * Connect to the storage service
+ *
+ * @return bool	True if the connection was made
+ */
+bool StorageQueryStream::connect()
+{
+	struct addrinfo hints, *result, *rp;
+	bzero(&hints, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	string port = to_string(m_port);
+	int rval;
+	if ((rval = getaddrinfo(m_host.c_str(), port.c_str(), &hints, &result)) != 0)
+	{
+		Logger::getLogger()->error("Unable to resolve storage service host %s: %s",
+				m_host.c_str(), gai_strerror(rval));
+		return false;
+	}
+	for (rp = result; rp; rp = rp->ai_next)
+	{
+		m_socket = socket(rp->ai_family, rp->ai_socktype | SOCK_CLOEXEC, rp->ai_protocol);
+		if (m_socket == -1)
+			continue;
+		if (::connect(m_socket, rp->ai_addr, rp->ai_addrlen) == 0)
+			break;
+		close(m_socket);
+		m_socket = -1;
+	}
+	freeaddrinfo(result);
+	if (m_socket == -1)
+	{
+		Logger::getLogger()->error("Unable to connect to storage service %s:%d for streamed query",
+				m_host.c_str(), m_port);
+		return false;
+	}
+	struct timeval timeout;
+	timeout.tv_sec = QUERY_STREAM_TIMEOUT;
+	timeout.tv_usec = 0;
+	setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	return true;
+}
+
+/**
+ * Send the request to the storage service
+ *
+ * @param method	The HTTP method of the request
+ * @param url		The URL of the request
+ * @param payload	The payload of the request
+ * @return bool		True if the request was sent
+ */
+bool StorageQueryStream::sendRequest(const string& method, const string& url, const string& payload)
+{
+	string request = method + " " + url + " HTTP/1.1\r\n";
+	request += "Host: " + m_host + ":" + to_string(m_port) + "\r\n";
+	request += "Content-Type: application/json\r\n";
+	request += "Content-Length: " + to_string(payload.length()) + "\r\n";
+	request += "Connection: close\r\n\r\n";
+	request += payload;
+
+	const char *p = request.c_str();
+	size_t left = request.length();
+	while (left > 0)
+	{
+		ssize_t n = send(m_socket, p, left, MSG_NOSIGNAL);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+				continue;
+			Logger::getLogger()->error("Failed to send streamed query to the storage service: %s",
+					strerror(errno));
+			return false;
+		}
+		p += n;
+		left -= (size_t)n;
+	}
+	return true;
+}
+
+/**
+ * Read the status line and the headers of the response
+ *
+ * @return bool	True if the headers were read
+ */
+bool StorageQueryStream::readHeaders()
+{
+	string line;
+	if (!readLine(line))
+	{
+		Logger::getLogger()->error("No response from the storage service to streamed query");
+		return false;
+	}
+	size_t space = line.find(' ');
+	if (line.compare(0, 5, "HTTP/") != 0 || space == string::npos)
+	{
+		Logger::getLogger()->error("Malformed response from the storage service to streamed query: %s",
+				line.c_str());
+		return false;
+	}
+	m_status = line.substr(space + 1);
+
+	bool haveLength = false;
+	while (readLine(line) && !line.empty())
+	{
+		size_t colon = line.find(':');
+		if (colon == string::npos)
+			continue;
+		string name = line.substr(0, colon);
+		size_t start = line.find_first_not_of(" \t", colon + 1);
+		string value = start == string::npos ? "" : line.substr(start);
+		if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0
+				&& strcasestr(value.c_str(), "chunked"))
+		{
+			m_chunked = true;
+		}
+		else if (strcasecmp(name.c_str(), "Content-Length") == 0)
+		{
+			m_remaining = strtoul(value.c_str(), NULL, 10);
+			haveLength = true;
+		}
+	}
+	if (m_chunked)
+	{
+		m_remaining = 0;
+	}
+	else if (!haveLength)
+	{
+		// The body ends when the connection is closed
+		m_remaining = SIZE_MAX;
+	}
+	return true;
+}
+
+/**
+ * Read a line of the response, the line terminator is removed
+ *
+ * @param line	The line read
+ * @return bool	False if the connection closed before a line was read
+ */
+bool StorageQueryStream::readLine(string& line)
+{
+	line.clear();
+	while (true)
+	{
+		if (m_pos == m_length && !fill())
+		{
+			return false;
+		}
+		char c = m_buffer[m_pos++];
+		if (c == '\n')
+		{
+			return true;
+		}
+		if (c != '\r')
+		{
+			line += c;
+		}
+	}
+}
+
+/**
+ * Read more data from the connection into the buffer
+ *
+ * @return bool	False if the connection has closed or failed
+ */
+bool StorageQueryStream::fill()
+{
+	ssize_t n;
+	do {
+		n = recv(m_socket, m_buffer, sizeof(m_buffer), 0);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0)
+	{
+		if (n < 0)
+		{
+			Logger::getLogger()->error("Failed to read streamed query result: %s", strerror(errno));
+		}
+		return false;
+	}
+	m_pos = 0;
+	m_length = (size_t)n;
+	return true;
+}
+
+/**
+ * Move to the next chunk of a chunked response
+ *
+ * @return bool	False if there are no more chunks
+ */
+bool StorageQueryStream::nextChunk()
+{
+	string line;
+	if (!m_firstChunk)
+	{
+		// Consume the line end that follows the data of the previous chunk
+		if (!readLine(line))
+			return false;
+	}
+	m_firstChunk = false;
+	if (!readLine(line))
+	{
+		return false;
+	}
+	m_remaining = strtoul(line.c_str(), NULL, 16);
+	if (m_remaining == 0)
+	{
+		// Consume any trailers
+		while (readLine(line) && !line.empty())
+			;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Return the next character of the body of the response without
+ * consuming it.
+ *
+ * @return char	The next character or '\0' at the end of the body
+ */
+StorageQueryStream::Ch StorageQueryStream::Peek()
+{
+	if (m_end)
+	{
+		return '\0';
+	}
+	if (m_remaining == 0 && (!m_chunked || !nextChunk()))
+	{
+		m_end = true;
+		return '\0';
+	}
+	if (m_pos == m_length && !fill())
+	{
+		m_end = true;
+		return '\0';
+	}
+	return m_buffer[m_pos];
+}
+
+/**
+ * Consume the next character of the body of the response
+ *
+ * @return char	The character or '\0' at the end of the body
+ */
+StorageQueryStream::Ch StorageQueryStream::Take()
+{
+	Ch c = Peek();
+	if (!m_end)
+	{
+		m_pos++;
+		m_remaining--;
+		m_tell++;
+	}
+	return c;
+}
@@ -14,6 +14,13 @@
 #include <logger.h>
 #include <stdio.h>
 #include <string.h>
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRING_SCAN_X86	1
+#else
+#define STRING_SCAN_X86	0
+#endif
 
 using namespace std;
 
@@ -359,21 +366,233 @@ string urlDecode(const std::string& name)
 	return string(dec);
 }
 
+typedef size_t (*SCAN_FN)(const char *, size_t, char, char);
+
+/**
+ * Find the first occurrence of either of two characters, one byte at a time
+ */
+static size_t scanScalar(const char *str, size_t length, char c1, char c2)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		if (str[i] == c1 || str[i] == c2)
+			return i;
+	}
+	return length;
+}
+
+#if STRING_SCAN_X86
+/**
+ * Find the first occurrence of either of two characters, 16 bytes at a time
+ */
+__attribute__((target("sse2")))
+static size_t scanSSE2(const char *str, size_t length, char c1, char c2)
+{
+	const __m128i v1 = _mm_set1_epi8(c1);
+	const __m128i v2 = _mm_set1_epi8(c2);
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(str + i));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, v1),
+					_mm_cmpeq_epi8(block, v2)));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + scanScalar(str + i, length - i, c1, c2);
+}
+
+/**
+ * Find the first occurrence of either of two characters, 32 bytes at a time
+ */
+__attribute__((target("avx2")))
+static size_t scanAVX2(const char *str, size_t length, char c1, char c2)
+{
+	const __m256i v1 = _mm256_set1_epi8(c1);
+	const __m256i v2 = _mm256_set1_epi8(c2);
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(str + i));
+		unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, v1),
+					_mm256_cmpeq_epi8(block, v2)));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + scanSSE2(str + i, length - i, c1, c2);
+}
+#endif
+
+/**
+ * Select the scan supported by the CPU
+ */
+static SCAN_FN selectScan()
+{
+#if STRING_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return scanAVX2;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		return scanSSE2;
+	}
+#endif
+	return scanScalar;
+}
+
+/**
+ * Find the first occurrence of either of two characters in a buffer.
+ * The buffer is scanned 16 or 32 bytes at a time when the CPU supports
+ * it, this is the basis of the escaping functions below which copy the
+ * spans of characters that need no escaping as a whole.
+ *
+ * @param str		The buffer to scan
+ * @param length	The length of the buffer
+ * @param c1		The first character to find
+ * @param c2		The second character to find, may be the same as c1
+ * @return size_t	The offset of the first match or length if there is none
+ */
+size_t StringScan(const char *str, size_t length, char c1, char c2)
+{
+	static const SCAN_FN scan = selectScan();
+	return scan(str, length, c1, c2);
+}
+
 /**
  * Escape all double quotes characters in the string
  *
+ * A double quote that follows a backslash is considered to be
+ * escaped already. The string is not modified if it contains no
+ * double quotes.
+ *
  * @param str	The string to escape
  */
 void StringEscapeQuotes(std::string& str)
 {
-	for (size_t i = 0; i < str.length(); i++)
+	size_t length = str.length();
+	size_t pos = StringScan(str.data(), length, '\"', '\"');
+	if (pos == length)
 	{
-		if (str[i] == '\"' && (i == 0 || str[i-1] != '\\'))
+		return;
+	}
+	string escaped;
+	escaped.reserve(length + 16);
+	size_t i = 0;
+	while (true)
+	{
+		escaped.append(str, i, pos - i);
+		if (pos == length)
+			break;
+		if (pos == 0 || str[pos - 1] != '\\')
+			escaped.push_back('\\');
+		escaped.push_back('\"');
+		i = pos + 1;
+		pos = i + StringScan(str.data() + i, length - i, '\"', '\"');
+	}
+	str.swap(escaped);
+}
+
+/**
+ * Append a string to another, escaping the double quotes so that the
+ * string can be a property value within a JSON document. A double quote
+ * preceded by an odd number of backslashes is already escaped.
+ *
+ * @param out	The string to append to
+ * @param str	The string to escape
+ */
+void StringAppendEscapedQuotes(std::string& out, const std::string& str)
+{
+	const char *p = str.data();
+	size_t length = str.length();
+	size_t i = 0;
+	int bscount = 0;
+
+	while (i < length)
+	{
+		size_t pos = i + StringScan(p + i, length - i, '\\', '\"');
+		if (pos != i)
+		{
+			out.append(p + i, pos - i);
+			bscount = 0;
+		}
+		if (pos == length)
+			break;
+		if (p[pos] == '\\')
 		{
-			str.replace(i, 1, "\\\"");
+			bscount++;
 		}
+		else
+		{
+			if ((bscount & 1) == 0)	// not already escaped
+				out.push_back('\\');
+			bscount = 0;
+		}
+		out.push_back(p[pos]);
+		i = pos + 1;
+	}
+}
 
+/**
+ * Escape all backslashes and double quotes in a string
+ *
+ * @param str		The string to escape
+ * @return string	The escaped string, a copy of str if nothing needs escaping
+ */
+std::string StringEscapeJSON(const std::string& str)
+{
+	const char *p = str.data();
+	size_t length = str.length();
+	size_t pos = StringScan(p, length, '\\', '\"');
+	if (pos == length)
+	{
+		return str;
+	}
+	string escaped;
+	escaped.reserve(length + 16);
+	size_t i = 0;
+	while (true)
+	{
+		escaped.append(p + i, pos - i);
+		if (pos == length)
+			break;
+		escaped.push_back('\\');
+		escaped.push_back(p[pos]);
+		i = pos + 1;
+		pos = i + StringScan(p + i, length - i, '\\', '\"');
 	}
+	return escaped;
+}
+
+/**
+ * Escape the single quotes in a string for use as an SQL string literal
+ *
+ * @param str		The string to escape
+ * @return string	The escaped string, a copy of str if nothing needs escaping
+ */
+std::string StringEscapeSQL(const std::string& str)
+{
+	const char *p = str.data();
+	size_t length = str.length();
+	size_t pos = StringScan(p, length, '\'', '\'');
+	if (pos == length)
+	{
+		return str;
+	}
+	string escaped;
+	escaped.reserve(length + 16);
+	size_t i = 0;
+	while (true)
+	{
+		escaped.append(p + i, pos - i);
+		if (pos == length)
+			break;
+		escaped.append("''");
+		i = pos + 1;
+		pos = i + StringScan(p + i, length - i, '\'', '\'');
+	}
+	return escaped;
 }
 
 /**
@@ -462,3 +681,130 @@ std::string StringAround(const std::string& str, unsigned int pos,
 	size_t	len = before + after;
 	return str.substr(start, len);
 }
+
+/**
+ * Write the decimal representation of an unsigned long into a caller
+ * supplied buffer, without going via snprintf or a temporary string.
+ * The buffer must be at least NUMBER_BUFFER_LEN bytes long.
+ *
+ * @param buffer	The buffer to write into, it is null terminated
+ * @param value		The value to format
+ * @param width		Minimum number of digits, padded with leading zeros
+ * @return		The number of characters written, excluding the terminator
+ */
+size_t FormatUnsignedLong(char *buffer, unsigned long value, unsigned int width)
+{
+	static const char digitPairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	char	tmp[NUMBER_BUFFER_LEN];
+	char	*ptr = &tmp[NUMBER_BUFFER_LEN];
+
+	while (value >= 100)
+	{
+		unsigned int idx = (value % 100) * 2;
+		value /= 100;
+		*--ptr = digitPairs[idx + 1];
+		*--ptr = digitPairs[idx];
+	}
+	if (value >= 10)
+	{
+		unsigned int idx = value * 2;
+		*--ptr = digitPairs[idx + 1];
+		*--ptr = digitPairs[idx];
+	}
+	else
+	{
+		*--ptr = (char)('0' + value);
+	}
+	if (width >= NUMBER_BUFFER_LEN)
+		width = NUMBER_BUFFER_LEN - 1;
+	while ((size_t)(&tmp[NUMBER_BUFFER_LEN] - ptr) < width)
+	{
+		*--ptr = '0';
+	}
+
+	size_t len = &tmp[NUMBER_BUFFER_LEN] - ptr;
+	memcpy(buffer, ptr, len);
+	buffer[len] = 0;
+	return len;
+}
+
+/**
+ * Write the decimal representation of a signed long into a caller
+ * supplied buffer. The buffer must be at least NUMBER_BUFFER_LEN bytes long.
+ *
+ * @param buffer	The buffer to write into, it is null terminated
+ * @param value		The value to format
+ * @return		The number of characters written, excluding the terminator
+ */
+size_t FormatLong(char *buffer, long value)
+{
+	if (value < 0)
+	{
+		// Negate as unsigned to cope with LONG_MIN
+		*buffer = '-';
+		return FormatUnsignedLong(buffer + 1, 0UL - (unsigned long)value) + 1;
+	}
+	return FormatUnsignedLong(buffer, (unsigned long)value);
+}
+
+/**
+ * Write a double in fixed point notation into a caller supplied buffer.
+ * Optionally trailing zeros of the fractional part are removed, always
+ * leaving at least one digit after the decimal point.
+ *
+ * Values with no fractional part that fit in a long are formatted
+ * with the integer routine, everything else falls back to snprintf
+ * in order to retain correct rounding.
+ *
+ * @param buffer	The buffer to write into, it is null terminated
+ * @param size		The size of the buffer
+ * @param value		The value to format
+ * @param precision	The number of digits after the decimal point
+ * @param trim		Remove trailing zeros from the fractional part
+ * @return		The number of characters written, excluding the terminator
+ */
+size_t FormatDouble(char *buffer, size_t size, double value, int precision, bool trim)
+{
+	size_t len;
+
+	if (size >= NUMBER_BUFFER_LEN + precision + 2 && precision > 0
+			&& value > -1e15 && value < 1e15 && value == (double)(long)value
+			&& !(value == 0.0 && signbit(value)))
+	{
+		// Integral value, no rounding of the fraction is required
+		len = FormatLong(buffer, (long)value);
+		buffer[len++] = '.';
+		int zeros = trim ? 1 : precision;
+		memset(&buffer[len], '0', zeros);
+		len += zeros;
+		buffer[len] = 0;
+		return len;
+	}
+
+	int rval = snprintf(buffer, size, "%.*f", precision, value);
+	if (rval < 0)
+	{
+		buffer[0] = 0;
+		return 0;
+	}
+	len = (size_t)rval < size ? (size_t)rval : size - 1;
+	if (trim && precision > 0 && len > 0 && buffer[len - 1] == '0')
+	{
+		while (len > 1 && buffer[len - 1] == '0')
+			len--;
+		if (buffer[len - 1] == '.')
+			len++;		// Retain a single zero after the point
+		buffer[len] = 0;
+	}
+	return len;
+}
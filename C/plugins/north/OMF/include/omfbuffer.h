@@ -14,6 +14,7 @@
 #include <list>
 
 #define BUFFER_CHUNK	8192
+#define OMF_DOUBLE_LEN	330	// Large enough for %f of DBL_MAX
 
 /**
  * Buffer class designed to hold OMF payloads that can
@@ -52,6 +53,7 @@ class OMFBuffer {
 		void			clear();
 
 	private:
+		Buffer			*reserve(unsigned int len);
 		std::list<Buffer *>	buffers;
 };
 
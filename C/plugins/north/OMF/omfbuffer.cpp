@@ -102,19 +102,9 @@ OMFBuffer::Buffer *buffer = buffers.back();
  */
 void OMFBuffer::append(const int value)
 {
-char	tmpbuf[80];
-unsigned int len;
-OMFBuffer::Buffer *buffer = buffers.back();
+OMFBuffer::Buffer *buffer = reserve(NUMBER_BUFFER_LEN);
 
-	len = (unsigned int)snprintf(tmpbuf, 80, "%d", value);
-        if (buffer->offset + len >= buffer->length)
-        {
-		buffer = new OMFBuffer::Buffer();
-		buffers.push_back(buffer);
-	}
-	memcpy(&buffer->data[buffer->offset], tmpbuf, len);
-	buffer->offset += len;
-	buffer->data[buffer->offset] = 0;
+	buffer->offset += FormatLong(&buffer->data[buffer->offset], value);
 }
 
 /**
@@ -124,19 +114,9 @@ OMFBuffer::Buffer *buffer = buffers.back();
  */
 void OMFBuffer::append(const long value)
 {
-char	tmpbuf[80];
-unsigned int len;
-OMFBuffer::Buffer *buffer = buffers.back();
+OMFBuffer::Buffer *buffer = reserve(NUMBER_BUFFER_LEN);
 
-	len = (unsigned int)snprintf(tmpbuf, 80, "%ld", value);
-        if (buffer->offset + len >= buffer->length)
-        {
-		buffer = new OMFBuffer::Buffer();
-		buffers.push_back(buffer);
-	}
-	memcpy(&buffer->data[buffer->offset], tmpbuf, len);
-	buffer->offset += len;
-	buffer->data[buffer->offset] = 0;
+	buffer->offset += FormatLong(&buffer->data[buffer->offset], value);
 }
 
 /**
@@ -146,19 +126,9 @@ OMFBuffer::Buffer *buffer = buffers.back();
  */
 void OMFBuffer::append(const unsigned int value)
 {
-char	tmpbuf[80];
-unsigned int len;
-OMFBuffer::Buffer *buffer = buffers.back();
+OMFBuffer::Buffer *buffer = reserve(NUMBER_BUFFER_LEN);
 
-	len = (unsigned int)snprintf(tmpbuf, 80, "%u", value);
-        if (buffer->offset + len >= buffer->length)
-        {
-		buffer = new OMFBuffer::Buffer();
-		buffers.push_back(buffer);
-	}
-	memcpy(&buffer->data[buffer->offset], tmpbuf, len);
-	buffer->offset += len;
-	buffer->data[buffer->offset] = 0;
+	buffer->offset += FormatUnsignedLong(&buffer->data[buffer->offset], value);
 }
 
 /**
@@ -168,19 +138,9 @@ OMFBuffer::Buffer *buffer = buffers.back();
  */
 void OMFBuffer::append(const unsigned long value)
 {
-char	tmpbuf[80];
-unsigned int len;
-OMFBuffer::Buffer *buffer = buffers.back();
+OMFBuffer::Buffer *buffer = reserve(NUMBER_BUFFER_LEN);
 
-	len = (unsigned int)snprintf(tmpbuf, 80, "%lu", value);
-        if (buffer->offset + len >= buffer->length)
-        {
-		buffer = new OMFBuffer::Buffer();
-		buffers.push_back(buffer);
-	}
-	memcpy(&buffer->data[buffer->offset], tmpbuf, len);
-	buffer->offset += len;
-	buffer->data[buffer->offset] = 0;
+	buffer->offset += FormatUnsignedLong(&buffer->data[buffer->offset], value);
 }
 
 /**
@@ -190,19 +150,29 @@ OMFBuffer::Buffer *buffer = buffers.back();
  */
 void OMFBuffer::append(const double value)
 {
-char	tmpbuf[80];
-unsigned int len;
+OMFBuffer::Buffer *buffer = reserve(OMF_DOUBLE_LEN);
+
+	buffer->offset += FormatDouble(&buffer->data[buffer->offset], OMF_DOUBLE_LEN, value, 6, false);
+}
+
+/**
+ * Make sure the last buffer in the chain has room for at least len
+ * characters plus a terminating null, adding a new buffer if not.
+ * Numeric values are formatted directly into the returned buffer.
+ *
+ * @param len	The number of characters required
+ * @return	The buffer to append to
+ */
+OMFBuffer::Buffer *OMFBuffer::reserve(unsigned int len)
+{
 OMFBuffer::Buffer *buffer = buffers.back();
 
-	len = (unsigned int)snprintf(tmpbuf, 80, "%f", value);
         if (buffer->offset + len >= buffer->length)
         {
 		buffer = new OMFBuffer::Buffer();
 		buffers.push_back(buffer);
 	}
-	memcpy(&buffer->data[buffer->offset], tmpbuf, len);
-	buffer->offset += len;
-	buffer->data[buffer->offset] = 0;
+	return buffer;
 }
 
 /**
@@ -29,6 +29,7 @@
 #include <sys/time.h>
 
 #include "json_utils.h"
+#include <string_utils.h>
 
 #include <iostream>
 #include <chrono>
@@ -3280,78 +3281,17 @@ const string Connection::double_quote_reserved_column_name(const string &column_
   */
 const string Connection::escape_double_quotes(const string& str)
 {
-	char		*buffer;
-	const char	*p1;
-	char  		*p2;
-	string		newString;
-
-	if (str.find_first_of('\"') == string::npos)
+	// Backslashes are only escaped if the string contains double quotes
+	if (StringScan(str.data(), str.length(), '\"', '\"') == str.length())
 	{
 		return str;
 	}
-
-	buffer = (char *)malloc(str.length() * 2);
-
-	p1 = str.c_str();
-	p2 = buffer;
-	while (*p1)
-	{
-		if (*p1 == '\"')
-		{
-			*p2++ = '\\';
-			*p2++ = '\"';
-			p1++;
-		}
-		else if (*p1 == '\\' ) // Take care of previously escaped quotes
-		{
-			*p2++ = '\\';
-			*p2++ = '\\';
-			p1++;
-		}
-		else
-		{
-			*p2++ = *p1++;
-		}
-	}
-	*p2 = 0;
-	newString = string(buffer);
-	free(buffer);
-	return newString;
+	return StringEscapeJSON(str);
 }
 
 const string Connection::escape(const string& str)
 {
-char    *buffer;
-const char    *p1;
-char  *p2;
-string  newString;
-
-    if (str.find_first_of('\'') == string::npos)
-    {
-        return str;
-    }
-
-    buffer = (char *)malloc(str.length() * 2);
-
-    p1 = str.c_str();
-    p2 = buffer;
-    while (*p1)
-    {
-        if (*p1 == '\'')
-        {
-            *p2++ = '\'';
-            *p2++ = '\'';
-            p1++;
-        }
-        else
-        {
-            *p2++ = *p1++;
-        }
-    }
-    *p2 = 0;
-    newString = string(buffer);
-    free(buffer);
-    return newString;
+	return StringEscapeSQL(str);
 }
 
 /**
@@ -3511,6 +3451,101 @@ SQLBuffer sql;
 	return false;
 }
 
+/**
+ * Snapshot the statistics into the statistics history and roll the
+ * previous values of the statistics forward, as a single transaction.
+ * A history row is added for every statistic, with the change in value
+ * since the last snapshot.
+ *
+ * @return		-1 on error, the number of statistics on success
+ */
+int Connection::statisticsHistory()
+{
+	const char *statements[] = {
+		"START TRANSACTION;",
+		// Prevent the statistics changing between the snapshot and the roll forward
+		"LOCK TABLE fledge.statistics IN SHARE ROW EXCLUSIVE MODE;",
+		"INSERT INTO fledge.statistics_history (key, history_ts, value) "
+			"SELECT key, now(), value - previous_value FROM fledge.statistics;",
+		"UPDATE fledge.statistics SET previous_value = value;",
+		"COMMIT;"
+	};
+	int rows = 0;
+
+	for (unsigned int i = 0; i < sizeof(statements) / sizeof(statements[0]); i++)
+	{
+		logSQL("StatisticsHistory", statements[i]);
+		PGresult *res = PQexec(dbConnection, statements[i]);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		{
+			raiseError("statistics_history", PQerrorMessage(dbConnection));
+			PQclear(res);
+			PGresult *resRollback = PQexec(dbConnection, "ROLLBACK;");
+			if (PQresultStatus(resRollback) != PGRES_COMMAND_OK)
+			{
+				raiseError(" rollback statistics_history",
+					   PQerrorMessage(dbConnection));
+			}
+			PQclear(resRollback);
+			return -1;
+		}
+		if (strncmp(statements[i], "UPDATE", 6) == 0)
+		{
+			rows = atoi(PQcmdTuples(res));
+		}
+		PQclear(res);
+	}
+	return rows;
+}
+
+/**
+ * Move the statistics history older than the given age into the
+ * daily statistics history, summing the values for each key and day.
+ * The rows are processed in batches, each batch is removed from the
+ * statistics history and added to the daily history by a single
+ * statement. A key and day may span batches, so the sums are added
+ * to any existing daily row and new rows are only inserted for the
+ * others.
+ *
+ * @param age		The age in seconds of the rows to move
+ * @param limit		The maximum number of rows to move in each batch
+ * @return		-1 on error, the number of rows moved on success
+ */
+int Connection::statisticsHistoryPurge(unsigned long age, unsigned int limit)
+{
+	string query = "WITH purged AS (DELETE FROM fledge.statistics_history WHERE id IN ";
+	query += "(SELECT id FROM fledge.statistics_history WHERE history_ts < now() - INTERVAL '";
+	query += to_string(age) + " seconds' ORDER BY id LIMIT " + to_string(limit) + ") ";
+	query += "RETURNING history_ts, key, value), ";
+	query += "sums AS (SELECT date_part('year', history_ts::date) AS year, history_ts::date AS day, ";
+	query += "key, SUM(value) AS value FROM purged GROUP BY history_ts::date, key), ";
+	query += "updated AS (UPDATE fledge.statistics_history_daily d SET value = d.value + s.value ";
+	query += "FROM sums s WHERE d.day = s.day AND d.key = s.key RETURNING d.day, d.key), ";
+	query += "daily AS (INSERT INTO fledge.statistics_history_daily (year, day, key, value) ";
+	query += "SELECT s.year, s.day, s.key, s.value FROM sums s WHERE NOT EXISTS ";
+	query += "(SELECT 1 FROM updated u WHERE u.day = s.day AND u.key = s.key)) ";
+	query += "SELECT count(*) FROM purged;";
+
+	logSQL("StatisticsHistoryPurge", query.c_str());
+
+	int total = 0;
+	int moved;
+	do {
+		PGresult *res = PQexec(dbConnection, query.c_str());
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		{
+			raiseError("statistics_history_purge", PQerrorMessage(dbConnection));
+			PQclear(res);
+			return -1;
+		}
+		moved = atoi(PQgetvalue(res, 0, 0));
+		PQclear(res);
+		total += moved;
+	} while (moved > 0 && moved >= (int)limit);
+
+	return total;
+}
+
 /**
  * Check to see if the str is a function
  *
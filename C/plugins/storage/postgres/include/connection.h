@@ -54,6 +54,8 @@ class Connection {
 		int		delete_table_snapshot(const std::string& table, const std::string& id);
 		bool		get_table_snapshots(const std::string& table,
 						    std::string& resultSet);
+		int		statisticsHistory();
+		int		statisticsHistoryPurge(unsigned long age, unsigned int limit);
 		bool		aggregateQuery(const rapidjson::Value& payload, std::string& resultSet);
 		int 		create_schema(const std::string &payload);
 		bool 		findSchemaFromDB(const std::string &service,
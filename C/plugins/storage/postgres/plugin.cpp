@@ -411,6 +411,54 @@ std::string results;
 	return rval ? strdup(results.c_str()) : NULL;
 }
 
+/**
+ * Snapshot the statistics into the statistics history and roll
+ * the previous values of the statistics forward
+ *
+ * @param handle	The plugin handle
+ * @return		-1 on error, the number of statistics on success
+ */
+int plugin_statistics_history(PLUGIN_HANDLE handle)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+
+	if (connection == NULL)
+	{
+		Logger::getLogger()->fatal("No database connections available");
+		return -1;
+	}
+
+	int result = connection->statisticsHistory();
+	manager->release(connection);
+	return result;
+}
+
+/**
+ * Move the statistics history older than a given age into the
+ * daily statistics history
+ *
+ * @param handle	The plugin handle
+ * @param age		The age in seconds of the statistics history to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return		-1 on error, the number of rows moved on success
+ */
+int plugin_statistics_history_purge(PLUGIN_HANDLE handle, unsigned long age, unsigned int limit)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+
+	if (connection == NULL)
+	{
+		Logger::getLogger()->fatal("No database connections available");
+		return -1;
+	}
+
+	int result = connection->statisticsHistoryPurge(age, limit);
+	manager->release(connection);
+	return result;
+}
+
 /**
  * Create schema of a common table
  *
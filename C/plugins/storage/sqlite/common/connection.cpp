@@ -11,6 +11,7 @@
 #include <connection.h>
 #include <connection_manager.h>
 #include <utils.h>
+#include <string_utils.h>
 #include <unistd.h>
 
 #include "readings_catalogue.h"
@@ -437,6 +438,8 @@ Connection::Connection()
 	m_logSQL = false;
 	m_queuing = 0;
 	m_streamOpenTransaction = true;
+	m_resultStream = NULL;
+	m_resultStreamData = NULL;
 
 	if (defaultConnection == NULL)
 	{
@@ -663,6 +666,10 @@ void Connection::setTrace(bool flag)
 /**
  * Map a SQLite3 result set to a string version of a JSON document
  *
+ * If a result stream has been set for the connection the rows are
+ * passed to the result stream as the result set is iterated over
+ * rather than being added to the JSON document.
+ *
  * @param res          Sqlite3 result set
  * @param resultSet    Output Json as string
  * @return             SQLite3 result code of sqlite3_step(res)
@@ -676,8 +683,13 @@ sqlite3_stmt* pStmt = (sqlite3_stmt *)res;
 Document doc;
 // SQLite3 return code
 int rc;
-// Number of returned rows, number of columns
-unsigned long nRows = 0, nCols = 0;
+// Number of returned rows
+unsigned long nRows = 0;
+
+	if (m_resultStream)
+	{
+		return streamResultSet(pStmt, rowsCount);
+	}
 
 	// Create the JSON document
 	doc.SetObject();
@@ -692,98 +704,11 @@ unsigned long nRows = 0, nCols = 0;
 	// Iterate over all the rows in the resultSet
 	while ((rc = SQLstep(pStmt)) == SQLITE_ROW)
 	{
-		// Get number of columns for current row
-		nCols = sqlite3_column_count(pStmt);
 		// Create the 'row' object
 		Value row(kObjectType);
 
 		// Build the row with all fields
-		for (int i = 0; i < nCols; i++)
-		{
-			// JSON document for the current row
-			Document d;
-			// Set object name as the column name
-			Value name(sqlite3_column_name(pStmt, i), allocator);
-			// Get the "TEXT" value of the column value
-			char* str = (char *)sqlite3_column_text(pStmt, i);
-
-			// Check the column value datatype
-			switch (sqlite3_column_type(pStmt, i))
-			{
-				case (SQLITE_NULL):
-				{
-					row.AddMember(name, "", allocator);
-					break;
-				}
-				case (SQLITE3_TEXT):
-				{
-
-					/**
-					 * Handle here possible unformatted DATETIME column type
-					 */
-					string newDate;
-					if (applyColumnDateTimeFormat(pStmt, i, newDate))
-					{
-						// Use new formatted datetime value
-						str = (char *)newDate.c_str();
-					}
-
-					Value value;
-					if (!d.Parse(str).HasParseError())
-					{
-						if (d.IsNumber())
-						{
-							// Set string
-							value = Value(str, allocator);
-						}
-						else
-						{
-							// JSON parsing ok, use the document
-							// if string value is not "null"
-							if (strcmp(str, "null") != 0)
-							{
-								value = Value(d, allocator);
-							}
-							else
-							{
-								// Use (char *) value for "null"
-								value = Value(str, allocator);
-							}
-						}
-					}
-					else
-					{
-						// Use (char *) value
-						value = Value(str, allocator);
-					}
-					// Add name & value to the current row
-					row.AddMember(name, value, allocator);
-					break;
-				}
-				case (SQLITE_INTEGER):
-				{
-					int64_t intVal = atol(str);
-					// Add name & value to the current row
-					row.AddMember(name, intVal, allocator);
-					break;
-				}
-				case (SQLITE_FLOAT):
-				{
-					double dblVal = atof(str);
-					// Add name & value to the current row
-					row.AddMember(name, dblVal, allocator);
-					break;
-				}
-				default:
-				{
-					// Default: use  (char *) value
-					Value value(str != NULL ? str : "", allocator);
-					// Add name & value to the current row
-					row.AddMember(name, value, allocator);
-					break;
-				}
-			}
-		}
+		mapRow(pStmt, row, allocator);
 
 		// All fields added: increase row counter
 		nRows++;
@@ -816,6 +741,166 @@ unsigned long nRows = 0, nCols = 0;
 	return rc;
 }
 
+/**
+ * Map the current row of a SQLite3 result set to a JSON object
+ *
+ * @param pStmt		Sqlite3 result set positioned on the row
+ * @param row		The JSON object to populate
+ * @param allocator	The allocator for the JSON values
+ */
+void Connection::mapRow(sqlite3_stmt *pStmt, Value& row, Document::AllocatorType& allocator)
+{
+	// Get number of columns for current row
+	int nCols = sqlite3_column_count(pStmt);
+
+	for (int i = 0; i < nCols; i++)
+	{
+		// JSON document for the current row
+		Document d;
+		// Set object name as the column name
+		Value name(sqlite3_column_name(pStmt, i), allocator);
+		// Get the "TEXT" value of the column value
+		char* str = (char *)sqlite3_column_text(pStmt, i);
+
+		// Check the column value datatype
+		switch (sqlite3_column_type(pStmt, i))
+		{
+			case (SQLITE_NULL):
+			{
+				row.AddMember(name, "", allocator);
+				break;
+			}
+			case (SQLITE3_TEXT):
+			{
+
+				/**
+				 * Handle here possible unformatted DATETIME column type
+				 */
+				string newDate;
+				if (applyColumnDateTimeFormat(pStmt, i, newDate))
+				{
+					// Use new formatted datetime value
+					str = (char *)newDate.c_str();
+				}
+
+				Value value;
+				if (!d.Parse(str).HasParseError())
+				{
+					if (d.IsNumber())
+					{
+						// Set string
+						value = Value(str, allocator);
+					}
+					else
+					{
+						// JSON parsing ok, use the document
+						// if string value is not "null"
+						if (strcmp(str, "null") != 0)
+						{
+							value = Value(d, allocator);
+						}
+						else
+						{
+							// Use (char *) value for "null"
+							value = Value(str, allocator);
+						}
+					}
+				}
+				else
+				{
+					// Use (char *) value
+					value = Value(str, allocator);
+				}
+				// Add name & value to the current row
+				row.AddMember(name, value, allocator);
+				break;
+			}
+			case (SQLITE_INTEGER):
+			{
+				int64_t intVal = atol(str);
+				// Add name & value to the current row
+				row.AddMember(name, intVal, allocator);
+				break;
+			}
+			case (SQLITE_FLOAT):
+			{
+				double dblVal = atof(str);
+				// Add name & value to the current row
+				row.AddMember(name, dblVal, allocator);
+				break;
+			}
+			default:
+			{
+				// Default: use  (char *) value
+				Value value(str != NULL ? str : "", allocator);
+				// Add name & value to the current row
+				row.AddMember(name, value, allocator);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Pass the rows of a SQLite3 result set to the result stream of the
+ * connection in batches of RESULT_STREAM_ROWS rows. Only the rows of
+ * a single batch are held in memory.
+ *
+ * @param pStmt		Sqlite3 result set
+ * @param rowsCount	Output number of rows
+ * @return		SQLite3 result code of sqlite3_step(res) or SQLITE_ABORT
+ *			if the result stream abandoned the query
+ */
+int Connection::streamResultSet(sqlite3_stmt *pStmt, unsigned long *rowsCount)
+{
+Document doc;
+StringBuffer buffer;
+unsigned long nRows = 0;
+unsigned int batch = 0;
+int rc;
+
+	Document::AllocatorType& allocator = doc.GetAllocator();
+	while ((rc = SQLstep(pStmt)) == SQLITE_ROW)
+	{
+		if (batch)
+		{
+			buffer.Put(',');
+		}
+		{
+			Value row(kObjectType);
+			mapRow(pStmt, row, allocator);
+			Writer<StringBuffer> writer(buffer);
+			row.Accept(writer);
+		}
+		nRows++;
+
+		if (++batch == RESULT_STREAM_ROWS)
+		{
+			if (!(*m_resultStream)(m_resultStreamData, buffer.GetString(), buffer.GetSize(), batch))
+			{
+				rc = SQLITE_ABORT;
+				break;
+			}
+			buffer.Clear();
+			allocator.Clear();
+			batch = 0;
+		}
+	}
+	if (rc == SQLITE_DONE && batch)
+	{
+		if (!(*m_resultStream)(m_resultStreamData, buffer.GetString(), buffer.GetSize(), batch))
+		{
+			rc = SQLITE_ABORT;
+		}
+	}
+
+	if (rowsCount != nullptr)
+	{
+		*rowsCount = nRows;
+	}
+	return rc;
+}
+
 /**
  * This SQLIte3 query callback just returns the number of rows seen
  * by a SELECT statement in the 'data' parameter
@@ -3059,37 +3144,7 @@ SQLBuffer buf;
  */
 const string Connection::escape(const string& str)
 {
-char    *buffer;
-const char    *p1;
-char  *p2;
-string  newString;
-
-    if (str.find_first_of('\'') == string::npos)
-    {
-        return str;
-    }
-
-    buffer = (char *)malloc(str.length() * 2);
-
-    p1 = str.c_str();
-    p2 = buffer;
-    while (*p1)
-    {
-        if (*p1 == '\'')
-        {
-            *p2++ = '\'';
-            *p2++ = '\'';
-            p1++;
-        }
-        else
-        {
-            *p2++ = *p1++;
-        }
-    }
-    *p2 = 0;
-    newString = string(buffer);
-    free(buffer);
-    return newString;
+	return StringEscapeSQL(str);
 }
 
 /**
@@ -3573,6 +3628,143 @@ SQLBuffer sql;
 	}
 }
 
+/**
+ * Snapshot the statistics into the statistics history and roll the
+ * previous values of the statistics forward, as a single transaction.
+ * A history row is added for every statistic, with the change in value
+ * since the last snapshot.
+ *
+ * @return		-1 on error, the number of statistics on success
+ */
+int Connection::statisticsHistory()
+{
+	string query = "BEGIN TRANSACTION; ";
+	query += "INSERT INTO fledge.statistics_history (key, history_ts, value) ";
+	query += "SELECT key, STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW'), value - previous_value ";
+	query += "FROM fledge.statistics; ";
+	query += "UPDATE fledge.statistics SET previous_value = value; ";
+	query += "COMMIT TRANSACTION;";
+
+	logSQL("StatisticsHistory", query.c_str());
+
+	char* zErrMsg = NULL;
+	int rc = SQLexec(dbHandle, "statistics",
+			 query.c_str(),
+			 NULL,
+			 NULL,
+			 &zErrMsg);
+
+	// Check result code
+	if (rc == SQLITE_OK)
+	{
+		return sqlite3_changes(dbHandle);
+	}
+	else
+	{
+		raiseError("statistics_history", zErrMsg);
+		sqlite3_free(zErrMsg);
+
+		// transaction is still open, do rollback
+		if (sqlite3_get_autocommit(dbHandle) == 0)
+		{
+			rc = SQLexec(dbHandle, "statistics",
+				     "ROLLBACK TRANSACTION;",
+				     NULL,
+				     NULL,
+				     &zErrMsg);
+			if (rc != SQLITE_OK)
+			{
+				raiseError("rollback for statistics_history", zErrMsg);
+				sqlite3_free(zErrMsg);
+			}
+		}
+		return -1;
+	}
+}
+
+/**
+ * Move the statistics history older than the given age into the
+ * daily statistics history, summing the values for each key and day.
+ * The rows are processed in batches, each batch is added to the
+ * daily history and removed from the statistics history in a single
+ * transaction. A key and day may span batches, so the sums are added
+ * to any existing daily row and new rows are only inserted for the
+ * others.
+ *
+ * @param age		The age in seconds of the rows to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return		-1 on error, the number of rows moved on success
+ */
+int Connection::statisticsHistoryPurge(unsigned long age, unsigned int limit)
+{
+	// Compute the cutoff once so that the insert and delete of every
+	// batch select exactly the same rows
+	char cutoff[32];
+	struct tm tm;
+	time_t before = time(0) - age;
+	gmtime_r(&before, &tm);
+	strftime(cutoff, sizeof(cutoff), "%Y-%m-%d %H:%M:%S", &tm);
+
+	string batch = "SELECT id FROM fledge.statistics_history WHERE history_ts < '";
+	batch += string(cutoff) + "' ORDER BY id LIMIT " + to_string(limit);
+
+	// The rows of the batch with the day and key of the daily row updated
+	string match = "FROM fledge.statistics_history h WHERE h.id IN (" + batch + ") ";
+	match += "AND DATE(h.history_ts) = statistics_history_daily.day ";
+	match += "AND h.key = statistics_history_daily.key";
+
+	string query = "BEGIN TRANSACTION; ";
+	query += "UPDATE fledge.statistics_history_daily ";
+	query += "SET value = value + (SELECT SUM(h.value) " + match + ") ";
+	query += "WHERE EXISTS (SELECT 1 " + match + "); ";
+	query += "INSERT INTO fledge.statistics_history_daily (year, day, key, value) ";
+	query += "SELECT STRFTIME('%Y', history_ts), DATE(history_ts), key, SUM(value) ";
+	query += "FROM fledge.statistics_history h WHERE id IN (" + batch + ") ";
+	query += "AND NOT EXISTS (SELECT 1 FROM fledge.statistics_history_daily d ";
+	query += "WHERE d.day = DATE(h.history_ts) AND d.key = h.key) ";
+	query += "GROUP BY DATE(history_ts), key; ";
+	query += "DELETE FROM fledge.statistics_history WHERE id IN (" + batch + "); ";
+	query += "COMMIT TRANSACTION;";
+
+	logSQL("StatisticsHistoryPurge", query.c_str());
+
+	int total = 0;
+	int moved;
+	do {
+		char* zErrMsg = NULL;
+		int rc = SQLexec(dbHandle, "statistics_history",
+				 query.c_str(),
+				 NULL,
+				 NULL,
+				 &zErrMsg);
+		if (rc != SQLITE_OK)
+		{
+			raiseError("statistics_history_purge", zErrMsg);
+			sqlite3_free(zErrMsg);
+
+			// transaction is still open, do rollback
+			if (sqlite3_get_autocommit(dbHandle) == 0)
+			{
+				rc = SQLexec(dbHandle, "statistics_history",
+					     "ROLLBACK TRANSACTION;",
+					     NULL,
+					     NULL,
+					     &zErrMsg);
+				if (rc != SQLITE_OK)
+				{
+					raiseError("rollback for statistics_history_purge", zErrMsg);
+					sqlite3_free(zErrMsg);
+				}
+			}
+			return -1;
+		}
+		moved = sqlite3_changes(dbHandle);
+		total += moved;
+	} while (moved > 0 && moved >= (int)limit);
+
+	return total;
+}
+
 /**
  * In the case of a join add the columns to select from for all the tables in
  * the join
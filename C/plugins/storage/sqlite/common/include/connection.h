@@ -16,6 +16,7 @@
 #include <sqlite3.h>
 #include <mutex>
 #include <reading_stream.h>
+#include <result_stream.h>
 #include <schema.h>
 #include <map>
 #include <vector>
@@ -122,11 +123,15 @@ class Connection {
 		int		load_table_snapshot(const std::string& table, const std::string& id);
 		int		delete_table_snapshot(const std::string& table, const std::string& id);
 		bool		get_table_snapshots(const std::string& table, std::string& resultSet);
+		int		statisticsHistory();
+		int		statisticsHistoryPurge(unsigned long age, unsigned int limit);
 #endif
-		int		appendReadings(const char *readings);
+		int		appendReadings(const char *readings, bool insitu = false);
 		int 		readingStream(ReadingStream **readings, bool commit);
 		bool		fetchReadings(unsigned long id, unsigned int blksize,
 						std::string& resultSet);
+		bool		fetchReadingsBinary(unsigned long id, unsigned int blksize,
+						std::string& resultSet);
 		bool		retrieveReadings(const std::string& condition,
 						 std::string& resultSet);
 		unsigned int	purgeReadings(unsigned long age, unsigned int flags,
@@ -146,6 +151,11 @@ class Connection {
 		unsigned int	purgeReadingsAsset(const std::string& asset);
 		bool		vacuum();
 		bool		supportsReadings() { return ! m_noReadings; };
+		void		setResultStream(RESULT_STREAM_CB callback, void *data)
+				{
+					m_resultStream = callback;
+					m_resultStreamData = data;
+				};
 #if TRACK_CONNECTION_USER
 		void		setUsage(std::string usage) { m_usage = usage; };
 		void		clearUsage() { m_usage = ""; };
@@ -171,6 +181,15 @@ class Connection {
 		sqlite3		*dbHandle;
 		SchemaManager	*m_schemaManager;
 		int		mapResultSet(void *res, std::string& resultSet, unsigned long *rowsCount = nullptr);
+		void		mapRow(sqlite3_stmt *pStmt, rapidjson::Value& row,
+					rapidjson::Document::AllocatorType& allocator);
+		int		streamResultSet(sqlite3_stmt *pStmt, unsigned long *rowsCount);
+		RESULT_STREAM_CB
+				m_resultStream;
+		void		*m_resultStreamData;
+		int		mapBinaryReadings(void *res, std::string& resultSet, unsigned long *rowsCount);
+		bool		fetchReadingsBlock(unsigned long id, unsigned int blksize,
+						std::string& resultSet, bool binary);
 #ifndef SQLITE_SPLIT_READINGS
 		bool		jsonWhereClause(const rapidjson::Value& whereClause, SQLBuffer&, std::vector<std::string>  &asset_codes, bool convertLocaltime = false, std::string prefix = "");
 #else
@@ -671,8 +671,11 @@ void  Connection::shutdownAppendReadings()
 #ifndef SQLITE_SPLIT_READINGS
 /**
  * Append a set of readings to the readings table
+ *
+ * @param readings	The readings to append
+ * @param insitu	Parse the readings in place, the readings buffer is modified
  */
-int Connection::appendReadings(const char *readings)
+int Connection::appendReadings(const char *readings, bool insitu)
 {
 // Default template parameter uses UTF8 and MemoryPoolAllocator.
 Document doc;
@@ -748,7 +751,7 @@ ostringstream threadId;
 	gettimeofday(&start, NULL);
 #endif
 
-	ParseResult ok = doc.Parse(readings);
+	ParseResult ok = insitu ? doc.ParseInsitu(const_cast<char *>(readings)) : doc.Parse(readings);
 	if (!ok)
 	{
  		raiseError("appendReadings", GetParseError_En(doc.GetParseError()));
@@ -1101,6 +1104,44 @@ ostringstream threadId;
 bool Connection::fetchReadings(unsigned long id,
 			       unsigned int blksize,
 			       std::string& resultSet)
+{
+	return fetchReadingsBlock(id, blksize, resultSet, false);
+}
+
+/**
+ * Fetch a block of readings from the reading table and return
+ * them as a binary block of RDSFetchReading records rather than
+ * a JSON document. The timestamps are returned as UTC timevals and
+ * the reading payload is passed through exactly as stored, avoiding
+ * the construction and serialisation of a JSON document for the
+ * block and the parse of that document by the caller.
+ *
+ * @param id		The first reading id to fetch
+ * @param blksize	The maximum number of readings to fetch
+ * @param resultSet	The binary block of readings
+ * @return bool		True if the fetch was successful
+ */
+bool Connection::fetchReadingsBinary(unsigned long id,
+			       unsigned int blksize,
+			       std::string& resultSet)
+{
+	return fetchReadingsBlock(id, blksize, resultSet, true);
+}
+
+/**
+ * Fetch a block of readings from the reading table, mapping
+ * the result set either to a JSON document or to a binary block
+ *
+ * @param id		The first reading id to fetch
+ * @param blksize	The maximum number of readings to fetch
+ * @param resultSet	The fetched readings
+ * @param binary	Return a binary block rather than JSON
+ * @return bool		True if the fetch was successful
+ */
+bool Connection::fetchReadingsBlock(unsigned long id,
+			       unsigned int blksize,
+			       std::string& resultSet,
+			       bool binary)
 {
 char sqlbuffer[5120];
 char *zErrMsg = NULL;
@@ -1149,7 +1190,20 @@ unsigned long rowsCount;
 
 	// Generate a single SQL statement that using a set of UNION considers all the readings table in handling
 	// SQL - start
-	sql_cmd = R"(
+	const char *columns = binary ? R"(
+		SELECT
+			id,
+			asset_code,
+			reading,
+			strftime('%s', user_ts, 'utc') AS user_ts_sec,
+			CASE WHEN instr(user_ts, '.') > 0
+				THEN substr(user_ts, instr(user_ts, '.') + 1, 6)
+				ELSE '0' END AS user_ts_usec,
+			strftime('%s', ts, 'utc') AS ts_sec,
+			strftime('%f', ts, 'utc') AS ts_frac
+		FROM
+		(
+	)" : R"(
 		SELECT
 			id,
 			asset_code,
@@ -1160,6 +1214,7 @@ unsigned long rowsCount;
 		FROM
 		(
 	)";
+	sql_cmd = columns;
 
 	// SQL - union of all the readings tables
 	string sql_cmd_base;
@@ -1226,7 +1281,10 @@ unsigned long rowsCount;
 	else
 	{
 		// Call result set mapping
-		rc = mapResultSet(stmt, resultSet, &rowsCount);
+		if (binary)
+			rc = mapBinaryReadings(stmt, resultSet, &rowsCount);
+		else
+			rc = mapResultSet(stmt, resultSet, &rowsCount);
 
 		if (rowsCount == 0)
 		{
@@ -1244,17 +1302,7 @@ unsigned long rowsCount;
 				// Generate a single SQL statement that using a set of UNION considers all the readings table in handling
 				{
 					// SQL - start
-					sql_cmd = R"(
-						SELECT
-							id,
-							asset_code,
-							reading,
-							strftime('%Y-%m-%d %H:%M:%S', user_ts, 'utc')  ||
-							substr(user_ts, instr(user_ts, '.'), 7) AS user_ts,
-							strftime('%Y-%m-%d %H:%M:%f', ts, 'utc') AS ts
-						FROM
-						(
-					)";
+					sql_cmd = columns;
 
 					// SQL - union of all the readings tables
 					string sql_cmd_base;
@@ -1284,7 +1332,10 @@ unsigned long rowsCount;
 					return false;
 				}
 				// Call result set mapping
-				rc = mapResultSet(stmt, resultSet, &rowsCount);
+				if (binary)
+					rc = mapBinaryReadings(stmt, resultSet, &rowsCount);
+				else
+					rc = mapResultSet(stmt, resultSet, &rowsCount);
 
 				if (rowsCount != 0)
 				{
@@ -1311,6 +1362,93 @@ unsigned long rowsCount;
 		}
 	}
 }
+
+/**
+ * Parse the digits of a fractional second, as returned by the binary
+ * readings fetch, into a number of microseconds
+ *
+ * @param frac	The digits following the decimal point, may be NULL
+ * @return long	The number of microseconds
+ */
+static long fractionToMicroseconds(const char *frac)
+{
+long	usec = 0;
+int	digits = 0;
+
+	if (frac)
+	{
+		for (; digits < 6 && *frac >= '0' && *frac <= '9'; frac++, digits++)
+		{
+			usec = (usec * 10) + (*frac - '0');
+		}
+	}
+	for (; digits < 6; digits++)
+	{
+		usec *= 10;
+	}
+	return usec;
+}
+
+/**
+ * Map the result set of a binary readings fetch to a binary block
+ * of readings as defined by RDSFetchHeader and RDSFetchReading.
+ *
+ * @param res		Sqlite3 result set
+ * @param resultSet	Output binary block of readings
+ * @param rowsCount	Number of readings added to the block
+ * @return		SQLite3 result code of sqlite3_step(res)
+ */
+int Connection::mapBinaryReadings(void *res, string& resultSet, unsigned long *rowsCount)
+{
+sqlite3_stmt	*pStmt = (sqlite3_stmt *)res;
+RDSFetchHeader	header;
+RDSFetchReading	record;
+unsigned long	nRows = 0;
+int		rc;
+
+	resultSet.clear();
+	header.magic = RDS_FETCH_MAGIC;
+	header.count = 0;
+	resultSet.append((const char *)&header, sizeof(header));
+
+	while ((rc = SQLstep(pStmt)) == SQLITE_ROW)
+	{
+		const char *asset = (const char *)sqlite3_column_text(pStmt, 1);
+		const char *payload = (const char *)sqlite3_column_text(pStmt, 2);
+		if (!asset)
+			asset = "";
+		if (!payload)
+			payload = "";
+
+		memset(&record, 0, sizeof(record));
+		record.id = (uint64_t)sqlite3_column_int64(pStmt, 0);
+		record.userTs.tv_sec = (time_t)sqlite3_column_int64(pStmt, 3);
+		record.userTs.tv_usec = fractionToMicroseconds((const char *)sqlite3_column_text(pStmt, 4));
+		record.ts.tv_sec = (time_t)sqlite3_column_int64(pStmt, 5);
+		// The ts fraction is returned as SS.SSS
+		const char *tsFrac = (const char *)sqlite3_column_text(pStmt, 6);
+		if (tsFrac && (tsFrac = strchr(tsFrac, '.')) != NULL)
+		{
+			record.ts.tv_usec = fractionToMicroseconds(tsFrac + 1);
+		}
+		record.assetLength = strlen(asset) + 1;
+		record.payloadLength = strlen(payload) + 1;
+
+		resultSet.append((const char *)&record, sizeof(record));
+		resultSet.append(asset, record.assetLength);
+		resultSet.append(payload, record.payloadLength);
+		nRows++;
+	}
+
+	header.count = nRows;
+	resultSet.replace(0, sizeof(header), (const char *)&header, sizeof(header));
+
+	if (rowsCount != nullptr)
+	{
+		*rowsCount = nRows;
+	}
+	return rc;
+}
 #endif
 
 #ifndef SQLITE_SPLIT_READINGS
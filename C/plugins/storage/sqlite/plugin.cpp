@@ -24,6 +24,7 @@
 #include <logger.h>
 #include <plugin_exception.h>
 #include <reading_stream.h>
+#include <result_stream.h>
 #include <config_category.h>
 #include <readings_catalogue.h>
 #include <purge_configuration.h>
@@ -223,6 +224,29 @@ std::string results;
 	return NULL;
 }
 
+/**
+ * Retrieve data from an arbitrary table, the rows of the result are
+ * passed to the callback as the plugin iterates over the result rather
+ * than being returned as a single document
+ */
+bool plugin_common_retrieve_stream(PLUGIN_HANDLE handle, char *schema, char *table, char *query,
+		RESULT_STREAM_CB callback, void *data)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+std::string results;
+
+#if TRACK_CONNECTION_USER
+	string usage = "Streamed retrieve from " + string(table);
+	connection->setUsage(usage);
+#endif
+	connection->setResultStream(callback, data);
+	bool rval = connection->retrieve(std::string(schema), std::string(table), std::string(query), results);
+	connection->setResultStream(NULL, NULL);
+	manager->release(connection);
+	return rval;
+}
+
 /**
  * Update an arbitary table
  */
@@ -275,6 +299,24 @@ Connection        *connection = manager->allocate();
 	return result;;
 }
 
+/**
+ * Append readings to the readings buffer, parsing the readings in
+ * place. The readings buffer is modified by the parse.
+ */
+int plugin_reading_append_insitu(PLUGIN_HANDLE handle, char *readings)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+
+#if TRACK_CONNECTION_USER
+	string usage = "Reading append";
+	connection->setUsage(usage);
+#endif
+	int result = connection->appendReadings(readings, true);
+	manager->release(connection);
+	return result;
+}
+
 /**
  * Append a stream of readings to the readings buffer
  */
@@ -314,6 +356,65 @@ std::string	  resultSet;
 	return strdup(resultSet.c_str());
 }
 
+/**
+ * Fetch a block of readings from the readings buffer, the readings are
+ * passed to the callback as the plugin iterates over them
+ */
+bool plugin_reading_fetch_stream(PLUGIN_HANDLE handle, unsigned long id, unsigned int blksize,
+		RESULT_STREAM_CB callback, void *data)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+std::string	  resultSet;
+
+#if TRACK_CONNECTION_USER
+	string usage = "Streamed fetch readings";
+	connection->setUsage(usage);
+#endif
+
+	connection->setResultStream(callback, data);
+	bool rval = connection->fetchReadings(id, blksize, resultSet);
+	connection->setResultStream(NULL, NULL);
+	manager->release(connection);
+	return rval;
+}
+
+/**
+ * Fetch a block of readings from the readings buffer as a binary
+ * block of RDSFetchReading records. The returned buffer is allocated
+ * with malloc and should be released by the caller with free.
+ */
+char *plugin_reading_fetch_binary(PLUGIN_HANDLE handle, unsigned long id, unsigned int blksize, unsigned int *length)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+std::string	  resultSet;
+
+#if TRACK_CONNECTION_USER
+	string usage = "Fetch binary readings";
+	connection->setUsage(usage);
+#endif
+
+	bool rval = connection->fetchReadingsBinary(id, blksize, resultSet);
+	manager->release(connection);
+	if (!rval)
+	{
+		*length = 0;
+		return NULL;
+	}
+	char *block = (char *)malloc(resultSet.length());
+	if (block)
+	{
+		memcpy(block, resultSet.data(), resultSet.length());
+		*length = resultSet.length();
+	}
+	else
+	{
+		*length = 0;
+	}
+	return block;
+}
+
 /**
  * Retrieve some readings from the readings buffer
  */
@@ -333,6 +434,29 @@ std::string results;
 	return strdup(results.c_str());
 }
 
+/**
+ * Retrieve some readings from the readings buffer, the rows of the
+ * result are passed to the callback as the plugin iterates over them
+ */
+bool plugin_reading_retrieve_stream(PLUGIN_HANDLE handle, char *condition,
+		RESULT_STREAM_CB callback, void *data)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+std::string results;
+
+#if TRACK_CONNECTION_USER
+	string usage = "Streamed reading retrieve";
+	connection->setUsage(usage);
+#endif
+
+	connection->setResultStream(callback, data);
+	bool rval = connection->retrieveReadings(std::string(condition), results);
+	connection->setResultStream(NULL, NULL);
+	manager->release(connection);
+	return rval;
+}
+
 /**
  * Purge readings from the buffer
  */
@@ -509,6 +633,50 @@ std::string results;
 	return rval ? strdup(results.c_str()) : NULL;
 }
 
+/**
+ * Snapshot the statistics into the statistics history and roll
+ * the previous values of the statistics forward
+ *
+ * @param handle	The plugin handle
+ * @return		-1 on error, the number of statistics on success
+ */
+int plugin_statistics_history(PLUGIN_HANDLE handle)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+
+#if TRACK_CONNECTION_USER
+	string usage = "Statistics history";
+	connection->setUsage(usage);
+#endif
+	int result = connection->statisticsHistory();
+	manager->release(connection);
+	return result;
+}
+
+/**
+ * Move the statistics history older than a given age into the
+ * daily statistics history
+ *
+ * @param handle	The plugin handle
+ * @param age		The age in seconds of the statistics history to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return		-1 on error, the number of rows moved on success
+ */
+int plugin_statistics_history_purge(PLUGIN_HANDLE handle, unsigned long age, unsigned int limit)
+{
+ConnectionManager *manager = (ConnectionManager *)handle;
+Connection        *connection = manager->allocate();
+
+#if TRACK_CONNECTION_USER
+	string usage = "Statistics history purge";
+	connection->setUsage(usage);
+#endif
+	int result = connection->statisticsHistoryPurge(age, limit);
+	manager->release(connection);
+	return result;
+}
+
 
 /**
  * Update or creats a schema
@@ -11,6 +11,7 @@
 #include <connection_manager.h>
 #include <sqlite_common.h>
 #include <utils.h>
+#include <string_utils.h>
 #ifndef MEMORY_READING_PLUGIN
 #include <schema.h>
 #endif
@@ -3118,37 +3119,7 @@ SQLBuffer buf;
  */
 const string Connection::escape(const string& str)
 {
-char    *buffer;
-const char    *p1;
-char  *p2;
-string  newString;
-
-    if (str.find_first_of('\'') == string::npos)
-    {
-        return str;
-    }
-
-    buffer = (char *)malloc(str.length() * 2);
-
-    p1 = str.c_str();
-    p2 = buffer;
-    while (*p1)
-    {
-        if (*p1 == '\'')
-        {
-            *p2++ = '\'';
-            *p2++ = '\'';
-            p1++;
-        }
-        else
-        {
-            *p2++ = *p1++;
-        }
-    }
-    *p2 = 0;
-    newString = string(buffer);
-    free(buffer);
-    return newString;
+	return StringEscapeSQL(str);
 }
 
 /**
@@ -3620,6 +3591,143 @@ SQLBuffer sql;
 		return false;
 	}
 }
+
+/**
+ * Snapshot the statistics into the statistics history and roll the
+ * previous values of the statistics forward, as a single transaction.
+ * A history row is added for every statistic, with the change in value
+ * since the last snapshot.
+ *
+ * @return		-1 on error, the number of statistics on success
+ */
+int Connection::statisticsHistory()
+{
+	string query = "BEGIN TRANSACTION; ";
+	query += "INSERT INTO fledge.statistics_history (key, history_ts, value) ";
+	query += "SELECT key, STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW'), value - previous_value ";
+	query += "FROM fledge.statistics; ";
+	query += "UPDATE fledge.statistics SET previous_value = value; ";
+	query += "COMMIT TRANSACTION;";
+
+	logSQL("StatisticsHistory", query.c_str());
+
+	char* zErrMsg = NULL;
+	int rc = SQLexec(dbHandle, "statistics",
+			 query.c_str(),
+			 NULL,
+			 NULL,
+			 &zErrMsg);
+
+	// Check result code
+	if (rc == SQLITE_OK)
+	{
+		return sqlite3_changes(dbHandle);
+	}
+	else
+	{
+		raiseError("statistics_history", zErrMsg);
+		sqlite3_free(zErrMsg);
+
+		// transaction is still open, do rollback
+		if (sqlite3_get_autocommit(dbHandle) == 0)
+		{
+			rc = SQLexec(dbHandle, "statistics",
+				     "ROLLBACK TRANSACTION;",
+				     NULL,
+				     NULL,
+				     &zErrMsg);
+			if (rc != SQLITE_OK)
+			{
+				raiseError("rollback for statistics_history", zErrMsg);
+				sqlite3_free(zErrMsg);
+			}
+		}
+		return -1;
+	}
+}
+
+/**
+ * Move the statistics history older than the given age into the
+ * daily statistics history, summing the values for each key and day.
+ * The rows are processed in batches, each batch is added to the
+ * daily history and removed from the statistics history in a single
+ * transaction. A key and day may span batches, so the sums are added
+ * to any existing daily row and new rows are only inserted for the
+ * others.
+ *
+ * @param age		The age in seconds of the rows to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return		-1 on error, the number of rows moved on success
+ */
+int Connection::statisticsHistoryPurge(unsigned long age, unsigned int limit)
+{
+	// Compute the cutoff once so that the insert and delete of every
+	// batch select exactly the same rows
+	char cutoff[32];
+	struct tm tm;
+	time_t before = time(0) - age;
+	gmtime_r(&before, &tm);
+	strftime(cutoff, sizeof(cutoff), "%Y-%m-%d %H:%M:%S", &tm);
+
+	string batch = "SELECT id FROM fledge.statistics_history WHERE history_ts < '";
+	batch += string(cutoff) + "' ORDER BY id LIMIT " + to_string(limit);
+
+	// The rows of the batch with the day and key of the daily row updated
+	string match = "FROM fledge.statistics_history h WHERE h.id IN (" + batch + ") ";
+	match += "AND DATE(h.history_ts) = statistics_history_daily.day ";
+	match += "AND h.key = statistics_history_daily.key";
+
+	string query = "BEGIN TRANSACTION; ";
+	query += "UPDATE fledge.statistics_history_daily ";
+	query += "SET value = value + (SELECT SUM(h.value) " + match + ") ";
+	query += "WHERE EXISTS (SELECT 1 " + match + "); ";
+	query += "INSERT INTO fledge.statistics_history_daily (year, day, key, value) ";
+	query += "SELECT STRFTIME('%Y', history_ts), DATE(history_ts), key, SUM(value) ";
+	query += "FROM fledge.statistics_history h WHERE id IN (" + batch + ") ";
+	query += "AND NOT EXISTS (SELECT 1 FROM fledge.statistics_history_daily d ";
+	query += "WHERE d.day = DATE(h.history_ts) AND d.key = h.key) ";
+	query += "GROUP BY DATE(history_ts), key; ";
+	query += "DELETE FROM fledge.statistics_history WHERE id IN (" + batch + "); ";
+	query += "COMMIT TRANSACTION;";
+
+	logSQL("StatisticsHistoryPurge", query.c_str());
+
+	int total = 0;
+	int moved;
+	do {
+		char* zErrMsg = NULL;
+		int rc = SQLexec(dbHandle, "statistics_history",
+				 query.c_str(),
+				 NULL,
+				 NULL,
+				 &zErrMsg);
+		if (rc != SQLITE_OK)
+		{
+			raiseError("statistics_history_purge", zErrMsg);
+			sqlite3_free(zErrMsg);
+
+			// transaction is still open, do rollback
+			if (sqlite3_get_autocommit(dbHandle) == 0)
+			{
+				rc = SQLexec(dbHandle, "statistics_history",
+					     "ROLLBACK TRANSACTION;",
+					     NULL,
+					     NULL,
+					     &zErrMsg);
+				if (rc != SQLITE_OK)
+				{
+					raiseError("rollback for statistics_history_purge", zErrMsg);
+					sqlite3_free(zErrMsg);
+				}
+			}
+			return -1;
+		}
+		moved = sqlite3_changes(dbHandle);
+		total += moved;
+	} while (moved > 0 && moved >= (int)limit);
+
+	return total;
+}
 /**
  * Create schema and populate with tables and indexes as defined in the JSON schema
  * definition.
@@ -102,6 +102,8 @@ class Connection {
 		int		load_table_snapshot(const std::string& table, const std::string& id);
 		int		delete_table_snapshot(const std::string& table, const std::string& id);
 		bool		get_table_snapshots(const std::string& table, std::string& resultSet);
+		int		statisticsHistory();
+		int		statisticsHistoryPurge(unsigned long age, unsigned int limit);
 #endif
 		int		appendReadings(const char *readings);
 		int 		readingStream(ReadingStream **readings, bool commit);
@@ -15,20 +15,60 @@
 #include <insert.h>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <atomic>
 
+#define PERFMON_EXACT		16	// Values below this have a bucket each
+#define PERFMON_SUB_BUCKETS	8	// Buckets per power of two above PERFMON_EXACT
+#define PERFMON_BUCKETS		(PERFMON_EXACT + (64 - 4) * PERFMON_SUB_BUCKETS)
+
+/**
+ * An individual performance monitor.
+ *
+ * Values are recorded in a log-linear histogram held per thread, so
+ * collecting a value does not take a lock or share a cache line with
+ * other threads. The histograms are merged when the values are written,
+ * giving the minimum, maximum, average and the 50th, 99th and 99.9th
+ * percentiles to within the width of a bucket, about 6%. When a thread
+ * exits its histogram is folded into a histogram shared by the threads
+ * that have exited and is freed.
+ */
 class PerfMon {
 	public:
 		PerfMon(const std::string& name);
+		~PerfMon();
 		void		addValue(long value);
 		int		getValues(InsertValues& values);
+		const std::string&
+				getName() const { return m_name; };
+		static int	bucketIndex(unsigned long value);
+		static unsigned long
+				bucketValue(int index);
+	private:
+		/**
+		 * The values collected by a single thread
+		 */
+		struct Histogram {
+			Histogram();
+			std::atomic<unsigned long>	buckets[PERFMON_BUCKETS];
+			std::atomic<long>		sum;
+			std::atomic<long>		min;
+			std::atomic<long>		max;
+		};
+		struct ThreadHistograms;
+		Histogram	*histogram();
+		void		retire(Histogram *histogram);
+		void		drain(Histogram *histogram, unsigned long *counts, unsigned long& samples,
+					long& sum, long& min, long& max);
 	private:
 		std::string	m_name;
-		long		m_average;
-		long		m_min;
-		long		m_max;
-		int		m_samples;
+		unsigned long	m_id;
+		std::vector<Histogram *>
+				m_histograms;
+		Histogram	m_retired;	// Values collected by threads that have exited
 		std::mutex	m_mutex;
 };
+
 /**
  * Class to handle the performance monitors
  */
@@ -50,6 +90,21 @@ class PerformanceMonitor {
 						m_service.c_str());
 			}
 		};
+		// Write a set of rows to storage
+		virtual void writeData(const std::string& table, const std::vector<InsertValues>& values)
+		{
+			// Write all the rows in a single insert via storage client
+			if (m_storage != NULL)
+			{
+				m_storage->insertTable(table, values);
+			}
+			else
+			{
+				Logger::getLogger()->error("Failed to save performace monitor data: "\
+						"storage client is null for servide '%s'",
+						m_service.c_str());
+			}
+		};
 		virtual ~PerformanceMonitor();
 					/**
 					 * Collect a performance monitor
@@ -64,6 +119,21 @@ class PerformanceMonitor {
 							doCollection(name, value);
 						}
 					};
+					/**
+					 * Collect a performance monitor using the
+					 * handle returned by getMonitor
+					 *
+					 * @param monitor	The monitor
+					 * @param value		Value of the monitor
+					 */
+		inline void		collect(PerfMon *monitor, long value)
+					{
+						if (m_collecting)
+						{
+							monitor->addValue(value);
+						}
+					};
+		PerfMon			*getMonitor(const std::string& name);
 		void			setCollecting(bool state);
 		void			writeThread();
 		bool			isCollecting() { return m_collecting; };
@@ -76,6 +146,7 @@ class PerformanceMonitor {
 		bool			m_collecting;
 		std::unordered_map<std::string, PerfMon *>
 					m_monitors;
+		std::mutex		m_monitorsMutex;
 		std::condition_variable m_cv;
 		std::mutex		m_mutex;
 };
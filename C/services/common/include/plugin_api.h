@@ -97,6 +97,8 @@ typedef enum controlDestination {
 #define SP_BUILTIN		0x0100
 /** The plugin supports control data */
 #define SP_CONTROL		0x1000
+/** The north plugin send entry point may be called concurrently from multiple threads */
+#define SP_THREAD_SAFE		0x2000
 
 /**
  * Plugin types
@@ -9,63 +9,293 @@
  */
 #include <perfmonitors.h>
 #include <chrono>
+#include <climits>
+#include <cmath>
+#include <unordered_set>
 
 using namespace std;
 
+static atomic<unsigned long> nextMonitorId(1);
+
+// The ids of the monitors that exist, guarded by liveMutex. A thread
+// that exits only retires its histograms for monitors that still exist.
+static mutex liveMutex;
+static unordered_set<unsigned long> liveMonitors;
+
+/**
+ * The histograms created by a thread, keyed by monitor id. When the
+ * thread exits its histograms are retired from their monitors.
+ */
+struct PerfMon::ThreadHistograms {
+	~ThreadHistograms()
+	{
+		lock_guard<mutex> guard(liveMutex);
+		for (auto& entry : histograms)
+		{
+			if (liveMonitors.find(entry.first) != liveMonitors.end())
+			{
+				entry.second.first->retire(entry.second.second);
+			}
+		}
+	};
+	unordered_map<unsigned long, pair<PerfMon *, Histogram *>>	histograms;
+};
+
 /**
  * Constructor for an individual performance monitor
  *
  * @param name	The name of the performance monitor
  */
-PerfMon::PerfMon(const string& name) : m_name(name), m_samples(0)
+PerfMon::PerfMon(const string& name) : m_name(name)
 {
+	// The id identifies the monitor in the per thread histogram maps
+	m_id = nextMonitorId++;
+	lock_guard<mutex> guard(liveMutex);
+	liveMonitors.insert(m_id);
 }
 
 /**
- * Collect a new value for the performance monitor
+ * Destructor for an individual performance monitor
+ */
+PerfMon::~PerfMon()
+{
+	lock_guard<mutex> guard(liveMutex);
+	liveMonitors.erase(m_id);
+	for (auto histogram : m_histograms)
+	{
+		delete histogram;
+	}
+}
+
+/**
+ * Constructor for the histogram of a single thread
+ */
+PerfMon::Histogram::Histogram() : sum(0), min(LONG_MAX), max(LONG_MIN)
+{
+	for (int i = 0; i < PERFMON_BUCKETS; i++)
+	{
+		buckets[i].store(0, memory_order_relaxed);
+	}
+}
+
+/**
+ * Return the histogram bucket for a value. Values below PERFMON_EXACT
+ * have a bucket each, larger values are split into PERFMON_SUB_BUCKETS
+ * buckets for each power of two.
  *
- * @param value	The new value
+ * @param value	The value
+ * @return int	The index of the bucket
  */
-void PerfMon::addValue(long value)
+int PerfMon::bucketIndex(unsigned long value)
+{
+	if (value < PERFMON_EXACT)
+	{
+		return (int)value;
+	}
+	int exponent = 63 - __builtin_clzl(value);
+	return PERFMON_EXACT + (exponent - 4) * PERFMON_SUB_BUCKETS
+		+ (int)((value >> (exponent - 3)) & (PERFMON_SUB_BUCKETS - 1));
+}
+
+/**
+ * Return the value reported for a histogram bucket, the mid point
+ * of the range of values counted by the bucket
+ *
+ * @param index	The index of the bucket
+ * @return unsigned long	The value of the bucket
+ */
+unsigned long PerfMon::bucketValue(int index)
+{
+	if (index < PERFMON_EXACT)
+	{
+		return (unsigned long)index;
+	}
+	int exponent = 4 + (index - PERFMON_EXACT) / PERFMON_SUB_BUCKETS;
+	unsigned long sub = (index - PERFMON_EXACT) % PERFMON_SUB_BUCKETS;
+	unsigned long low = (PERFMON_SUB_BUCKETS + sub) << (exponent - 3);
+	unsigned long width = 1UL << (exponent - 3);
+	return low + width / 2;
+}
+
+/**
+ * Return the histogram of the calling thread for this monitor,
+ * creating it on the first call from the thread
+ *
+ * @return Histogram*	The histogram of the calling thread
+ */
+PerfMon::Histogram *PerfMon::histogram()
+{
+	static thread_local ThreadHistograms thread;
+
+	auto it = thread.histograms.find(m_id);
+	if (it != thread.histograms.end())
+	{
+		return it->second.second;
+	}
+	Histogram *histogram = new Histogram();
+	{
+		lock_guard<mutex> guard(m_mutex);
+		m_histograms.push_back(histogram);
+	}
+	thread.histograms[m_id] = make_pair(this, histogram);
+	return histogram;
+}
+
+/**
+ * Fold the histogram of a thread that is exiting into the histogram
+ * of the threads that have exited, then free it
+ *
+ * @param histogram	The histogram of the exiting thread
+ */
+void PerfMon::retire(Histogram *histogram)
 {
 	lock_guard<mutex> guard(m_mutex);
-	if (m_samples)
+	for (int i = 0; i < PERFMON_BUCKETS; i++)
+	{
+		unsigned long count = histogram->buckets[i].load(memory_order_relaxed);
+		if (count)
+		{
+			m_retired.buckets[i].fetch_add(count, memory_order_relaxed);
+		}
+	}
+	m_retired.sum.fetch_add(histogram->sum.load(memory_order_relaxed), memory_order_relaxed);
+	if (histogram->min.load(memory_order_relaxed) < m_retired.min.load(memory_order_relaxed))
+	{
+		m_retired.min.store(histogram->min.load(memory_order_relaxed), memory_order_relaxed);
+	}
+	if (histogram->max.load(memory_order_relaxed) > m_retired.max.load(memory_order_relaxed))
 	{
-		if (value < m_min)
-			m_min = value;
-		else if (value > m_max)
-			m_max = value;
-		m_average = ((m_samples * m_average) + value) / (m_samples + 1);
-		m_samples++;
+		m_retired.max.store(histogram->max.load(memory_order_relaxed), memory_order_relaxed);
 	}
-	else
+	for (auto it = m_histograms.begin(); it != m_histograms.end(); ++it)
 	{
-		m_min = value;
-		m_max = value;
-		m_average = value;
-		m_samples = 1;
+		if (*it == histogram)
+		{
+			m_histograms.erase(it);
+			break;
+		}
 	}
+	delete histogram;
+}
+
+/**
+ * Collect a new value for the performance monitor
+ *
+ * @param value	The new value
+ */
+void PerfMon::addValue(long value)
+{
+	Histogram *histogram = this->histogram();
+
+	histogram->buckets[bucketIndex(value < 0 ? 0 : (unsigned long)value)].fetch_add(1, memory_order_relaxed);
+	histogram->sum.fetch_add(value, memory_order_relaxed);
+	long current = histogram->min.load(memory_order_relaxed);
+	while (value < current && !histogram->min.compare_exchange_weak(current, value, memory_order_relaxed));
+	current = histogram->max.load(memory_order_relaxed);
+	while (value > current && !histogram->max.compare_exchange_weak(current, value, memory_order_relaxed));
 }
 
 /**
- * Return the performance values to insert
+ * Add the values of a histogram to the merged values and reset it.
+ * The caller must hold the monitor mutex.
  *
+ * @param histogram	The histogram to drain
+ * @param counts	The merged bucket counts
+ * @param samples	The merged number of samples
+ * @param sum		The merged sum of the values
+ * @param min		The merged minimum value
+ * @param max		The merged maximum value
+ */
+void PerfMon::drain(Histogram *histogram, unsigned long *counts, unsigned long& samples,
+		long& sum, long& min, long& max)
+{
+	for (int i = 0; i < PERFMON_BUCKETS; i++)
+	{
+		if (histogram->buckets[i].load(memory_order_relaxed))
+		{
+			unsigned long count = histogram->buckets[i].exchange(0, memory_order_relaxed);
+			counts[i] += count;
+			samples += count;
+		}
+	}
+	sum += histogram->sum.exchange(0, memory_order_relaxed);
+	long hmin = histogram->min.exchange(LONG_MAX, memory_order_relaxed);
+	long hmax = histogram->max.exchange(LONG_MIN, memory_order_relaxed);
+	if (hmin < min)
+		min = hmin;
+	if (hmax > max)
+		max = hmax;
+}
+
+/**
+ * Return the performance values to insert. The histograms of all the
+ * threads that have collected values are merged and reset.
+ *
+ * @param values	The values to insert
+ * @return int		The number of samples collected
  */
 int PerfMon::getValues(InsertValues& values)
 {
-	lock_guard<mutex> guard(m_mutex);
-	if (m_samples == 0)
+	unsigned long counts[PERFMON_BUCKETS] = { 0 };
+	unsigned long samples = 0;
+	long sum = 0;
+	long min = LONG_MAX;
+	long max = LONG_MIN;
+
+	{
+		lock_guard<mutex> guard(m_mutex);
+		for (auto histogram : m_histograms)
+		{
+			drain(histogram, counts, samples, sum, min, max);
+		}
+		drain(&m_retired, counts, samples, sum, min, max);
+	}
+	if (samples == 0)
 		return 0;
-	values.push_back(InsertValue("minimum", m_min));
-	values.push_back(InsertValue("maximum", m_max));
-	values.push_back(InsertValue("average", m_average));
-	values.push_back(InsertValue("samples", m_samples));
-	m_min = 0;
-	m_max = 0;
-	m_average = 0;
-	int samples = m_samples;
-	m_samples = 0;
-	return samples;
+	if (min > max)
+	{
+		// A value was being added as the histograms were reset
+		min = max = sum / (long)samples;
+	}
+
+	// Find the percentiles from the merged histogram
+	const double percentiles[] = { 0.5, 0.99, 0.999 };
+	unsigned long ranks[3];
+	for (int i = 0; i < 3; i++)
+	{
+		ranks[i] = (unsigned long)ceil(percentiles[i] * samples);
+		if (ranks[i] == 0)
+			ranks[i] = 1;
+	}
+	long results[3];
+	unsigned long cumulative = 0;
+	int p = 0;
+	for (int i = 0; i < PERFMON_BUCKETS && p < 3; i++)
+	{
+		cumulative += counts[i];
+		while (p < 3 && cumulative >= ranks[p])
+		{
+			long value = (long)bucketValue(i);
+			if (value < min)
+				value = min;
+			if (value > max)
+				value = max;
+			results[p++] = value;
+		}
+	}
+	while (p < 3)
+	{
+		results[p++] = max;
+	}
+
+	values.push_back(InsertValue("minimum", min));
+	values.push_back(InsertValue("maximum", max));
+	values.push_back(InsertValue("average", sum / (long)samples));
+	values.push_back(InsertValue("samples", (long)samples));
+	values.push_back(InsertValue("p50", results[0]));
+	values.push_back(InsertValue("p99", results[1]));
+	values.push_back(InsertValue("p999", results[2]));
+	return (int)samples;
 }
 
 /**
@@ -90,6 +320,7 @@ PerformanceMonitor::~PerformanceMonitor()
 	}
 	// Write thread has now been stopped or
 	// was never running
+	lock_guard<mutex> guard(m_monitorsMutex);
 	for (const auto& it : m_monitors)
 	{
 		string name = it.first;
@@ -139,19 +370,30 @@ void PerformanceMonitor::setCollecting(bool state)
  */
 void PerformanceMonitor::doCollection(const string& name, long value)
 {
-	PerfMon *mon;
+	getMonitor(name)->addValue(value);
+}
+
+/**
+ * Return the handle of a named performance monitor, creating the
+ * monitor if it does not exist. Code that collects a monitor
+ * frequently should obtain the handle once and collect values using
+ * the handle, avoiding looking up the monitor by name.
+ *
+ * @param name	The name of the performance monitor
+ * @return PerfMon*	The performance monitor
+ */
+PerfMon *PerformanceMonitor::getMonitor(const string& name)
+{
+	lock_guard<mutex> guard(m_monitorsMutex);
 	auto it = m_monitors.find(name);
-	if (it == m_monitors.end())
+	if (it != m_monitors.end())
 	{
-		// Create a new monitor
-		mon = new PerfMon(name);
-		m_monitors[name] = mon;
+		return it->second;
 	}
-	else
-	{
-		mon = it->second;
-	}
-	mon->addValue(value);
+	// Create a new monitor
+	PerfMon *mon = new PerfMon(name);
+	m_monitors[name] = mon;
+	return mon;
 }
 
 /**
@@ -165,7 +407,9 @@ void PerformanceMonitor::writeThread()
 		m_cv.wait_for(lk, chrono::seconds(60));
 		if (m_collecting)
 		{
-			// Write to the database
+			// Write all the monitors to the database in one insert
+			vector<InsertValues> rows;
+			unique_lock<mutex> monitors(m_monitorsMutex);
 			for (const auto& it : m_monitors)
 			{
 				string name = it.first;
@@ -175,11 +419,18 @@ void PerformanceMonitor::writeThread()
 				{
 					values.push_back(InsertValue("service", m_service));
 					values.push_back(InsertValue("monitor", name));
-
-					// Inser data
-					writeData("monitors", values);
+					rows.push_back(values);
 				}
 			}
+			monitors.unlock();
+			if (rows.size() == 1)
+			{
+				writeData("monitors", rows[0]);
+			}
+			else if (rows.size() > 1)
+			{
+				writeData("monitors", rows);
+			}
 		}
 	}
 }
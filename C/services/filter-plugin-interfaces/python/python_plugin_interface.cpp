@@ -217,12 +217,22 @@ void filter_plugin_ingest_fn(PLUGIN_HANDLE handle, READINGSET *data)
 	PyObject* pFunc;
 	PyGILState_STATE state = PyGILState_Ensure();
 
+	// Filters that implement plugin_ingest_columns are passed columns of
+	// readings rather than a dict per reading
+	const char *method = "plugin_ingest";
+	bool columns = PyObject_HasAttrString(it->second->m_module, "plugin_ingest_columns");
+	if (columns)
+	{
+		method = "plugin_ingest_columns";
+	}
+
 	// Fetch required method in loaded object
-	pFunc = PyObject_GetAttrString(it->second->m_module, "plugin_ingest");
+	pFunc = PyObject_GetAttrString(it->second->m_module, method);
 	if (!pFunc)
 	{
-		Logger::getLogger()->fatal("Cannot find 'plugin_ingest' "
+		Logger::getLogger()->fatal("Cannot find '%s' "
 					   "method in loaded python module '%s'",
+					   method,
 					   pName.c_str());
 		PyGILState_Release(state);
 		return;
@@ -235,8 +245,9 @@ void filter_plugin_ingest_fn(PLUGIN_HANDLE handle, READINGSET *data)
 			logErrorMessage();
 		}
 
-		Logger::getLogger()->fatal("Cannot call method plugin_ingest"
+		Logger::getLogger()->fatal("Cannot call method %s "
 					   "in loaded python module '%s'",
+					   method,
 					   pName.c_str());
 		Py_CLEAR(pFunc);
 
@@ -265,7 +276,7 @@ void filter_plugin_ingest_fn(PLUGIN_HANDLE handle, READINGSET *data)
 	
 	// Create a readingList of readings to be filtered
 	PythonReadingSet *pyReadingSet = (PythonReadingSet *) data;
-	PyObject* readingsList = pyReadingSet->toPython();
+	PyObject* readingsList = columns ? pyReadingSet->toColumns() : pyReadingSet->toPython();
 
 	PyObject* pReturn = PyObject_CallFunction(pFunc,
 						  "OO",
@@ -276,8 +287,9 @@ void filter_plugin_ingest_fn(PLUGIN_HANDLE handle, READINGSET *data)
 	// Handle returned data
 	if (!pReturn)
 	{
-		Logger::getLogger()->error("Called python script method plugin_ingest "
+		Logger::getLogger()->error("Called python script method %s "
 					   ": error while getting result object, plugin '%s'",
+					   method,
 					   pName.c_str());
 		logErrorMessage();
 	}
@@ -30,9 +30,10 @@ static void threadMain(void *arg)
 DataLoad::DataLoad(const string& name, long streamId, StorageClient *storage) : 
 	m_name(name), m_streamId(streamId), m_storage(storage), m_shutdown(false),
 	m_readRequest(0), m_dataSource(SourceReadings), m_pipeline(NULL), m_perfMonitor(NULL),
-	m_prefetchLimit(2)
+	m_prefetchLimit(2), m_partitions(1), m_nextBlock(0), m_partitionFetching(false)
 {
 	m_blockSize = DEFAULT_BLOCK_SIZE;
+	m_binaryFetch = false;
 
 	if (m_streamId == 0)
 	{
@@ -41,7 +42,8 @@ DataLoad::DataLoad(const string& name, long streamId, StorageClient *storage) :
 	m_nextStreamUpdate = 1;
 	m_streamUpdate = 1;
 	m_lastFetched = getLastSentId();
-	m_streamSent = getLastSentId();
+	m_blockLastId = m_lastFetched;
+	m_streamSent = m_lastFetched;
 	m_flushRequired = false;
 	m_thread = new thread(threadMain, this);
 	loadFilters(name);
@@ -66,7 +68,7 @@ DataLoad::~DataLoad()
 		m_pipeline->cleanupFilters(m_name);
 		delete m_pipeline;
 	}
-	if (m_flushRequired)
+	if (flushRequired())
 	{
 		flushLastSentId();
 	}
@@ -78,6 +80,15 @@ DataLoad::~DataLoad()
 		delete readings;
 		m_queue.pop_front();
 	}
+	// Clear out any partitioned blocks that have not been sent
+	for (auto& queue : m_partitionQueues)
+	{
+		for (auto& entry : queue)
+		{
+			delete entry.second;
+		}
+		queue.clear();
+	}
 	Logger::getLogger()->info("Data load shutdown complete");
 }
 
@@ -89,6 +100,10 @@ void DataLoad::shutdown()
 	m_shutdown = true;
 	m_cv.notify_all();
 	m_fetchCV.notify_all();
+	{
+		lock_guard<mutex> guard(m_partitionMutex);
+	}
+	m_partitionCV.notify_all();
 }
 
 /**
@@ -190,7 +205,10 @@ void DataLoad::readBlock(unsigned int blockSize)
 			{
 				case SourceReadings:
 					// Logger::getLogger()->debug("Fetch %d readings from %d", blockSize, m_lastFetched + 1);
-					readings = m_storage->readingFetch(m_lastFetched + 1, blockSize);
+					if (m_binaryFetch)
+						readings = m_storage->readingFetchBinary(m_lastFetched + 1, blockSize);
+					else
+						readings = m_storage->readingFetch(m_lastFetched + 1, blockSize);
 					break;
 				case SourceStatistics:
 					readings = fetchStatistics(blockSize);
@@ -235,10 +253,13 @@ void DataLoad::readBlock(unsigned int blockSize)
 			delete readings;
 			n_update_streamId++;
 			if (n_update_streamId > max_wait_count) {
-				// Update 'last_object_id' in 'streams' table when no readings to send
+				// Write any pending update of 'last_object' in the
+				// 'streams' table when there are no readings to send
 				n_update_streamId = 0;
-				m_streamSent = getLastFetched();
-				flushLastSentId();
+				if (flushRequired())
+				{
+					flushLastSentId();
+				}
 			}
 		}
 		else
@@ -288,7 +309,7 @@ ReadingSet *DataLoad::fetchStatistics(unsigned int blockSize)
 	qStatistics.sort(sort);
 
 	// Query the statistics_history table and get a ReadingSet result
-	return m_storage->queryTableToReadings("statistics_history", qStatistics);
+	return queryReadings("statistics_history", qStatistics);
 }
 
 /**
@@ -322,7 +343,53 @@ ReadingSet *DataLoad::fetchAudit(unsigned int blockSize)
 	qStatistics.sort(sort);
 
 	// Query the audit  table and get a ReadingSet result
-	return m_storage->queryTableToReadings("log", qStatistics);
+	return queryReadings("log", qStatistics);
+}
+
+/**
+ * Query a table whose rows are readings. The rows are converted to
+ * readings as they are streamed from the storage service, rather than
+ * once the whole result has been received and parsed.
+ *
+ * @param table		The table to query
+ * @param query		The query
+ * @return ReadingSet*	The readings or NULL if the query failed
+ */
+ReadingSet *DataLoad::queryReadings(const string& table, const Query& query)
+{
+	vector<Reading *> readings;
+	long rows;
+	try {
+		rows = m_storage->queryTableRows(table, query, appendReading, &readings);
+	} catch (...) {
+		for (auto reading : readings)
+			delete reading;
+		throw;
+	}
+	if (rows < 0)
+	{
+		for (auto reading : readings)
+			delete reading;
+		return NULL;
+	}
+	return new ReadingSet(&readings);
+}
+
+/**
+ * Row callback of a streamed query, convert the row to a reading
+ *
+ * @param readings	The vector of readings to append to
+ * @param row		The row of the query result
+ * @return bool		Always true, every row is required
+ */
+bool DataLoad::appendReading(void *readings, const rapidjson::Value& row)
+{
+	if (!row.IsObject())
+	{
+		throw new ReadingSetException("Expected reading to be an object");
+	}
+	((vector<Reading *> *)readings)->push_back(new JSONReading(row));
+	return true;
 }
 
 /**
@@ -387,6 +454,9 @@ void DataLoad::bufferReadings(ReadingSet *readings)
 			}
 
 			m_pipeline->execute();
+			// Readings created by the filters have no id, the
+			// sets they are sent in account for this block
+			m_blockLastId = readings->getLastId();
 			// Pass readingSet to filter chain
 			firstElement->ingest(readings);
 			m_pipeline->completeBranch();	// Main branch has completed
@@ -494,16 +564,25 @@ InsertValues streamValues;
 }
 
 /**
- * Update the last sent ID for our stream
+ * Update the last sent ID for our stream. Must not be called with
+ * the partition mutex held, as it may write to the storage layer.
  */
 void DataLoad::updateLastSentId(unsigned long id)
 {
-	m_streamSent = id;
-	m_flushRequired = true;
-	if (m_nextStreamUpdate-- <= 0)
+	bool flush = false;
+	{
+		lock_guard<mutex> guard(m_streamMutex);
+		m_streamSent = id;
+		m_flushRequired = true;
+		if (m_nextStreamUpdate-- <= 0)
+		{
+			flush = true;
+			m_nextStreamUpdate = m_streamUpdate;
+		}
+	}
+	if (flush)
 	{
 		flushLastSentId();
-		m_nextStreamUpdate = m_streamUpdate;
 	}
 }
 
@@ -512,14 +591,204 @@ void DataLoad::updateLastSentId(unsigned long id)
  */
 void DataLoad::flushLastSentId()
 {
+	lock_guard<mutex> flushGuard(m_flushMutex);
+	unsigned long sent;
+	{
+		lock_guard<mutex> guard(m_streamMutex);
+		sent = m_streamSent;
+		m_flushRequired = false;
+	}
 	const Condition condition(Equals);
 	Where where("id", condition, to_string(m_streamId));
 	InsertValues lastId;
 
-	lastId.push_back(InsertValue("last_object", (long)m_streamSent));
+	lastId.push_back(InsertValue("last_object", (long)sent));
 	m_storage->updateTable("streams", lastId, where);
 }
 
+/**
+ * Return true if the last sent Id has changed since it was last
+ * flushed to the storage layer
+ */
+bool DataLoad::flushRequired()
+{
+	lock_guard<mutex> guard(m_streamMutex);
+	return m_flushRequired;
+}
+
+
+/**
+ * Set the number of partitions the readings are split into for sending.
+ * Each partition is consumed by its own sending thread and all the
+ * readings of a given asset are always placed in the same partition,
+ * so the order of readings within an asset is preserved.
+ *
+ * This must be called before any consumer calls fetchPartition.
+ *
+ * @param partitions	The number of partitions
+ */
+void DataLoad::setPartitions(unsigned int partitions)
+{
+	lock_guard<mutex> guard(m_partitionMutex);
+	m_partitions = partitions > 0 ? partitions : 1;
+	m_partitionQueues.resize(m_partitions);
+}
+
+/**
+ * Fetch the next block of readings for a partition. If the partition
+ * has nothing queued then a block is fetched from the reading buffer
+ * and split across all the partitions. Only one thread fetches from
+ * the buffer at a time, the others wait for the split to complete.
+ *
+ * @param partition	The partition to fetch readings for
+ * @param block		Returns the block the readings belong to
+ * @return ReadingSet*	The readings or NULL if the service is shutting down
+ */
+ReadingSet *DataLoad::fetchPartition(unsigned int partition, unsigned long *block)
+{
+	unique_lock<mutex> lck(m_partitionMutex);
+	while (m_shutdown == false && m_partitionQueues[partition].empty())
+	{
+		if (m_partitionFetching)
+		{
+			m_partitionCV.wait(lck);
+			continue;
+		}
+		m_partitionFetching = true;
+		lck.unlock();
+		ReadingSet *readings = fetchReadings(true);
+		lck.lock();
+		m_partitionFetching = false;
+		unsigned long lowWater = 0;
+		if (readings)
+		{
+			lowWater = partitionBlock(readings);
+		}
+		m_partitionCV.notify_all();
+		if (lowWater)
+		{
+			lck.unlock();
+			updateLastSentId(lowWater);
+			lck.lock();
+		}
+	}
+	if (m_partitionQueues[partition].empty())
+	{
+		return NULL;
+	}
+	auto entry = m_partitionQueues[partition].front();
+	m_partitionQueues[partition].pop_front();
+	*block = entry.first;
+	return entry.second;
+}
+
+/**
+ * Split a block of readings by asset across the partition queues and
+ * record the block so that the low water mark of sent readings can be
+ * tracked. Called with the partition mutex held.
+ *
+ * @param readings	The block of readings to split
+ * @return unsigned long	The new low water mark of sent readings if
+ *			it has moved, otherwise 0
+ */
+unsigned long DataLoad::partitionBlock(ReadingSet *readings)
+{
+	vector<vector<Reading *> > parts(m_partitions);
+	hash<string> assetHash;
+	// The highest id of the block as fetched, filters may have
+	// replaced the readings with new readings that have no id
+	unsigned long lastId = readings->getLastId();
+
+	for (auto reading : readings->getAllReadings())
+	{
+		parts[assetHash(reading->getAssetName()) % m_partitions].push_back(reading);
+		if (reading->hasId() && reading->getId() > lastId)
+		{
+			lastId = reading->getId();
+		}
+	}
+	readings->clear();
+	delete readings;
+	if (lastId == 0)
+	{
+		Logger::getLogger()->info("A block of readings to send has no reading ids, the position of the last sent reading will not be moved for it");
+	}
+
+	unsigned long block = m_nextBlock++;
+	PartitionedBlock& pending = m_partitionBlocks[block];
+	pending.lastId = lastId;
+	pending.outstanding = 0;
+	for (unsigned int i = 0; i < m_partitions; i++)
+	{
+		if (!parts[i].empty())
+		{
+			ReadingSet *set = new ReadingSet();
+			set->append(parts[i]);
+			m_partitionQueues[i].push_back(make_pair(block, set));
+			pending.outstanding++;
+		}
+	}
+	if (pending.outstanding == 0)
+	{
+		// Everything was filtered out, the block is complete once
+		// all earlier blocks are
+		return advanceLowWater();
+	}
+	return 0;
+}
+
+/**
+ * Called by a partition sender once it has sent all of the readings
+ * it was given for a block. The last sent id is only moved forward to
+ * the end of the newest block for which all partitions have sent their
+ * readings, along with all earlier blocks. This low water mark
+ * guarantees no readings are skipped if the service is restarted.
+ *
+ * @param block		The block the partition has completed
+ */
+void DataLoad::partitionComplete(unsigned long block)
+{
+	unsigned long lowWater;
+	{
+		lock_guard<mutex> guard(m_partitionMutex);
+		auto it = m_partitionBlocks.find(block);
+		if (it == m_partitionBlocks.end())
+		{
+			return;
+		}
+		if (it->second.outstanding > 0)
+		{
+			it->second.outstanding--;
+		}
+		lowWater = advanceLowWater();
+	}
+	if (lowWater)
+	{
+		updateLastSentId(lowWater);
+	}
+}
+
+/**
+ * Remove the completed blocks at the head of the list of partitioned
+ * blocks and return the end of the newest of them, the caller updates
+ * the last sent id once the partition mutex is released.
+ * Called with the partition mutex held.
+ *
+ * @return unsigned long	The new low water mark or 0 if it has not moved
+ */
+unsigned long DataLoad::advanceLowWater()
+{
+	unsigned long lowWater = 0;
+	while (!m_partitionBlocks.empty() && m_partitionBlocks.begin()->second.outstanding == 0)
+	{
+		if (m_partitionBlocks.begin()->second.lastId)
+		{
+			lowWater = m_partitionBlocks.begin()->second.lastId;
+		}
+		m_partitionBlocks.erase(m_partitionBlocks.begin());
+	}
+	return lowWater;
+}
 
 /**
  * Load filter plugins
@@ -631,12 +900,14 @@ void DataLoad::pipelineEnd(OUTPUT_HANDLE *outHandle,
                                   readingSet->getCount(), lastReadingId, load->m_lastFetched);
     
 	// Special case when all readings are filtered out 
-	// or new readings are appended by filter with id 0
+	// or new readings are appended by filter with id 0.
+	// The set is still queued, so that the last sent id is
+	// moved to the end of the block in order once it is sent
 	if ((readingSet->getCount() == 0) || (lastReadingId == 0))
 	{
-	    Logger::getLogger()->debug("DataLoad::pipelineEnd(): updating with load->updateLastSentId(%d)", 
-	                                load->m_lastFetched);
-		load->updateLastSentId(load->m_lastFetched);
+	    Logger::getLogger()->debug("DataLoad::pipelineEnd(): set accounts for block ending at %lu",
+	                                load->m_blockLastId);
+		readingSet->setLastId(load->m_blockLastId);
 	}
 
 	unique_lock<mutex> lck(load->m_qMutex);
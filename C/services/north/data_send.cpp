@@ -14,6 +14,8 @@
 
 using namespace std;
 
+static mutex assetTrackingMutex;
+
 /**
  * Start the sending thread within the DataSender class
  *
@@ -25,45 +27,31 @@ static void startSenderThread(void *data)
 	sender->sendThread();
 }
 
-/**
- * Thread to update statistics table in DB
- */
-static void statsThread(DataSender *sender)
-{
-	while (sender->isRunning())
-	{
-		sender->flushStatistics();
-	}
-}
-
 /**
  * Constructor for the data sending class
+ *
+ * If the loader has been set up with more than one partition the sender
+ * only sends the readings of the given partition, several senders may
+ * then call the plugin send entry point concurrently.
+ *
+ * @param plugin	The north plugin to send the data with
+ * @param loader	The data loader that supplies the readings
+ * @param service	The north service
+ * @param partition	The partition of readings this sender sends
  */
-DataSender::DataSender(NorthPlugin *plugin, DataLoad *loader, NorthService *service) :
-	m_plugin(plugin), m_loader(loader), m_service(service), m_shutdown(false), m_paused(false), m_perfMonitor(NULL), m_sending(false),
+DataSender::DataSender(NorthPlugin *plugin, DataLoad *loader, NorthService *service, unsigned int partition) :
+	m_plugin(plugin), m_loader(loader), m_service(service), m_partition(partition), m_shutdown(false), m_paused(false), m_perfMonitor(NULL), m_sending(false),
 	m_repeatedFailure(0)
 {
-	m_statsUpdateFails = 0;
+	m_partitioned = m_loader->getPartitions() > 1;
 
 	m_logger = Logger::getLogger();
 
-	// Create statistics rows if not existant
-	if (createStats("Readings Sent", 0))
-	{
-		m_statsDbEntriesCache.insert("Readings Sent");
-	}
-	if (createStats(m_loader->getName(), 0))
-	{
-		m_statsDbEntriesCache.insert(m_loader->getName());
-	}
-
 	/*
 	 * Start the thread. Everything must be initialsied
 	 * before the thread is started
 	 */
 	m_thread = new thread(startSenderThread, this);
-
-	m_statsThread = new thread(statsThread, this);
 }
 
 /**
@@ -76,12 +64,6 @@ DataSender::~DataSender()
 	m_thread->join();
 	delete m_thread;
 
-	m_statsCv.notify_one();
-	m_logger->debug("DataSender stats thread notified");
-	m_statsThread->join();
-	m_logger->debug("DataSender stats thread joined");
-	delete m_statsThread;
-
 	m_logger->info("DataSender shutdown complete");
 }
 
@@ -94,12 +76,16 @@ void DataSender::sendThread()
 		return;
 
 	ReadingSet *readings = nullptr;
+	unsigned long block = 0;
 
 	while (!m_shutdown)
 	{
 		if (readings == NULL) {
 
-			readings = m_loader->fetchReadings(true);
+			if (m_partitioned)
+				readings = m_loader->fetchPartition(m_partition, &block);
+			else
+				readings = m_loader->fetchReadings(true);
 		}
 		if (!readings)
 		{
@@ -111,27 +97,34 @@ void DataSender::sendThread()
 		if (m_shutdown == false && readings->getCount() > 0)
 		{
 			unsigned long lastSent = send(readings);
-			if (lastSent)
+
+			// Check all readings sent, the readings may all have been
+			// created by filters and have no id to report as sent
+			vector<Reading *> *vec = readings->getAllReadingsPtr();
+			if (vec->empty() && readings->getLastId() > lastSent)
 			{
-				m_loader->updateLastSentId(lastSent);
+				// The whole block the set accounts for has been sent
+				lastSent = readings->getLastId();
+			}
 
-				// Check all readings sent
-				vector<Reading *> *vec = readings->getAllReadingsPtr();
+			// Partitioned senders report completed blocks instead
+			if (lastSent && !m_partitioned)
+				m_loader->updateLastSentId(lastSent);
 
-				// Set readings removal
-				removeReadings = vec->size() == 0;
-			}
+			// Set readings removal
+			removeReadings = vec->size() == 0;
 		}
 		else if (m_shutdown == false) 
 		{
 			// All readings filtered out
 			Logger::getLogger()->debug("All readings filtered out");
 
-			// Get last read item from the readings database
-			unsigned long lastRead = m_loader->getLastFetched();
-
-			// Update LastSentId in streams table
-			m_loader->updateLastSentId(lastRead);
+			if (!m_partitioned && readings->getLastId())
+			{
+				// Update LastSentId in streams table to the end
+				// of the block the filtered set accounts for
+				m_loader->updateLastSentId(readings->getLastId());
+			}
 
 			// Set readings removal
 			removeReadings = true;
@@ -144,6 +137,10 @@ void DataSender::sendThread()
 		// Remove readings object if needed
 		if (removeReadings)
 		{
+			if (m_partitioned)
+			{
+				m_loader->partitionComplete(block);
+			}
 			delete readings;
 			readings = NULL;
 		}
@@ -166,7 +163,10 @@ unsigned long DataSender::send(ReadingSet *readings)
 {
 	blockPause();
 	uint32_t to_send = readings->getCount();
+	auto sendStart = chrono::steady_clock::now();
 	uint32_t sent = m_plugin->send(readings->getAllReadings());
+	long sendTime = (long)chrono::duration_cast<chrono::milliseconds>(
+			chrono::steady_clock::now() - sendStart).count();
 	releasePause();
 
 	if (to_send > 0 && sent == 0)
@@ -225,6 +225,7 @@ unsigned long DataSender::send(ReadingSet *readings)
 	{
 		m_perfMonitor->collect("Readings sent", sent);
 		m_perfMonitor->collect("Percentage readings sent", (100 * sent) / to_send);
+		m_perfMonitor->collect("Send time", sendTime);
 	}
 
 	Logger::getLogger()->debug("DataSender::send(): to_send=%d, sent=%d, lastSent=%lu", to_send, sent, lastSent);
@@ -233,8 +234,10 @@ unsigned long DataSender::send(ReadingSet *readings)
 	{
 		// lastSent = readings->getLastId();
 
-		// Update asset tracker table/cache, if required
+		// Update asset tracker table/cache, if required. The asset
+		// tracker cache is shared by all the sending threads
 		vector<Reading *> *vec = readings->getAllReadingsPtr();
+		lock_guard<mutex> guard(assetTrackingMutex);
 
 		for (vector<Reading *>::iterator it = vec->begin(); it != vec->end(); )
 		{
@@ -330,180 +333,20 @@ void DataSender::releasePause()
 }
 
 /**
- * Update the sent statistics
+ * Update the sent statistics. The statistics are accumulated and
+ * written to the storage service by the statistics accumulator of
+ * the north service.
  *
  * @param increment     Increment of the number of readings sent
  */
 void DataSender::updateStatistics(uint32_t increment)
 {
-	lock_guard<mutex> guard(m_statsMtx);
-
-	// Add statistics counter to the map
-	m_statsPendingEntries[m_loader->getName()] += increment;
-	m_statsPendingEntries["Readings Sent"] += increment;
-}
-
-/**
- * Flush statistics to storage service
- */
-void DataSender::flushStatistics()
-{
-	// Wait for FLUSH_STATS_INTERVAL seconds or receive notification
-	// when shutdown is called
-	unique_lock<mutex> flush(m_flushStatsMtx);
-	m_statsCv.wait_for(flush, std::chrono::seconds(FLUSH_STATS_INTERVAL));
-	flush.unlock();
-
-	std::map<std::string, unsigned int> statsData;
-
-	// Acquire m_statsMtx lock for m_statsMtx
-	unique_lock<mutex> lck(m_statsMtx);
-
-	// copy statistics map
-	statsData = m_statsPendingEntries;
-
-	// Reset statistics
-	m_statsPendingEntries.clear();
-
-	// Release lock
-	lck.unlock();
-
-	if (statsData.empty())
+	StatisticsAccumulator *statistics = m_service->getStatistics();
+	if (statistics)
 	{
-		return;
+		statistics->increment(m_loader->getName(), increment);
+		statistics->increment("Readings Sent", increment);
 	}
-
-	vector<pair<ExpressionValues *, Where *>> statsUpdates;
-	const Condition conditionStat(Equals);
-
-	// Send statistics to storage service
-	map<string, unsigned int>::iterator it;
-	for (it = statsData.begin(); it != statsData.end(); it++)
-	{
-		// Prepare "WHERE key = name
-		Where *nStat = new Where("key", conditionStat, it->first);
-		// Prepare value = value + inc
-		ExpressionValues *updateValue = new ExpressionValues;
-		updateValue->push_back(Expression("value", "+", (int) it->second));
-
-		statsUpdates.emplace_back(updateValue, nStat);
-
-		// Check whether to create stats entry into the storage
-		if (m_statsDbEntriesCache.find(it->first) == m_statsDbEntriesCache.end())
-		{
-			if (createStats(it->first, it->second))
-			{
-				m_statsDbEntriesCache.insert(it->first);
-			}
-		}
-
-		Logger::getLogger()->debug("Flushing statistics '%s': %d",
-				it->first.c_str(),
-				it->second);
-	}
-
-	// Bulk update
-	if (m_loader->getStorage())
-	{
-		// Do the update
-		int rv = m_loader->getStorage()->updateTable("statistics", statsUpdates);
-
-		// Check for errors
-		if (rv < 1)
-		{
-			if (++m_statsUpdateFails > STATS_UPDATE_FAIL_THRESHOLD)
-			{
-				Logger::getLogger()->warn("Update of statistics failure has persisted, attempting recovery");
-
-				m_statsDbEntriesCache.clear();
-				// Create statistics rows if not existant
-				if (createStats("Readings Sent", 0))
-				{
-					m_statsDbEntriesCache.insert("Readings Sent");
-				}
-				if (createStats(m_loader->getName(), 0))
-				{
-					m_statsDbEntriesCache.insert(m_loader->getName());
-				}
-
-				m_statsUpdateFails = 0;
-			}
-			else if (m_statsUpdateFails == 1)
-			{
-				Logger::getLogger()->warn("Update of statistics failed");
-			}
-			else
-			{
-				Logger::getLogger()->warn("Update of statistics still failing");
-			}
-		}
-	}
-}
-
-/**
- * Create a row into statistic table for each statistic
- *
- * @param key		The statistics key to create
- * @param value		The statistics value
- * @return		True for created data, False for no operation or error
- */
-bool DataSender::createStats(const std::string &key,
-		unsigned int value)
-{
-	if (!m_loader->getStorage())
-	{
-		return false;
-	}
-
-	// SELECT * FROM fledge.statiatics WHERE key = statistics_key
-	const Condition conditionKey(Equals);
-	Where *wKey = new Where("key", conditionKey, key);
-	Query qKey(wKey);
-
-	ResultSet* result = 0;
-
-	// Query via storage client
-	result = m_loader->getStorage()->queryTable("statistics", qKey);
-
-	bool doInsert = !result->rowCount();
-	delete result;
-
-	if (!doInsert)
- 	{
-		// Row already exists
-		return true;
-	}
-
-	string description;
-	if (key == m_loader->getName())
-	{
-		description = key + " Readings Sent";
-	}
-	else
-	{
-		description = key + " North";
-	}
-	InsertValues values;
-	values.push_back(InsertValue("key",         key));
-	values.push_back(InsertValue("description", description));
-	values.push_back(InsertValue("value",       (long)value));
-	string table = "statistics";
-
-	if (m_loader->getStorage()->insertTable(table, values) != 1)
-	{
-		Logger::getLogger()->error("Failed to insert a new "\
-				"row into the 'statistics' table, key '%s'",
-				key.c_str());
-		return false;
-	}
-	else
-	{
-		Logger::getLogger()->info("New row added into 'statistics' table, key '%s'",
-			key.c_str());
-		return true;
-	}
-
-	return false;
 }
 
 /**
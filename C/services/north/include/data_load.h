@@ -4,8 +4,11 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <vector>
+#include <map>
 #include <storage_client.h>
 #include <reading.h>
 #include <filter_pipeline.h>
@@ -48,8 +51,13 @@ class DataLoad : public ServiceHandler {
 					{
 						m_blockSize = blockSize;
 					};
+		void			setBinaryFetch(bool binaryFetch)
+					{
+						m_binaryFetch = binaryFetch;
+					};
 		void			setStreamUpdate(unsigned long streamUpdate)
 					{
+						std::lock_guard<std::mutex> guard(m_streamMutex);
 						m_streamUpdate = streamUpdate;
 						m_nextStreamUpdate = streamUpdate;
 					};
@@ -60,6 +68,10 @@ class DataLoad : public ServiceHandler {
 					{
 						m_prefetchLimit = limit;
 					};
+		void			setPartitions(unsigned int partitions);
+		unsigned int		getPartitions() { return m_partitions; };
+		ReadingSet		*fetchPartition(unsigned int partition, unsigned long *block);
+		void			partitionComplete(unsigned long block);
 
 	private:
 		void			readBlock(unsigned int blockSize);
@@ -68,8 +80,13 @@ class DataLoad : public ServiceHandler {
 		int			createNewStream();
 		ReadingSet		*fetchStatistics(unsigned int blockSize);
 		ReadingSet		*fetchAudit(unsigned int blockSize);
+		ReadingSet		*queryReadings(const std::string& table, const Query& query);
+		static bool		appendReading(void *readings, const rapidjson::Value& row);
 		void			bufferReadings(ReadingSet *readings);
 		bool			loadFilters(const std::string& category);
+		unsigned long		partitionBlock(ReadingSet *readings);
+		unsigned long		advanceLowWater();
+		bool			flushRequired();
 
 	private:
 		const std::string&	m_name;
@@ -84,17 +101,45 @@ class DataLoad : public ServiceHandler {
 		enum { SourceReadings, SourceStatistics, SourceAudit }
 					m_dataSource;
 		unsigned long		m_lastFetched;
+		unsigned long		m_blockLastId;	// Last id of the block in the filter pipeline
 		std::deque<ReadingSet *>
 					m_queue;
 		std::mutex		m_qMutex;
 		FilterPipeline		*m_pipeline;
 		std::mutex		m_pipelineMutex;
 		unsigned long		m_blockSize;
+		std::atomic<bool>	m_binaryFetch;
 		PerformanceMonitor	*m_perfMonitor;
+		unsigned int		m_prefetchLimit;
+		/*
+		 * The last sent id is updated by the sending threads and the
+		 * loading thread, the stream mutex protects it. The flush
+		 * mutex keeps the writes to the streams table in order.
+		 */
 		int			m_streamUpdate;
 		unsigned long		m_streamSent;
 		int			m_nextStreamUpdate;
-		unsigned int		m_prefetchLimit;
 		bool			m_flushRequired;
+		std::mutex		m_streamMutex;
+		std::mutex		m_flushMutex;
+		/**
+		 * A block of readings that has been split across the
+		 * partitions, the last reading id in the block can only be
+		 * recorded as sent once all partitions have sent their part
+		 * of this and all earlier blocks.
+		 */
+		struct PartitionedBlock {
+			unsigned long	lastId;
+			unsigned int	outstanding;
+		};
+		unsigned int		m_partitions;
+		std::vector<std::deque<std::pair<unsigned long, ReadingSet *> > >
+					m_partitionQueues;
+		std::map<unsigned long, PartitionedBlock>
+					m_partitionBlocks;
+		unsigned long		m_nextBlock;
+		bool			m_partitionFetching;
+		std::mutex		m_partitionMutex;
+		std::condition_variable m_partitionCV;
 };
 #endif
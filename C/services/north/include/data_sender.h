@@ -24,7 +24,8 @@ class NorthService;
 
 class DataSender {
 	public:
-		DataSender(NorthPlugin *plugin, DataLoad *loader, NorthService *north);
+		DataSender(NorthPlugin *plugin, DataLoad *loader, NorthService *north,
+				unsigned int partition = 0);
 		~DataSender();
 		void			sendThread();
 		void			updatePlugin(NorthPlugin *plugin) { m_plugin = plugin; };
@@ -32,11 +33,9 @@ class DataSender {
 		void			release();
 		void			setPerfMonitor(PerformanceMonitor *perfMonitor) { m_perfMonitor = perfMonitor; };
 		bool			isRunning() { return !m_shutdown; };
-		void			flushStatistics();
 		bool			isDryRun();
 	private:
 		void			updateStatistics(uint32_t increment);
-		bool 			createStats(const std::string &key, unsigned int value);
 		unsigned long		send(ReadingSet *readings);
 		void			blockPause();
 		void			releasePause();
@@ -44,6 +43,8 @@ class DataSender {
 		NorthPlugin		*m_plugin;
 		DataLoad		*m_loader;
 		NorthService		*m_service;
+		unsigned int		m_partition;
+		bool			m_partitioned;
 		volatile bool		m_shutdown;
 		std::thread		*m_thread;
 		Logger			*m_logger;
@@ -52,18 +53,6 @@ class DataSender {
 		std::mutex		m_pauseMutex;
 		std::condition_variable m_pauseCV;
 		PerformanceMonitor	*m_perfMonitor;
-		// Statistics send via thread
-		std::thread		*m_statsThread;
-		std::mutex		m_flushStatsMtx;
-		// Statistics save map
-		std::condition_variable m_statsCv;
-		std::mutex		m_statsMtx;
-		std::map<std::string, unsigned int>
-					m_statsPendingEntries;
-		int			m_statsUpdateFails;
-		// confirmed stats table entries
-		std::unordered_set<std::string>
-					m_statsDbEntriesCache;
 		unsigned int		m_repeatedFailure;
 		unsigned int		m_sendBackoffTime;
 };
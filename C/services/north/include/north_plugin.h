@@ -44,6 +44,7 @@ public:
 	void		startData(const std::string& pluginData);
 	std::string	shutdownSaveData();
 	bool		hasControl() { return info->options & SP_CONTROL; };
+	bool		isThreadSafe() { return info->options & SP_THREAD_SAFE; };
 	void		pluginRegister(bool ( *write)(char *name, char *value, ControlDestination destination, ...),
 				int (* operation)(char *operation, int paramCount, char *names[], char *parameters[], ControlDestination destination, ...));
 
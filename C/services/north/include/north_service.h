@@ -20,6 +20,8 @@
 #include <condition_variable>
 #include <audit_logger.h>
 #include <perfmonitors.h>
+#include <statistics_accumulator.h>
+#include <vector>
 
 #define SERVICE_NAME  "Fledge North"
 
@@ -57,6 +59,7 @@ class NorthService : public ServiceAuthHandler {
 		bool				getDryRun() { return m_dryRun; };
 		void				alertFailures();
 		void				clearFailures();
+		StatisticsAccumulator		*getStatistics() { return m_statistics; };
 	private:
 		void				addConfigDefaults(DefaultConfigCategory& defaults);
 		bool 				loadPlugin();
@@ -67,7 +70,7 @@ class NorthService : public ServiceAuthHandler {
 		bool				sendToService(const std::string& southService, const std::string& name, const std::string& value);
 		bool				sendToDispatcher(const std::string& path, const std::string& payload);
 		DataLoad			*m_dataLoad;
-		DataSender			*m_dataSender;
+		std::vector<DataSender *>	m_dataSenders;
 		NorthPlugin			*northPlugin;
 		std::string			m_pluginName;
 		Logger        			*logger;
@@ -86,5 +89,6 @@ class NorthService : public ServiceAuthHandler {
 		bool				m_requestRestart;
 		AuditLogger			*m_auditLogger;
 		PerformanceMonitor		*m_perfMonitor;
+		StatisticsAccumulator		*m_statistics;
 };
 #endif
@@ -295,7 +295,6 @@ int	size;
  */
 NorthService::NorthService(const string& myName, const string& token) :
 	m_dataLoad(NULL),
-	m_dataSender(NULL),
 	northPlugin(NULL),
 	m_assetTracker(NULL),
 	m_shutdown(false),
@@ -307,7 +306,8 @@ NorthService::NorthService(const string& myName, const string& token) :
 	m_dryRun(false),
 	m_requestRestart(),
 	m_auditLogger(NULL),
-	m_perfMonitor(NULL)
+	m_perfMonitor(NULL),
+	m_statistics(NULL)
 {
 	m_name = myName;
 	logger = new Logger(myName);
@@ -321,14 +321,16 @@ NorthService::~NorthService()
 {
 	if (m_perfMonitor)
 		delete m_perfMonitor;
+	if (m_statistics)
+		delete m_statistics;
 	if (northPlugin)
 		delete northPlugin;
 	if (m_storage)
 		delete m_storage;
 	if (m_dataLoad)
 		delete m_dataLoad;
-	if (m_dataSender)
-		delete m_dataSender;
+	for (auto sender : m_dataSenders)
+		delete sender;
 	if (m_pluginData)
 		delete m_pluginData;
 	if (m_assetTracker)
@@ -491,6 +493,14 @@ void NorthService::start(string& coreAddress, unsigned short corePort)
 				m_dataLoad->setBlockSize(newBlock);
 			}
 		}
+		if (m_configAdvanced.itemExists("binaryFetch"))
+		{
+			m_dataLoad->setBinaryFetch(m_configAdvanced.getValue("binaryFetch").compare("true") == 0);
+		}
+		if (m_configAdvanced.itemExists("sharedMemoryTransport"))
+		{
+			m_storage->setSharedMemory(m_configAdvanced.getValue("sharedMemoryTransport").compare("true") == 0);
+		}
 		if (m_configAdvanced.itemExists("streamUpdate"))
 		{
 			unsigned long newStreamUpdate = strtoul(
@@ -522,8 +532,47 @@ void NorthService::start(string& coreAddress, unsigned short corePort)
 			if (m_assetTracker)
 				m_assetTracker->tune(interval);
 		}
-		m_dataSender = new DataSender(northPlugin, m_dataLoad, this);
-		m_dataSender->setPerfMonitor(m_perfMonitor);
+		unsigned long senders = 1;
+		if (m_configAdvanced.itemExists("senderThreads"))
+		{
+			senders = strtoul(m_configAdvanced.getValue("senderThreads").c_str(),
+						NULL,
+						10);
+			if (senders < 1)
+			{
+				senders = 1;
+			}
+			else if (senders > 1 && !northPlugin->isThreadSafe())
+			{
+				logger->warn("The plugin %s does not support concurrent sends, using a single send thread",
+						m_pluginName.c_str());
+				senders = 1;
+			}
+		}
+		if (senders > 1)
+		{
+			logger->info("Sending data with %lu threads, readings are partitioned by asset", senders);
+			m_dataLoad->setPartitions(senders);
+		}
+		// Statistics of all the senders are written in a single update per flush
+		m_statistics = new StatisticsAccumulator(m_storage);
+		m_statistics->setFlushInterval(FLUSH_STATS_INTERVAL);
+		m_statistics->setFailureThreshold(STATS_UPDATE_FAIL_THRESHOLD);
+		m_statistics->define("Readings Sent", "Readings Sent North");
+		m_statistics->define(m_dataLoad->getName(), m_dataLoad->getName() + " Readings Sent");
+		if (m_configAdvanced.itemExists("statisticsFlushCount"))
+		{
+			m_statistics->setFlushCount(strtoul(
+					m_configAdvanced.getValue("statisticsFlushCount").c_str(), NULL, 10));
+		}
+		m_statistics->start();
+
+		for (unsigned int i = 0; i < senders; i++)
+		{
+			DataSender *sender = new DataSender(northPlugin, m_dataLoad, this, i);
+			sender->setPerfMonitor(m_perfMonitor);
+			m_dataSenders.push_back(sender);
+		}
 
 		if (!m_dryRun)
 		{
@@ -549,9 +598,12 @@ void NorthService::start(string& coreAddress, unsigned short corePort)
 		}
 
 		m_dataLoad->shutdown();		// Forces the data load to return from any blocking fetch call
-		delete m_dataSender;
-		m_dataSender = NULL;
+		for (auto sender : m_dataSenders)
+			delete sender;
+		m_dataSenders.clear();
 		logger->debug("North service data sender has shut down");
+		delete m_statistics;
+		m_statistics = NULL;
 		delete m_dataLoad;
 		m_dataLoad = NULL;
 		logger->debug("North service shutting down plugin");
@@ -857,6 +909,14 @@ void NorthService::configChange(const string& categoryName, const string& catego
 				m_dataLoad->setBlockSize(newBlock);
 			}
 		}
+		if (m_configAdvanced.itemExists("binaryFetch"))
+		{
+			m_dataLoad->setBinaryFetch(m_configAdvanced.getValue("binaryFetch").compare("true") == 0);
+		}
+		if (m_configAdvanced.itemExists("sharedMemoryTransport"))
+		{
+			m_storage->setSharedMemory(m_configAdvanced.getValue("sharedMemoryTransport").compare("true") == 0);
+		}
 		if (m_configAdvanced.itemExists("streamUpdate"))
 		{
 			unsigned long newStreamUpdate = strtoul(
@@ -868,6 +928,11 @@ void NorthService::configChange(const string& categoryName, const string& catego
 				m_dataLoad->setStreamUpdate(newStreamUpdate);
 			}
 		}
+		if (m_statistics && m_configAdvanced.itemExists("statisticsFlushCount"))
+		{
+			m_statistics->setFlushCount(strtoul(
+					m_configAdvanced.getValue("statisticsFlushCount").c_str(), NULL, 10));
+		}
 		if (m_configAdvanced.itemExists("assetTrackerInterval"))
 		{
 			unsigned long interval  = strtoul(
@@ -907,8 +972,9 @@ void NorthService::restartPlugin()
 {
 	m_restartPlugin = false;
 
-	// Stop the send data thread
-	m_dataSender->pause();
+	// Stop the send data threads
+	for (auto sender : m_dataSenders)
+		sender->pause();
 
 	if (m_pluginData)
 	{
@@ -944,8 +1010,11 @@ void NorthService::restartPlugin()
 		logger->debug("Start %s plugin", m_pluginName.c_str());
 		northPlugin->start();
 	}
-	m_dataSender->updatePlugin(northPlugin);
-	m_dataSender->release();
+	for (auto sender : m_dataSenders)
+	{
+		sender->updatePlugin(northPlugin);
+		sender->release();
+	}
 
 	// If the plugin supports control register the callback functions
 	if (northPlugin->hasControl() && m_allowControl)
@@ -988,6 +1057,16 @@ void NorthService::addConfigDefaults(DefaultConfigCategory& defaultConfig)
 		std::to_string(DEFAULT_BLOCK_SIZE),
 		std::to_string(DEFAULT_BLOCK_SIZE));
 	defaultConfig.setItemDisplayName("blockSize", "Data block size");
+	// Add binary fetch configuration item
+	defaultConfig.addItem("binaryFetch",
+		"Fetch readings from the storage service in a binary format rather than JSON, if the storage plugin supports it.",
+		"boolean", "false", "false");
+	defaultConfig.setItemDisplayName("binaryFetch", "Binary data fetch");
+	// Add shared memory transport configuration item
+	defaultConfig.addItem("sharedMemoryTransport",
+		"Fetch binary blocks of readings over a shared memory channel if the storage service is on the same host.",
+		"boolean", "false", "false");
+	defaultConfig.setItemDisplayName("sharedMemoryTransport", "Shared memory transport");
 	// Add streams update configuration item
 	defaultConfig.addItem("streamUpdate",
 		"Set the number of blocks to be sent before updating the stream location in the storage layer.",
@@ -1005,6 +1084,22 @@ void NorthService::addConfigDefaults(DefaultConfigCategory& defaultConfig)
 	defaultConfig.setItemDisplayName("prefetchLimit", "Data block prefetch");
 	defaultConfig.setItemAttribute("prefetchLimit", ConfigCategory::MINIMUM_ATTR, "2");
 	defaultConfig.setItemAttribute("prefetchLimit", ConfigCategory::MAXIMUM_ATTR, "10");
+	if (northPlugin->isThreadSafe())
+	{
+		// Only offered for plugins that support concurrent sends
+		defaultConfig.addItem("senderThreads",
+			"The number of threads sending data in parallel, readings are partitioned by asset. A change requires a restart of the service.",
+			"integer",
+			std::to_string(1),
+			std::to_string(1));
+		defaultConfig.setItemDisplayName("senderThreads", "Send threads");
+		defaultConfig.setItemAttribute("senderThreads", ConfigCategory::MINIMUM_ATTR, "1");
+		defaultConfig.setItemAttribute("senderThreads", ConfigCategory::MAXIMUM_ATTR, "16");
+	}
+	defaultConfig.addItem("statisticsFlushCount",
+		"Number of statistics increments that causes the statistics to be written before the flush interval, 0 to write them on the interval only.",
+		"integer", "0", "0");
+	defaultConfig.setItemDisplayName("statisticsFlushCount", "Statistics flush count");
 	defaultConfig.addItem("assetTrackerInterval",
 			"Number of milliseconds between updates of the asset tracker information",
 			"integer", std::to_string(MIN_ASSET_TRACKER_UPDATE),
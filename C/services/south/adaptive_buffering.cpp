@@ -0,0 +1,108 @@
+/*
+ * Fledge south service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <adaptive_buffering.h>
+
+/**
+ * Construct the controller with no buffering until the threshold
+ * and timeout are set
+ */
+AdaptiveBuffering::AdaptiveBuffering() : m_threshold(1), m_timeout(0),
+	m_batchSize(1), m_flushInterval(0), m_appendTime(0)
+{
+}
+
+/**
+ * Set the configured number of readings buffered before sending.
+ * This becomes the current buffer size.
+ *
+ * @param threshold	The configured buffer threshold
+ */
+void AdaptiveBuffering::setThreshold(unsigned int threshold)
+{
+	m_threshold = threshold;
+	m_batchSize = threshold;
+}
+
+/**
+ * Set the configured maximum latency of readings. This becomes the
+ * current flush interval.
+ *
+ * @param timeout	The maximum latency in milliseconds
+ */
+void AdaptiveBuffering::setTimeout(long timeout)
+{
+	m_timeout = timeout;
+	m_flushInterval = timeout;
+}
+
+/**
+ * Return to the configured buffer threshold and maximum latency and
+ * forget the append times measured so far
+ */
+void AdaptiveBuffering::reset()
+{
+	m_batchSize = m_threshold.load();
+	m_flushInterval = m_timeout.load();
+	m_appendTime = 0;
+}
+
+/**
+ * Adjust the number of readings buffered before sending and the time
+ * readings may be buffered, based on the time taken to append the last
+ * block to the storage layer and the latency of the readings in it.
+ *
+ * The buffer is grown while full blocks are waiting to be sent and
+ * there is headroom against the maximum latency, reducing the number
+ * of appends needed. It is shrunk if the maximum latency is exceeded.
+ * The time readings may wait in the buffer allows for the time the
+ * storage layer takes to append them.
+ *
+ * @param rows		The number of readings appended
+ * @param appendTime	The time in ms taken to append the readings
+ * @param latency	The time in ms the oldest reading waited in the service
+ * @param backlog	True if full blocks are waiting to be sent
+ */
+void AdaptiveBuffering::update(size_t rows, long appendTime, long latency, bool backlog)
+{
+	// Work on a copy of the state, the configuration may be changed
+	// by another thread during the update
+	unsigned int threshold = m_threshold;
+	long timeout = m_timeout;
+	unsigned int batchSize = m_batchSize;
+	long smoothed = m_appendTime;
+
+	// Smooth the append time so a single slow append is not overreacted to
+	if (smoothed == 0)
+		smoothed = appendTime;
+	else
+		smoothed = (3 * smoothed + appendTime) / 4;
+
+	unsigned int minBatch = threshold < ADAPTIVE_MIN_BATCH
+					? threshold : ADAPTIVE_MIN_BATCH;
+	unsigned int maxBatch = threshold * ADAPTIVE_MAX_FACTOR;
+
+	if (latency + appendTime > timeout)
+	{
+		// Missing the latency target, send smaller blocks more often
+		batchSize = batchSize * 3 / 4;
+		if (batchSize < minBatch)
+			batchSize = minBatch;
+	}
+	else if (backlog && rows >= batchSize && latency + 2 * smoothed < timeout / 2)
+	{
+		// Full blocks are waiting, send more readings in each block
+		batchSize += batchSize / 8 ? batchSize / 8 : 1;
+		if (batchSize > maxBatch)
+			batchSize = maxBatch;
+	}
+
+	long interval = timeout - 2 * smoothed;
+	m_appendTime = smoothed;
+	m_batchSize = batchSize;
+	m_flushInterval = interval < ADAPTIVE_MIN_FLUSH ? ADAPTIVE_MIN_FLUSH : interval;
+}
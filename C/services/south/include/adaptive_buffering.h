@@ -0,0 +1,51 @@
+#ifndef _ADAPTIVE_BUFFERING_H
+#define _ADAPTIVE_BUFFERING_H
+/*
+ * Fledge south service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <cstddef>
+#include <atomic>
+
+/*
+ * Constants related to adaptive buffering of readings
+ */
+#define ADAPTIVE_MIN_BATCH	10	// Smallest number of readings buffered before sending
+#define ADAPTIVE_MAX_FACTOR	10	// Largest multiple of the buffer threshold that is buffered
+#define ADAPTIVE_MIN_FLUSH	10	// Shortest time in ms readings are buffered before sending
+
+/**
+ * The controller used by the ingest class to adapt the number of
+ * readings buffered before an append, and the time readings may be
+ * buffered, to the time the storage layer takes to append them.
+ *
+ * The controller is updated by the thread that appends the readings
+ * and configured by the thread that handles configuration changes,
+ * so its state is held in atomics.
+ */
+class AdaptiveBuffering {
+	public:
+		AdaptiveBuffering();
+		void		setThreshold(unsigned int threshold);
+		void		setTimeout(long timeout);
+		void		reset();
+		void		update(size_t rows, long appendTime, long latency, bool backlog);
+		unsigned int	batchSize() const { return m_batchSize; };
+		long		flushInterval() const { return m_flushInterval; };
+		long		appendTime() const { return m_appendTime; };
+	private:
+		std::atomic<unsigned int>
+				m_threshold;	// Configured buffer threshold
+		std::atomic<long>
+				m_timeout;	// Configured maximum latency in ms
+		std::atomic<unsigned int>
+				m_batchSize;	// Number of readings buffered before sending
+		std::atomic<long>
+				m_flushInterval;// Time in ms readings may be buffered before sending
+		std::atomic<long>
+				m_appendTime;	// Smoothed time in ms to append a block
+};
+#endif
@@ -21,6 +21,12 @@ static struct {
 			"Maximum time to spend filling buffer before sending", "integer", "5000" },
 	{ "bufferThreshold",	"Maximum buffered Readings",
 			"Number of readings to buffer before sending", "integer", "100" },
+	{ "adaptiveBuffering",	"Adaptive Buffering",
+			"Adjust the number of readings buffered and the time they are buffered to meet the maximum reading latency", "boolean", "false" },
+	{ "sharedMemoryTransport",	"Shared Memory Transport",
+			"Append readings over a shared memory channel if the storage service is on the same host", "boolean", "false" },
+	{ "statisticsFlushCount",	"Statistics Flush Count",
+			"Number of statistics increments that causes the statistics to be written before the flush interval, 0 to write them on the interval only", "integer", "0" },
 	{ "throttle",	"Throttle",
 			"Enable flow control by reducing the poll rate", "boolean", "false" },
 	{ "readingsPerSec",	"Reading Rate",
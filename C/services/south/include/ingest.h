@@ -17,8 +17,10 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 #include <sstream>
 #include <unordered_set>
+#include <unordered_map>
 #include <condition_variable>
 #include <filter_plugin.h>
 #include <filter_pipeline.h>
@@ -26,6 +28,8 @@
 #include <service_handler.h>
 #include <set>
 #include <perfmonitors.h>
+#include <statistics_accumulator.h>
+#include <adaptive_buffering.h>
 
 #define SERVICE_NAME  "Fledge South"
 
@@ -45,6 +49,11 @@
 #define AFC_SLEEP_MAX		200	// Maximum sleep tiem in ms between tests
 #define AFC_MAX_WAIT		5000	// Maximum amount of time we wait for the queue to drain
 
+/*
+ * Constants related to the block ingest of readings by async plugins
+ */
+#define BLOCK_POOL_SIZE		8	// Number of empty reading blocks kept for reuse
+
 /**
  * The ingest class is used to ingest asset readings.
  * It maintains a queue of readings to be sent to storage,
@@ -61,7 +70,12 @@ public:
 	~Ingest();
 
 	void		ingest(const Reading& reading);
+	void		ingest(Reading&& reading);
+	void		ingest(Reading *reading);
 	void		ingest(const std::vector<Reading *> *vec);
+	std::vector<Reading *>
+			*reserveBlock(size_t count);
+	long		commitBlock(std::vector<Reading *> *block);
 	void		start(long timeout, unsigned int threshold);
 	bool		running();
     	bool		isStopping();
@@ -69,8 +83,6 @@ public:
 	void		processQueue();
 	void		waitForQueue();
 	size_t		queueLength();
-	void		updateStats(void);
-	int 		createStatsDbEntry(const std::string& assetName);
 
 	bool		loadFilters(const std::string& categoryName);
 	static void	passToOnwardFilter(OUTPUT_HANDLE *outHandle,
@@ -78,8 +90,27 @@ public:
 	static void	useFilteredData(OUTPUT_HANDLE *outHandle,
 					READINGSET* readings);
 
-	void		setTimeout(const long timeout) { m_timeout = timeout; };
-	void		setThreshold(const unsigned int threshold) { m_queueSizeThreshold = threshold; };
+	void		setTimeout(const long timeout)
+			{
+				m_timeout = timeout;
+				m_flushInterval = timeout;
+				m_buffering.setTimeout(timeout);
+			};
+	void		setThreshold(const unsigned int threshold)
+			{
+				m_queueSizeThreshold = threshold;
+				m_batchSize = threshold;
+				m_buffering.setThreshold(threshold);
+			};
+	void		setAdaptive(bool adaptive);
+	void		setSharedMemory(bool enable)
+			{
+				m_storage.setSharedMemory(enable);
+			};
+	void		setStatisticsFlushCount(unsigned long count)
+			{
+				m_statistics->setFlushCount(count);
+			};
 	void		configChange(const std::string&, const std::string&);
 	void		configChildCreate(const std::string& , const std::string&, const std::string&){};
 	void		configChildDelete(const std::string& , const std::string&){};
@@ -97,28 +128,55 @@ public:
 	std::string  	getStringFromSet(const std::set<std::string> &dpSet);
 	void		setFlowControl(unsigned int lowWater, unsigned int highWater) { m_lowWater = lowWater; m_highWater = highWater; };
 	void		flowControl();
+	long		flowControlDelay();
 	void		setPerfMon(PerformanceMonitor *mon)
 			{
+				m_perfQueueLength = mon->getMonitor("queueLength");
+				m_perfIngestCount = mon->getMonitor("ingestCount");
+				m_perfReadLatency = mon->getMonitor("readLatency");
+				m_perfStoredReadings = mon->getMonitor("storedReadings");
+				m_perfAppendTime = mon->getMonitor("appendTime");
+				m_perfBatchSize = mon->getMonitor("batchSize");
+				m_perfFlushInterval = mon->getMonitor("flushInterval");
 				m_performance = mon;
 			};
 
 private:
-	void				signalStatsUpdate() {
-						// Signal stats thread to update stats
-						std::lock_guard<std::mutex> guard(m_statsMutex);
-						m_statsCv.notify_all();
-					};
+	/**
+	 * The cached per asset state used when a block of readings
+	 * has been sent to the storage service. This avoids building
+	 * asset tracking tuples and datapoint sets for every reading.
+	 */
+	struct AssetRecord {
+		AssetRecord() : tracking(NULL), readings(0), newDatapoints(false) {};
+		AssetTrackingTuple		*tracking;	// Ingest tuple held by the asset tracker
+		std::string			statsKey;	// Key of the asset in the statistics table
+		std::set<std::string>		datapoints;	// Datapoint names seen for the asset
+		std::vector<std::string>	layout;		// Datapoint names of the last reading
+		unsigned int			readings;	// Readings of the asset in the current block
+		bool				newDatapoints;	// Datapoints not yet passed to storage asset tracking
+	};
+	void				queueReading(Reading *reading);
+	void				releaseBlock(std::vector<Reading *> *block);
+	bool				trackReadings(const std::vector<Reading *>& readings);
+	void				indeterminateAppend(const std::vector<Reading *>& readings);
+	void				defineServiceStatistics();
+	void				trackDatapoints(AssetRecord *record, const std::vector<Datapoint *>& datapoints);
 	void				logDiscardedStat() {
-						std::lock_guard<std::mutex> guard(m_statsMutex);
-						m_discardedReadings++;
+						m_statistics->increment("DISCARDED");
 					};
 	long				calculateWaitTime();
-	int 				createServiceStatsDbEntry();
+	void				adaptBuffering(size_t rows, long appendTime, long latency);
 
 	StorageClient&			m_storage;
 	long				m_timeout;
 	bool				m_shutdown;
 	unsigned int			m_queueSizeThreshold;
+	// Adaptive buffering of readings
+	bool				m_adaptive;
+	AdaptiveBuffering		m_buffering;
+	std::atomic<unsigned int>	m_batchSize;	// Number of readings buffered before sending
+	std::atomic<long>		m_flushInterval;// Time in ms readings may be buffered before sending
 	bool				m_running;
 	std::string 			m_serviceName;
 	std::string 			m_pluginName;
@@ -126,13 +184,10 @@ private:
 	// New data: queued
 	std::vector<Reading *>*		m_queue;
 	std::mutex			m_qMutex;
-	std::mutex			m_statsMutex;
 	std::mutex			m_pipelineMutex;
 	std::thread*			m_thread;
-	std::thread*			m_statsThread;
 	Logger*				m_logger;
 	std::condition_variable		m_cv;
-	std::condition_variable		m_statsCv;
 	// Data ready to be filtered/sent
 	std::vector<Reading *>*		m_data;
 	std::vector<std::vector<Reading *>*>
@@ -140,18 +195,19 @@ private:
 	std::queue<std::vector<Reading *>*>
 					m_fullQueues;
 	std::mutex			m_fqMutex;
-	unsigned int			m_discardedReadings; // discarded readings since last update to statistics table
+	// Empty reading blocks that may be reserved by async plugins
+	std::vector<std::vector<Reading *>*>
+					m_blockPool;
+	std::mutex			m_poolMutex;
 	FilterPipeline*			m_filterPipeline;
 	
-	std::unordered_set<std::string> statsDbEntriesCache;  // confirmed stats table entries
-	std::map<std::string, int>	statsPendingEntries;  // pending stats table entries
+	StatisticsAccumulator		*m_statistics;	      // Statistics pending update
 	bool				m_highLatency;	      // Flag to indicate we are exceeding latency request
 	bool				m_10Latency;	      // Latency within 10%
 	time_t				m_reportedLatencyTime;// Last tiem we reported high latency
 	int				m_failCnt;
 	bool				m_storageFailed;
 	int				m_storesFailed;
-	int				m_statsUpdateFails;
 	enum { STATS_BOTH, STATS_ASSET, STATS_SERVICE }
 					m_statisticsOption;
 	unsigned int			m_highWater;
@@ -160,7 +216,18 @@ private:
 	time_t				m_deprecatedAgeOut;
 	time_t				m_deprecatedAgeOutStorage;
 	PerformanceMonitor		*m_performance;
+	// Handles for the monitors collected for every reading or block
+	PerfMon				*m_perfQueueLength;
+	PerfMon				*m_perfIngestCount;
+	PerfMon				*m_perfReadLatency;
+	PerfMon				*m_perfStoredReadings;
+	PerfMon				*m_perfAppendTime;
+	PerfMon				*m_perfBatchSize;
+	PerfMon				*m_perfFlushInterval;
 	std::mutex			m_useDataMutex;
+	std::unordered_map<std::string, AssetRecord>
+					m_assetCache;
+	AssetTracker			*m_assetCacheTracker;
 };
 
 #endif
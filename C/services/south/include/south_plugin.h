@@ -19,6 +19,15 @@
 typedef void (*INGEST_CB)(void *, Reading);
 typedef void (*INGEST_CB2)(void *, std::vector<Reading *>*);
 
+/*
+ * Callbacks used by async plugins to ingest blocks of readings. A block
+ * is reserved, filled with readings and then committed, the commit
+ * returns the time in milliseconds the plugin should wait before it
+ * commits another block.
+ */
+typedef std::vector<Reading *> *(*INGEST_RESERVE_CB)(void *, size_t);
+typedef long (*INGEST_COMMIT_CB)(void *, std::vector<Reading *>*);
+
 /**
  * Class that represents a south plugin.
  *
@@ -43,6 +52,8 @@ public:
 	void		shutdown();
 	void		registerIngest(INGEST_CB, void *);
 	void		registerIngestV2(INGEST_CB2, void *);
+	void		registerIngestBlock(INGEST_RESERVE_CB, INGEST_COMMIT_CB, void *);
+	bool		hasIngestBlock() { return pluginRegisterBlockPtr != NULL; };
 	bool		isAsync() { return info->options & SP_ASYNC; };
 	bool		hasControl() { return info->options & SP_CONTROL; };
 	bool		persistData() { return info->options & SP_PERSIST_DATA; };
@@ -61,6 +72,8 @@ private:
 	void		(*pluginShutdownPtr)(PLUGIN_HANDLE);
 	void		(*pluginRegisterPtr)(PLUGIN_HANDLE, INGEST_CB, void *);
 	void		(*pluginRegisterPtrV2)(PLUGIN_HANDLE, INGEST_CB2, void *);
+	void		(*pluginRegisterBlockPtr)(PLUGIN_HANDLE, INGEST_RESERVE_CB,
+						INGEST_COMMIT_CB, void *);
 	std::string	(*pluginShutdownDataPtr)(const PLUGIN_HANDLE);
 	void		(*pluginStartDataPtr)(PLUGIN_HANDLE,
 					      const std::string& pluginData);
@@ -36,235 +36,6 @@ static void ingestThread(Ingest *ingest)
 	}
 }
 
-/**
- * Thread to update statistics table in DB
- */
-static void statsThread(Ingest *ingest)
-{
-	while (ingest->running())
-	{
-		ingest->updateStats();
-	}
-}
-
-/**
- * Create a row for given assetName in statistics DB table, if not present already
- * The key checked/created in the table is "<assetName>"
- * 
- * @param assetName     Asset name for the plugin that is sending readings
- * @return int		Return -1 on error, 0 if not required or 1 if the entry exists
- */
-int Ingest::createStatsDbEntry(const string& assetName)
-{
-	if (m_statisticsOption == STATS_SERVICE)
-	{
-		// No asset stats required
-		return 0;
-	}
-	// Prepare fledge.statistics update
-	string statistics_key = assetName;
-	for (auto & c: statistics_key) c = toupper(c);
-	
-	// SELECT * FROM fledge.statiatics WHERE key = statistics_key
-	const Condition conditionKey(Equals);
-	Where *wKey = new Where("key", conditionKey, statistics_key);
-	Query qKey(wKey);
-
-	ResultSet* result = 0;
-	try
-	{
-		// Query via storage client
-		result = m_storage.queryTable("statistics", qKey);
-
-		if (!result->rowCount())
-		{
-			// Prepare insert values for insertTable
-			InsertValues newStatsEntry;
-			newStatsEntry.push_back(InsertValue("key", statistics_key));
-			newStatsEntry.push_back(InsertValue("description", string("Readings received from asset ")+assetName));
-			// Set "value" field for insert using the JSON document object
-			newStatsEntry.push_back(InsertValue("value", 0));
-			newStatsEntry.push_back(InsertValue("previous_value", 0));
-
-			// Do the insert
-			if (!m_storage.insertTable("statistics", newStatsEntry))
-			{
-				m_logger->error("%s:%d : Insert new row into statistics table failed, newStatsEntry='%s'", __FUNCTION__, __LINE__, newStatsEntry.toJSON().c_str());
-				delete result;
-				return -1;
-			}
-		}
-		delete result;
-	}
-	catch (...)
-	{
-		m_logger->error("%s:%d : Unable to create new row in statistics table with key='%s'", __FUNCTION__, __LINE__, statistics_key.c_str());
-		return -1;
-	}
-	return 1;
-}
-
-/**
- * Create a row for service in the statistics DB table, if not present already
- * 
- */
-int Ingest::createServiceStatsDbEntry()
-{
-	if (m_statisticsOption == STATS_ASSET)
-	{
-		// No service stats required
-		return 0;
-	}
-	// SELECT * FROM fledge.configuration WHERE key = categoryName
-	const Condition conditionKey(Equals);
-	Where *wKey = new Where("key", conditionKey, m_serviceName + INGEST_SUFFIX);
-	Query qKey(wKey);
-
-	ResultSet* result = 0;
-	try
-	{
-		// Query via storage client
-		result = m_storage.queryTable("statistics", qKey);
-
-		if (!result->rowCount())
-		{
-			// Prepare insert values for insertTable
-			InsertValues newStatsEntry;
-			newStatsEntry.push_back(InsertValue("key", m_serviceName + INGEST_SUFFIX));
-			newStatsEntry.push_back(InsertValue("description", string("Readings received from service ")+ m_serviceName));
-			// Set "value" field for insert using the JSON document object
-			newStatsEntry.push_back(InsertValue("value", 0));
-			newStatsEntry.push_back(InsertValue("previous_value", 0));
-
-			// Do the insert
-			if (!m_storage.insertTable("statistics", newStatsEntry))
-			{
-				m_logger->error("%s:%d : Insert new row into statistics table failed, newStatsEntry='%s'", __FUNCTION__, __LINE__, newStatsEntry.toJSON().c_str());
-				delete result;
-				return -1;
-			}
-		}
-		delete result;
-	}
-	catch (...)
-	{
-		m_logger->error("%s:%d : Unable to create new row in statistics table with key='%s'", __FUNCTION__, __LINE__, m_serviceName.c_str());
-		return -1;
-	}
-	return 0;
-}
-/**
- * Update statistics for this south service. Successfully processed 
- * readings are reflected against plugin asset name and READINGS keys.
- * Discarded readings stats are updated against DISCARDED key.
- */
-void Ingest::updateStats()
-{
-	unique_lock<mutex> lck(m_statsMutex);
-	if (m_running) // don't wait on condition variable if plugin/ingest is being shutdown
-		m_statsCv.wait_for(lck, std::chrono::seconds(FLUSH_STATS_INTERVAL));
-
-	if (statsPendingEntries.empty())
-	{
-		return;
-	}
-
-	int readings=0;
-	vector<pair<ExpressionValues *, Where *>> statsUpdates;
-	string key;
-	const Condition conditionStat(Equals);
-	
-	for (auto it = statsPendingEntries.begin(); it != statsPendingEntries.end(); ++it)
-	{
-		if (statsDbEntriesCache.find(it->first) == statsDbEntriesCache.end())
-		{
-			if (createStatsDbEntry(it->first) > 0)
-			{
-				statsDbEntriesCache.insert(it->first);
-			}
-		}
-		
-		if (it->second)
-		{
-			if (m_statisticsOption == STATS_BOTH || m_statisticsOption == STATS_ASSET)
-			{
-				// Prepare fledge.statistics update
-				key = it->first;
-				for (auto & c: key) c = toupper(c);
-
-				// Prepare "WHERE key = name
-				Where *wPluginStat = new Where("key", conditionStat, key);
-
-				// Prepare value = value + inc
-				ExpressionValues *updateValue = new ExpressionValues;
-				updateValue->push_back(Expression("value", "+", (int) it->second));
-
-				statsUpdates.emplace_back(updateValue, wPluginStat);
-			}
-			readings += it->second;
-		}
-	}
-
-	if (readings)
-	{
-		Where *wPluginStat = new Where("key", conditionStat, "READINGS");
-		ExpressionValues *updateValue = new ExpressionValues;
-		updateValue->push_back(Expression("value", "+", (int) readings));
-		statsUpdates.emplace_back(updateValue, wPluginStat);
-
-		if (m_statisticsOption == STATS_BOTH || m_statisticsOption == STATS_SERVICE)
-		{
-			Where *wPluginStat = new Where("key", conditionStat, m_serviceName + INGEST_SUFFIX);
-			ExpressionValues *updateValue = new ExpressionValues;
-			updateValue->push_back(Expression("value", "+", (int) readings));
-			statsUpdates.emplace_back(updateValue, wPluginStat);
-		}
-	}
-	if (m_discardedReadings)
-	{
-		Where *wPluginStat = new Where("key", conditionStat, "DISCARDED");
-		ExpressionValues *updateValue = new ExpressionValues;
-		updateValue->push_back(Expression("value", "+", (int) m_discardedReadings));
-		statsUpdates.emplace_back(updateValue, wPluginStat);
- 	}
-	
-	try {
-		int rv = m_storage.updateTable("statistics", statsUpdates);
-		
-		if (rv < 0)
-		{
-			if (++m_statsUpdateFails > STATS_UPDATE_FAIL_THRESHOLD)
-			{
-				Logger::getLogger()->warn("Update of statistics failure has persisted, attempting recovery");
-				createServiceStatsDbEntry();
-				statsDbEntriesCache.clear();
-				m_statsUpdateFails = 0;
-			}
-			else if (m_statsUpdateFails == 1)
-			{
-				Logger::getLogger()->warn("Update of statistics failed");
-			}
-			else
-			{
-				Logger::getLogger()->warn("Update of statistics still failing");
-			}
-		}
-		else
-		{
-			m_discardedReadings = 0;
-			statsPendingEntries.clear();
-		}
-	}
-	catch (...) {
-		Logger::getLogger()->info("%s:%d : Statistics table update failed, will retry on next iteration", __FUNCTION__, __LINE__);
-	}
-	for (auto it = statsUpdates.begin(); it != statsUpdates.end(); ++it)
-	{
-		delete it->first;
-		delete it->second;
-	}
-}
-
 /**
  * Construct an Ingest class to handle the readings queue.
  * A seperate thread is used to send the readings to the
@@ -293,7 +64,6 @@ Ingest::Ingest(StorageClient& storage,
 	m_queue = new vector<Reading *>();
 	m_logger = Logger::getLogger();
 	m_data = NULL;
-	m_discardedReadings = 0;
 	m_highLatency = false;
 
 	// populate asset and storage asset tracking cache
@@ -301,8 +71,10 @@ Ingest::Ingest(StorageClient& storage,
 	as->populateAssetTrackingCache(m_pluginName, "Ingest");
 	as->populateStorageAssetTrackingCache();
 
-	// Create the stats entry for the service
-	createServiceStatsDbEntry();
+	// Statistics are accumulated and written in a single update per flush
+	m_statistics = new StatisticsAccumulator(&m_storage);
+	m_statistics->setFlushInterval(FLUSH_STATS_INTERVAL);
+	m_statistics->setFailureThreshold(STATS_UPDATE_FAIL_THRESHOLD);
 
 	m_filterPipeline = NULL;
 
@@ -310,6 +82,10 @@ Ingest::Ingest(StorageClient& storage,
 
 	m_deprecatedAgeOut = 0;
 	m_deprecatedAgeOutStorage = 0;
+
+	m_assetCacheTracker = NULL;
+
+	m_adaptive = false;
 }
 
 /**
@@ -321,9 +97,14 @@ Ingest::Ingest(StorageClient& storage,
 void Ingest::start(long timeout, unsigned int threshold)
 {
 	m_timeout = timeout;
+	m_flushInterval = timeout;
 	m_queueSizeThreshold = threshold;
+	m_batchSize = threshold;
+	m_buffering.setTimeout(timeout);
+	m_buffering.setThreshold(threshold);
 	m_thread = new thread(ingestThread, this);
-	m_statsThread = new thread(statsThread, this);
+	defineServiceStatistics();
+	m_statistics->start();
 }
 
 /**
@@ -353,9 +134,7 @@ Ingest::~Ingest()
 	m_cv.notify_one();
 	m_thread->join();
 	processQueue();
-	m_statsCv.notify_one();
-	m_statsThread->join();
-	updateStats();
+	m_statistics->stop();
 	// Cleanup and readings left in the various queues
 	for (auto& reading : *m_queue)
 	{
@@ -380,8 +159,12 @@ Ingest::~Ingest()
 		delete q;
 		m_fullQueues.pop();
 	}
+	for (auto& block : m_blockPool)
+	{
+		delete block;
+	}
 	delete m_thread;
-	delete m_statsThread;
+	delete m_statistics;
 
 	// Delete filter pipeline
 	{
@@ -420,13 +203,47 @@ bool Ingest::isStopping()
  * @param reading	The single reading to ingest
  */
 void Ingest::ingest(const Reading& reading)
+{
+	queueReading(new Reading(reading));
+}
+
+/**
+ * Add a reading to the reading queue, moving the datapoints
+ * of the reading rather than copying them
+ *
+ * @param reading	The single reading to ingest
+ */
+void Ingest::ingest(Reading&& reading)
+{
+	queueReading(new Reading(std::move(reading)));
+}
+
+/**
+ * Add a reading to the reading queue. The ingest class takes
+ * ownership of the reading and will delete it once it has been
+ * sent to the storage service.
+ *
+ * @param reading	The single reading to ingest
+ */
+void Ingest::ingest(Reading *reading)
+{
+	queueReading(reading);
+}
+
+/**
+ * Append a reading to the current queue, passing the queue on
+ * to the ingest thread once it is full
+ *
+ * @param reading	The reading to append, the queue takes ownership
+ */
+void Ingest::queueReading(Reading *reading)
 {
 vector<Reading *> *fullQueue = 0;
 
 	{
 		lock_guard<mutex> guard(m_qMutex);
-		m_queue->emplace_back(new Reading(reading));
-		if (m_queue->size() >= m_queueSizeThreshold || m_running == false)
+		m_queue->emplace_back(reading);
+		if (m_queue->size() >= m_batchSize || m_running == false)
 		{
 			fullQueue = m_queue;
 			m_queue = new vector<Reading *>;
@@ -439,7 +256,7 @@ vector<Reading *> *fullQueue = 0;
 	}
 	if (m_fullQueues.size())
 		m_cv.notify_all();
-	m_performance->collect("queueLength", (long)queueLength());
+	m_performance->collect(m_perfQueueLength, (long)queueLength());
 }
 
 /**
@@ -461,7 +278,7 @@ unsigned int nFullQueues = 0;
 		{
 			m_queue->emplace_back(rdng);
 		}
-		if (m_queue->size() >= m_queueSizeThreshold || m_running == false)
+		if (m_queue->size() >= m_batchSize || m_running == false)
 		{
 			fullQueue = m_queue;
 			m_queue = new vector<Reading *>;
@@ -479,12 +296,136 @@ unsigned int nFullQueues = 0;
 		lock_guard<mutex> guard(m_fqMutex);
 		nFullQueues = m_fullQueues.size();
 	}
-	if (nFullQueues != 0 || qSize > m_queueSizeThreshold * 3 / 4)
+	if (nFullQueues != 0 || qSize > m_batchSize * 3 / 4)
 	{
 		m_cv.notify_all();
 	}
-	m_performance->collect("queueLength", (long)queueLength());
-	m_performance->collect("ingestCount", (long)vec->size());
+	m_performance->collect(m_perfQueueLength, (long)queueLength());
+	m_performance->collect(m_perfIngestCount, (long)vec->size());
+}
+
+/**
+ * Reserve an empty block of readings for an async plugin to fill.
+ * The plugin appends readings it has allocated to the block and then
+ * passes the block to commitBlock. Blocks are reused, so in the steady
+ * state no allocation is needed to pass readings to the ingest queue.
+ *
+ * @param count		The number of readings the caller expects to add
+ * @return		An empty block of readings
+ */
+vector<Reading *> *Ingest::reserveBlock(size_t count)
+{
+vector<Reading *> *block = NULL;
+
+	{
+		lock_guard<mutex> guard(m_poolMutex);
+		if (!m_blockPool.empty())
+		{
+			block = m_blockPool.back();
+			m_blockPool.pop_back();
+		}
+	}
+	if (!block)
+	{
+		block = new vector<Reading *>;
+	}
+	block->reserve(count);
+	return block;
+}
+
+/**
+ * Return an empty block of readings to the pool of blocks that
+ * may be reserved
+ *
+ * @param block		The empty block
+ */
+void Ingest::releaseBlock(vector<Reading *> *block)
+{
+	block->clear();
+	{
+		lock_guard<mutex> guard(m_poolMutex);
+		if (m_blockPool.size() < BLOCK_POOL_SIZE)
+		{
+			m_blockPool.push_back(block);
+			return;
+		}
+	}
+	delete block;
+}
+
+/**
+ * Add a block of readings previously returned by reserveBlock to the
+ * reading queue. The ingest class takes ownership of the block and the
+ * readings in it, the caller must not use either after this call.
+ *
+ * If the queue is empty the block becomes the queue, or is passed
+ * directly to the ingest thread if it is full, rather than the readings
+ * being copied.
+ *
+ * Unlike the other ingest calls this never waits for the queue to drain,
+ * instead the time the caller should wait before it commits another
+ * block is returned. This allows a plugin to apply back pressure to the
+ * source of the data in whatever way suits the source.
+ *
+ * @param block		The block of readings to ingest
+ * @return long		The time in milliseconds the caller should wait
+ *			before committing another block, zero if no wait
+ *			is required
+ */
+long Ingest::commitBlock(vector<Reading *> *block)
+{
+vector<Reading *> *fullQueue = 0;
+vector<Reading *> *spare = 0;
+size_t qSize;
+size_t count = block->size();
+unsigned int nFullQueues = 0;
+
+	if (count == 0)
+	{
+		releaseBlock(block);
+		return flowControlDelay();
+	}
+	{
+		lock_guard<mutex> guard(m_qMutex);
+		if (m_queue->empty())
+		{
+			spare = m_queue;
+			m_queue = block;
+		}
+		else
+		{
+			m_queue->insert(m_queue->end(), block->begin(), block->end());
+			// The readings now belong to the queue, only the block's storage is spare
+			block->clear();
+			spare = block;
+		}
+		if (m_queue->size() >= m_batchSize || m_running == false)
+		{
+			fullQueue = m_queue;
+			m_queue = spare;
+			spare = 0;
+		}
+		qSize = m_queue->size();
+	}
+	if (spare)
+	{
+		releaseBlock(spare);
+	}
+	{
+		lock_guard<mutex> guard(m_fqMutex);
+		if (fullQueue)
+		{
+			m_fullQueues.push(fullQueue);
+		}
+		nFullQueues = m_fullQueues.size();
+	}
+	if (nFullQueues != 0 || qSize > m_batchSize * 3 / 4)
+	{
+		m_cv.notify_all();
+	}
+	m_performance->collect(m_perfQueueLength, (long)queueLength());
+	m_performance->collect(m_perfIngestCount, (long)count);
+	return flowControlDelay();
 }
 
 /**
@@ -496,7 +437,7 @@ unsigned int nFullQueues = 0;
  */
 long Ingest::calculateWaitTime()
 {
-	long timeout = m_timeout;
+	long timeout = m_flushInterval;
 	lock_guard<mutex> guard(m_qMutex);
 	if (!m_queue->empty())
 	{
@@ -506,7 +447,7 @@ long Ingest::calculateWaitTime()
 		gettimeofday(&now, NULL);
 		long ageMS = (now.tv_sec - tm.tv_sec) * 1000 +
 			(now.tv_usec - tm.tv_usec) / 1000;
-		timeout = m_timeout - ageMS;
+		timeout -= ageMS;
 	}
 	return timeout;
 }
@@ -518,7 +459,7 @@ void Ingest::waitForQueue()
 {
 	if (m_fullQueues.size() > 0 || m_resendQueues.size() > 0)
 		return;
-	if (m_running && m_queue->size() < m_queueSizeThreshold)
+	if (m_running && m_queue->size() < m_batchSize)
 	{
 		long timeout = calculateWaitTime();
 		if (timeout > 0)
@@ -551,7 +492,12 @@ void Ingest::processQueue()
 		while (m_resendQueues.size() > 0)
 		{
 			vector<Reading *> *q = *m_resendQueues.begin();
-			if (m_storage.readingAppend(*q) == false)
+			bool appended = m_storage.readingAppend(*q);
+			if (appended == false && m_storage.lastAppendIndeterminate())
+			{
+				indeterminateAppend(*q);
+			}
+			if (appended == false)
 			{
 				if (!m_storageFailed)
 					m_logger->info("Still unable to resend buffered data, leaving on resend queue.");
@@ -582,7 +528,7 @@ void Ingest::processQueue()
 			else
 			{
 
-				m_performance->collect("storedReadings", (long int)(q->size()));
+				m_performance->collect(m_perfStoredReadings, (long int)(q->size()));
 				if (m_storageFailed)
 				{
 					m_logger->warn("Storage operational after %d failures", m_storesFailed);
@@ -590,108 +536,16 @@ void Ingest::processQueue()
 					m_storesFailed = 0;
 				}
 				m_failCnt = 0;
-				std::map<std::string, int>		statsEntriesCurrQueue;
-				AssetTracker *tracker = AssetTracker::getAssetTracker();
-				if (tracker == nullptr)
-                                {
-                                        Logger::getLogger()->error("%s could not initialize asset tracker",
-								__FUNCTION__);
-					return;
-                                }
-
-				string lastAsset = "";
-				int *lastStat = NULL;
-				std::map <std::string , std::set<std::string> > assetDatapointMap;
-
-				for (vector<Reading *>::iterator it = q->begin();
-							 it != q->end(); ++it)
+				if (!trackReadings(*q))
 				{
-					Reading *reading = *it;
-					string assetName = reading->getAssetName();
-                                        const std::vector<Datapoint *> dpVec = reading->getReadingData();
-					std::string temp;
-					std::set<std::string> tempSet;
-					// first sort the individual datapoints 
-					// e.g. dp2, dp3, dp1 push them in a set,to make them 
-					// dp1,dp2,dp3
-                                        for ( auto dp : dpVec)
-                                        {
-						temp.clear();
-                                                temp.append(dp->getName());
-						tempSet.insert(temp);
-                                        }
-
-					temp.clear();
-
-					// Push them in a set so as to avoid duplication of datapoints
-					// a reading of d1, d2, d3 and another d2,d3,d1 , second will be discarded
-					//
-					for (auto dp: tempSet)
-					{
-						set<string> &s= assetDatapointMap[assetName];
-						if (s.find(dp) == s.end())
-						{
-							s.insert(dp);
-						}
-					}
-
-					if (lastAsset.compare(assetName))
-					{
-						AssetTrackingTuple tuple(m_serviceName,
-									m_pluginName,
-									assetName,
-									"Ingest");
-
-						// Check Asset record exists
-						AssetTrackingTuple* res = tracker->findAssetTrackingCache(tuple);
-						if (res == NULL)
-						{
-							// Record non in cache, add it
-							tracker->addAssetTrackingTuple(tuple);
-						}
-						else
-						{
-							// Possibly Un-deprecate asset tracking record
-							unDeprecateAssetTrackingRecord(res,
-											assetName,
-											"Ingest");
-						}
-						lastAsset = assetName;
-						lastStat = &(statsEntriesCurrQueue[assetName]);
-						(*lastStat)++;
-					}
-					else if (lastStat)
-					{
-						(*lastStat)++;
-					}
-					delete reading;
+					return;
 				}
-
-				for (auto itr : assetDatapointMap)
+				for (auto reading : *q)
 				{
-					std::set<string> &s = itr.second;
-					unsigned int count = s.size();
-					StorageAssetTrackingTuple storageTuple(m_serviceName,
-										m_pluginName,
-										itr.first,
-										"store",
-										false,
-										"",
-										count);
-
-					StorageAssetTrackingTuple *ptr = &storageTuple;
-
-					// Update SAsset Tracker database and cache
-					tracker->updateCache(s, ptr);
+					delete reading;
 				}
-
 				delete q;
 				m_resendQueues.erase(m_resendQueues.begin());
-				unique_lock<mutex> lck(m_statsMutex);
-				for (auto &it : statsEntriesCurrQueue)
-				{
-					statsPendingEntries[it.first] += it.second;
-				}
 			}
 		}
 
@@ -770,6 +624,7 @@ void Ingest::processQueue()
 		 * Check the first reading in the list to see if we are meeting the
 		 * latency configuration we have been set
 		 */
+		long sendLatency = 0;
 		if (m_data)
 		{
 			vector<Reading *>::iterator itr = m_data->begin();
@@ -781,7 +636,12 @@ void Ingest::processQueue()
 				firstReading->getUserTimestamp(&tmFirst);
 				timersub(&tmNow, &tmFirst, &dur);
 				long latency = dur.tv_sec * 1000 + (dur.tv_usec / 1000);
-				m_performance->collect("readLatency", latency);
+				// Adaptive buffering uses the time the reading has been
+				// in the service, the user timestamp may be historical
+				firstReading->getTimestamp(&tmFirst);
+				timersub(&tmNow, &tmFirst, &dur);
+				sendLatency = dur.tv_sec * 1000 + (dur.tv_usec / 1000);
+				m_performance->collect(m_perfReadLatency, latency);
 				if (latency > m_timeout && m_highLatency == false)
 				{
 					m_logger->warn("Current send latency of %ldms exceeds requested maximum latency of %dmS", latency, m_timeout);
@@ -822,7 +682,16 @@ void Ingest::processQueue()
 		 */
 		if (m_data && m_data->size())
 		{
-			if (m_storage.readingAppend(*m_data) == false)
+			auto appendStart = chrono::steady_clock::now();
+			bool appended = m_storage.readingAppend(*m_data);
+			long appendTime = (long)chrono::duration_cast<chrono::milliseconds>(
+						chrono::steady_clock::now() - appendStart).count();
+			m_performance->collect(m_perfAppendTime, appendTime);
+			if (appended == false && m_storage.lastAppendIndeterminate())
+			{
+				indeterminateAppend(*m_data);
+			}
+			if (appended == false)
 			{
 				if (!m_storageFailed)
 					m_logger->warn("Failed to write readings to storage layer, queue for resend");
@@ -835,7 +704,7 @@ void Ingest::processQueue()
 			}
 			else
 			{
-				m_performance->collect("storedReadings", (long int)(m_data->size()));
+				m_performance->collect(m_perfStoredReadings, (long int)(m_data->size()));
 				if (m_storageFailed)
 				{
 					m_logger->warn("Storage operational after %d failures", m_storesFailed);
@@ -843,119 +712,203 @@ void Ingest::processQueue()
 					m_storesFailed = 0;
 				}
 				m_failCnt = 0;
-				std::map<std::string, int>		statsEntriesCurrQueue;
-				// check if this requires addition of a new asset tracker tuple
-				// Remove the Readings in the vector
-				AssetTracker *tracker = AssetTracker::getAssetTracker();
-
-				string lastAsset;
-				int *lastStat = NULL;
-				std::map <std::string, std::set<std::string> > assetDatapointMap;
-
-				for (vector<Reading *>::iterator it = m_data->begin(); it != m_data->end(); ++it)
+				if (m_adaptive)
 				{
-		               	        Reading *reading = *it;
-					string	assetName = reading->getAssetName();
-					const std::vector<Datapoint *> dpVec = reading->getReadingData();
-					std::string temp;
-                                        std::set<std::string> tempSet;
-                                        // first sort the individual datapoints
-                                        // e.g. dp2, dp3, dp1 push them in a set,to make them
-                                        // dp1,dp2,dp3
-                                        for ( auto dp : dpVec)
-                                        {
-                                                temp.clear();
-                                                temp.append(dp->getName());
-                                                tempSet.insert(temp);
-                                        }
-
-                                        temp.clear();
-
-                                        // Push them in a set so as to avoid duplication of datapoints
-                                        // a reading of d1, d2, d3 and another d2,d3,d1 , second will be discarded
-                                        //
-                                        for (auto dp: tempSet)
-                                        {
-                                                set<string> &s= assetDatapointMap[assetName];
-                                                if (s.find(dp) == s.end())
-                                                {
-                                                        s.insert(dp);
-                                                }
-                                        }
-
-                                        if (lastAsset.compare(assetName))
-                                        {
-						AssetTrackingTuple tuple(m_serviceName,
-									m_pluginName,
-									assetName,
-									"Ingest");
-
-						// Check Asset record exists
-						AssetTrackingTuple* res = tracker->findAssetTrackingCache(tuple);
-						if (res == NULL)
-						{
-							// Record not in cache, add it
-							tracker->addAssetTrackingTuple(tuple);
-						}
-						else
-						{
-							// Un-deprecate asset tracking record
-							unDeprecateAssetTrackingRecord(res,
-											assetName,
-											"Ingest");
-						}
-
-						lastAsset = assetName;
-                                                  lastStat = &statsEntriesCurrQueue[assetName];
-                                                  (*lastStat)++;
-                                          }
-                                          else if (lastStat)
-                                          {
-                                                  (*lastStat)++;
-                                          }
-                                          // delete reading;
-
+					adaptBuffering(m_data->size(), appendTime, sendLatency);
 				}
+				trackReadings(*m_data);
 				for( auto & rdng : *m_data)
 				{
 					delete rdng;
 				}
 				m_data->clear();
+			}
+		}
 
-				for (auto itr : assetDatapointMap)
+		if (m_data)
+		{
+			delete m_data;
+			m_data = NULL;
+		}
+	} while (! m_fullQueues.empty());
+}
+
+/**
+ * Report a block of readings for which the append to the storage
+ * service timed out. The storage client has closed the channel that
+ * timed out, the block is queued for resend in the same way as a
+ * failed append, so it is not lost, but may be stored twice if the
+ * storage service did complete the timed out append.
+ *
+ * @param readings	The readings that may not have been stored
+ */
+void Ingest::indeterminateAppend(const vector<Reading *>& readings)
+{
+	m_logger->warn("No response from the storage layer for a block of %d readings, "
+			"they will be resent and may be stored twice",
+			(int)readings.size());
+	m_performance->collect("indeterminateAppend", (long int)(readings.size()));
+}
+
+/**
+ * Update the asset tracking and per asset statistics for a block
+ * of readings that has been sent to the storage service.
+ *
+ * The tracking state of each asset is held in a cache record, so
+ * in the steady state a reading costs a lookup when the asset name
+ * changes and an increment of the count for the asset.
+ *
+ * @param readings	The readings that have been stored
+ * @return bool		False if the asset tracker is not available
+ */
+bool Ingest::trackReadings(const vector<Reading *>& readings)
+{
+	AssetTracker *tracker = AssetTracker::getAssetTracker();
+	if (tracker == nullptr)
+	{
+		Logger::getLogger()->error("%s could not initialize asset tracker",
+				__FUNCTION__);
+		return false;
+	}
+	if (tracker != m_assetCacheTracker)
+	{
+		// The cached tuples belong to the asset tracker
+		m_assetCache.clear();
+		m_assetCacheTracker = tracker;
+	}
+
+	vector<pair<const string, AssetRecord> *> blockAssets;
+	pair<const string, AssetRecord> *last = NULL;
+
+	for (auto reading : readings)
+	{
+		const string& assetName = reading->getAssetName();
+		if (last == NULL || last->first.compare(assetName))
+		{
+			auto it = m_assetCache.find(assetName);
+			if (it == m_assetCache.end())
+			{
+				it = m_assetCache.emplace(assetName, AssetRecord()).first;
+				string& key = it->second.statsKey;
+				key = assetName;
+				for (auto & c: key) c = toupper(c);
+				m_statistics->define(key, string("Readings received from asset ") + assetName);
+			}
+			last = &(*it);
+
+			AssetRecord& record = last->second;
+			if (record.readings == 0)
+			{
+				// First reading of the asset in this block
+				blockAssets.push_back(last);
+				if (record.tracking)
 				{
-					std::set<string> &s = itr.second;
-				        unsigned int count = s.size();
-				        StorageAssetTrackingTuple storageTuple(m_serviceName,
-										m_pluginName,
-										itr.first,
-										"store",
-										false,
-										"",
-										count);
-
-					StorageAssetTrackingTuple *ptr = &storageTuple;
-
-					// Update SAsset Tracker database and cache
-					tracker->updateCache(s, ptr);
+					// Possibly un-deprecate asset tracking record
+					unDeprecateAssetTrackingRecord(record.tracking,
+								assetName,
+								"Ingest");
 				}
-
+				else
 				{
-					unique_lock<mutex> lck(m_statsMutex);
-					for (auto &it : statsEntriesCurrQueue)
+					AssetTrackingTuple tuple(m_serviceName,
+								m_pluginName,
+								assetName,
+								"Ingest");
+
+					// Check Asset record exists
+					AssetTrackingTuple *res = tracker->findAssetTrackingCache(tuple);
+					if (res == NULL)
 					{
-						statsPendingEntries[it.first] += it.second;
+						// Record not in cache, add it
+						tracker->addAssetTrackingTuple(tuple);
+						res = tracker->findAssetTrackingCache(tuple);
 					}
+					else
+					{
+						// Possibly un-deprecate asset tracking record
+						unDeprecateAssetTrackingRecord(res,
+									assetName,
+									"Ingest");
+					}
+					record.tracking = res;
 				}
 			}
 		}
+		last->second.readings++;
+		trackDatapoints(&last->second, reading->getReadingData());
+	}
 
-		if (m_data)
+	for (auto asset : blockAssets)
+	{
+		AssetRecord& record = asset->second;
+		if (record.newDatapoints)
 		{
-			delete m_data;
-			m_data = NULL;
+			StorageAssetTrackingTuple storageTuple(m_serviceName,
+								m_pluginName,
+								asset->first,
+								"store",
+								false,
+								"",
+								record.datapoints.size());
+
+			// Update SAsset Tracker database and cache
+			tracker->updateCache(record.datapoints, &storageTuple);
+			record.newDatapoints = false;
 		}
-	} while (! m_fullQueues.empty());
+	}
+
+	unsigned long total = 0;
+	for (auto asset : blockAssets)
+	{
+		AssetRecord& record = asset->second;
+		if (m_statisticsOption == STATS_BOTH || m_statisticsOption == STATS_ASSET)
+		{
+			m_statistics->increment(record.statsKey, record.readings);
+		}
+		total += record.readings;
+		record.readings = 0;
+	}
+	if (total)
+	{
+		m_statistics->increment("READINGS", total);
+		if (m_statisticsOption == STATS_BOTH || m_statisticsOption == STATS_SERVICE)
+		{
+			m_statistics->increment(m_serviceName + INGEST_SUFFIX, total);
+		}
+	}
+	return true;
+}
+
+/**
+ * Record the datapoint names of a reading against the cached asset
+ * record. Readings of an asset usually have the same datapoints in
+ * the same order as the previous reading, in which case the names
+ * are compared with those of the previous reading and nothing else
+ * is done.
+ *
+ * @param record	The cache record of the asset
+ * @param datapoints	The datapoints of the reading
+ */
+void Ingest::trackDatapoints(AssetRecord *record, const vector<Datapoint *>& datapoints)
+{
+	bool same = record->layout.size() == datapoints.size();
+	for (size_t i = 0; same && i < datapoints.size(); i++)
+	{
+		same = record->layout[i].compare(datapoints[i]->getName()) == 0;
+	}
+	if (same)
+	{
+		return;
+	}
+	record->layout.clear();
+	for (auto dp : datapoints)
+	{
+		record->layout.push_back(dp->getName());
+		if (record->datapoints.insert(dp->getName()).second)
+		{
+			record->newDatapoints = true;
+		}
+	}
 }
 
 /**
@@ -1152,6 +1105,53 @@ void Ingest::configChange(const string& category, const string& newConfig)
 	}
 }
 
+/**
+ * Enable or disable adaptive buffering of readings. When disabled
+ * the configured buffer threshold and maximum latency are used.
+ *
+ * @param adaptive	True if adaptive buffering should be used
+ */
+void Ingest::setAdaptive(bool adaptive)
+{
+	m_adaptive = adaptive;
+	if (!adaptive)
+	{
+		m_buffering.reset();
+		m_batchSize = m_queueSizeThreshold;
+		m_flushInterval = m_timeout;
+	}
+}
+
+/**
+ * Pass the time taken to append the last block to the storage layer
+ * and the latency of the readings in it to the adaptive buffering
+ * controller and apply the buffer size and flush interval it decides.
+ *
+ * @param rows		The number of readings appended
+ * @param appendTime	The time in ms taken to append the readings
+ * @param latency	The time in ms the oldest reading waited in the service
+ */
+void Ingest::adaptBuffering(size_t rows, long appendTime, long latency)
+{
+	bool backlog;
+	{
+		lock_guard<mutex> guard(m_fqMutex);
+		backlog = !m_fullQueues.empty();
+	}
+	m_buffering.update(rows, appendTime, latency, backlog);
+
+	unsigned int batch = m_buffering.batchSize();
+	if (batch != m_batchSize)
+	{
+		m_logger->debug("Adaptive buffering: buffer size now %u readings", batch);
+		m_batchSize = batch;
+	}
+	m_flushInterval = m_buffering.flushInterval();
+
+	m_performance->collect(m_perfBatchSize, (long)batch);
+	m_performance->collect(m_perfFlushInterval, m_flushInterval);
+}
+
 /**
  * Return the numebr fo queued readings in the south service
  */
@@ -1160,8 +1160,8 @@ size_t Ingest::queueLength()
 	size_t	len = m_queue->size();
 
 	// Approximate the amount of data in the full queues
-	len += m_fullQueues.size() * m_queueSizeThreshold;
-	len += m_resendQueues.size() * m_queueSizeThreshold;
+	len += m_fullQueues.size() * m_batchSize;
+	len += m_resendQueues.size() * m_batchSize;
 
 	return len;
 }
@@ -1438,13 +1438,28 @@ void Ingest::unDeprecateStorageAssetTrackingRecord(StorageAssetTrackingTuple* cu
  */
 void Ingest::setStatistics(const string& option)
 {
-	unique_lock<mutex> lck(m_statsMutex);
 	if (option.compare("per asset") == 0)
 		m_statisticsOption = STATS_ASSET;
 	else if (option.compare("per service") == 0)
 		m_statisticsOption = STATS_SERVICE;
 	else
 		m_statisticsOption = STATS_BOTH;
+	defineServiceStatistics();
+}
+
+/**
+ * Define the statistic that counts the readings of the service, if the
+ * statistics option includes it, so that its row in the statistics
+ * table is created. Services that only collect statistics per asset
+ * have no row for the service.
+ */
+void Ingest::defineServiceStatistics()
+{
+	if (m_statisticsOption == STATS_BOTH || m_statisticsOption == STATS_SERVICE)
+	{
+		m_statistics->define(m_serviceName + INGEST_SUFFIX,
+				string("Readings received from service ") + m_serviceName);
+	}
 }
 
 /*
@@ -1488,6 +1503,12 @@ void Ingest::flowControl()
 	{
 		m_logger->debug("Waiting for ingest queue to drain");
 		int total = 0, delay = AFC_SLEEP_INCREMENT;
+		long appendTime = m_buffering.appendTime();
+		if (m_adaptive && appendTime > AFC_SLEEP_INCREMENT)
+		{
+			// Start with the time the storage layer takes to append a block
+			delay = appendTime > AFC_SLEEP_MAX ? AFC_SLEEP_MAX : appendTime;
+		}
 		while (total < AFC_MAX_WAIT && queueLength() > m_lowWater)
 		{
 			this_thread::sleep_for(chrono::milliseconds(delay));
@@ -1503,3 +1524,41 @@ void Ingest::flowControl()
 		m_performance->collect("flow controlled", total);
 	}
 }
+
+/**
+ * Return the time the caller should wait before adding more readings
+ * to the queue, without waiting. This is used by plugins that ingest
+ * blocks of readings to apply their own flow control.
+ *
+ * No wait is required unless the queue is longer than the high water
+ * mark. Beyond that the wait increases with each full block of
+ * readings the queue is over the high water mark, starting from the
+ * time the storage layer takes to append a block if adaptive buffering
+ * is enabled, up to a maximum of AFC_SLEEP_MAX.
+ *
+ * @return long	The time in milliseconds to wait
+ */
+long Ingest::flowControlDelay()
+{
+	if (m_highWater == 0)	// No flow control
+	{
+		return 0;
+	}
+	size_t length = queueLength();
+	if (length <= m_highWater)
+	{
+		return 0;
+	}
+	long delay = AFC_SLEEP_INCREMENT;
+	long appendTime = m_buffering.appendTime();
+	if (m_adaptive && appendTime > AFC_SLEEP_INCREMENT)
+	{
+		delay = appendTime;
+	}
+	unsigned int batch = m_batchSize;
+	if (batch > 0)
+	{
+		delay *= 1 + (long)((length - m_highWater) / batch);
+	}
+	return delay > AFC_SLEEP_MAX ? AFC_SLEEP_MAX : delay;
+}
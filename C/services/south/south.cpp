@@ -218,7 +218,7 @@ int	size;
  */
 void doIngest(Ingest *ingest, Reading reading)
 {
-	ingest->ingest(reading);
+	ingest->ingest(std::move(reading));
 }
 
 void doIngestV2(Ingest *ingest, ReadingSet *set)
@@ -241,6 +241,32 @@ void doIngestV2(Ingest *ingest, ReadingSet *set)
 	ingest->flowControl();
 }
 
+/**
+ * Callback called by async south plugins to reserve a block of readings
+ *
+ * @param ingest	The ingest class to use
+ * @param count		The number of readings the plugin expects to add
+ * @return		An empty block of readings
+ */
+std::vector<Reading *> *doReserveBlock(Ingest *ingest, size_t count)
+{
+	return ingest->reserveBlock(count);
+}
+
+/**
+ * Callback called by async south plugins to ingest a block of readings
+ * previously reserved
+ *
+ * @param ingest	The ingest class to use
+ * @param block		The block of readings
+ * @return		The time in milliseconds the plugin should wait
+ *			before committing another block
+ */
+long doCommitBlock(Ingest *ingest, std::vector<Reading *> *block)
+{
+	return ingest->commitBlock(block);
+}
+
 /**
  * Constructor for the south service
  */
@@ -458,6 +484,19 @@ void SouthService::start(string& coreAddress, unsigned short corePort)
 		{
 			m_ingest->setFlowControl(m_lowWater, m_highWater);
 		}
+		if (m_configAdvanced.itemExists("adaptiveBuffering"))
+		{
+			m_ingest->setAdaptive(m_configAdvanced.getValue("adaptiveBuffering").compare("true") == 0);
+		}
+		if (m_configAdvanced.itemExists("statisticsFlushCount"))
+		{
+			m_ingest->setStatisticsFlushCount(strtoul(
+					m_configAdvanced.getValue("statisticsFlushCount").c_str(), NULL, 10));
+		}
+		if (m_configAdvanced.itemExists("sharedMemoryTransport"))
+		{
+			m_ingest->setSharedMemory(m_configAdvanced.getValue("sharedMemoryTransport").compare("true") == 0);
+		}
 
 		if (m_configAdvanced.itemExists("statistics"))
 		{
@@ -620,7 +659,7 @@ void SouthService::start(string& coreAddress, unsigned short corePort)
 							Reading reading = southPlugin->poll();
 							if (reading.getDatapointCount())
 							{
-								ingest.ingest(reading);
+								ingest.ingest(std::move(reading));
 							}
 							++pollCount;
 						}
@@ -669,6 +708,11 @@ void SouthService::start(string& coreAddress, unsigned short corePort)
 					southPlugin->registerIngest((INGEST_CB)doIngest, &ingest);
 				else
 					southPlugin->registerIngestV2((INGEST_CB2)doIngestV2, &ingest);
+				if (southPlugin->hasIngestBlock())
+				{
+					southPlugin->registerIngestBlock((INGEST_RESERVE_CB)doReserveBlock,
+							(INGEST_COMMIT_CB)doCommitBlock, &ingest);
+				}
 				bool started = false;
 				int backoff = 1000;
 				while (started == false && m_shutdown == false)
@@ -1011,6 +1055,19 @@ void SouthService::processConfigChange(const string& categoryName, const string&
 		{
 			m_ingest->setTimeout(strtol(m_configAdvanced.getValue("maxSendLatency").c_str(), NULL, 10));
 		}
+		if (m_configAdvanced.itemExists("adaptiveBuffering"))
+		{
+			m_ingest->setAdaptive(m_configAdvanced.getValue("adaptiveBuffering").compare("true") == 0);
+		}
+		if (m_configAdvanced.itemExists("statisticsFlushCount"))
+		{
+			m_ingest->setStatisticsFlushCount(strtoul(
+					m_configAdvanced.getValue("statisticsFlushCount").c_str(), NULL, 10));
+		}
+		if (m_configAdvanced.itemExists("sharedMemoryTransport"))
+		{
+			m_ingest->setSharedMemory(m_configAdvanced.getValue("sharedMemoryTransport").compare("true") == 0);
+		}
 		if (m_configAdvanced.itemExists("logLevel"))
 		{
 			string prevLogLevel = logger->getMinLevel();
@@ -70,8 +70,15 @@ SouthPlugin::SouthPlugin(PLUGIN_HANDLE handle, const ConfigCategory& category) :
 				manager->resolveSymbol(handle, "plugin_reconfigure");
   	pluginShutdownPtr = (void (*)(PLUGIN_HANDLE))
 				manager->resolveSymbol(handle, "plugin_shutdown");
+	pluginRegisterPtr = NULL;
+	pluginRegisterPtrV2 = NULL;
+	pluginRegisterBlockPtr = NULL;
 	if (isAsync())
 	{
+		// Optional entry point to ingest blocks of readings
+		pluginRegisterBlockPtr = (void (*)(PLUGIN_HANDLE, INGEST_RESERVE_CB,
+						INGEST_COMMIT_CB, void *))
+				manager->resolveSymbol(handle, "plugin_register_ingest_block");
 		if (pluginInterfaceVer[0]=='1' && pluginInterfaceVer[1]=='.')
 		{
 	  		pluginRegisterPtr = (void (*)(PLUGIN_HANDLE, INGEST_CB cb, void *data))
@@ -281,6 +288,8 @@ string SouthPlugin::shutdownSaveData()
 void SouthPlugin::registerIngest(INGEST_CB cb, void *data)
 {
 	lock_guard<mutex> guard(mtx2);
+	if (!this->pluginRegisterPtr)	// Plugin only ingests blocks
+		return;
 	try {
 		return this->pluginRegisterPtr(instance, cb, data);
 	} catch (exception& e) {
@@ -298,6 +307,8 @@ void SouthPlugin::registerIngest(INGEST_CB cb, void *data)
 void SouthPlugin::registerIngestV2(INGEST_CB2 cb, void *data)
 {
 	lock_guard<mutex> guard(mtx2);
+	if (!this->pluginRegisterPtrV2)	// Plugin only ingests blocks
+		return;
 	try {
 		return this->pluginRegisterPtrV2(instance, cb, data);
 	} catch (exception& e) {
@@ -312,6 +323,30 @@ void SouthPlugin::registerIngestV2(INGEST_CB2 cb, void *data)
 	}
 }
 
+/**
+ * Register the callbacks an async plugin uses to ingest blocks of readings
+ *
+ * @param reserve	The callback to reserve an empty block of readings
+ * @param commit	The callback to commit a filled block of readings
+ * @param data		The data to pass to the callbacks
+ */
+void SouthPlugin::registerIngestBlock(INGEST_RESERVE_CB reserve, INGEST_COMMIT_CB commit, void *data)
+{
+	lock_guard<mutex> guard(mtx2);
+	try {
+		return this->pluginRegisterBlockPtr(instance, reserve, commit, data);
+	} catch (exception& e) {
+		Logger::getLogger()->fatal("Unhandled exception raised in south plugin registerIngestBlock(), %s",
+			e.what());
+		throw;
+	} catch (...) {
+		std::exception_ptr p = std::current_exception();
+		Logger::getLogger()->fatal("Unhandled exception raised in south plugin registerIngestBlock(), %s",
+			p ? p.__cxa_exception_type()->name() : "unknown exception");
+		throw;
+	}
+}
+
 /**
  * Call the write entry point of the plugin
  *
@@ -0,0 +1,343 @@
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <append_group.h>
+#include <logger.h>
+#include <rapidjson/reader.h>
+#include <chrono>
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace rapidjson;
+
+/**
+ * Handler for the parse of an append payload that checks the payload
+ * is a single readings array of reading objects and counts the readings
+ */
+class ReadingsCounter : public BaseReaderHandler<UTF8<>, ReadingsCounter> {
+	public:
+		ReadingsCounter() : m_depth(0), m_keys(0), m_readings(false), m_array(false), m_valid(true), m_count(0) {};
+		bool	Default()
+		{
+			// A scalar value of the payload or an element of the readings array
+			if (m_depth <= 2)
+				m_valid = false;
+			return true;
+		};
+		bool	Key(const char *str, SizeType length, bool)
+		{
+			if (m_depth == 1)
+			{
+				m_keys++;
+				m_readings = length == 8 && strncmp(str, "readings", 8) == 0;
+			}
+			return true;
+		};
+		bool	StartObject()
+		{
+			if (m_depth == 1)
+				m_valid = false;
+			else if (m_depth == 2)
+				m_count++;
+			m_depth++;
+			return true;
+		};
+		bool	EndObject(SizeType)
+		{
+			m_depth--;
+			return true;
+		};
+		bool	StartArray()
+		{
+			if (m_depth == 1 && m_readings)
+				m_array = true;
+			else if (m_depth <= 2)
+				m_valid = false;
+			m_depth++;
+			return true;
+		};
+		bool	EndArray(SizeType)
+		{
+			m_depth--;
+			return true;
+		};
+		bool	combinable() const { return m_valid && m_array && m_keys == 1; };
+		unsigned int	count() const { return m_count; };
+	private:
+		int		m_depth;
+		int		m_keys;
+		bool		m_readings;
+		bool		m_array;
+		bool		m_valid;
+		unsigned int	m_count;
+};
+
+/**
+ * Construct an append request
+ *
+ * @param payload	The payload of the append
+ * @param insitu	The payload may be parsed in place
+ * @param completion	Called with the result of the append
+ */
+AppendGroupCommit::Request::Request(const shared_ptr<string>& payload, bool insitu, Completion completion) :
+	m_payload(payload), m_completion(completion), m_insitu(insitu), m_scanned(false), m_count(0),
+	m_combine(false), m_start(0), m_end(0)
+{
+}
+
+/**
+ * Check whether the request can be combined with others and count its
+ * readings. The payload is only parsed the first time this is called.
+ * Requests that are not a single readings array of readings are not
+ * combined with other requests, the plugin reports the error in the
+ * payload as it would for any append.
+ *
+ * @return bool		True if the request can be combined with others
+ */
+bool AppendGroupCommit::Request::scan()
+{
+	if (m_scanned)
+		return m_combine;
+	m_scanned = true;
+	Reader reader;
+	StringStream stream(m_payload->c_str());
+	ReadingsCounter counter;
+	if (reader.Parse(stream, counter) && counter.combinable())
+	{
+		// The payload is { "readings" : [ ... ] }, so the first and last
+		// brackets of the payload delimit the readings array
+		m_start = m_payload->find('[');
+		m_end = m_payload->rfind(']');
+		m_count = counter.count();
+		m_combine = m_start != string::npos && m_end != string::npos;
+	}
+	return m_combine;
+}
+
+/**
+ * Constructor for the group commit of appends
+ */
+AppendGroupCommit::AppendGroupCommit() : m_plugin(NULL), m_thread(NULL),
+	m_running(false), m_concurrent(false), m_window(APPEND_GROUP_WINDOW), m_size(APPEND_GROUP_SIZE)
+{
+}
+
+/**
+ * Destructor for the group commit of appends
+ */
+AppendGroupCommit::~AppendGroupCommit()
+{
+	stop();
+}
+
+/**
+ * Start the thread that commits the appends
+ *
+ * @param plugin	The plugin to append the readings to
+ */
+void AppendGroupCommit::start(StoragePlugin *plugin)
+{
+	lock_guard<mutex> guard(m_mutex);
+	if (m_running)
+		return;
+	m_plugin = plugin;
+	m_running = true;
+	m_thread = new thread(&AppendGroupCommit::committer, this);
+}
+
+/**
+ * Stop the group commit once the queued appends have been committed.
+ * Appends made after the group commit has stopped are refused.
+ */
+void AppendGroupCommit::stop()
+{
+	{
+		lock_guard<mutex> guard(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	m_cv.notify_all();
+	m_thread->join();
+	delete m_thread;
+	m_thread = NULL;
+}
+
+/**
+ * Set the latency and size bounds of a group
+ *
+ * @param window	The maximum time in milliseconds to hold a group open, 0 to never wait
+ * @param size		The maximum number of readings in a group
+ */
+void AppendGroupCommit::setLimits(unsigned int window, unsigned int size)
+{
+	lock_guard<mutex> guard(m_mutex);
+	m_window = window;
+	m_size = size ? size : 1;
+}
+
+/**
+ * Queue a set of readings to be appended as part of a group. The
+ * completion is called on the thread that commits the group.
+ *
+ * The payload is shared with the queued request and must not be
+ * modified by the caller until the completion has been called.
+ *
+ * @param payload	The readings to append
+ * @param insitu	The plugin may parse the payload in place
+ * @param completion	Called with the number of readings appended or -1 on failure
+ * @return bool		False if the group commit is not running, the caller should append the readings
+ */
+bool AppendGroupCommit::append(const shared_ptr<string>& payload, bool insitu, Completion completion)
+{
+	Request *request = new Request(payload, insitu, completion);
+	{
+		lock_guard<mutex> guard(m_mutex);
+		if (!m_running)
+		{
+			delete request;
+			return false;
+		}
+		m_queue.push_back(request);
+	}
+	m_cv.notify_all();
+	return true;
+}
+
+/**
+ * The thread that takes groups of requests from the queue and commits them.
+ * The queued requests are taken from the queue to be checked without the
+ * lock held, those that do not join the group are returned to the front
+ * of the queue.
+ */
+void AppendGroupCommit::committer()
+{
+	unique_lock<mutex> lck(m_mutex);
+	while (m_running || !m_queue.empty())
+	{
+		if (m_queue.empty())
+		{
+			m_cv.wait(lck);
+			continue;
+		}
+		// Every request holds at least one reading, so a queue of
+		// m_size requests fills a group
+		if (m_concurrent && m_window && m_running && m_queue.size() < m_size)
+		{
+			m_cv.wait_for(lck, milliseconds(m_window),
+					[this]() { return m_queue.size() >= m_size || !m_running; });
+		}
+
+		deque<Request *> pending;
+		pending.swap(m_queue);
+		unsigned int size = m_size;
+		lck.unlock();
+
+		vector<Request *> group;
+		group.push_back(pending.front());
+		pending.pop_front();
+		if (!pending.empty() && group[0]->scan())
+		{
+			unsigned int readings = group[0]->m_count;
+			while (!pending.empty() && pending.front()->scan()
+					&& readings + pending.front()->m_count <= size)
+			{
+				readings += pending.front()->m_count;
+				group.push_back(pending.front());
+				pending.pop_front();
+			}
+		}
+
+		lck.lock();
+		m_queue.insert(m_queue.begin(), pending.begin(), pending.end());
+		m_concurrent = group.size() > 1 || !m_queue.empty();
+
+		lck.unlock();
+		commit(group);
+		lck.lock();
+	}
+}
+
+/**
+ * Commit a group of requests as a single append. The requests are
+ * completed once the group has been committed.
+ *
+ * @param group	The requests to commit
+ */
+void AppendGroupCommit::commit(vector<Request *>& group)
+{
+	vector<int> results(group.size(), -1);
+	try {
+		bool committed = false;
+		if (group.size() > 1)
+		{
+			size_t length = 0;
+			for (auto request : group)
+				length += request->m_end - request->m_start;
+			string combined;
+			combined.reserve(length + 16);
+			combined = "{\"readings\":[";
+			bool first = true;
+			for (auto request : group)
+			{
+				if (request->m_count == 0)
+					continue;
+				if (!first)
+					combined += ',';
+				combined.append(*request->m_payload, request->m_start + 1,
+						request->m_end - request->m_start - 1);
+				first = false;
+			}
+			combined += "]}";
+
+			// The combined payload is private to the group and may always be parsed in place
+			int rval = m_plugin->hasInsituAppendSupport() ?
+				m_plugin->readingsAppendInsitu(combined) : m_plugin->readingsAppend(combined);
+			if (rval != -1)
+			{
+				// Report the readings the plugin appended, in the order
+				// the requests were queued
+				unsigned int readings = 0;
+				int remaining = rval;
+				for (size_t i = 0; i < group.size(); i++)
+				{
+					readings += group[i]->m_count;
+					results[i] = min((int)group[i]->m_count, remaining);
+					remaining -= results[i];
+				}
+				if ((unsigned int)rval != readings)
+				{
+					Logger::getLogger()->warn("Append of a group of %d requests appended %d of %u readings",
+							(int)group.size(), rval, readings);
+				}
+				committed = true;
+			}
+			else
+			{
+				Logger::getLogger()->warn("Append of a group of %d requests failed, appending the requests individually",
+						(int)group.size());
+			}
+		}
+		for (size_t i = 0; !committed && i < group.size(); i++)
+		{
+			Request *request = group[i];
+			if (request->m_insitu && m_plugin->hasInsituAppendSupport())
+				results[i] = m_plugin->readingsAppendInsitu(*request->m_payload);
+			else
+				results[i] = m_plugin->readingsAppend(*request->m_payload);
+		}
+	} catch (exception& ex) {
+		Logger::getLogger()->error("Append of readings failed: %s", ex.what());
+	}
+	for (size_t i = 0; i < group.size(); i++)
+	{
+		group[i]->m_completion(results[i], group[i]->m_payload);
+		delete group[i];
+	}
+}
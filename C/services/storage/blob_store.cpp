@@ -0,0 +1,264 @@
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <blob_store.h>
+#include <logger.h>
+#include <openssl/sha.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <utime.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+using namespace std;
+
+/**
+ * Remove the mapping of the blob
+ */
+MappedBlob::~MappedBlob()
+{
+	if (m_data)
+	{
+		munmap(m_data, m_length);
+	}
+}
+
+/**
+ * Construct the blob store. The directory is created when the
+ * first blob is stored.
+ *
+ * @param directory	The directory in which to hold the blobs
+ */
+BlobStore::BlobStore(const string& directory) : m_directory(directory)
+{
+}
+
+/**
+ * Store a blob. If a blob with the same content already exists
+ * the modification time of the existing blob is updated.
+ *
+ * @param data		The data of the blob
+ * @param length	The length of the data
+ * @return string	The reference of the blob, or an empty string on error
+ */
+string BlobStore::put(const char *data, size_t length)
+{
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	SHA256((const unsigned char *)data, length, digest);
+	char hex[SHA256_DIGEST_LENGTH * 2 + 1];
+	for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+	{
+		snprintf(&hex[i * 2], 3, "%02x", digest[i]);
+	}
+	string blob(hex);
+	string file = path(blob);
+
+	if (access(file.c_str(), F_OK) == 0)
+	{
+		// Already held, record the new use of the blob
+		utime(file.c_str(), NULL);
+		return blob;
+	}
+
+	if (!createDirectory(m_directory) || !createDirectory(m_directory + "/" + blob.substr(0, 2)))
+	{
+		return "";
+	}
+	// Write to a temporary file and rename it so a partially written
+	// blob is never visible to a reader
+	char tmp[40];
+	snprintf(tmp, sizeof(tmp), ".tmp.%d.%lx", getpid(), (unsigned long)pthread_self());
+	string tmpFile = m_directory + "/" + tmp;
+	int fd = open(tmpFile.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0600);
+	if (fd == -1)
+	{
+		Logger::getLogger()->error("Unable to create blob file %s: %s",
+				tmpFile.c_str(), strerror(errno));
+		return "";
+	}
+	size_t written = 0;
+	while (written < length)
+	{
+		ssize_t n = write(fd, data + written, length - written);
+		if (n <= 0)
+		{
+			if (n == -1 && errno == EINTR)
+				continue;
+			Logger::getLogger()->error("Unable to write blob file %s: %s",
+					tmpFile.c_str(), strerror(errno));
+			close(fd);
+			unlink(tmpFile.c_str());
+			return "";
+		}
+		written += (size_t)n;
+	}
+	close(fd);
+	if (rename(tmpFile.c_str(), file.c_str()) == -1)
+	{
+		Logger::getLogger()->error("Unable to store blob %s: %s",
+				file.c_str(), strerror(errno));
+		unlink(tmpFile.c_str());
+		return "";
+	}
+	return blob;
+}
+
+/**
+ * Map a blob into memory
+ *
+ * @param blob		The reference of the blob
+ * @return MappedBlob*	The mapped blob or NULL if the blob does not exist.
+ *			The caller must delete the returned blob.
+ */
+MappedBlob *BlobStore::get(const string& blob)
+{
+	if (!isValid(blob))
+	{
+		return NULL;
+	}
+	string file = path(blob);
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return new MappedBlob(NULL, 0);
+	}
+	void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		Logger::getLogger()->error("Unable to map blob %s: %s",
+				blob.c_str(), strerror(errno));
+		return NULL;
+	}
+	return new MappedBlob(data, (size_t)st.st_size);
+}
+
+/**
+ * Remove the blobs that are not referenced by any reading. Blobs that
+ * have been stored since a given time are retained as the readings
+ * that refer to them may not yet have been appended.
+ *
+ * @param referenced	The blobs referenced by the readings
+ * @param before	The time before which unreferenced blobs are removed
+ * @return unsigned long	The number of blobs removed
+ */
+unsigned long BlobStore::purge(const set<string>& referenced, time_t before)
+{
+	unsigned long removed = 0;
+	DIR *dir = opendir(m_directory.c_str());
+	if (!dir)
+	{
+		return 0;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strlen(entry->d_name) != 2 || entry->d_name[0] == '.')
+		{
+			continue;
+		}
+		string subdir = m_directory + "/" + entry->d_name;
+		DIR *sub = opendir(subdir.c_str());
+		if (!sub)
+		{
+			continue;
+		}
+		struct dirent *blob;
+		while ((blob = readdir(sub)) != NULL)
+		{
+			if (!isValid(blob->d_name) || referenced.count(blob->d_name))
+			{
+				continue;
+			}
+			string file = subdir + "/" + blob->d_name;
+			struct stat st;
+			if (stat(file.c_str(), &st) == 0 && st.st_mtime < before)
+			{
+				if (unlink(file.c_str()) == 0)
+				{
+					removed++;
+				}
+			}
+		}
+		closedir(sub);
+	}
+	closedir(dir);
+	if (removed)
+	{
+		Logger::getLogger()->info("Purged %lu blobs from the blob store", removed);
+	}
+	return removed;
+}
+
+/**
+ * Check that a blob reference is a SHA-256 digest in hex
+ *
+ * @param blob		The blob reference
+ * @return bool		True if the reference is valid
+ */
+bool BlobStore::isValid(const string& blob)
+{
+	if (blob.length() != SHA256_DIGEST_LENGTH * 2)
+	{
+		return false;
+	}
+	for (char c : blob)
+	{
+		if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Return the path of the file that holds a blob
+ *
+ * @param blob		The blob reference
+ * @return string	The path of the blob file
+ */
+string BlobStore::path(const string& blob)
+{
+	return m_directory + "/" + blob.substr(0, 2) + "/" + blob;
+}
+
+/**
+ * Create a directory if it does not exist
+ *
+ * @param directory	The directory to create
+ * @return bool		True if the directory exists
+ */
+bool BlobStore::createDirectory(const string& directory)
+{
+	if (mkdir(directory.c_str(), 0700) == -1 && errno != EEXIST)
+	{
+		Logger::getLogger()->error("Unable to create blob store directory %s: %s",
+				directory.c_str(), strerror(errno));
+		return false;
+	}
+	return true;
+}
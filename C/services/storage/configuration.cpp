@@ -109,6 +109,25 @@ static std::string defaultConfiguration(QUOTE({
 		"default": "false",
 		"value": "false",
 		"order" : "10"
+	},
+	"appendGroupWindow" : {
+		"value" : "10",
+		"default" : "10",
+		"description" : "The maximum time in milliseconds to wait for further reading appends to commit with an append. Only appends that arrive while other appends are being committed wait",
+		"type" : "integer",
+		"displayName" : "Append Group Window",
+		"minimum" : "0",
+		"maximum" : "1000",
+		"order" : "11"
+	},
+	"appendGroupSize" : {
+		"value" : "10000",
+		"default" : "10000",
+		"description" : "The maximum number of readings to commit to storage as a single group of appends",
+		"type" : "integer",
+		"displayName" : "Append Group Size",
+		"minimum" : "1",
+		"order" : "12"
 	}
 }));
 
@@ -0,0 +1,92 @@
+#ifndef _APPEND_GROUP_H
+#define _APPEND_GROUP_H
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <storage_plugin.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+#define APPEND_GROUP_WINDOW	10	// Default milliseconds a group is held open for further appends
+#define APPEND_GROUP_SIZE	10000	// Default maximum number of readings in a group
+
+/**
+ * Group commit of reading appends. Append requests are queued and a
+ * single thread passes them to the storage plugin, combining all the
+ * requests that are queued into one append, and so one transaction,
+ * rather than each request committing its readings separately.
+ *
+ * Requests queue while the previous group is being committed. If the
+ * previous group combined more than one request, appends are arriving
+ * concurrently and a group is held open for up to the window for
+ * further requests to join it. A request that arrives when there is no
+ * other activity is therefore never delayed.
+ *
+ * A request is only checked, and its readings counted, when there are
+ * other requests queued that it may be combined with. A request that is
+ * appended alone is passed to the plugin as it is and completed with the
+ * number of readings the plugin appended.
+ *
+ * Each request is completed individually. If the combined append fails
+ * the requests of the group are appended one at a time, so that only
+ * the request that caused the failure is failed. If the plugin appends
+ * fewer readings than the group holds, the readings appended are
+ * reported against the requests in the order they were queued.
+ *
+ * Payloads are shared with the caller rather than copied. A request may
+ * allow its payload to be parsed in place by the plugin, in which case
+ * the payload is modified by the append.
+ */
+class AppendGroupCommit {
+	public:
+		typedef std::function<void(int, const std::shared_ptr<std::string>&)> Completion;
+		AppendGroupCommit();
+		~AppendGroupCommit();
+		void		start(StoragePlugin *plugin);
+		void		stop();
+		void		setLimits(unsigned int window, unsigned int size);
+		bool		append(const std::shared_ptr<std::string>& payload, bool insitu, Completion completion);
+	private:
+		/**
+		 * An append request that is waiting to be committed
+		 */
+		class Request {
+			public:
+				Request(const std::shared_ptr<std::string>& payload, bool insitu, Completion completion);
+				bool		scan();
+				std::shared_ptr<std::string>
+						m_payload;
+				Completion	m_completion;
+				bool		m_insitu;	// The payload may be parsed in place
+				bool		m_scanned;	// The payload has been checked
+				unsigned int	m_count;	// The number of readings in the request
+				bool		m_combine;	// The request can be combined with others
+				size_t		m_start;	// The readings array within the payload
+				size_t		m_end;
+		};
+		void		committer();
+		void		commit(std::vector<Request *>& group);
+		StoragePlugin	*m_plugin;
+		std::thread	*m_thread;
+		std::mutex	m_mutex;
+		std::condition_variable
+				m_cv;
+		std::deque<Request *>
+				m_queue;
+		bool		m_running;
+		bool		m_concurrent;
+		unsigned int	m_window;
+		unsigned int	m_size;
+};
+
+#endif
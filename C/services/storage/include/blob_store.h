@@ -0,0 +1,55 @@
+#ifndef _BLOB_STORE_H
+#define _BLOB_STORE_H
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <string>
+#include <set>
+#include <time.h>
+
+/**
+ * A blob that has been mapped into memory from the blob store.
+ * The mapping is removed when the MappedBlob is destroyed.
+ */
+class MappedBlob {
+	public:
+		MappedBlob(void *data, size_t length) : m_data(data), m_length(length) {};
+		~MappedBlob();
+		const char	*data() const { return (const char *)m_data; };
+		size_t		length() const { return m_length; };
+	private:
+		MappedBlob(const MappedBlob&);
+		MappedBlob&	operator=(const MappedBlob&);
+		void		*m_data;
+		size_t		m_length;
+};
+
+/**
+ * A content addressed store for the data of large image and data
+ * buffer datapoints. Each blob is held in a file named by the SHA-256
+ * digest of its content, within a subdirectory named by the first two
+ * characters of the digest. Storing the same content more than once
+ * results in a single file, the modification time of which is updated
+ * on every store. Blobs that are no longer referenced by readings are
+ * purged once the readings that referenced them have been purged.
+ */
+class BlobStore {
+	public:
+		BlobStore(const std::string& directory);
+		std::string	put(const char *data, size_t length);
+		MappedBlob	*get(const std::string& blob);
+		unsigned long	purge(const std::set<std::string>& referenced, time_t before);
+		static bool	isValid(const std::string& blob);
+	private:
+		std::string	path(const std::string& blob);
+		bool		createDirectory(const std::string& directory);
+		std::string	m_directory;
+};
+
+#endif
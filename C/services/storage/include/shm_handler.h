@@ -0,0 +1,83 @@
+#ifndef _SHM_HANDLER_H
+#define _SHM_HANDLER_H
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+#include <sys/epoll.h>
+#include <reading_shm.h>
+
+#define SHM_MAX_EVENTS	20	// Number of epoll events in one epoll_wait call
+#define SHM_WORKER_POLL	500	// Milliseconds between checks for a closed channel
+
+class StorageApi;
+
+/**
+ * Handler for the shared memory channels used by co-located services
+ * to append and fetch readings without the overhead of the HTTP
+ * interface. A single thread accepts the connections on all channels
+ * and detects clients going away, each connected channel has a worker
+ * thread that passes its requests to the storage plugin.
+ */
+class ShmHandler {
+	public:
+		ShmHandler(StorageApi *);
+		~ShmHandler();
+		void			handler();
+		bool			createChannel(uint32_t *token, std::string& name);
+	private:
+		class Channel {
+			public:
+				Channel();
+				~Channel();
+				bool		create(int epollfd, const std::string& name, uint32_t *token);
+				void		handleEvent(int epollfd, StorageApi *api, uint32_t events);
+				/**
+				 * The channel is closed and its worker thread,
+				 * if any, has finished with it
+				 */
+				bool		isClosed()
+						{
+							return m_status == Closed &&
+								(!m_worker.joinable() || m_workerDone);
+						};
+				void		worker(StorageApi *api);
+			private:
+				void		accept(int epollfd);
+				void		verify(int epollfd, StorageApi *api);
+				void		closeChannel(int epollfd);
+				void		stopWorker();
+				void		processRequests(StorageApi *api);
+				void		appendReadings(StorageApi *api, ShmMessage *msg);
+				void		fetchReadings(StorageApi *api, ShmMessage *msg);
+				void		respond(uint32_t type, int32_t status);
+				enum { Closed, Listen, AwaitingToken, Connected }
+						m_status;
+				ShmChannel	m_channel;
+				int		m_socket;
+				uint32_t	m_token;
+				std::thread	m_worker;
+				std::atomic<bool>
+						m_stopping;
+				std::atomic<bool>
+						m_workerDone;
+		};
+		StorageApi		*m_api;
+		std::thread		m_handlerThread;
+		unsigned int		m_channelNo;
+		std::condition_variable	m_channelsCV;
+		std::mutex		m_channelsMutex;
+		std::vector<Channel *>	m_channels;
+		bool			m_running;
+		int			m_pollfd;
+};
+#endif
@@ -15,7 +15,12 @@
 #include <storage_stats.h>
 #include <storage_registry.h>
 #include <stream_handler.h>
+#include <shm_handler.h>
 #include <perfmonitors.h>
+#include <blob_store.h>
+#include <streamed_result.h>
+#include <append_group.h>
+#include <functional>
 
 using namespace std;
 using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
@@ -26,6 +31,7 @@ using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
 #define COMMON_ACCESS		"^/storage/table/([A-Za-z][a-zA-Z0-9_]*)$"
 #define COMMON_QUERY		"^/storage/table/([A-Za-z][a-zA-Z_0-9]*)/query$"
 #define READING_ACCESS  	"^/storage/reading$"
+#define READING_FETCH_BINARY	"^/storage/reading/binary$"
 #define READING_QUERY   	"^/storage/reading/query"
 #define READING_PURGE   	"^/storage/reading/purge"
 #define READING_INTEREST	"^/storage/reading/interest/([A-Za-z0-9\\*][a-zA-Z0-9_%\\.\\-]*)$"
@@ -36,10 +42,23 @@ using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
 #define LOAD_TABLE_SNAPSHOT	"^/storage/table/([A-Za-z][a-zA-Z_0-9_]*)/snapshot/([a-zA-Z_0-9_]*)$"
 #define DELETE_TABLE_SNAPSHOT	LOAD_TABLE_SNAPSHOT
 #define CREATE_STORAGE_STREAM	"^/storage/reading/stream$"
+#define STATISTICS_HISTORY	"^/storage/statistics/history$"
+#define STATISTICS_HISTORY_PURGE	"^/storage/statistics/history/purge$"
+#define CREATE_STORAGE_SHM	"^/storage/reading/shm$"
 #define STORAGE_SCHEMA		"^/storage/schema"
 #define STORAGE_TABLE_ACCESS    "^/storage/schema/([A-Za-z][a-zA-Z0-9_]*)/table/([A-Za-z][a-zA-Z0-9_]*)$"
+#define BLOB_STORE		"^/storage/blob$"
+#define BLOB_FETCH		"^/storage/blob/([0-9a-f]{64})$"
 #define STORAGE_TABLE_QUERY	 "^/storage/schema/([A-Za-z][a-zA-Z0-9_]*)/table/([A-Za-z][a-zA-Z_0-9]*)/query$"           
 
+#define STREAM_QUERY_PARAM	"stream"	// Query parameter used to request a streamed result
+#define STREAM_QUERY_POOL	2		// Maximum number of streamed results in progress
+
+#define STATISTICS_PURGE_LIMIT	10000	// Default number of statistics history rows purged per transaction
+
+#define BLOB_PURGE_GRACE	600	// Seconds for which unreferenced blobs are retained after they are stored
+#define BLOB_PURGE_PAGE		1000	// Readings read per query when collecting blob references
+
 #define PURGE_FLAG_RETAIN      "retain"
 #define PURGE_FLAG_RETAIN_ANY  "retainany"
 #define PURGE_FLAG_RETAIN_ALL  "retainall"
@@ -49,6 +68,7 @@ using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
 #define STORAGE_SCHEMA_NAME_COMPONENT	1
 #define STORAGE_TABLE_NAME_COMPONENT	2
 #define ASSET_NAME_COMPONENT	1
+#define BLOB_COMPONENT		1
 #define SNAPSHOT_ID_COMPONENT	2
 
 /**
@@ -57,7 +77,8 @@ using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
  */
 class StorageOperation {
 	public:
-		enum Operations	{ ReadingAppend, ReadingPurge, ReadingFetch, ReadingQuery };
+		enum Operations	{ ReadingAppend, ReadingPurge, ReadingFetch, ReadingQuery, ReadingFetchBinary,
+				  StreamQuery };
 	public:
 		StorageOperation(StorageOperation::Operations operation, shared_ptr<HttpServer::Request> request,
 				shared_ptr<HttpServer::Response> response) :
@@ -66,6 +87,11 @@ class StorageOperation {
 					m_response(response)
 		{
 		};
+		StorageOperation(std::function<void()> work) :
+					m_operation(StreamQuery),
+					m_work(work)
+		{
+		};
 		~StorageOperation()
 		{
 		};
@@ -73,6 +99,7 @@ class StorageOperation {
 		StorageOperation::Operations	m_operation;
 		shared_ptr<HttpServer::Request> m_request;
 		shared_ptr<HttpServer::Response> m_response;
+		std::function<void()>		m_work;
 };
 
 class StoragePerformanceMonitor;
@@ -103,6 +130,7 @@ public:
 	void	defaultResource(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	readingAppend(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	readingFetch(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	void	readingFetchBinary(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	readingQuery(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	readingPurge(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	readingRegister(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
@@ -113,8 +141,16 @@ public:
 	void	loadTableSnapshot(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	deleteTableSnapshot(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	getTableSnapshots(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	void	statisticsHistory(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	void	statisticsHistoryPurge(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	void	blobStore(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	void	blobFetch(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void	createStorageStream(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	bool	readingStream(ReadingStream **readings, bool commit);
+	int	readingAppendStream(ReadingStream **readings, size_t size);
+	void	createShmChannel(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
+	bool	supportsBinaryFetch();
+	char	*readingFetchBlock(unsigned long id, unsigned int count, unsigned int *length);
 	void    createStorageSchema(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void 	storageTableInsert(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
 	void    storageTableUpdate(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request);
@@ -133,11 +169,19 @@ public:
 			}
 		};
 
+	void	setAppendGroupLimits(unsigned int window, unsigned int size)
+		{
+			m_appendGroup.setLimits(window, size);
+		};
+
 	StoragePlugin	*getStoragePlugin() { return plugin; };
 	StoragePerformanceMonitor
 			*getPerformanceMonitor() { return m_perfMonitor; };
 	void		worker();
+	void		streamWorker();
+	unsigned int	activeStreams();
 	void		queue(StorageOperation::Operations op, shared_ptr<HttpServer::Request> request, shared_ptr<HttpServer::Response> response);
+	void		queue(StorageOperation *operation);
 public:
 	std::atomic<int>        m_workers_count;
 
@@ -159,7 +203,20 @@ private:
 	void			respond(shared_ptr<HttpServer::Response>, SimpleWeb::StatusCode, const string&);
 	void			internalError(shared_ptr<HttpServer::Response>, const exception&);
 	void			mapError(string&, PLUGIN_ERROR *);
+	void			appendComplete(shared_ptr<HttpServer::Response>, const shared_ptr<string>& payload,
+						bool notify, int rval, struct timeval tStart);
+	void			appendMonitor(int rows, size_t size, struct timeval tStart);
+	std::string		readingStreamPayload(ReadingStream **readings);
+	void			purgeBlobs();
+	void			notifyStatisticsHistory(int rows);
+	bool			streamRequested(shared_ptr<HttpServer::Request>);
+	bool			streamQuery(shared_ptr<HttpServer::Response>, StoragePlugin *,
+						std::function<bool(RESULT_STREAM_CB, void *)>);
+	void			completeStream(shared_ptr<HttpServer::Response>, StreamedResult&,
+						bool complete, StoragePlugin *);
 	StreamHandler		*streamHandler;
+	ShmHandler		*shmHandler;
+	std::mutex		m_shmMutex;
 	StoragePerformanceMonitor
 				*m_perfMonitor;
 	std::mutex		m_queueMutex;
@@ -169,7 +226,21 @@ private:
 	std::vector<std::thread	*>
 				m_workers;
 	unsigned int		m_workerPoolSize;
+	/*
+	 * Streamed results hold a thread until the client has received
+	 * them, they have their own pool of threads so that they can not
+	 * hold up the appends, fetches and purges of the worker pool
+	 */
+	std::mutex		m_streamMutex;
+	std::condition_variable	m_streamCV;
+	std::queue<StorageOperation *>
+				m_streamQueue;
+	std::vector<std::thread *>
+				m_streamWorkers;
+	unsigned int		m_activeStreams;
 	bool			m_shutdown;
+	BlobStore		*m_blobs;
+	AppendGroupCommit	m_appendGroup;
 };
 
 /**
@@ -187,6 +258,18 @@ class StoragePerformanceMonitor : public PerformanceMonitor {
 			m_instance->getStoragePlugin()->commonInsert(table,
 								values.toJSON());
 		}
+		// Direct write to storage of a set of monitor rows
+		void writeData(const std::string& table, const std::vector<InsertValues>& values) {
+			std::string payload = "{ \"inserts\": [";
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				if (i)
+					payload += ", ";
+				payload += values[i].toJSON();
+			}
+			payload += "] }";
+			m_instance->getStoragePlugin()->commonInsert(table, payload);
+		}
 	private:
 		std::string	m_name;
 		StorageApi *m_instance;
@@ -14,6 +14,7 @@
 #include <plugin_manager.h>
 #include <string>
 #include <reading_stream.h>
+#include <result_stream.h>
 #include <plugin_configuration.h>
 
 #define	STORAGE_PURGE_RETAIN_ANY 0x0001U
@@ -39,11 +40,26 @@ public:
 
 	int		commonInsert(const std::string& table, const std::string& payload, const char *schema = nullptr);
 	char		*commonRetrieve(const std::string& table, const std::string& payload, const char *schema = nullptr);
+	bool		hasStreamedRetrieveSupport() { return commonRetrieveStreamPtr != NULL; };
+	bool		commonRetrieveStream(const std::string& table, const std::string& payload,
+					RESULT_STREAM_CB callback, void *data, const char *schema = nullptr);
 	int		commonUpdate(const std::string& table, const std::string& payload, const char *schema = nullptr);
 	int		commonDelete(const std::string& table, const std::string& payload, const char *schema = nullptr);
 	int		readingsAppend(const std::string& payload);
+	bool		hasInsituAppendSupport() { return readingsAppendInsituPtr != NULL; };
+	int		readingsAppendInsitu(std::string& payload);
 	char		*readingsFetch(unsigned long id, unsigned int blksize);
+	bool		hasBinaryFetchSupport() { return readingsFetchBinaryPtr != NULL; };
+	char		*readingsFetchBinary(unsigned long id, unsigned int blksize, unsigned int *length);
 	char		*readingsRetrieve(const std::string& payload);
+	bool		hasStreamedReadingsSupport()
+			{
+				return readingsFetchStreamPtr != NULL && readingsRetrieveStreamPtr != NULL;
+			};
+	bool		readingsFetchStream(unsigned long id, unsigned int blksize,
+					RESULT_STREAM_CB callback, void *data);
+	bool		readingsRetrieveStream(const std::string& payload,
+					RESULT_STREAM_CB callback, void *data);
 	char		*readingsPurge(unsigned long age, unsigned int flags, unsigned long sent);
 	long		*readingsPurge();
 	char		*readingsPurgeAsset(const std::string& asset);
@@ -52,6 +68,10 @@ public:
 	int		loadTableSnapshot(const std::string& table, const std::string& id);
 	int		deleteTableSnapshot(const std::string& table, const std::string& id);
 	char		*getTableSnapshots(const std::string& table);
+	bool		hasStatisticsHistorySupport() { return statisticsHistoryPtr != NULL; };
+	int		statisticsHistory();
+	bool		hasStatisticsHistoryPurgeSupport() { return statisticsHistoryPurgePtr != NULL; };
+	int		statisticsHistoryPurge(unsigned long age, unsigned int limit);
 	PLUGIN_ERROR	*lastError();
 	bool		hasStreamSupport() { return readingStreamPtr != NULL; };
 	int		readingStream(ReadingStream **stream, bool commit);
@@ -73,8 +93,16 @@ private:
         int             (*storageSchemaUpdatePtr)(PLUGIN_HANDLE, const char *, const char *, const char*) = nullptr;
         int             (*storageSchemaDeletePtr)(PLUGIN_HANDLE, const char *, const char *, const char*) = nullptr;
 	int		(*readingsAppendPtr)(PLUGIN_HANDLE, const char *);
+	int		(*readingsAppendInsituPtr)(PLUGIN_HANDLE, char *);
 	char		*(*readingsFetchPtr)(PLUGIN_HANDLE, unsigned long id, unsigned int blksize);
+	char		*(*readingsFetchBinaryPtr)(PLUGIN_HANDLE, unsigned long id, unsigned int blksize, unsigned int *length);
 	char		*(*readingsRetrievePtr)(PLUGIN_HANDLE, const char *payload);
+	bool		(*commonRetrieveStreamPtr)(PLUGIN_HANDLE, const char *, const char *, const char *,
+					RESULT_STREAM_CB, void *);
+	bool		(*readingsFetchStreamPtr)(PLUGIN_HANDLE, unsigned long id, unsigned int blksize,
+					RESULT_STREAM_CB, void *);
+	bool		(*readingsRetrieveStreamPtr)(PLUGIN_HANDLE, const char *payload,
+					RESULT_STREAM_CB, void *);
 	char		*(*readingsPurgePtr)(PLUGIN_HANDLE, unsigned long age, unsigned int flags, unsigned long sent);
 	unsigned int	(*readingsPurgeAssetPtr)(PLUGIN_HANDLE, const char *asset);
 	void		(*releasePtr)(PLUGIN_HANDLE, const char *payload);
@@ -82,6 +110,8 @@ private:
 	int		(*loadTableSnapshotPtr)(PLUGIN_HANDLE, const char *, const char *);
 	int		(*deleteTableSnapshotPtr)(PLUGIN_HANDLE, const char *, const char *);
 	char		*(*getTableSnapshotsPtr)(PLUGIN_HANDLE, const char *);
+	int		(*statisticsHistoryPtr)(PLUGIN_HANDLE);
+	int		(*statisticsHistoryPurgePtr)(PLUGIN_HANDLE, unsigned long, unsigned int);
 	int		(*readingStreamPtr)(PLUGIN_HANDLE, ReadingStream **, bool);
 	PLUGIN_ERROR	*(*lastErrorPtr)(PLUGIN_HANDLE);
 	bool		(*pluginShutdownPtr)(PLUGIN_HANDLE);
@@ -7,6 +7,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <memory>
+#include <atomic>
 
 typedef std::vector<std::pair<std::string *, std::string *> > REGISTRY;
 
@@ -32,16 +34,19 @@ class StorageRegistry {
 		void		registerAsset(const std::string& asset, const std::string& url);
 		void		unregisterAsset(const std::string& asset, const std::string& url);
 		void		process(const std::string& payload);
+		void		process(const std::shared_ptr<std::string>& payload);
+		bool		hasRegistrations() { return m_registrationCount != 0; };
 		void		processTableInsert(const std::string& tableName, const std::string& payload);
 		void		processTableUpdate(const std::string& tableName, const std::string& payload);
 		void		processTableDelete(const std::string& tableName, const std::string& payload);
 		void		registerTable(const std::string& table, const std::string& url);
 		void		unregisterTable(const std::string& table, const std::string& url);
+		bool		hasTableRegistration(const std::string& table);
 		void		run();
 	private:
-		void		processPayload(char *payload);
+		void		processPayload(const char *payload);
 		void		sendPayload(const std::string& url, const char *payload);
-		void		filterPayload(const std::string& url, char *payload, const std::string& asset);
+		void		filterPayload(const std::string& url, const char *payload, const std::string& asset);
 		void		processInsert(char *tableName, char *payload);
 		void		processUpdate(char *tableName, char *payload);
 		void		processDelete(char *tableName, char *payload);
@@ -50,9 +55,10 @@ class StorageRegistry {
 		void 		insertTestTableReg();
 		void		removeTestTableReg(int n);
         
-		typedef 	std::pair<time_t, char *> Item;
+		typedef 	std::pair<time_t, std::shared_ptr<std::string> > Item;
 		typedef 	std::tuple<time_t, char *, char *> TableItem;
 		REGISTRY			m_registrations;
+		std::atomic<unsigned int>	m_registrationCount;	// Size of m_registrations, read without the lock
 		REGISTRY_TABLE			m_tableRegistrations;
         
 		std::queue<StorageRegistry::Item>
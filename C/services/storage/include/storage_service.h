@@ -47,6 +47,7 @@ class StorageService : public ServiceHandler {
 	private:
 		const string&		m_name;
 		bool 			loadPlugin();
+		void			setAppendGroupLimits();
 		StorageApi    		*api;
 		StorageConfiguration	*config;
 		Logger        		*logger;
@@ -0,0 +1,76 @@
+#ifndef _STREAMED_RESULT_H
+#define _STREAMED_RESULT_H
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <server_http.hpp>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+
+#define STREAM_SEND_TIMEOUT	60	// Seconds to wait for the end of a streamed result to be sent
+#define STREAM_BUFFER_LIMIT	(4 * 1024 * 1024)	// Bytes of a streamed result buffered for a slow client
+
+/**
+ * The result of a query that is sent to the client as the storage
+ * plugin produces the rows, using chunked transfer encoding. Clients
+ * request a streamed result with the stream query parameter. The
+ * document sent is the same as for a result that is not streamed,
+ * other than the count of rows following rather than preceding the
+ * rows.
+ *
+ * The status and headers are not sent until the first rows are
+ * produced, a query that fails before then may still be reported
+ * with an error status.
+ *
+ * Only one chunk is in flight at a time. Rows produced while a chunk
+ * is being sent are buffered and sent as the next chunk, the storage
+ * plugin is never held waiting for the client. If the client does not
+ * read the result fast enough and the buffer exceeds STREAM_BUFFER_LIMIT
+ * the query is abandoned, rather than holding the resources of the
+ * storage plugin. The end of the result is waited for, so the result
+ * must not be streamed from one of the threads of the HTTP server.
+ */
+class StreamedResult {
+	public:
+		StreamedResult(std::shared_ptr<HttpServer::Response> response);
+		static bool	rows(void *result, const char *rows, size_t length, unsigned int count);
+		bool		started() const { return m_started; };
+		unsigned long	count() const { return m_count; };
+		bool		complete();
+		void		abandon();
+	private:
+		/**
+		 * The state of the send of a chunk, this is shared with
+		 * the completion callback of the send as the callback may
+		 * be called after the wait for it has timed out.
+		 */
+		class SendState {
+			public:
+				SendState() : pending(false), failed(false) {};
+				std::mutex		mutex;
+				std::condition_variable	cv;
+				bool			pending;
+				bool			failed;
+		};
+		bool		append(const char *rows, size_t length, unsigned int count);
+		bool		sendChunk(bool last = false);
+		bool		wait();
+		std::shared_ptr<HttpServer::Response>
+				m_response;
+		std::shared_ptr<SendState>
+				m_state;
+		std::string	m_buffer;	// Rows not yet sent
+		bool		m_started;
+		unsigned long	m_count;
+};
+
+#endif
@@ -0,0 +1,527 @@
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <shm_handler.h>
+#include <storage_api.h>
+#include <reading_stream.h>
+#include <logger.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <chrono>
+#include <unistd.h>
+#include <stddef.h>
+#include <errno.h>
+
+using namespace std;
+
+/**
+ * C wrapper for the handler thread that services the shared
+ * memory channels.
+ *
+ * @param handler	The ShmHandler instance that started this thread
+ */
+static void threadWrapper(void *handler)
+{
+	((ShmHandler *)handler)->handler();
+}
+
+/**
+ * Read a random token for a channel from the kernel random source,
+ * the token must not be guessable by other processes.
+ *
+ * @param token		Returns the token
+ * @return bool		True if a token was read
+ */
+static bool randomToken(uint32_t *token)
+{
+	int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		Logger::getLogger()->error("Unable to open /dev/urandom for shared memory channel token: %s",
+				strerror(errno));
+		return false;
+	}
+	ssize_t n;
+	while ((n = read(fd, token, sizeof(*token))) == -1 && errno == EINTR)
+		;
+	close(fd);
+	if (n != (ssize_t)sizeof(*token))
+	{
+		Logger::getLogger()->error("Unable to read shared memory channel token");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Constructor for the ShmHandler class
+ */
+ShmHandler::ShmHandler(StorageApi *api) : m_api(api), m_channelNo(0), m_running(true)
+{
+	m_pollfd = epoll_create(1);
+	m_handlerThread = thread(threadWrapper, this);
+}
+
+/**
+ * Destructor for the ShmHandler. Close down the epoll system,
+ * wait for the handler thread to terminate and remove the channels.
+ * Removing a channel waits for any request it is processing.
+ */
+ShmHandler::~ShmHandler()
+{
+	m_running = false;
+	m_channelsCV.notify_all();
+	m_handlerThread.join();
+	for (auto channel : m_channels)
+	{
+		delete channel;
+	}
+	close(m_pollfd);
+}
+
+/**
+ * The handler method for the shared memory channels. This is run in its
+ * own thread and uses epoll to wait for connections and for clients
+ * closing their channels. Requests are processed by the worker thread of
+ * each channel, so a slow storage plugin call on one channel does not
+ * hold up the others.
+ *
+ * The channels mutex only protects the list of channels, it is not held
+ * whilst waiting for events so that new channels may be created at any
+ * time. Channels are only ever deleted by this thread, once closed and
+ * their worker has finished, hence a channel is not removed whilst an
+ * event for it is being handled.
+ */
+void ShmHandler::handler()
+{
+	struct epoll_event events[SHM_MAX_EVENTS];
+	while (m_running)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_channelsMutex);
+			if (m_channels.size() == 0)
+			{
+				m_channelsCV.wait_for(lock, chrono::milliseconds(500));
+				continue;
+			}
+		}
+		int nfds = epoll_wait(m_pollfd, events, SHM_MAX_EVENTS, 100);
+		if (nfds == -1)
+		{
+			if (errno != EINTR)
+				Logger::getLogger()->error("Shared memory channel epoll error: %s", strerror(errno));
+			continue;
+		}
+		for (int i = 0; i < nfds; i++)
+		{
+			Channel *channel = (Channel *)events[i].data.ptr;
+			channel->handleEvent(m_pollfd, m_api, events[i].events);
+		}
+		std::lock_guard<std::mutex> guard(m_channelsMutex);
+		for (auto it = m_channels.begin(); it != m_channels.end(); )
+		{
+			if ((*it)->isClosed())
+			{
+				delete *it;
+				it = m_channels.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
+
+/**
+ * Create a new shared memory channel. The client connects to the Unix
+ * domain socket with the returned name and sends the token, the
+ * descriptors of the channel are then passed to the client.
+ *
+ * @param token		Returns the single use token the client should send
+ * @param name		Returns the name of the Unix domain socket
+ * @return bool		True if the channel was created
+ */
+bool ShmHandler::createChannel(uint32_t *token, string& name)
+{
+	Channel *channel = new Channel();
+	std::unique_lock<std::mutex> lock(m_channelsMutex);
+	name = "fledge-storage-" + to_string(getpid()) + "-" + to_string(m_channelNo++);
+	if (!channel->create(m_pollfd, name, token))
+	{
+		delete channel;
+		return false;
+	}
+	m_channels.push_back(channel);
+	lock.unlock();
+	m_channelsCV.notify_all();
+	return true;
+}
+
+/**
+ * Construct an unconnected channel
+ */
+ShmHandler::Channel::Channel() : m_status(Closed), m_socket(-1), m_token(0),
+	m_stopping(false), m_workerDone(false)
+{
+}
+
+/**
+ * Destroy a channel, waiting for the worker thread to finish
+ */
+ShmHandler::Channel::~Channel()
+{
+	stopWorker();
+	if (m_socket != -1)
+		::close(m_socket);
+}
+
+/**
+ * Create the shared memory and events for the channel and the Unix domain
+ * socket in the abstract namespace on which the client will connect.
+ *
+ * @param epollfd	The epoll descriptor
+ * @param name		The name of the Unix domain socket
+ * @param token		Returns the single use token the client should send
+ * @return bool		True if the channel was created
+ */
+bool ShmHandler::Channel::create(int epollfd, const string& name, uint32_t *token)
+{
+struct sockaddr_un	address;
+
+	if (!m_channel.create())
+	{
+		return false;
+	}
+	if ((m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+	{
+		Logger::getLogger()->error("Failed to create shared memory channel socket: %s", strerror(errno));
+		return false;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(&address.sun_path[1], name.c_str(), sizeof(address.sun_path) - 2);
+	socklen_t len = offsetof(struct sockaddr_un, sun_path) + 1 + name.length();
+	if (bind(m_socket, (struct sockaddr *)&address, len) < 0)
+	{
+		Logger::getLogger()->error("Failed to bind shared memory channel socket: %s", strerror(errno));
+		return false;
+	}
+	if (listen(m_socket, 1) < 0)
+	{
+		Logger::getLogger()->error("Failed to listen on shared memory channel socket: %s", strerror(errno));
+		return false;
+	}
+
+	if (!randomToken(&m_token))
+	{
+		return false;
+	}
+	*token = m_token;
+
+	// The handler thread may see the connection as soon as the socket is added
+	m_status = Listen;
+	struct epoll_event event;
+	event.data.ptr = this;
+	event.events = EPOLLIN;
+	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, m_socket, &event) < 0)
+	{
+		Logger::getLogger()->error("Failed to add shared memory channel socket to epoll fileset, %s", strerror(errno));
+		m_status = Closed;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Handle an epoll event on the socket of the channel.
+ *
+ * @param epollfd	The epoll descriptor
+ * @param api		The storage API
+ * @param events	The epoll events
+ */
+void ShmHandler::Channel::handleEvent(int epollfd, StorageApi *api, uint32_t events)
+{
+	if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+	{
+		Logger::getLogger()->info("Shared memory channel closed by client");
+		closeChannel(epollfd);
+		return;
+	}
+	if (events & EPOLLIN)
+	{
+		if (m_status == Listen)
+		{
+			accept(epollfd);
+		}
+		else if (m_status == AwaitingToken)
+		{
+			verify(epollfd, api);
+		}
+		else
+		{
+			// No data is expected on the socket once connected
+			char buf[16];
+			if (read(m_socket, buf, sizeof(buf)) <= 0)
+			{
+				closeChannel(epollfd);
+			}
+		}
+	}
+}
+
+/**
+ * Accept the client connection and close the listening socket
+ *
+ * @param epollfd	The epoll descriptor
+ */
+void ShmHandler::Channel::accept(int epollfd)
+{
+	int conn = ::accept4(m_socket, NULL, NULL, SOCK_CLOEXEC);
+	if (conn == -1)
+	{
+		Logger::getLogger()->info("Accept failed for shared memory channel: %s", strerror(errno));
+		return;
+	}
+
+	// Only a process running as the same user may use the channel
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || cred.uid != getuid())
+	{
+		Logger::getLogger()->warn("Rejected shared memory channel connection from another user");
+		::close(conn);
+		return;
+	}
+
+	epoll_ctl(epollfd, EPOLL_CTL_DEL, m_socket, NULL);
+	::close(m_socket);
+	m_socket = conn;
+	m_status = AwaitingToken;
+
+	struct epoll_event event;
+	event.data.ptr = this;
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR;
+	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, m_socket, &event) < 0)
+	{
+		Logger::getLogger()->error("Failed to add shared memory channel connection to epoll fileset, %s", strerror(errno));
+		closeChannel(epollfd);
+	}
+}
+
+/**
+ * Verify the token sent by the client, pass the descriptors of the
+ * channel to the client and start the worker thread for the channel.
+ *
+ * @param epollfd	The epoll descriptor
+ * @param api		The storage API
+ */
+void ShmHandler::Channel::verify(int epollfd, StorageApi *api)
+{
+	RDSConnectHeader hdr;
+	if (read(m_socket, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)
+		|| hdr.magic != RDS_CONNECTION_MAGIC || hdr.token != m_token)
+	{
+		Logger::getLogger()->warn("Incorrect token for shared memory channel");
+		closeChannel(epollfd);
+		return;
+	}
+	if (!m_channel.sendDescriptors(m_socket))
+	{
+		closeChannel(epollfd);
+		return;
+	}
+
+	m_status = Connected;
+	m_worker = thread(&ShmHandler::Channel::worker, this, api);
+	Logger::getLogger()->info("Shared memory channel established");
+}
+
+/**
+ * Close the channel, removing the socket from the epoll set and asking
+ * the worker thread to stop. The channel is deleted by the handler
+ * thread once the worker has finished.
+ *
+ * @param epollfd	The epoll descriptor
+ */
+void ShmHandler::Channel::closeChannel(int epollfd)
+{
+	if (m_status == Connected)
+	{
+		m_stopping = true;
+		m_channel.signal(m_channel.requestEvent());
+	}
+	if (m_socket != -1)
+	{
+		epoll_ctl(epollfd, EPOLL_CTL_DEL, m_socket, NULL);
+		::close(m_socket);
+		m_socket = -1;
+	}
+	m_status = Closed;
+}
+
+/**
+ * Stop the worker thread of the channel and wait for it to finish
+ * the request it is processing.
+ */
+void ShmHandler::Channel::stopWorker()
+{
+	if (m_worker.joinable())
+	{
+		m_stopping = true;
+		m_channel.signal(m_channel.requestEvent());
+		m_worker.join();
+	}
+}
+
+/**
+ * The worker thread of a connected channel. Wait for the client to
+ * signal requests and process them until the channel is closed. The
+ * wait is bounded so that a lost wakeup can not leave the thread
+ * running once the channel is closed.
+ *
+ * @param api	The storage API
+ */
+void ShmHandler::Channel::worker(StorageApi *api)
+{
+	while (!m_stopping)
+	{
+		if (m_channel.wait(m_channel.requestEvent(), SHM_WORKER_POLL) && !m_stopping)
+		{
+			processRequests(api);
+		}
+	}
+	m_workerDone = true;
+}
+
+/**
+ * Process all the requests that are waiting in the request ring of
+ * the channel, sending a response to each.
+ *
+ * @param api	The storage API
+ */
+void ShmHandler::Channel::processRequests(StorageApi *api)
+{
+	ShmMessage *msg;
+	while ((msg = m_channel.request()->peek()) != NULL)
+	{
+		switch (msg->type)
+		{
+			case ShmAppend:
+				appendReadings(api, msg);
+				break;
+			case ShmFetch:
+				fetchReadings(api, msg);
+				break;
+			default:
+				Logger::getLogger()->error("Unexpected message type %d on shared memory channel", msg->type);
+				respond(ShmError, -EINVAL);
+				break;
+		}
+		m_channel.request()->release();
+		m_channel.signal(m_channel.responseEvent());
+	}
+}
+
+/**
+ * Append the readings in a request. The readings are passed to the
+ * storage plugin directly from the shared memory, via the same append
+ * path as readings sent with the HTTP interface.
+ *
+ * @param api	The storage API
+ * @param msg	The append request
+ */
+void ShmHandler::Channel::appendReadings(StorageApi *api, ShmMessage *msg)
+{
+	ShmAppendHeader *hdr = (ShmAppendHeader *)(msg + 1);
+	char *ptr = (char *)(hdr + 1);
+	char *end = (char *)(msg + 1) + msg->length;
+	vector<ReadingStream *> readings;
+
+	readings.reserve(hdr->count + 1);
+	for (uint32_t i = 0; i < hdr->count; i++)
+	{
+		ReadingStream *reading = (ReadingStream *)ptr;
+		if (ptr + offsetof(ReadingStream, assetCode) > end)
+		{
+			break;
+		}
+		ptr += SHM_ALIGN(offsetof(ReadingStream, assetCode) + reading->assetCodeLength + reading->payloadLength);
+		if (ptr > end)
+		{
+			break;
+		}
+		readings.push_back(reading);
+	}
+	if (readings.size() != hdr->count)
+	{
+		Logger::getLogger()->error("Malformed append request on shared memory channel");
+		respond(ShmError, -EINVAL);
+		return;
+	}
+	readings.push_back(NULL);
+	int rval = api->readingAppendStream(readings.data(), msg->length);
+	respond(ShmAppendResult, rval != -1 ? 0 : -EIO);
+}
+
+/**
+ * Fetch a block of readings in the binary block format and return it
+ * in the response ring.
+ *
+ * @param api	The storage API
+ * @param msg	The fetch request
+ */
+void ShmHandler::Channel::fetchReadings(StorageApi *api, ShmMessage *msg)
+{
+	ShmFetchRequest *req = (ShmFetchRequest *)(msg + 1);
+
+	if (!api->supportsBinaryFetch())
+	{
+		respond(ShmError, -ENOTSUP);
+		return;
+	}
+	unsigned int length = 0;
+	char *block = api->readingFetchBlock(req->id, req->count, &length);
+	if (!block)
+	{
+		respond(ShmError, -EIO);
+		return;
+	}
+	void *payload = m_channel.response()->reserve(ShmFetchResult, length);
+	if (payload)
+	{
+		memcpy(payload, block, length);
+		m_channel.response()->commit();
+	}
+	else
+	{
+		respond(ShmError, -E2BIG);
+	}
+	free(block);
+}
+
+/**
+ * Write a status response to the response ring
+ *
+ * @param type		The response message type
+ * @param status	The status to return
+ */
+void ShmHandler::Channel::respond(uint32_t type, int32_t status)
+{
+	ShmResult *result = (ShmResult *)m_channel.response()->reserve(type, sizeof(ShmResult));
+	if (result)
+	{
+		result->status = status;
+		result->pad = 0;
+		m_channel.response()->commit();
+	}
+	else
+	{
+		Logger::getLogger()->error("No space for response on shared memory channel");
+	}
+}
@@ -269,6 +269,26 @@ unsigned short servicePort;
 
 	api = new StorageApi(servicePort, threads, workerPoolSize);
 	api->setTimeout(m_timeout);
+	setAppendGroupLimits();
+}
+
+/**
+ * Set the bounds of the groups in which reading appends are committed
+ * from the configuration
+ */
+void StorageService::setAppendGroupLimits()
+{
+	unsigned int window = APPEND_GROUP_WINDOW;
+	if (config->hasValue("appendGroupWindow"))
+	{
+		window = (unsigned int)strtoul(config->getValue("appendGroupWindow"), NULL, 10);
+	}
+	unsigned int size = APPEND_GROUP_SIZE;
+	if (config->hasValue("appendGroupSize"))
+	{
+		size = (unsigned int)strtoul(config->getValue("appendGroupSize"), NULL, 10);
+	}
+	api->setAppendGroupLimits(window, size);
 }
 
 /**
@@ -616,6 +636,7 @@ void StorageService::configChange(const string& categoryName, const string& cate
 				api->getPerformanceMonitor()->setCollecting(false);
 			}
 		}
+		setAppendGroupLimits();
 		return;
 	}
 	if (!categoryName.compare(getPluginName()))
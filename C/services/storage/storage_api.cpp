@@ -15,7 +15,10 @@
 #include "logger.h"
 #include "plugin_exception.h"
 #include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
 #include <atomic>
+#include <functional>
 
 // Added for the default_resource example
 #include <algorithm>
@@ -26,6 +29,8 @@
 #endif
 
 #include <string_utils.h>
+#include <blob_reference.h>
+#include <utils.h>
 
 #define WORKER_THREAD_POOL	1
 // Enable worker threads for readings append and fetch
@@ -193,6 +198,20 @@ void readingFetchWrapper(shared_ptr<HttpServer::Response> response,
 #endif
 }
 
+/**
+ * Wrapper function for the binary reading fetch API call.
+ */
+void readingFetchBinaryWrapper(shared_ptr<HttpServer::Response> response,
+			 shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+#if WORKER_THREAD_POOL
+        api->queue(StorageOperation::ReadingFetchBinary, request, response);
+#else
+	api->readingFetchBinary(response, request);
+#endif
+}
+
 /**
  * Wrapper function for the reading query API call.
  */
@@ -321,6 +340,46 @@ void getTableSnapshotsWrapper(shared_ptr<HttpServer::Response> response,
 	api->getTableSnapshots(response, request);
 }
 
+/**
+ * Wrapper function for the statistics history API call.
+ */
+void statisticsHistoryWrapper(shared_ptr<HttpServer::Response> response,
+				shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->statisticsHistory(response, request);
+}
+
+/**
+ * Wrapper function for the statistics history purge API call.
+ */
+void statisticsHistoryPurgeWrapper(shared_ptr<HttpServer::Response> response,
+				shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->statisticsHistoryPurge(response, request);
+}
+
+/**
+ * Wrapper function for the blob store API call.
+ */
+void blobStoreWrapper(shared_ptr<HttpServer::Response> response,
+				shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->blobStore(response, request);
+}
+
+/**
+ * Wrapper function for the blob fetch API call.
+ */
+void blobFetchWrapper(shared_ptr<HttpServer::Response> response,
+				shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->blobFetch(response, request);
+}
+
 /**
  * Wrapper function for the create storage stream API call.
  */
@@ -331,6 +390,16 @@ void createStorageStreamWrapper(shared_ptr<HttpServer::Response> response,
 	api->createStorageStream(response, request);
 }
 
+/**
+ * Wrapper function for the create shared memory channel API call.
+ */
+void createShmChannelWrapper(shared_ptr<HttpServer::Response> response,
+				shared_ptr<HttpServer::Request> request)
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->createShmChannel(response, request);
+}
+
 /**
  * Wrapper function for the create storage stream API call.
  */
@@ -396,7 +465,7 @@ void storageTableQueryWrapper(shared_ptr<HttpServer::Response> response,
 /**
  * Construct the singleton Storage API 
  */
-StorageApi::StorageApi(const unsigned short port, const unsigned int threads, const unsigned int poolSize) : m_thread(NULL), readingPlugin(0), streamHandler(0)
+StorageApi::StorageApi(const unsigned short port, const unsigned int threads, const unsigned int poolSize) : m_thread(NULL), readingPlugin(0), streamHandler(0), shmHandler(0)
 {
 	m_port = port;
 	m_threads = threads;
@@ -407,6 +476,9 @@ StorageApi::StorageApi(const unsigned short port, const unsigned int threads, co
 	m_perfMonitor = NULL;
 	m_workerPoolSize = poolSize;
 	m_workers.resize(poolSize, NULL);
+	m_streamWorkers.resize(STREAM_QUERY_POOL, NULL);
+	m_activeStreams = 0;
+	m_blobs = new BlobStore(getDataDir() + "/blobs");
 	StorageApi::m_instance = this;
 }
 
@@ -421,6 +493,7 @@ StorageApi::~StorageApi()
 	{
 		delete m_server;
 	}
+	delete m_blobs;
 	m_instance = NULL;
 
 	if (m_thread)
@@ -431,11 +504,19 @@ StorageApi::~StorageApi()
 	{
 		delete m_perfMonitor;
 	}
+	if (shmHandler)
+	{
+		delete shmHandler;
+	}
 	for (unsigned int i = 0; i < m_workerPoolSize; i++)
 	{
 		if (m_workers[i])
 			delete m_workers[i];
 	}
+	for (auto streamWorker : m_streamWorkers)
+	{
+		delete streamWorker;
+	}
 }
 
 /**
@@ -489,13 +570,19 @@ void StorageApi::initResources()
 	m_server->resource[LOAD_TABLE_SNAPSHOT]["PUT"] = loadTableSnapshotWrapper;
 	m_server->resource[DELETE_TABLE_SNAPSHOT]["DELETE"] = deleteTableSnapshotWrapper;
 	m_server->resource[GET_TABLE_SNAPSHOTS]["GET"] = getTableSnapshotsWrapper;
+	m_server->resource[STATISTICS_HISTORY]["POST"] = statisticsHistoryWrapper;
+	m_server->resource[STATISTICS_HISTORY_PURGE]["PUT"] = statisticsHistoryPurgeWrapper;
+	m_server->resource[BLOB_STORE]["POST"] = blobStoreWrapper;
+	m_server->resource[BLOB_FETCH]["GET"] = blobFetchWrapper;
 
 	m_server->resource[READING_ACCESS]["POST"] = readingAppendWrapper;
 	m_server->resource[READING_ACCESS]["GET"] = readingFetchWrapper;
+	m_server->resource[READING_FETCH_BINARY]["GET"] = readingFetchBinaryWrapper;
 	m_server->resource[READING_QUERY]["PUT"] = readingQueryWrapper;
 	m_server->resource[READING_PURGE]["PUT"] = readingPurgeWrapper;
 
 	m_server->resource[CREATE_STORAGE_STREAM]["POST"] = createStorageStreamWrapper;
+	m_server->resource[CREATE_STORAGE_SHM]["POST"] = createShmChannelWrapper;
 	m_server->resource[STORAGE_SCHEMA]["POST"] = createStorageSchemaWrapper;
 
 	m_server->resource[STORAGE_TABLE_ACCESS]["POST"] = storageTableInsertWrapper;
@@ -528,16 +615,30 @@ static void workerStart()
 	api->worker();
 }
 
+/**
+ * Static method used to start a streamed query thread
+ */
+static void streamWorkerStart()
+{
+	StorageApi *api = StorageApi::getInstance();
+	api->streamWorker();
+}
+
 /**
  * Start the HTTP server
  */
 void StorageApi::start() {
+	m_appendGroup.start(readingPlugin ? readingPlugin : plugin);
 	m_thread = new thread(startService);
 	m_shutdown = false;
 	for (unsigned int i = 0; i < m_workerPoolSize; i++)
 	{
 		m_workers[i] = new thread(workerStart);
 	}
+	for (auto& streamWorker : m_streamWorkers)
+	{
+		streamWorker = new thread(streamWorkerStart);
+	}
 }
 
 void StorageApi::startServer() {
@@ -552,6 +653,7 @@ void StorageApi::stopServer() {
  */
 void StorageApi::wait() {
 	m_thread->join();
+	m_appendGroup.stop();
 	m_shutdown = true;
 	m_queueCV.notify_all();
 	for (unsigned int i = 0; i < m_workerPoolSize; i++)
@@ -563,6 +665,19 @@ void StorageApi::wait() {
 			m_workers[i] = NULL;
 		}
 	}
+	{
+		lock_guard<mutex> guard(m_streamMutex);
+	}
+	m_streamCV.notify_all();
+	for (auto& streamWorker : m_streamWorkers)
+	{
+		if (streamWorker)
+		{
+			streamWorker->join();
+			delete streamWorker;
+			streamWorker = NULL;
+		}
+	}
 }
 
 /**
@@ -614,6 +729,9 @@ void StorageApi::worker()
 			case StorageOperation::ReadingFetch:
 				readingFetch(op->m_response, op->m_request);
 				break;
+			case StorageOperation::ReadingFetchBinary:
+				readingFetchBinary(op->m_response, op->m_request);
+				break;
 			case StorageOperation::ReadingPurge:
 				readingPurge(op->m_response, op->m_request);
 				break;
@@ -631,6 +749,28 @@ void StorageApi::worker()
 	}
 }
 
+/**
+ * The streamed query thread, runs the streamed queries one at a time
+ */
+void StorageApi::streamWorker()
+{
+	unique_lock<mutex> lck(m_streamMutex);
+	while (!m_shutdown)
+	{
+		while (!m_streamQueue.empty())
+		{
+			StorageOperation *op = m_streamQueue.front();
+			m_streamQueue.pop();
+			lck.unlock();
+			op->m_work();
+			delete op;
+			lck.lock();
+			m_activeStreams--;
+		}
+		m_streamCV.wait(lck);
+	}
+}
+
 /**
  * Append a request to the readings request queue
  *
@@ -642,9 +782,20 @@ void StorageApi::worker()
  * @param response	The HTTP response
  */
 void StorageApi::queue(StorageOperation::Operations op, shared_ptr<HttpServer::Request> request, shared_ptr<HttpServer::Response> response)
+{
+	queue(new StorageOperation(op, request, response));
+}
+
+/**
+ * Append an operation to the readings request queue, the queue takes
+ * ownership of the operation
+ *
+ * @param operation	The operation to perform
+ */
+void StorageApi::queue(StorageOperation *operation)
 {
 	unique_lock<mutex> lck(m_queueMutex);
-	m_queue.push(new StorageOperation(op, request, response));
+	m_queue.push(operation);
 	m_queueCV.notify_all();
 	unsigned int length = m_queue.size();
 	m_perfMonitor->collect("Worker Queue length", length);
@@ -864,6 +1015,18 @@ string	payload;
 		tableName = request->path_match[TABLE_NAME_COMPONENT];
 		payload = request->content.string();
 
+		if (plugin->hasStreamedRetrieveSupport() && streamRequested(request))
+		{
+			StoragePlugin *queryPlugin = plugin;
+			if (streamQuery(response, queryPlugin,
+					[queryPlugin, tableName, payload](RESULT_STREAM_CB callback, void *data) {
+						return queryPlugin->commonRetrieveStream(tableName, payload, callback, data);
+					}))
+			{
+				return;
+			}
+		}
+
 		char *pluginResult = plugin->commonRetrieve(tableName, payload);
 		if (pluginResult)
 		{
@@ -884,6 +1047,103 @@ string	payload;
 	}
 }
 
+/**
+ * Check if the client has requested the result of a query be streamed.
+ * Streaming is requested with the stream query parameter, clients that
+ * do not request it receive the result as a single document.
+ *
+ * @param request	The HTTP request
+ * @return bool		True if the result should be streamed
+ */
+bool StorageApi::streamRequested(shared_ptr<HttpServer::Request> request)
+{
+	SimpleWeb::CaseInsensitiveMultimap query = request->parse_query_string();
+	auto search = query.find(STREAM_QUERY_PARAM);
+	return search != query.end() && search->second.compare("true") == 0;
+}
+
+/**
+ * Return the number of streamed queries queued or in progress
+ */
+unsigned int StorageApi::activeStreams()
+{
+	lock_guard<mutex> guard(m_streamMutex);
+	return m_activeStreams;
+}
+
+/**
+ * Stream the result of a query to the client as the storage plugin
+ * produces the rows. The streamed result waits for the end of the
+ * result to be sent, so the query is run by the streamed query thread
+ * pool rather than on the HTTP server thread that received the request.
+ *
+ * Only STREAM_QUERY_POOL streamed results may be in progress at once,
+ * if that many are already in progress the query is not streamed and
+ * the caller should return the result as a single document.
+ *
+ * @param response	The response stream to send the response on
+ * @param queryPlugin	The plugin that will execute the query
+ * @param query		Function that runs the query, passing the rows to the callback
+ * @return bool		True if the query will be streamed
+ */
+bool StorageApi::streamQuery(shared_ptr<HttpServer::Response> response, StoragePlugin *queryPlugin,
+		function<bool(RESULT_STREAM_CB, void *)> query)
+{
+	unique_lock<mutex> lck(m_streamMutex);
+	if (m_activeStreams >= STREAM_QUERY_POOL)
+	{
+		m_perfMonitor->collect("Streamed queries refused", 1);
+		return false;
+	}
+	m_activeStreams++;
+	m_streamQueue.push(new StorageOperation([this, response, queryPlugin, query]()
+	{
+		StreamedResult result(response);
+		try {
+			bool rval = query(StreamedResult::rows, &result);
+			completeStream(response, result, rval, queryPlugin);
+		} catch (exception& ex) {
+			if (result.started())
+				result.abandon();
+			else
+				internalError(response, ex);
+		}
+	}));
+	m_streamCV.notify_one();
+	return true;
+}
+
+/**
+ * Complete a streamed query result. If the query failed before any rows
+ * were sent the error is reported to the client, otherwise the result is
+ * abandoned as the status has already been sent.
+ *
+ * @param response	The response stream to send the response on
+ * @param result	The streamed result
+ * @param complete	The query completed successfully
+ * @param queryPlugin	The plugin that executed the query
+ */
+void StorageApi::completeStream(shared_ptr<HttpServer::Response> response, StreamedResult& result,
+		bool complete, StoragePlugin *queryPlugin)
+{
+	if (complete)
+	{
+		result.complete();
+	}
+	else if (!result.started())
+	{
+		string responsePayload;
+		mapError(responsePayload, queryPlugin->lastError());
+		respond(response, SimpleWeb::StatusCode::client_error_bad_request, responsePayload);
+	}
+	else
+	{
+		Logger::getLogger()->error("Query failed after %lu rows had been sent, the result is incomplete",
+				result.count());
+		result.abandon();
+	}
+}
+
 /**
  * Perform a delete on a table using the condition encoded in the JSON payload
  *
@@ -935,9 +1195,9 @@ string  responsePayload;
  */
 void StorageApi::readingAppend(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request)
 {
-string payload;
+shared_ptr<string> payload;
 string  responsePayload;
-struct timeval	tStart, tEnd;
+struct timeval	tStart = { 0, 0 };
 
 	if (m_perfMonitor->isCollecting())
 	{
@@ -986,42 +1246,90 @@ struct timeval	tStart, tEnd;
 
 	stats.readingAppend++;
 	try {
-		payload = request->content.string();
-		int rval = (readingPlugin ? readingPlugin : plugin)->readingsAppend(payload);
+		/*
+		 * The request body is copied once into a buffer that is shared
+		 * by the append and the registry. If no service has registered
+		 * for readings the body is not needed once it has been appended
+		 * and the plugin may parse it in place.
+		 */
+		payload = make_shared<string>((const char *)request->content.data(), request->content.size());
+		bool notify = registry.hasRegistrations();
+		if (m_appendGroup.append(payload, !notify, [this, response, notify, tStart](int rval,
+						const shared_ptr<string>& payload) {
+					appendComplete(response, payload, notify, rval, tStart);
+				}))
+		{
+			return;
+		}
+		StoragePlugin *appendPlugin = readingPlugin ? readingPlugin : plugin;
+		int rval = !notify && appendPlugin->hasInsituAppendSupport() ?
+			appendPlugin->readingsAppendInsitu(*payload) : appendPlugin->readingsAppend(*payload);
+		appendComplete(response, payload, notify, rval, tStart);
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
+/**
+ * Respond to an append of readings once the readings have been appended
+ *
+ * @param response	The response stream to send the response on
+ * @param payload	The readings that were appended
+ * @param notify	Pass the readings to the registry
+ * @param rval		The number of readings appended or -1 if the append failed
+ * @param tStart	The time the request was received
+ */
+void StorageApi::appendComplete(shared_ptr<HttpServer::Response> response, const shared_ptr<string>& payload,
+		bool notify, int rval, struct timeval tStart)
+{
+string  responsePayload;
+
+	try {
 		if (rval != -1)
 		{
-			registry.process(payload);
+			if (notify)
+				registry.process(payload);
 			responsePayload = "{ \"response\" : \"appended\", \"readings_added\" : ";
 			responsePayload += to_string(rval);
 			responsePayload += " }";
 			respond(response, responsePayload);
-
-			if (m_perfMonitor->isCollecting())
-			{
-				gettimeofday(&tEnd, NULL);
-				m_perfMonitor->collect("Reading Append Rows " +
-						(readingPlugin ? readingPlugin : plugin)->getName(),
-						rval);
-				m_perfMonitor->collect("Reading Append PayloadSize " +
-						(readingPlugin ? readingPlugin : plugin)->getName(),
-						payload.length());
-				struct timeval diff;
-				timersub(&tEnd, &tStart, &diff);
-				m_perfMonitor->collect("Reading Append Time (ms)", diff.tv_sec * 1000 + diff.tv_usec / 1000);
-			}
+			appendMonitor(rval, payload->length(), tStart);
 		}
 		else
 		{
 			mapError(responsePayload, (readingPlugin ? readingPlugin : plugin)->lastError());
 			respond(response, SimpleWeb::StatusCode::client_error_bad_request, responsePayload);
 		}
-
-		//respond(response, responsePayload);
 	} catch (exception& ex) {
 		internalError(response, ex);
 	}
 }
 
+/**
+ * Collect the performance monitors for a completed append of readings
+ *
+ * @param rows		The number of readings appended
+ * @param size		The size of the appended payload
+ * @param tStart	The time the append was requested
+ */
+void StorageApi::appendMonitor(int rows, size_t size, struct timeval tStart)
+{
+struct timeval	tEnd, diff;
+
+	if (m_perfMonitor && m_perfMonitor->isCollecting())
+	{
+		gettimeofday(&tEnd, NULL);
+		m_perfMonitor->collect("Reading Append Rows " +
+				(readingPlugin ? readingPlugin : plugin)->getName(),
+				rows);
+		m_perfMonitor->collect("Reading Append PayloadSize " +
+				(readingPlugin ? readingPlugin : plugin)->getName(),
+				size);
+		timersub(&tEnd, &tStart, &diff);
+		m_perfMonitor->collect("Reading Append Time (ms)", diff.tv_sec * 1000 + diff.tv_usec / 1000);
+	}
+}
+
 /**
  * Fetch a block of readings.
  *
@@ -1065,8 +1373,20 @@ unsigned long			   count = 0;
 			count = (unsigned)atol(search->second.c_str());
 		}
 
+		StoragePlugin *fetchPlugin = readingPlugin ? readingPlugin : plugin;
+		if (fetchPlugin->hasStreamedReadingsSupport() && streamRequested(request))
+		{
+			if (streamQuery(response, fetchPlugin,
+					[fetchPlugin, id, count](RESULT_STREAM_CB callback, void *data) {
+						return fetchPlugin->readingsFetchStream(id, count, callback, data);
+					}))
+			{
+				return;
+			}
+		}
+
 		// Get plugin data
-		char *responsePayload = (readingPlugin ? readingPlugin : plugin)->readingsFetch(id, count);
+		char *responsePayload = fetchPlugin->readingsFetch(id, count);
 		string res = responsePayload;
 
 		// Reply to client
@@ -1078,6 +1398,76 @@ unsigned long			   count = 0;
 	}
 }
 
+/**
+ * Fetch a block of readings as a binary block rather than a JSON
+ * document. The block format is defined by RDSFetchHeader and
+ * RDSFetchReading. If the storage plugin does not support binary
+ * fetches a not implemented status is returned and the caller
+ * should use the JSON fetch instead.
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::readingFetchBinary(shared_ptr<HttpServer::Response> response,
+			      shared_ptr<HttpServer::Request> request)
+{
+SimpleWeb::CaseInsensitiveMultimap query;
+unsigned long			   id = 0;
+unsigned long			   count = 0;
+StoragePlugin			   *fetchPlugin = readingPlugin ? readingPlugin : plugin;
+
+	stats.readingFetch++;
+	try {
+		if (!fetchPlugin->hasBinaryFetchSupport())
+		{
+			string payload = "{ \"error\" : \"Storage plugin does not support binary reading fetch\" }";
+			respond(response,
+				SimpleWeb::StatusCode::server_error_not_implemented,
+				payload);
+			return;
+		}
+		query = request->parse_query_string();
+
+		auto search = query.find("id");
+		if (search == query.end())
+		{
+			string payload = "{ \"error\" : \"Missing query parameter id\" }";
+			respond(response,
+				SimpleWeb::StatusCode::client_error_bad_request,
+				payload);
+			return;
+		}
+		id = (unsigned long)atol(search->second.c_str());
+		search = query.find("count");
+		if (search == query.end())
+		{
+			string payload = "{ \"error\" : \"Missing query parameter count\" }";
+			respond(response,
+				SimpleWeb::StatusCode::client_error_bad_request,
+				payload);
+			return;
+		}
+		count = (unsigned)atol(search->second.c_str());
+
+		unsigned int length = 0;
+		char *block = fetchPlugin->readingsFetchBinary(id, count, &length);
+		if (!block)
+		{
+			string responsePayload;
+			mapError(responsePayload, fetchPlugin->lastError());
+			respond(response, SimpleWeb::StatusCode::client_error_bad_request, responsePayload);
+			return;
+		}
+
+		*response << "HTTP/1.1 200 OK\r\nContent-Length: " << length << "\r\n"
+			 <<  "Content-type: application/octet-stream\r\n\r\n";
+		response->write(block, length);
+		free(block);
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
 /**
  * Perform a query on a set of readings
  *
@@ -1092,7 +1482,19 @@ string	payload;
 	try {
 		payload = request->content.string();
 
-		char *resultSet = (readingPlugin ? readingPlugin : plugin)->readingsRetrieve(payload);
+		StoragePlugin *queryPlugin = readingPlugin ? readingPlugin : plugin;
+		if (queryPlugin->hasStreamedReadingsSupport() && streamRequested(request))
+		{
+			if (streamQuery(response, queryPlugin,
+					[queryPlugin, payload](RESULT_STREAM_CB callback, void *data) {
+						return queryPlugin->readingsRetrieveStream(payload, callback, data);
+					}))
+			{
+				return;
+			}
+		}
+
+		char *resultSet = queryPlugin->readingsRetrieve(payload);
 		string res = resultSet;
 
 		respond(response, res);
@@ -1217,7 +1619,15 @@ static std::atomic<bool> already_running(false);
 			return;
 		}
 		respond(response, purged);
+		Document result;
+		bool removed = purged && !result.Parse(purged).HasParseError()
+				&& result.HasMember("removed") && result["removed"].IsNumber()
+				&& result["removed"].GetDouble() > 0;
 		free(purged);
+		if (removed)
+		{
+			purgeBlobs();
+		}
 	}
 	/** Handle PluginNotImplementedException exception here */
 	catch (PluginNotImplementedException& ex) {
@@ -1238,6 +1648,85 @@ static std::atomic<bool> already_running(false);
 	already_running.store(false);
 }
 
+/**
+ * Remove the blobs that are no longer referenced by any reading. This
+ * is called after a purge has removed readings. The references held
+ * by the remaining readings are collected and the other blobs are
+ * removed from the blob store, apart from those stored recently which
+ * may belong to readings that are still being appended. If the
+ * references can not be collected no blobs are removed.
+ *
+ * The readings that hold references are read in pages of at most
+ * BLOB_PURGE_PAGE readings, in id order, so that only the references
+ * and not the readings are held in memory.
+ */
+void StorageApi::purgeBlobs()
+{
+	StoragePlugin *queryPlugin = readingPlugin ? readingPlugin : plugin;
+	set<string> referenced;
+	unsigned long lastId = 0;
+	unsigned int count;
+	do {
+		string query = "{ \"where\" : { \"column\" : \"id\", \"condition\" : \">\", ";
+		query += "\"value\" : " + to_string(lastId) + ", \"and\" : { \"column\" : \"reading\", ";
+		query += "\"condition\" : \"like\", \"value\" : \"%" BLOB_PREFIX "%\" } }, ";
+		query += "\"sort\" : { \"column\" : \"id\", \"direction\" : \"asc\" }, ";
+		query += "\"limit\" : " + to_string(BLOB_PURGE_PAGE) + " }";
+		char *result = NULL;
+		try {
+			result = queryPlugin->readingsRetrieve(query);
+		} catch (exception& ex) {
+			Logger::getLogger()->error("Unable to find the blobs referenced by readings, %s", ex.what());
+		}
+		if (!result)
+		{
+			Logger::getLogger()->error("Unable to find the blobs referenced by readings, blobs will not be purged");
+			return;
+		}
+
+		Document doc;
+		if (doc.Parse(result).HasParseError() || !doc.HasMember("rows") || !doc["rows"].IsArray())
+		{
+			Logger::getLogger()->error("Unable to parse the readings that reference blobs, blobs will not be purged");
+			queryPlugin->release(result);
+			return;
+		}
+		const Value& rows = doc["rows"];
+		count = rows.Size();
+		if (count)
+		{
+			const Value& last = rows[count - 1];
+			if (!last.HasMember("id") || !last["id"].IsUint64())
+			{
+				Logger::getLogger()->error("The readings that reference blobs have no id, blobs will not be purged");
+				queryPlugin->release(result);
+				return;
+			}
+			lastId = last["id"].GetUint64();
+		}
+
+		// The reference ends with the blob digest, which is terminated
+		// by the quote, possibly escaped, of the string that holds it
+		const char *ptr = result;
+		while ((ptr = strstr(ptr, BLOB_PREFIX)) != NULL)
+		{
+			ptr += BLOB_PREFIX_LEN;
+			const char *end = ptr;
+			const char *blob = ptr;
+			while (*end && *end != '"' && *end != '\\')
+			{
+				if (*end == ':')
+					blob = end + 1;
+				end++;
+			}
+			referenced.insert(string(blob, end - blob));
+			ptr = end;
+		}
+		queryPlugin->release(result);
+	} while (count >= BLOB_PURGE_PAGE);
+	m_blobs->purge(referenced, time(0) - BLOB_PURGE_GRACE);
+}
+
 /**
  * Register interest in readings for an asset
  */
@@ -1427,6 +1916,76 @@ string	responsePayload;
 		}
 }
 
+/**
+ * Create a shared memory channel for a co-located client to append
+ * and fetch readings. The client connects to the returned Unix domain
+ * socket and sends the token in order to receive the channel.
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::createShmChannel(shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request> request)
+{
+string	responsePayload;
+
+	(void)(request); 	// Surpress unused arguemnt warning
+	try {
+		if (!(readingPlugin ? readingPlugin : plugin)->hasStreamSupport())
+		{
+			responsePayload = "{ \"error\" : \"Storage plugin does not support reading streams\" }";
+			respond(response, SimpleWeb::StatusCode::server_error_not_implemented, responsePayload);
+			return;
+		}
+		{
+			lock_guard<mutex> guard(m_shmMutex);
+			if (!shmHandler)
+			{
+				shmHandler = new ShmHandler(this);
+			}
+		}
+		uint32_t token;
+		string name;
+		if (shmHandler->createChannel(&token, name))
+		{
+			responsePayload = "{ \"socket\": \"";
+			responsePayload += name;
+			responsePayload += "\", \"token\":";
+			responsePayload += to_string(token);
+			responsePayload += " }";
+			respond(response, responsePayload);
+		}
+		else
+		{
+			respond(response, SimpleWeb::StatusCode::server_error_internal_server_error, responsePayload);
+		}
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
+/**
+ * Return true if the readings storage plugin supports fetching
+ * readings as a binary block
+ */
+bool StorageApi::supportsBinaryFetch()
+{
+	return (readingPlugin ? readingPlugin : plugin)->hasBinaryFetchSupport();
+}
+
+/**
+ * Fetch a block of readings as a binary block for a shared memory channel
+ *
+ * @param id		The first reading id to fetch
+ * @param count		The maximum number of readings to fetch
+ * @param length	Returns the length of the block
+ * @return char*	The binary block, to be released with free, or NULL on error
+ */
+char *StorageApi::readingFetchBlock(unsigned long id, unsigned int count, unsigned int *length)
+{
+	stats.readingFetch++;
+	return (readingPlugin ? readingPlugin : plugin)->readingsFetchBinary(id, count, length);
+}
+
 /**
  * Append the readings that have arrived via a stream to the storage plugin
  *
@@ -1442,34 +2001,91 @@ bool StorageApi::readingStream(ReadingStream **readings, bool commit)
 	else
 	{
 		// Plugin does not support streaming input
-		ostringstream convert;
-		char	ts[60], micro_s[10];
-		
-
-		convert << "{\"readings\":[";
-		for (int i = 0; readings[i]; i++)
-		{
-			if (i > 0)
-				convert << ",";
-			convert << "{\"asset_code\":\"";
-			convert << readings[i]->assetCode;
-			convert << "\",\"user_ts\":\"";
-			struct tm timeinfo;
-			gmtime_r(&readings[i]->userTs.tv_sec, &timeinfo);
-			std::strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &timeinfo);
-			snprintf(micro_s, sizeof(micro_s), ".%06lu", readings[i]->userTs.tv_usec);
-			convert << ts << micro_s;
-			convert << "\",\"reading\":";
-			convert << &(readings[i]->assetCode[readings[i]->assetCodeLength]);
-			convert << "}";
-		}
-		convert << "]}";
-		Logger::getLogger()->debug("Fallback created payload: %s", convert.str().c_str());
-		(readingPlugin ? readingPlugin : plugin)->readingsAppend(convert.str());
+		string payload = readingStreamPayload(readings);
+		Logger::getLogger()->debug("Fallback created payload: %s", payload.c_str());
+		(readingPlugin ? readingPlugin : plugin)->readingsAppend(payload);
 	}	
 	return false;
 }
 
+/**
+ * Append a block of readings that has arrived on a shared memory channel.
+ * The block is a single append request and is treated in the same way as
+ * an append of readings via the HTTP interface; the statistics and
+ * performance monitors are updated and the readings are passed to the
+ * registry once they have been stored. The readings are passed to the
+ * storage plugin in place, the JSON payload is only created if there are
+ * services registered for readings or the plugin does not support streams.
+ *
+ * @param readings	A Null terminated array of points to ReadingStream structures
+ * @param size		The size of the readings in the block
+ * @return int		The number of readings appended or -1 if the append failed
+ */
+int StorageApi::readingAppendStream(ReadingStream **readings, size_t size)
+{
+struct timeval	tStart;
+
+	gettimeofday(&tStart, NULL);
+	stats.readingAppend++;
+
+	StoragePlugin *appendPlugin = readingPlugin ? readingPlugin : plugin;
+	bool notify = registry.hasRegistrations();
+	shared_ptr<string> payload;
+	if (notify || !appendPlugin->hasStreamSupport())
+	{
+		payload = make_shared<string>(readingStreamPayload(readings));
+	}
+	int rval;
+	if (appendPlugin->hasStreamSupport())
+	{
+		rval = appendPlugin->readingStream(readings, true);
+	}
+	else
+	{
+		rval = appendPlugin->readingsAppend(*payload);
+	}
+	if (rval != -1)
+	{
+		if (notify)
+			registry.process(payload);
+		appendMonitor(rval, size, tStart);
+	}
+	return rval;
+}
+
+/**
+ * Create the JSON append payload for a set of readings in the
+ * ReadingStream layout
+ *
+ * @param readings	A Null terminated array of points to ReadingStream structures
+ * @return string	The JSON payload
+ */
+string StorageApi::readingStreamPayload(ReadingStream **readings)
+{
+	ostringstream convert;
+	char	ts[60], micro_s[10];
+
+	convert << "{\"readings\":[";
+	for (int i = 0; readings[i]; i++)
+	{
+		if (i > 0)
+			convert << ",";
+		convert << "{\"asset_code\":\"";
+		convert << readings[i]->assetCode;
+		convert << "\",\"user_ts\":\"";
+		struct tm timeinfo;
+		gmtime_r(&readings[i]->userTs.tv_sec, &timeinfo);
+		std::strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &timeinfo);
+		snprintf(micro_s, sizeof(micro_s), ".%06lu", readings[i]->userTs.tv_usec);
+		convert << ts << micro_s;
+		convert << "\",\"reading\":";
+		convert << &(readings[i]->assetCode[readings[i]->assetCodeLength]);
+		convert << "}";
+	}
+	convert << "]}";
+	return convert.str();
+}
+
 /**
  * Handle a bad URL endpoint call
  */
@@ -1664,6 +2280,214 @@ string   payload;
         }
 }
 
+/**
+ * Snapshot the statistics into the statistics history table and roll
+ * the previous values of the statistics forward in a single operation
+ * within the storage plugin. If the storage plugin does not support
+ * this a not implemented status is returned and the caller should
+ * update the tables using the common table operations.
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::statisticsHistory(shared_ptr<HttpServer::Response> response,
+				   shared_ptr<HttpServer::Request> request)
+{
+	try {
+		if (!plugin->hasStatisticsHistorySupport())
+		{
+			string payload = "{ \"error\" : \"Storage plugin does not support statistics history\" }";
+			respond(response,
+				SimpleWeb::StatusCode::server_error_not_implemented,
+				payload);
+			return;
+		}
+		int rows = plugin->statisticsHistory();
+		string responsePayload;
+		if (rows < 0)
+		{
+			mapError(responsePayload, plugin->lastError());
+			respond(response,
+				SimpleWeb::StatusCode::client_error_bad_request,
+				responsePayload);
+		}
+		else
+		{
+			responsePayload = "{ \"response\" : \"inserted\", \"rows_affected\" : ";
+			responsePayload += to_string(rows);
+			responsePayload += " }";
+			respond(response, responsePayload);
+			notifyStatisticsHistory(rows);
+		}
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
+/**
+ * Raise the table insert notifications for the rows the storage plugin
+ * has added to the statistics history table. The plugin only returns
+ * the number of rows, so the newest rows are read back to build the
+ * same insert payload as an insert via the common table interface.
+ * This is only done if a client has registered an interest in the table.
+ *
+ * @param rows	The number of rows added to the statistics history
+ */
+void StorageApi::notifyStatisticsHistory(int rows)
+{
+	if (rows <= 0 || !registry.hasTableRegistration("statistics_history"))
+	{
+		return;
+	}
+	string query = "{ \"return\" : [ \"key\", \"history_ts\", \"value\" ], "
+			"\"sort\" : { \"column\" : \"id\", \"direction\" : \"desc\" }, "
+			"\"limit\" : " + to_string(rows) + " }";
+	char *result = plugin->commonRetrieve("statistics_history", query);
+	if (!result)
+	{
+		Logger::getLogger()->warn("Unable to read the statistics history to notify interested parties");
+		return;
+	}
+	rapidjson::Document doc;
+	doc.Parse(result);
+	free(result);
+	if (doc.HasParseError() || !doc.HasMember("rows") || !doc["rows"].IsArray())
+	{
+		Logger::getLogger()->warn("Invalid statistics history returned by the storage plugin");
+		return;
+	}
+	rapidjson::Document inserts;
+	inserts.SetObject();
+	rapidjson::Value values(doc["rows"], inserts.GetAllocator());
+	inserts.AddMember("inserts", values, inserts.GetAllocator());
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	inserts.Accept(writer);
+	registry.processTableInsert("statistics_history", buffer.GetString());
+}
+
+/**
+ * Move the statistics history older than the age given in the
+ * query parameters into the daily statistics history, removing
+ * it from the statistics history table. The storage plugin does
+ * this in batches of at most limit rows, each batch within a
+ * single transaction. If the storage plugin does not support
+ * this a not implemented status is returned and the caller should
+ * update the tables using the common table operations.
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::statisticsHistoryPurge(shared_ptr<HttpServer::Response> response,
+				   shared_ptr<HttpServer::Request> request)
+{
+SimpleWeb::CaseInsensitiveMultimap query;
+unsigned long age = 0;
+unsigned int limit = STATISTICS_PURGE_LIMIT;
+
+	try {
+		if (!plugin->hasStatisticsHistoryPurgeSupport())
+		{
+			string payload = "{ \"error\" : \"Storage plugin does not support statistics history purge\" }";
+			respond(response,
+				SimpleWeb::StatusCode::server_error_not_implemented,
+				payload);
+			return;
+		}
+		query = request->parse_query_string();
+		auto search = query.find("age");
+		if (search == query.end())
+		{
+			string payload = "{ \"error\" : \"Missing query parameter age\" }";
+			respond(response, SimpleWeb::StatusCode::client_error_bad_request, payload);
+			return;
+		}
+		age = strtoul(search->second.c_str(), NULL, 10);
+		search = query.find("limit");
+		if (search != query.end())
+		{
+			limit = (unsigned int)strtoul(search->second.c_str(), NULL, 10);
+		}
+		if (limit == 0)
+		{
+			string payload = "{ \"error\" : \"The query parameter limit must be greater than zero\" }";
+			respond(response, SimpleWeb::StatusCode::client_error_bad_request, payload);
+			return;
+		}
+
+		int rows = plugin->statisticsHistoryPurge(age, limit);
+		string responsePayload;
+		if (rows < 0)
+		{
+			mapError(responsePayload, plugin->lastError());
+			respond(response,
+				SimpleWeb::StatusCode::client_error_bad_request,
+				responsePayload);
+		}
+		else
+		{
+			responsePayload = "{ \"response\" : \"purged\", \"rows_affected\" : ";
+			responsePayload += to_string(rows);
+			responsePayload += " }";
+			respond(response, responsePayload);
+		}
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
+/**
+ * Store the content of the request in the blob store. The
+ * response contains the reference of the blob.
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::blobStore(shared_ptr<HttpServer::Response> response,
+				   shared_ptr<HttpServer::Request> request)
+{
+	try {
+		string content = request->content.string();
+		string blob = m_blobs->put(content.data(), content.length());
+		if (blob.empty())
+		{
+			string payload = "{ \"error\" : \"Unable to store the blob\" }";
+			respond(response, SimpleWeb::StatusCode::server_error_internal_server_error, payload);
+			return;
+		}
+		string responsePayload = "{ \"blob\" : \"" + blob + "\" }";
+		respond(response, responsePayload);
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
+
+/**
+ * Return the content of a blob in the blob store
+ *
+ * @param response	The response stream to send the response on
+ * @param request	The HTTP request
+ */
+void StorageApi::blobFetch(shared_ptr<HttpServer::Response> response,
+				   shared_ptr<HttpServer::Request> request)
+{
+	try {
+		string blob = request->path_match[BLOB_COMPONENT];
+		MappedBlob *mapped = m_blobs->get(blob);
+		if (!mapped)
+		{
+			string payload = "{ \"error\" : \"Blob " + blob + " does not exist\" }";
+			respond(response, SimpleWeb::StatusCode::client_error_not_found, payload);
+			return;
+		}
+		*response << "HTTP/1.1 200 OK\r\nContent-Length: " << mapped->length() << "\r\n"
+			 <<  "Content-type: application/octet-stream\r\n\r\n";
+		response->write(mapped->data(), (streamsize)mapped->length());
+		delete mapped;
+	} catch (exception& ex) {
+		internalError(response, ex);
+	}
+}
 
 /**
  * Perform an create table and create index for schema provided in the payload.
@@ -1938,6 +2762,19 @@ string  payload;
                 tableName = request->path_match[STORAGE_TABLE_NAME_COMPONENT];
                 payload = request->content.string();
 
+		if (plugin->hasStreamedRetrieveSupport() && streamRequested(request))
+		{
+			StoragePlugin *queryPlugin = plugin;
+			if (streamQuery(response, queryPlugin,
+					[queryPlugin, tableName, payload, schemaName](RESULT_STREAM_CB callback, void *data) {
+						return queryPlugin->commonRetrieveStream(tableName, payload, callback, data,
+								schemaName.c_str());
+					}))
+			{
+				return;
+			}
+		}
+
                 char *pluginResult = plugin->commonRetrieve(tableName, payload, const_cast<char*>(schemaName.c_str()));
                 if (pluginResult)
                 {
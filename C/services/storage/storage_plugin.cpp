@@ -102,10 +102,20 @@ StoragePlugin::StoragePlugin(const string& name, PLUGIN_HANDLE handle) : Plugin(
 
 	readingsAppendPtr = (int (*)(PLUGIN_HANDLE, const char *))
 				manager->resolveSymbol(handle, "plugin_reading_append");
+	readingsAppendInsituPtr = (int (*)(PLUGIN_HANDLE, char *))
+				manager->resolveSymbol(handle, "plugin_reading_append_insitu");
 	readingsFetchPtr = (char * (*)(PLUGIN_HANDLE, unsigned long id, unsigned int blksize))
 				manager->resolveSymbol(handle, "plugin_reading_fetch");
+	readingsFetchBinaryPtr = (char * (*)(PLUGIN_HANDLE, unsigned long id, unsigned int blksize, unsigned int *length))
+				manager->resolveSymbol(handle, "plugin_reading_fetch_binary");
 	readingsRetrievePtr = (char * (*)(PLUGIN_HANDLE, const char *))
 				manager->resolveSymbol(handle, "plugin_reading_retrieve");
+	commonRetrieveStreamPtr = (bool (*)(PLUGIN_HANDLE, const char *, const char *, const char *, RESULT_STREAM_CB, void *))
+				manager->resolveSymbol(handle, "plugin_common_retrieve_stream");
+	readingsFetchStreamPtr = (bool (*)(PLUGIN_HANDLE, unsigned long, unsigned int, RESULT_STREAM_CB, void *))
+				manager->resolveSymbol(handle, "plugin_reading_fetch_stream");
+	readingsRetrieveStreamPtr = (bool (*)(PLUGIN_HANDLE, const char *, RESULT_STREAM_CB, void *))
+				manager->resolveSymbol(handle, "plugin_reading_retrieve_stream");
 	readingsPurgePtr = (char * (*)(PLUGIN_HANDLE, unsigned long age, unsigned int flags, unsigned long sent))
 				manager->resolveSymbol(handle, "plugin_reading_purge");
 	readingsPurgeAssetPtr = (unsigned int (*)(PLUGIN_HANDLE, const char *))
@@ -126,6 +136,12 @@ StoragePlugin::StoragePlugin(const string& name, PLUGIN_HANDLE handle) : Plugin(
 	getTableSnapshotsPtr =
 			(char * (*)(PLUGIN_HANDLE, const char*))
 			      manager->resolveSymbol(handle, "plugin_get_table_snapshots");
+	statisticsHistoryPtr =
+			(int (*)(PLUGIN_HANDLE))
+			      manager->resolveSymbol(handle, "plugin_statistics_history");
+	statisticsHistoryPurgePtr =
+			(int (*)(PLUGIN_HANDLE, unsigned long, unsigned int))
+			      manager->resolveSymbol(handle, "plugin_statistics_history_purge");
 	readingStreamPtr =
 			(int (*)(PLUGIN_HANDLE, ReadingStream **, bool))
 			      manager->resolveSymbol(handle, "plugin_readingStream");
@@ -170,6 +186,24 @@ char *StoragePlugin::commonRetrieve(const string& table, const string& payload,
 	return NULL;
 }
 
+/**
+ * Call the streamed retrieve method in the plugin. The rows of the
+ * result are passed to the callback as the plugin produces them.
+ *
+ * @param table		The table to query
+ * @param payload	The query
+ * @param callback	The callback to pass the rows to
+ * @param data		The data to pass to the callback
+ * @param schema	The schema of the table
+ * @return bool		True if the query completed
+ */
+bool StoragePlugin::commonRetrieveStream(const string& table, const string& payload,
+		RESULT_STREAM_CB callback, void *data, const char *schema)
+{
+	return this->commonRetrieveStreamPtr(instance, schema ? schema : DEFAULT_SCHEMA,
+			table.c_str(), payload.c_str(), callback, data);
+}
+
 /**
  * Call the update method in the plugin
  */
@@ -212,6 +246,19 @@ int StoragePlugin::readingsAppend(const string& payload)
 	return this->readingsAppendPtr(instance, payload.c_str());
 }
 
+/**
+ * Call the readings append method in the plugin that parses the
+ * payload in place. The payload is modified by the append and must
+ * not be used once the append has been called.
+ *
+ * @param payload	The readings to append
+ * @return int		The number of readings appended or -1 on failure
+ */
+int StoragePlugin::readingsAppendInsitu(string& payload)
+{
+	return this->readingsAppendInsituPtr(instance, &payload[0]);
+}
+
 /**
  * Call the readings fetch method in the plugin
  */
@@ -220,6 +267,19 @@ char * StoragePlugin::readingsFetch(unsigned long id, unsigned int blksize)
 	return this->readingsFetchPtr(instance, id, blksize);
 }
 
+/**
+ * Call the binary readings fetch method in the plugin
+ *
+ * @param id		The first reading id to fetch
+ * @param blksize	The maximum number of readings to fetch
+ * @param length	Returns the length of the binary block
+ * @return char*	The binary block, to be released with free
+ */
+char *StoragePlugin::readingsFetchBinary(unsigned long id, unsigned int blksize, unsigned int *length)
+{
+	return this->readingsFetchBinaryPtr(instance, id, blksize, length);
+}
+
 /**
  * Call the readings retrieve method in the plugin
  */
@@ -228,6 +288,24 @@ char *StoragePlugin::readingsRetrieve(const string& payload)
 	return this->readingsRetrievePtr(instance, payload.c_str());
 }
 
+/**
+ * Call the streamed readings fetch method in the plugin
+ */
+bool StoragePlugin::readingsFetchStream(unsigned long id, unsigned int blksize,
+		RESULT_STREAM_CB callback, void *data)
+{
+	return this->readingsFetchStreamPtr(instance, id, blksize, callback, data);
+}
+
+/**
+ * Call the streamed readings retrieve method in the plugin
+ */
+bool StoragePlugin::readingsRetrieveStream(const string& payload,
+		RESULT_STREAM_CB callback, void *data)
+{
+	return this->readingsRetrieveStreamPtr(instance, payload.c_str(), callback, data);
+}
+
 /**
  * Call the readings purge method in the plugin
  */
@@ -306,6 +384,28 @@ char *StoragePlugin::getTableSnapshots(const string& table)
         return this->getTableSnapshotsPtr(instance, table.c_str());
 }
 
+/**
+ * Call the statistics history method in the plugin
+ *
+ * @return int	The number of statistics snapshot or -1 on error
+ */
+int StoragePlugin::statisticsHistory()
+{
+	return this->statisticsHistoryPtr(instance);
+}
+
+/**
+ * Call the statistics history purge method in the plugin
+ *
+ * @param age		The age in seconds of the statistics history to move
+ * @param limit		The maximum number of rows to move in each transaction
+ * @return int		The number of rows moved or -1 on error
+ */
+int StoragePlugin::statisticsHistoryPurge(unsigned long age, unsigned int limit)
+{
+	return this->statisticsHistoryPurgePtr(instance, age, limit);
+}
+
 /**
  * Call the reading stream method in the plugin
  */
@@ -53,7 +53,7 @@ static void worker(StorageRegistry *registry)
  * the storage layer is minimally impacted by the registration and
  * delivery of these messages to interested microservices.
  */
-StorageRegistry::StorageRegistry() : m_thread(NULL)
+StorageRegistry::StorageRegistry() : m_registrationCount(0), m_thread(NULL)
 {
 	m_running = true;
 	m_thread = new thread(worker, this);
@@ -93,22 +93,34 @@ StorageRegistry::~StorageRegistry()
 void
 StorageRegistry::process(const string& payload)
 {
-	if (m_registrations.size() != 0)
+	if (hasRegistrations())
 	{
 		/*
 		 * We have some registrations so queue a copy of the payload
 		 * to be examined in the thread the send reading notifications
 		 * to interested parties.
 		 */
-		char *data = NULL;
-		if ((data = strdup(payload.c_str())) != NULL)
-		{
-			time_t now = time(0);
-			Item item = make_pair(now, data);
-			lock_guard<mutex> guard(m_qMutex);
-			m_queue.push(item);
-			m_cv.notify_all();
-		}
+		process(make_shared<string>(payload));
+	}
+}
+
+/**
+ * Process a reading append payload that is shared with the caller.
+ * The payload is queued without taking a copy, the caller must not
+ * modify the payload once it has been passed to the registry.
+ *
+ * @param payload	The reading append payload
+ */
+void
+StorageRegistry::process(const shared_ptr<string>& payload)
+{
+	if (hasRegistrations())
+	{
+		time_t now = time(0);
+		Item item = make_pair(now, payload);
+		lock_guard<mutex> guard(m_qMutex);
+		m_queue.push(item);
+		m_cv.notify_all();
 	}
 }
 
@@ -222,6 +234,7 @@ StorageRegistry::registerAsset(const string& asset, const string& url)
 {
 	lock_guard<mutex> guard(m_registrationsMutex);
 	m_registrations.push_back(pair<string *, string *>(new string(asset), new string(url)));
+	m_registrationCount = m_registrations.size();
 }
 
 /**
@@ -247,6 +260,7 @@ StorageRegistry::unregisterAsset(const string& asset, const string& url)
 			++it;
         	}
 	}
+	m_registrationCount = m_registrations.size();
 }
 
 /**
@@ -325,6 +339,26 @@ StorageRegistry::registerTable(const string& table, const string& payload)
 	m_tableRegistrations.push_back(pair<string *, TableRegistration *>(new string(table), reg));
 }
 
+/**
+ * Check if there is a registration of interest in a table
+ *
+ * @param table		The table of interest
+ * @return bool		True if any client has registered an interest in the table
+ */
+bool
+StorageRegistry::hasTableRegistration(const string& table)
+{
+	lock_guard<mutex> guard(m_tableRegistrationsMutex);
+	for (auto& reg : m_tableRegistrations)
+	{
+		if (reg.first->compare(table) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Handle a request to remove a registration of interest in a table
  *
@@ -412,11 +446,10 @@ StorageRegistry::run()
 			{
 				Item item = m_queue.front();
 				m_queue.pop();
-				data = item.second;
 #if CHECK_QTIMES
 				qTime = item.first;
 #endif
-				if (data)
+				if (item.second)
 				{
 #if CHECK_QTIMES
 					if (time(0) - qTime > QTIME_THRESHOLD)
@@ -424,8 +457,7 @@ StorageRegistry::run()
 						Logger::getLogger()->error("Readings data has been queued for %d seconds to be sent to registered party", (time(0) - qTime));
 					}
 #endif
-					processPayload(data);
-					free(data);
+					processPayload(item.second->c_str());
 				}
 			}
 			
@@ -514,7 +546,7 @@ StorageRegistry::run()
  * @param payload	The payload to potentially distribute
  */
 void
-StorageRegistry::processPayload(char *payload)
+StorageRegistry::processPayload(const char *payload)
 {
 bool allDone = true;
 
@@ -580,7 +612,7 @@ StorageRegistry::sendPayload(const string& url, const char *payload)
  * @param asset		The asset code to filter
  */
 void
-StorageRegistry::filterPayload(const string& url, char *payload, const string& asset)
+StorageRegistry::filterPayload(const string& url, const char *payload, const string& asset)
 {
 ostringstream convert;
 
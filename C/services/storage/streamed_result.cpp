@@ -0,0 +1,178 @@
+/*
+ * Fledge storage service.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Mark Riddoch
+ */
+#include <streamed_result.h>
+#include <logger.h>
+#include <chrono>
+
+using namespace std;
+
+/**
+ * Construct a streamed result that will be sent on the given response
+ *
+ * @param response	The response to send the result on
+ */
+StreamedResult::StreamedResult(shared_ptr<HttpServer::Response> response) :
+	m_response(response), m_state(make_shared<SendState>()), m_started(false), m_count(0)
+{
+}
+
+/**
+ * Result stream callback registered with the storage plugin
+ *
+ * @param result	The streamed result
+ * @param rows		The JSON row objects
+ * @param length	The length of the rows
+ * @param count		The number of rows
+ * @return bool		False if the query should be abandoned
+ */
+bool StreamedResult::rows(void *result, const char *rows, size_t length, unsigned int count)
+{
+	return ((StreamedResult *)result)->append(rows, length, count);
+}
+
+/**
+ * Send a set of rows to the client. The status and headers are sent
+ * along with the first set of rows. If the previous chunk is still
+ * being sent the rows are buffered and sent with the next chunk.
+ *
+ * @param rows		The JSON row objects
+ * @param length	The length of the rows
+ * @param count		The number of rows
+ * @return bool		False if the rows could not be sent and the query should be abandoned
+ */
+bool StreamedResult::append(const char *rows, size_t length, unsigned int count)
+{
+	if (!m_started)
+	{
+		*m_response << "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+			<< "Content-type: application/json\r\n\r\n";
+		m_buffer = "{\"rows\":[";
+		m_started = true;
+	}
+	else if (m_count)
+	{
+		m_buffer += ',';
+	}
+	m_buffer.append(rows, length);
+	m_count += count;
+
+	{
+		lock_guard<mutex> guard(m_state->mutex);
+		if (m_state->failed)
+		{
+			return false;
+		}
+		if (m_state->pending)
+		{
+			if (m_buffer.length() <= STREAM_BUFFER_LIMIT)
+			{
+				return true;
+			}
+			Logger::getLogger()->warn("The client is not reading the streamed query result, "
+					"the query has been abandoned after %lu rows", m_count);
+			m_state->failed = true;
+			return false;
+		}
+	}
+	return sendChunk();
+}
+
+/**
+ * Complete the result by sending the count of rows and the end of
+ * the chunked response, then wait for the result to be sent.
+ *
+ * @return bool		True if the result was sent
+ */
+bool StreamedResult::complete()
+{
+	if (!m_started)
+	{
+		*m_response << "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+			<< "Content-type: application/json\r\n\r\n";
+		m_buffer = "{\"rows\":[";
+		m_started = true;
+	}
+	m_buffer += "],\"count\":" + to_string(m_count) + "}";
+	if (!wait() || !sendChunk(true))
+	{
+		return false;
+	}
+	return wait();
+}
+
+/**
+ * Abandon a result that has been started. The response can no longer
+ * report an error, instead the connection is closed without completing
+ * the chunked response so the client sees the result as truncated.
+ */
+void StreamedResult::abandon()
+{
+	wait();
+	m_response->close_connection_after_response = true;
+}
+
+/**
+ * Send the buffered rows as a chunk of the result. The caller must
+ * ensure the previous chunk has been sent.
+ *
+ * @param last		Send the terminating chunk after this chunk
+ * @return bool		False if the chunk could not be sent
+ */
+bool StreamedResult::sendChunk(bool last)
+{
+	if (m_buffer.empty() && !last)
+	{
+		// An empty chunk would end the response
+		return true;
+	}
+	char size[20];
+	snprintf(size, sizeof(size), "%zx\r\n", m_buffer.length());
+	*m_response << size;
+	m_response->write(m_buffer.data(), (streamsize)m_buffer.length());
+	*m_response << "\r\n";
+	if (last)
+	{
+		*m_response << "0\r\n\r\n";
+	}
+	m_buffer.clear();
+
+	shared_ptr<SendState> state = m_state;
+	{
+		lock_guard<mutex> guard(state->mutex);
+		state->pending = true;
+	}
+	m_response->send([state](const SimpleWeb::error_code& ec) {
+		lock_guard<mutex> guard(state->mutex);
+		state->pending = false;
+		if (ec)
+		{
+			state->failed = true;
+		}
+		state->cv.notify_all();
+	});
+	return true;
+}
+
+/**
+ * Wait for the chunk in flight, if any, to be sent
+ *
+ * @return bool		False if the chunk could not be sent
+ */
+bool StreamedResult::wait()
+{
+	unique_lock<mutex> lck(m_state->mutex);
+	if (!m_state->cv.wait_for(lck, chrono::seconds(STREAM_SEND_TIMEOUT),
+				[this]() { return !m_state->pending; }))
+	{
+		Logger::getLogger()->warn("Timed out sending streamed query result to the client");
+		m_state->failed = true;
+	}
+	return !m_state->failed;
+}
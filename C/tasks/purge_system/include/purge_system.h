@@ -24,6 +24,7 @@
 
 
 #define UTILITIES_CATEGORY	  "Utilities"
+#define PURGE_STATS_BATCH_SIZE	  10000	// Statistics history rows moved in each storage transaction
 
 
 class PurgeSystem : public FledgeProcess
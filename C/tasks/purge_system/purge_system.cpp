@@ -206,8 +206,19 @@ void PurgeSystem::purgeExecution()
 
 	tableName = "statistics_history";
 	try {
-		historicizeData(m_retainStatsHistory);
-		purgeTable(tableName, "history_ts", m_retainStatsHistory);
+		// Prefer the storage service moving the history in batches,
+		// fall back to the table operations if it is not supported
+		int rows = m_storage->statisticsHistoryPurge(m_retainStatsHistory * 86400,
+							PURGE_STATS_BATCH_SIZE);
+		if (rows >= 0)
+		{
+			m_logger->info("%d rows of statistics history moved to the daily history", rows);
+		}
+		else
+		{
+			historicizeData(m_retainStatsHistory);
+			purgeTable(tableName, "history_ts", m_retainStatsHistory);
+		}
 
 	} catch (const std::exception &e) {
 
@@ -288,7 +299,7 @@ ResultSet *PurgeSystem::extractData(const std::string& tableName, const std::str
 
 	try
 	{
-		data = m_storage->queryTable(tableName, _query);
+		data = m_storage->queryTable(tableName, _query, ResultSet::Columns);
 		if (data == nullptr)
 		{
 			raiseError ("Failure extracting data from the table :%s: ", tableName.c_str() );
@@ -319,69 +330,55 @@ void PurgeSystem::storeData(const std::string& tableDest, ResultSet *data)
 
 	int affected = 0;
 
-	bool retrieved;
-
 	try
 	{
 		m_logger->debug("%s - storing in :%s: rows :%d:", __FUNCTION__, tableDest.c_str(), data->rowCount() );
 
-		ResultSet::RowIterator item = data->firstRow();
-		do
+		// SQLite and PostgreSQL plugins behave differently, the SQLite plugin names
+		// the date column after the expression and returns the sum as an integer,
+		// the PostgreSQL one uses the alias and may return the sum as a string
+		const ResultSet::ColumnView *date;
+		try {
+			date = &data->column("date(history_ts)");
+		} catch (...) {
+			date = &data->column("date");
+		}
+		const ResultSet::ColumnView& key = data->column("key");
+		const ResultSet::ColumnView& sum = data->column("sum_value");
+
+		for (unsigned int i = 0; i < date->size(); i++)
 		{
-			ResultSet::Row* row = *item;
+			fieldDate = date->getString(i);
+			fieldYear = strtol(fieldDate.substr(0, 4).c_str(), nullptr, 10);
+			fieldKey = key.getString(i);
 
-			if (row)
+			if (sum.getType() == STRING_COLUMN)
 			{
-				// SQLite and PostgreSQL plugins behave differently, it initially tries the code for SQLite and in case
-				// of an error it executes the PostgreSQL one
-				try {
-					fieldDate = row->getColumn("date(history_ts)")->getString();
-					retrieved = true;
-
-				} catch (...) {
-					retrieved = false;
-				}
-				if (! retrieved)
-				{
-					fieldDate = row->getColumn("date")->getString();
-				}
-
-				fieldYear = strtol(fieldDate.substr(0, 4).c_str(), nullptr, 10);
-				fieldKey = row->getColumn("key")->getString();
-
-				// SQLite and PostgreSQL plugins behave differently, it initially tries the code for SQLite and in case
-				// of an error it executes the PostgreSQL one
-				try {
-					fieldValue = row->getColumn("sum_value")->getInteger();
-					retrieved = true;
-				} catch (...) {
-					retrieved = false;
-				}
-				if (! retrieved)
-				{
-					fieldValue = strtol(row->getColumn("sum_value")->getString(), nullptr, 10);
-				}
+				fieldValue = strtol(sum.getString(i), nullptr, 10);
+			}
+			else
+			{
+				fieldValue = sum.getInteger(i);
+			}
 
-				InsertValues values;
-				values.push_back(InsertValue("year", fieldYear) );
-				values.push_back(InsertValue("day", fieldDate) );
-				values.push_back(InsertValue("key", fieldKey) );
-				values.push_back(InsertValue("value", fieldValue) );
+			InsertValues values;
+			values.push_back(InsertValue("year", fieldYear) );
+			values.push_back(InsertValue("day", fieldDate) );
+			values.push_back(InsertValue("key", fieldKey) );
+			values.push_back(InsertValue("value", fieldValue) );
 
-				m_logger->debug("%s - :%s: inserting :%ld: :%s: :%s: :%ld:  ", __FUNCTION__, tableDest.c_str()
-					, fieldYear
-					, fieldDate.c_str()
-					, fieldKey.c_str()
-					, fieldValue);
+			m_logger->debug("%s - :%s: inserting :%ld: :%s: :%s: :%ld:  ", __FUNCTION__, tableDest.c_str()
+				, fieldYear
+				, fieldDate.c_str()
+				, fieldKey.c_str()
+				, fieldValue);
 
-				affected = m_storage->insertTable(tableDest, values);
-				if (affected == -1)
-				{
-					raiseError ("Failure inserting rows into :%s: ", tableDest.c_str() );
-				}
+			affected = m_storage->insertTable(tableDest, values);
+			if (affected == -1)
+			{
+				raiseError ("Failure inserting rows into :%s: ", tableDest.c_str() );
 			}
-
-		} while (!data->isLastRow(item++));
+		}
 
 	} catch (const std::exception &e) {
 
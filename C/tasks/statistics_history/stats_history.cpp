@@ -59,6 +59,15 @@ void StatsHistory::run() const
 	if (m_dryRun)
 		return;
 
+	// Snapshot the statistics and roll them forward in a single
+	// operation within the storage service if the plugin supports it
+	int n_keys = getStorageClient()->statisticsHistory();
+	if (n_keys >= 0)
+	{
+		getLogger()->debug("Statistics history updated for %d keys", n_keys);
+		return;
+	}
+
 	// Get the set of distinct statistics keys
 	Query query(new Returns("key"));
 	query.distinct();
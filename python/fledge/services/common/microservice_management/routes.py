@@ -71,6 +71,9 @@ def setup(app, obj, is_core=False):
         # Service token refresh
         app.router.add_route('POST', '/fledge/service/refresh_token', obj.refresh_token)
 
+        # Key for local verification of service tokens
+        app.router.add_route('GET', '/fledge/service/token_key', obj.token_key)
+
         app.router.add_route('GET', '/fledge/ACL/{acl_name}', obj.get_control_acl)
 
         # alerts
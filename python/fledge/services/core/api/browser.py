@@ -58,7 +58,7 @@ __version__ = "${VERSION}"
 __DEFAULT_LIMIT = 20
 __DEFAULT_OFFSET = 0
 
-DATAPOINT_TYPES = ['__DPIMAGE', '__DATABUFFER']
+DATAPOINT_TYPES = ['__DPIMAGE', '__DATABUFFER', '__BLOB']
 IMAGE_PLACEHOLDER = "Data removed for brevity"
 
 
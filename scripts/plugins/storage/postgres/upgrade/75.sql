@@ -0,0 +1,3 @@
+ALTER TABLE fledge.monitors ADD COLUMN p50 bigint;
+ALTER TABLE fledge.monitors ADD COLUMN p99 bigint;
+ALTER TABLE fledge.monitors ADD COLUMN p999 bigint;
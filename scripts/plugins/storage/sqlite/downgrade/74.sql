@@ -0,0 +1,3 @@
+ALTER TABLE fledge.monitors DROP COLUMN p50;
+ALTER TABLE fledge.monitors DROP COLUMN p99;
+ALTER TABLE fledge.monitors DROP COLUMN p999;
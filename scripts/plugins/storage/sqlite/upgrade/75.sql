@@ -0,0 +1,3 @@
+ALTER TABLE fledge.monitors ADD COLUMN p50 integer;
+ALTER TABLE fledge.monitors ADD COLUMN p99 integer;
+ALTER TABLE fledge.monitors ADD COLUMN p999 integer;
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <reading.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Microbenchmark of the serialisation of a block of readings into the
+ * payload of a reading append. The readings are serialised the way
+ * the storage client used to, a string per reading concatenated into
+ * an ostringstream, and into a single buffer using Reading::toJSON(string&).
+ * The heap allocations made on the calling thread are counted by
+ * replacing the global operator new, so these tests are built as a
+ * separate executable from the other common tests.
+ */
+
+#define BENCH_READINGS	10000
+
+static thread_local size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+	allocations++;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+static vector<Reading *> benchReadings()
+{
+	vector<Reading *> readings;
+	for (int i = 0; i < BENCH_READINGS; i++)
+	{
+		vector<Datapoint *> values;
+		DatapointValue l((long) i);
+		values.push_back(new Datapoint("count", l));
+		DatapointValue d(i * 0.25);
+		values.push_back(new Datapoint("temperature", d));
+		DatapointValue s(string("a \"quoted\" status"));
+		values.push_back(new Datapoint("status", s));
+		vector<double> a = { 1.0, 2.5, -3.0 };
+		DatapointValue av(a);
+		values.push_back(new Datapoint("vector", av));
+		Reading *reading = new Reading(string("pump"), values);
+		struct timeval tv = { 1547114463 + i / 100, (i * 997) % 1000000 };
+		reading->setUserTimestamp(tv);
+		reading->setTimestamp(tv);
+		readings.push_back(reading);
+	}
+	return readings;
+}
+
+static string concatenated(const vector<Reading *>& readings)
+{
+	ostringstream convert;
+	convert << "{ \"readings\" : [ ";
+	for (auto it = readings.cbegin(); it != readings.cend(); ++it)
+	{
+		if (it != readings.cbegin())
+			convert << ", ";
+		convert << (*it)->toJSON();
+	}
+	convert << " ] }";
+	return convert.str();
+}
+
+static string buffered(const vector<Reading *>& readings)
+{
+	string convert;
+	convert.reserve(256);
+	convert.append("{ \"readings\" : [ ");
+	for (auto it = readings.cbegin(); it != readings.cend(); ++it)
+	{
+		if (it != readings.cbegin())
+			convert.append(", ", 2);
+		size_t start = convert.size();
+		(*it)->toJSON(convert);
+		if (it == readings.cbegin())
+		{
+			size_t estimate = (convert.size() - start + 2) * readings.size();
+			convert.reserve(start + estimate + estimate / 8 + 8);
+		}
+	}
+	convert.append(" ] }");
+	return convert;
+}
+
+TEST(ReadingJSONBench, Allocations)
+{
+	vector<Reading *> readings = benchReadings();
+
+	size_t before = allocations;
+	auto start = steady_clock::now();
+	string expected = concatenated(readings);
+	double concatTime = duration<double, milli>(steady_clock::now() - start).count();
+	size_t concatAllocs = allocations - before;
+
+	before = allocations;
+	start = steady_clock::now();
+	string payload = buffered(readings);
+	double bufferTime = duration<double, milli>(steady_clock::now() - start).count();
+	size_t bufferAllocs = allocations - before;
+
+	ASSERT_EQ(payload, expected);
+	cout << "[ BENCH    ] per reading string: " << (double)concatAllocs / BENCH_READINGS
+		<< " allocations per reading, " << concatTime << "ms" << endl;
+	cout << "[ BENCH    ] single buffer:      " << (double)bufferAllocs / BENCH_READINGS
+		<< " allocations per reading, " << bufferTime << "ms" << endl;
+	ASSERT_LT(bufferAllocs, concatAllocs);
+
+	for (auto reading : readings)
+		delete reading;
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <base64databuffer.h>
+#include <base64dpimage.h>
+#include <base64.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Correctness tests and a microbenchmark of the base64 codec used
+ * for image and data buffer datapoints. The codec is compared with a
+ * byte at a time implementation for payloads of 64KB to 16MB.
+ */
+
+/**
+ * Byte at a time encoding, as used before the vectorised codec
+ */
+static string referenceEncode(const uint8_t *data, size_t length)
+{
+	string out;
+	out.reserve(base64EncodedLength(length));
+	size_t i;
+	for (i = 0; i + 3 <= length; i += 3)
+	{
+		out.push_back(encodingTable[data[i] >> 2]);
+		out.push_back(encodingTable[((data[i] & 0x3) << 4) | (data[i + 1] >> 4)]);
+		out.push_back(encodingTable[((data[i + 1] & 0xF) << 2) | (data[i + 2] >> 6)]);
+		out.push_back(encodingTable[data[i + 2] & 0x3F]);
+	}
+	if (i < length)
+	{
+		out.push_back(encodingTable[data[i] >> 2]);
+		if (i + 1 == length)
+		{
+			out.push_back(encodingTable[(data[i] & 0x3) << 4]);
+			out.push_back('=');
+		}
+		else
+		{
+			out.push_back(encodingTable[((data[i] & 0x3) << 4) | (data[i + 1] >> 4)]);
+			out.push_back(encodingTable[(data[i + 1] & 0xF) << 2]);
+		}
+		out.push_back('=');
+	}
+	return out;
+}
+
+/**
+ * Byte at a time decoding, as used before the vectorised codec
+ */
+static void referenceDecode(const string& encoded, uint8_t *out, size_t maxLength)
+{
+	for (size_t i = 0, j = 0; i + 4 <= encoded.length() && j < maxLength; i += 4)
+	{
+		uint32_t triple = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			char c = encoded[i + k];
+			triple = (triple << 6) + (c == '=' ? 0 : decodingTable[(uint8_t)c]);
+		}
+		out[j++] = (triple >> 16) & 0xFF;
+		if (j < maxLength)
+			out[j++] = (triple >> 8) & 0xFF;
+		if (j < maxLength)
+			out[j++] = triple & 0xFF;
+	}
+}
+
+static vector<uint8_t> payload(size_t length)
+{
+	vector<uint8_t> data(length);
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < length; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (seed >> 16) & 0xFF;
+	}
+	return data;
+}
+
+TEST(Base64Test, KnownValues)
+{
+	char out[16];
+	ASSERT_EQ(base64Encode("Man", 3, out), 4);
+	ASSERT_EQ(string(out, 4), "TWFu");
+	ASSERT_EQ(base64Encode("Ma", 2, out), 4);
+	ASSERT_EQ(string(out, 4), "TWE=");
+	ASSERT_EQ(base64Encode("M", 1, out), 4);
+	ASSERT_EQ(string(out, 4), "TQ==");
+	ASSERT_EQ(base64Encode("", 0, out), 0);
+}
+
+TEST(Base64Test, MatchesReference)
+{
+	for (size_t length = 0; length < 200; length++)
+	{
+		vector<uint8_t> data = payload(length);
+		string expected = referenceEncode(data.data(), length);
+		string encoded(base64EncodedLength(length), ' ');
+		ASSERT_EQ(base64Encode(data.data(), length, &encoded[0]), expected.length());
+		ASSERT_EQ(encoded, expected);
+
+		vector<uint8_t> decoded(length + 1, 0xAA);
+		base64Decode(encoded.c_str(), encoded.length(), decoded.data(), length);
+		ASSERT_EQ(memcmp(decoded.data(), data.data(), length), 0);
+		// Nothing is written beyond the output buffer
+		ASSERT_EQ(decoded[length], 0xAA);
+	}
+}
+
+TEST(Base64Test, InvalidCharacters)
+{
+	vector<uint8_t> data = payload(300);
+	string encoded = referenceEncode(data.data(), data.size());
+	encoded[5] = '#';
+	encoded[70] = '\x90';
+	encoded[150] = '=';
+	vector<uint8_t> expected(data.size()), decoded(data.size());
+	referenceDecode(encoded, expected.data(), expected.size());
+	base64Decode(encoded.c_str(), encoded.length(), decoded.data(), decoded.size());
+	ASSERT_EQ(memcmp(decoded.data(), expected.data(), decoded.size()), 0);
+}
+
+TEST(Base64Test, DataBufferItemSize)
+{
+	DataBuffer *buffer = new DataBuffer(sizeof(uint32_t), 25);
+	uint32_t *values = (uint32_t *)buffer->getData();
+	for (int i = 0; i < 25; i++)
+		values[i] = i * 0x01010101;
+	string encoded = ((Base64DataBuffer *)buffer)->encode();
+	ASSERT_EQ(encoded[0], '4');
+	Base64DataBuffer decoded(encoded);
+	ASSERT_EQ(decoded.getItemSize(), sizeof(uint32_t));
+	ASSERT_EQ(decoded.getItemCount(), 25);
+	ASSERT_EQ(memcmp(decoded.getData(), values, 25 * sizeof(uint32_t)), 0);
+	delete buffer;
+}
+
+static void benchCodec(size_t length)
+{
+	vector<uint8_t> data = payload(length);
+
+	auto start = steady_clock::now();
+	string expected = referenceEncode(data.data(), length);
+	auto refEncode = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	string encoded(base64EncodedLength(length), ' ');
+	start = steady_clock::now();
+	base64Encode(data.data(), length, &encoded[0]);
+	auto encode = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	vector<uint8_t> decoded(length);
+	start = steady_clock::now();
+	referenceDecode(encoded, decoded.data(), length);
+	auto refDecode = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	start = steady_clock::now();
+	base64Decode(encoded.c_str(), encoded.length(), decoded.data(), length);
+	auto decode = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	cout << "[ BENCH    ] base64 " << base64Implementation() << " " << length / 1024 << "KB: encode "
+		<< refEncode << "us -> " << encode << "us, decode "
+		<< refDecode << "us -> " << decode << "us" << endl;
+
+	ASSERT_EQ(encoded, expected);
+	ASSERT_EQ(memcmp(decoded.data(), data.data(), length), 0);
+}
+
+TEST(Base64Bench, Size64KB)
+{
+	benchCodec(64 * 1024);
+}
+
+TEST(Base64Bench, Size1MB)
+{
+	benchCodec(1024 * 1024);
+}
+
+TEST(Base64Bench, Size16MB)
+{
+	// Only benchmark the largest payload on the first iteration
+	static bool done = false;
+	if (done)
+		GTEST_SKIP();
+	done = true;
+	benchCodec(16 * 1024 * 1024);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <bearer_token.h>
+#include <string>
+
+using namespace std;
+
+static const string tokenKey = "f0gl@mp+Fl3dG3";
+
+// Signed with tokenKey, expires in 2100
+static const string validToken = "eyJhbGciOiJIUzUxMiIsInR5cCI6IkpXVCJ9."
+	"eyJhdWQiOiJTb3V0aGJvdW5kIiwic3ViIjoic2luZSIsImlzcyI6IkZsZWRnZSIsImV4cCI6NDEwMjQ0NDgwMH0."
+	"9Yt8x_GQK0acMaOScNv8AmA8mIJJFNxv4-42dmAvifXd5uPucH2Oj1sY_rS9zxMzJSd787Na7XdtkkO2V2C-pw";
+
+// Signed with tokenKey, expired in 2001
+static const string expiredToken = "eyJhbGciOiJIUzUxMiIsInR5cCI6IkpXVCJ9."
+	"eyJhdWQiOiJTb3V0aGJvdW5kIiwic3ViIjoic2luZSIsImlzcyI6IkZsZWRnZSIsImV4cCI6MTAwMDAwMDAwMH0."
+	"dA4FIO3rFuD0gY_cOo0ii5W7M8pbfPBGMQo9jH1Pm-W32uaGgc0rGHWMvf50uEoRJtS6Ci4GEPFHISXDDYFPnQ";
+
+TEST(BearerTokenTest, VerifyLocal)
+{
+	string token = validToken;
+	BearerToken bearer(token);
+	ASSERT_TRUE(bearer.verifyLocal(tokenKey));
+	ASSERT_EQ(bearer.getAudience(), "Southbound");
+	ASSERT_EQ(bearer.getSubject(), "sine");
+	ASSERT_EQ(bearer.getIssuer(), "Fledge");
+	ASSERT_EQ(bearer.getExpiration(), 4102444800UL);
+}
+
+TEST(BearerTokenTest, WrongKey)
+{
+	string token = validToken;
+	BearerToken bearer(token);
+	ASSERT_FALSE(bearer.verifyLocal("another key"));
+	ASSERT_FALSE(bearer.verifyLocal(""));
+}
+
+TEST(BearerTokenTest, Tampered)
+{
+	// Change the subject claim without signing the token again
+	string token = validToken;
+	size_t pos = token.find("c2luZ");
+	token.replace(pos, 5, "c2lue");
+	BearerToken bearer(token);
+	ASSERT_FALSE(bearer.verifyLocal(tokenKey));
+
+	string truncated = validToken.substr(0, validToken.rfind('.'));
+	BearerToken bearer2(truncated);
+	ASSERT_FALSE(bearer2.verifyLocal(tokenKey));
+}
+
+TEST(BearerTokenTest, Expired)
+{
+	string token = expiredToken;
+	BearerToken bearer(token);
+	ASSERT_FALSE(bearer.verifyLocal(tokenKey));
+}
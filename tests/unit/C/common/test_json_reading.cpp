@@ -1,8 +1,10 @@
 
 #include <gtest/gtest.h>
 #include <reading_set.h>
+#include <blob_reference.h>
 #include <string.h>
 #include <string>
+#include <stdexcept>
 #include <rapidjson/document.h>
 
 using namespace std;
@@ -46,3 +48,88 @@ TEST(JSONReadingTest, CopyReading)
 	// Check reading id is the same: copy is ok
 	ASSERT_EQ(reading.getId(), copyReading.getId());
 }
+
+const char *blobData = "{ \"id\": 17652, \"asset_code\": \"camera\", "
+            "\"reading\": { \"buffer\": \"__BLOB:DATABUFFER:1,8:"
+	    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\" }, "
+            "\"user_ts\": \"2017-09-21 15:00:08.532958\", "
+            "\"ts\": \"2017-09-22 14:47:18.872708\" }";
+
+static int fetches = 0;
+
+static bool testFetch(void *, const string&, void *buffer, size_t length)
+{
+	fetches++;
+	memset(buffer, 'x', length);
+	return true;
+}
+
+TEST(JSONReadingTest, BlobReference)
+{
+	Document doc;
+	doc.Parse(blobData);
+	JSONReading reading(doc);
+	Datapoint *dp = reading.getDatapoint("buffer");
+	ASSERT_NE(dp, (Datapoint *)NULL);
+	DatapointValue& value = dp->getData();
+	ASSERT_EQ(value.getType(), DatapointValue::T_DATABUFFER);
+	DataBuffer *buffer = value.getDataBuffer();
+	ASSERT_EQ(buffer->getItemSize(), 1);
+	ASSERT_EQ(buffer->getItemCount(), 8);
+
+	// The reference is passed on to the storage service without the data being fetched
+	fetches = 0;
+	BlobReference::registerFetch(testFetch, &fetches);
+	Reading copyReading(reading);
+	string json;
+	{
+		BlobReference::Scope references;
+		json = copyReading.toJSON();
+	}
+	ASSERT_NE(json.find("__BLOB:DATABUFFER:1,8:0123456789abcdef"), string::npos);
+	ASSERT_EQ(fetches, 0);
+
+	// Accessing the data fetches it and discards the reference
+	char *data = (char *)buffer->getData();
+	ASSERT_EQ(fetches, 1);
+	ASSERT_EQ(data[7], 'x');
+	ASSERT_TRUE(buffer->getBlob().empty());
+	json = reading.toJSON();
+	ASSERT_NE(json.find("__DATABUFFER:"), string::npos);
+
+	// Any other serialisation fetches the data
+	json = copyReading.toJSON();
+	ASSERT_EQ(fetches, 2);
+	ASSERT_EQ(json.find(BLOB_PREFIX), string::npos);
+	ASSERT_NE(json.find("__DATABUFFER:"), string::npos);
+	BlobReference::unregisterFetch(&fetches);
+}
+
+static bool failFetch(void *, const string&, void *, size_t)
+{
+	return false;
+}
+
+TEST(JSONReadingTest, BlobFetchFailure)
+{
+	Document doc;
+	doc.Parse(blobData);
+	JSONReading reading(doc);
+	DataBuffer *buffer = reading.getDatapoint("buffer")->getData().getDataBuffer();
+
+	// The data is not replaced by an empty buffer if it can not be fetched
+	int failed;
+	BlobReference::registerFetch(failFetch, &failed);
+	ASSERT_THROW(buffer->getData(), runtime_error);
+	ASSERT_FALSE(buffer->getBlob().empty());
+	ASSERT_THROW(reading.toJSON(), runtime_error);
+
+	// A second storage client is used if the first can not fetch the blob
+	fetches = 0;
+	BlobReference::registerFetch(testFetch, &fetches);
+	char *data = (char *)buffer->getData();
+	ASSERT_EQ(fetches, 1);
+	ASSERT_EQ(data[0], 'x');
+	BlobReference::unregisterFetch(&fetches);
+	BlobReference::unregisterFetch(&failed);
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <logger.h>
+#include <thread>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <syslog.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static atomic<int> captureRun(0);
+
+/**
+ * Capture the messages written to syslog by also writing them to
+ * stderr, which is redirected to a pipe. The pipe is not read until
+ * read() is called, so the logger thread blocks once the pipe is full.
+ */
+class CaptureLog {
+	public:
+		CaptureLog() : m_reader(NULL)
+		{
+			Logger::getLogger()->flush();
+			m_run = ++captureRun;
+			fflush(stderr);
+			m_stderr = dup(STDERR_FILENO);
+			if (pipe(m_pipe) == 0)
+			{
+				dup2(m_pipe[1], STDERR_FILENO);
+				close(m_pipe[1]);
+			}
+			// Not LOG_CONS, without a syslog daemon the console may block
+			openlog("Fledge fledge", LOG_PID|LOG_PERROR, LOG_USER);
+		};
+		~CaptureLog()
+		{
+			finish();
+		};
+		void	read()
+		{
+			if (m_reader)
+				return;
+			m_reader = new thread([this]() {
+				char buf[4096];
+				ssize_t n;
+				while ((n = ::read(m_pipe[0], buf, sizeof(buf))) > 0)
+					m_output.append(buf, n);
+			});
+		};
+		/**
+		 * Write the queued messages and return all that were captured
+		 */
+		const string&	finish()
+		{
+			if (m_stderr < 0)
+				return m_output;
+			read();
+			Logger::getLogger()->flush();
+			openlog("Fledge fledge", LOG_PID|LOG_CONS, LOG_USER);
+			dup2(m_stderr, STDERR_FILENO);
+			close(m_stderr);
+			m_stderr = -1;
+			m_reader->join();
+			delete m_reader;
+			close(m_pipe[0]);
+			return m_output;
+		};
+		/**
+		 * A message text that is unique to this capture
+		 */
+		string	unique(const string& text)
+		{
+			return text + " " + to_string(m_run);
+		};
+	private:
+		int		m_pipe[2];
+		int		m_stderr;
+		int		m_run;
+		thread		*m_reader;
+		string		m_output;
+};
+
+static int occurrences(const string& output, const string& text)
+{
+	int count = 0;
+	for (size_t pos = output.find(text); pos != string::npos; pos = output.find(text, pos + 1))
+		count++;
+	return count;
+}
+
+/*
+ * Logging from several threads at once must not block the threads
+ * that log, messages that do not fit in the buffer are discarded.
+ */
+TEST(LoggerTest, ConcurrentLogging)
+{
+	Logger *logger = Logger::getLogger();
+	auto start = steady_clock::now();
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(thread([logger, t]() {
+			for (int i = 0; i < 1000; i++)
+			{
+				logger->warn("Logger unit test thread %d", t);
+			}
+		}));
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	logger->flush();
+	auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+	ASSERT_LT(elapsed, 5000);
+}
+
+TEST(LoggerTest, BelowMinimumLevel)
+{
+	Logger *logger = Logger::getLogger();
+	logger->setMinLevel("error");
+	ASSERT_EQ(logger->getMinLevel(), "error");
+	for (int i = 0; i < 1000; i++)
+	{
+		logger->debug("Logger unit test %d", i);
+		logger->info("Logger unit test %d", i);
+		logger->warn("Logger unit test %d", i);
+	}
+	logger->setMinLevel("warning");
+	ASSERT_EQ(logger->getMinLevel(), "warning");
+	logger->flush();
+}
+
+TEST(LoggerTest, MessageOrder)
+{
+	Logger *logger = Logger::getLogger();
+	CaptureLog capture;
+	capture.read();
+	string text = capture.unique("Logger order test");
+	for (int i = 0; i < 100; i++)
+	{
+		logger->warn("%s message %d.", text.c_str(), i);
+	}
+	const string& output = capture.finish();
+	size_t last = 0;
+	for (int i = 0; i < 100; i++)
+	{
+		size_t pos = output.find(text + " message " + to_string(i) + ".");
+		ASSERT_NE(pos, string::npos);
+		ASSERT_GE(pos, last);
+		last = pos;
+	}
+}
+
+TEST(LoggerTest, RepeatSuppressed)
+{
+	Logger *logger = Logger::getLogger();
+	CaptureLog capture;
+	capture.read();
+	string text = capture.unique("Logger repeat test");
+	for (int i = 0; i < 50; i++)
+	{
+		logger->warn("%s", text.c_str());
+	}
+	logger->warn("%s done", text.c_str());
+	const string& output = capture.finish();
+
+	// The message is written once, followed by the count of repeats
+	ASSERT_EQ(occurrences(output, "WARNING: " + text + "\n"), 1);
+	ASSERT_EQ(occurrences(output, "WARNING: " + text + " (repeated 49 times)"), 1);
+	ASSERT_LT(output.find(text + " (repeated"), output.find(text + " done"));
+}
+
+TEST(LoggerTest, OverflowDiscarded)
+{
+	Logger *logger = Logger::getLogger();
+	CaptureLog capture;
+	string text = capture.unique("Logger overflow test");
+	string padding(800, 'x');
+	const int total = 1000;
+	for (int i = 0; i < total; i++)
+	{
+		logger->warn("%s message %d %s", text.c_str(), i, padding.c_str());
+	}
+	const string& output = capture.finish();
+
+	int written = occurrences(output, text + " message ");
+	string report = "log messages were discarded as the log buffer was full";
+	size_t pos = output.find(report);
+	ASSERT_NE(pos, string::npos);
+	size_t start = output.rfind("WARNING: ", pos);
+	ASSERT_NE(start, string::npos);
+	unsigned long discarded = strtoul(output.c_str() + start + 9, NULL, 10);
+	ASSERT_GT(discarded, 0UL);
+	ASSERT_LT(written, total);
+	// Other tests may also have had messages discarded
+	ASSERT_GE(written + discarded, (unsigned long)total);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <perfmonitors.h>
+#include <rapidjson/document.h>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace rapidjson;
+
+TEST(PerfMonTest, BucketIndex)
+{
+	for (unsigned long i = 0; i < PERFMON_EXACT; i++)
+	{
+		ASSERT_EQ(PerfMon::bucketIndex(i), (int)i);
+		ASSERT_EQ(PerfMon::bucketValue((int)i), i);
+	}
+	int last = 0;
+	for (unsigned long value = 1; value < 10000000; value += value / 7 + 1)
+	{
+		int index = PerfMon::bucketIndex(value);
+		ASSERT_GE(index, last);
+		last = index;
+		unsigned long estimate = PerfMon::bucketValue(index);
+		unsigned long error = estimate > value ? estimate - value : value - estimate;
+		ASSERT_LE(error * 16, value);
+	}
+	ASSERT_EQ(PerfMon::bucketIndex(ULONG_MAX), PERFMON_BUCKETS - 1);
+}
+
+TEST(PerfMonTest, Percentiles)
+{
+	PerfMon monitor("test");
+	for (long i = 1; i <= 1000; i++)
+	{
+		monitor.addValue(i);
+	}
+	InsertValues values;
+	ASSERT_EQ(monitor.getValues(values), 1000);
+
+	Document doc;
+	doc.Parse(values.toJSON().c_str());
+	ASSERT_FALSE(doc.HasParseError());
+	ASSERT_EQ(doc["minimum"].GetInt64(), 1);
+	ASSERT_EQ(doc["maximum"].GetInt64(), 1000);
+	ASSERT_EQ(doc["average"].GetInt64(), 500);
+	ASSERT_EQ(doc["samples"].GetInt64(), 1000);
+	ASSERT_NEAR(doc["p50"].GetInt64(), 500, 500 / 16);
+	ASSERT_NEAR(doc["p99"].GetInt64(), 990, 990 / 16);
+	ASSERT_NEAR(doc["p999"].GetInt64(), 999, 999 / 16);
+
+	// The values are reset once they have been returned
+	InsertValues empty;
+	ASSERT_EQ(monitor.getValues(empty), 0);
+}
+
+TEST(PerfMonTest, MultipleThreads)
+{
+	PerfMon monitor("test");
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(thread([&monitor]() {
+			for (long i = 0; i < 1000; i++)
+			{
+				monitor.addValue(10);
+			}
+		}));
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	InsertValues values;
+	ASSERT_EQ(monitor.getValues(values), 4000);
+
+	Document doc;
+	doc.Parse(values.toJSON().c_str());
+	ASSERT_EQ(doc["minimum"].GetInt64(), 10);
+	ASSERT_EQ(doc["maximum"].GetInt64(), 10);
+	ASSERT_EQ(doc["p99"].GetInt64(), 10);
+}
+
+TEST(PerfMonTest, ThreadExit)
+{
+	PerfMon monitor("test");
+	thread first([&monitor]() { monitor.addValue(5); });
+	first.join();
+	thread second([&monitor]() { monitor.addValue(50); });
+	second.join();
+
+	// The values of the threads survive the threads exiting
+	InsertValues values;
+	ASSERT_EQ(monitor.getValues(values), 2);
+	Document doc;
+	doc.Parse(values.toJSON().c_str());
+	ASSERT_EQ(doc["minimum"].GetInt64(), 5);
+	ASSERT_EQ(doc["maximum"].GetInt64(), 50);
+
+	InsertValues empty;
+	ASSERT_EQ(monitor.getValues(empty), 0);
+}
+
+TEST(PerfMonTest, MonitorDeletedFirst)
+{
+	// A thread that outlives a monitor it has added values to
+	PerfMon *monitor = new PerfMon("test");
+	mutex mtx;
+	condition_variable cv;
+	bool added = false, deleted = false;
+	thread worker([&]() {
+		monitor->addValue(1);
+		unique_lock<mutex> lock(mtx);
+		added = true;
+		cv.notify_all();
+		cv.wait(lock, [&deleted]() { return deleted; });
+	});
+	{
+		unique_lock<mutex> lock(mtx);
+		cv.wait(lock, [&added]() { return added; });
+		delete monitor;
+		deleted = true;
+		cv.notify_all();
+	}
+	worker.join();
+}
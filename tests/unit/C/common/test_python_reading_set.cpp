@@ -12,6 +12,21 @@ namespace {
 const char *script = R"(
 def count(set):
     return len(set)
+
+def block_count(blocks):
+    return len(blocks)
+
+def scale(blocks):
+    for block in blocks:
+        columns = block["columns"]
+        columns["long"] = columns["long"] * 2
+        columns["double"] = columns["double"] * 0.5
+    return blocks
+
+def int_name(blocks):
+    for block in blocks:
+        block["columns"][7] = block["columns"]["long"]
+    return blocks
 )";
 
 class  PythonReadingSetTest : public testing::Test {
@@ -141,4 +156,96 @@ TEST_F(PythonReadingSetTest, MultipleReadings)
 	PyGILState_Release(state);
 	EXPECT_EQ(rval, 3);
 }
+
+TEST_F(PythonReadingSetTest, ColumnBlocks)
+{
+	vector<Reading *> *readings = new vector<Reading *>;
+	long i = 1234;
+	DatapointValue value(i);
+	DatapointValue str("text");
+	readings->push_back(new Reading("test", new Datapoint("long", value)));
+	readings->push_back(new Reading("test", new Datapoint("long", value)));
+	readings->push_back(new Reading("other", new Datapoint("long", value)));
+	readings->push_back(new Reading("other", new Datapoint("string", str)));
+	ReadingSet set(readings);
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyObject *pySet = ((PythonReadingSet *)(&set))->toColumns();
+	EXPECT_TRUE(PythonReadingSet::isColumns(pySet));
+	PyObject *obj = callPythonFunc("block_count", pySet);
+	long rval = PyLong_AsLong(obj);
+	PyGILState_Release(state);
+	EXPECT_EQ(rval, 3);
+}
+
+TEST_F(PythonReadingSetTest, ColumnRoundTrip)
+{
+	vector<Reading *> *readings = new vector<Reading *>;
+	for (long i = 0; i < 10; i++)
+	{
+		vector<Datapoint *> values;
+		DatapointValue lval(i);
+		values.push_back(new Datapoint("long", lval));
+		DatapointValue dval((double)i);
+		values.push_back(new Datapoint("double", dval));
+		Reading *reading = new Reading("test", values);
+		struct timeval tv;
+		tv.tv_sec = 1700000000 + i;
+		tv.tv_usec = 123456;
+		reading->setUserTimestamp(tv);
+		readings->push_back(reading);
+	}
+	ReadingSet set(readings);
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyObject *pySet = ((PythonReadingSet *)(&set))->toColumns();
+	PyObject *obj = callPythonFunc("scale", pySet);
+	ASSERT_NE(obj, (PyObject *)NULL);
+	PythonReadingSet result(obj);
+	PyGILState_Release(state);
+	ASSERT_EQ(result.getCount(), 10);
+	const vector<Reading *>& out = result.getAllReadings();
+	for (long i = 0; i < 10; i++)
+	{
+		EXPECT_STREQ(out[i]->getAssetName().c_str(), "test");
+		Datapoint *dp = out[i]->getDatapoint("long");
+		ASSERT_NE(dp, (Datapoint *)NULL);
+		EXPECT_EQ(dp->getData().getType(), DatapointValue::dataTagType::T_INTEGER);
+		EXPECT_EQ(dp->getData().toInt(), i * 2);
+		dp = out[i]->getDatapoint("double");
+		ASSERT_NE(dp, (Datapoint *)NULL);
+		EXPECT_EQ(dp->getData().getType(), DatapointValue::dataTagType::T_FLOAT);
+		EXPECT_DOUBLE_EQ(dp->getData().toDouble(), i * 0.5);
+		struct timeval tv;
+		out[i]->getUserTimestamp(&tv);
+		EXPECT_EQ(tv.tv_sec, 1700000000 + i);
+		EXPECT_EQ(tv.tv_usec, 123456);
+	}
+}
+
+TEST_F(PythonReadingSetTest, ColumnNameNotString)
+{
+	vector<Reading *> *readings = new vector<Reading *>;
+	for (long i = 0; i < 3; i++)
+	{
+		DatapointValue lval(i);
+		readings->push_back(new Reading("test", new Datapoint("long", lval)));
+	}
+	ReadingSet set(readings);
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyObject *pySet = ((PythonReadingSet *)(&set))->toColumns();
+	PyObject *obj = callPythonFunc("int_name", pySet);
+	ASSERT_NE(obj, (PyObject *)NULL);
+	PythonReadingSet result(obj);
+	// The column whose name is not a string is skipped
+	EXPECT_FALSE(PyErr_Occurred());
+	PyGILState_Release(state);
+	ASSERT_EQ(result.getCount(), 3);
+	const vector<Reading *>& out = result.getAllReadings();
+	for (long i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(out[i]->getDatapointCount(), 1U);
+		Datapoint *dp = out[i]->getDatapoint("long");
+		ASSERT_NE(dp, (Datapoint *)NULL);
+		EXPECT_EQ(dp->getData().toInt(), i);
+	}
+}
 }
@@ -170,3 +170,34 @@ TEST(ReadingTest, ISO8601MS)
 	string datetime = reading.getAssetDateUserTime(Reading::FMT_ISO8601MS);
 	ASSERT_EQ(datetime.compare("2019-01-10 10:01:03.123456 +0000"), 0);
 }
+
+TEST(ReadingTest, MoveConstructor)
+{
+	DatapointValue value((long) 10);
+	Reading reading(string("test1"), new Datapoint("x", value));
+	reading.setUserTimestamp("2019-01-10 10:01:03.123456+0:00");
+	Datapoint *dp = reading.getDatapoint("x");
+	Reading moved(std::move(reading));
+	ASSERT_EQ(reading.getDatapointCount(), 0);
+	ASSERT_EQ(moved.getDatapointCount(), 1);
+	ASSERT_EQ(moved.getDatapoint("x"), dp);
+	ASSERT_EQ(moved.getAssetName().compare("test1"), 0);
+	ASSERT_EQ(moved.getAssetDateUserTime(Reading::FMT_DEFAULT).compare("2019-01-10 10:01:03.123456"), 0);
+}
+
+TEST(ReadingTest, AppendJSONMatchesString)
+{
+	vector<Datapoint *> values;
+	DatapointValue l((long) 42);
+	values.push_back(new Datapoint("count", l));
+	DatapointValue s(string("say \"hi\""));
+	values.push_back(new Datapoint("greeting", s));
+	Reading reading(string("asset \"one\""), values);
+
+	string buffer = "prefix:";
+	reading.toJSON(buffer);
+	ASSERT_EQ(buffer, "prefix:" + reading.toJSON());
+	buffer.clear();
+	reading.toJSON(buffer, true);
+	ASSERT_EQ(buffer, reading.toJSON(true));
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <reading.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Microbenchmark of the per-second formatted timestamp cache used by
+ * Reading::getAssetDateUserTime. A block of readings that mostly share
+ * the same second is formatted using the cached prefix and compared
+ * with formatting every timestamp with gmtime_r and strftime.
+ */
+
+#define BENCH_READINGS	10000
+#define BENCH_SECONDS	5
+
+static vector<Reading *> benchReadings()
+{
+	vector<Reading *> readings;
+	for (int i = 0; i < BENCH_READINGS; i++)
+	{
+		DatapointValue value((long) i);
+		Reading *reading = new Reading(string("bench"), new Datapoint("x", value));
+		struct timeval tv;
+		tv.tv_sec = 1547114463 + (i * BENCH_SECONDS) / BENCH_READINGS;
+		tv.tv_usec = (i * 997) % 1000000;
+		reading->setUserTimestamp(tv);
+		readings.push_back(reading);
+	}
+	return readings;
+}
+
+/**
+ * Format a timestamp without any caching, in the way the timestamp
+ * would be formatted for every reading without the cache
+ */
+static string uncachedFormat(const Reading *reading, Reading::readingTimeFormat fmt)
+{
+	static const char *formats[] = {
+		DEFAULT_DATE_TIME_FORMAT,
+		COMBINED_DATE_STANDARD_FORMAT,
+		ISO8601_DATE_TIME_FORMAT,
+		ISO8601_DATE_TIME_FORMAT
+	};
+	char date_time[DATE_TIME_BUFFER_LEN];
+	char assetTime[DATE_TIME_BUFFER_LEN + 20];
+	struct tm timeinfo;
+	time_t sec = (time_t)reading->getUserTimestamp();
+	gmtime_r(&sec, &timeinfo);
+	strftime(date_time, sizeof(date_time), formats[fmt], &timeinfo);
+	if (fmt == Reading::FMT_ISO8601)
+	{
+		return string(date_time);
+	}
+	struct timeval tv;
+	const_cast<Reading *>(reading)->getUserTimestamp(&tv);
+	if (fmt == Reading::FMT_ISO8601MS)
+	{
+		date_time[19] = 0;
+		snprintf(assetTime, sizeof(assetTime), "%s.%06lu +0000", date_time, (unsigned long)tv.tv_usec);
+	}
+	else
+	{
+		snprintf(assetTime, sizeof(assetTime), "%s.%06lu", date_time, (unsigned long)tv.tv_usec);
+	}
+	return string(assetTime);
+}
+
+static void benchFormat(Reading::readingTimeFormat fmt, const char *name)
+{
+	vector<Reading *> readings = benchReadings();
+	size_t total = 0;
+
+	auto start = steady_clock::now();
+	for (auto reading : readings)
+	{
+		total += uncachedFormat(reading, fmt).length();
+	}
+	auto uncached = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	start = steady_clock::now();
+	for (auto reading : readings)
+	{
+		total += reading->getAssetDateUserTime(fmt).length();
+	}
+	auto cached = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+	cout << "[ BENCH    ] " << name << ": " << BENCH_READINGS << " timestamps, uncached "
+		<< uncached << "us, cached " << cached << "us" << endl;
+
+	for (auto reading : readings)
+	{
+		ASSERT_EQ(reading->getAssetDateUserTime(fmt), uncachedFormat(reading, fmt));
+		delete reading;
+	}
+	ASSERT_GT(total, 0);
+}
+
+TEST(ReadingDateTimeBench, FMTDEFAULT)
+{
+	benchFormat(Reading::FMT_DEFAULT, "FMT_DEFAULT");
+}
+
+TEST(ReadingDateTimeBench, ISO8601)
+{
+	benchFormat(Reading::FMT_ISO8601, "FMT_ISO8601");
+}
+
+TEST(ReadingDateTimeBench, ISO8601MS)
+{
+	benchFormat(Reading::FMT_ISO8601MS, "FMT_ISO8601MS");
+}
+
+TEST(ReadingDateTimeBench, FormatsDoNotShareCache)
+{
+	DatapointValue value((long) 10);
+	Reading reading(string("test1"), new Datapoint("x", value));
+	reading.setUserTimestamp("2019-01-10 10:01:03.123456+0:00");
+	ASSERT_EQ(reading.getAssetDateUserTime(Reading::FMT_DEFAULT), "2019-01-10 10:01:03.123456");
+	ASSERT_EQ(reading.getAssetDateUserTime(Reading::FMT_STANDARD), "2019-01-10T10:01:03.123456");
+	ASSERT_EQ(reading.getAssetDateUserTime(Reading::FMT_ISO8601), "2019-01-10 10:01:03 +0000");
+	ASSERT_EQ(reading.getAssetDateUserTime(Reading::FMT_DEFAULT), "2019-01-10 10:01:03.123456");
+}
+
+TEST(ReadingDateTimeBench, ThreadsDoNotShareCache)
+{
+	string results[2];
+	auto worker = [&results](int idx, const char *ts) {
+		DatapointValue value((long) idx);
+		Reading reading(string("test1"), new Datapoint("x", value));
+		reading.setUserTimestamp(ts);
+		for (int i = 0; i < 1000; i++)
+		{
+			results[idx] = reading.getAssetDateUserTime(Reading::FMT_DEFAULT);
+		}
+	};
+	thread t1(worker, 0, "2019-01-10 10:01:03.000001+0:00");
+	thread t2(worker, 1, "2020-06-11 11:02:04.000002+0:00");
+	t1.join();
+	t2.join();
+	ASSERT_EQ(results[0], "2019-01-10 10:01:03.000001");
+	ASSERT_EQ(results[1], "2020-06-11 11:02:04.000002");
+}
@@ -3,6 +3,8 @@
 #include <string.h>
 #include <string>
 #include <rapidjson/document.h>
+#include <sys/time.h>
+#include <reading_stream.h>
 
 using namespace std;
 using namespace rapidjson;
@@ -60,3 +62,121 @@ TEST(ReadingSet, NotificationIndex)
 	ASSERT_NE(json.find(string("\"readkey\" : ")), 0);
 	ASSERT_NE(json.find(string("\"user_ts\" : \"2017-09-22 14:47:18.872708\"")), 0);
 }
+
+/**
+ * Append a record to a binary block of readings
+ */
+static void appendBinaryReading(string& block, uint64_t id, const char *asset,
+		time_t userSec, long userUsec, time_t sec, long usec, const char *payload)
+{
+	RDSFetchReading record;
+	memset(&record, 0, sizeof(record));
+	record.id = id;
+	record.userTs.tv_sec = userSec;
+	record.userTs.tv_usec = userUsec;
+	record.ts.tv_sec = sec;
+	record.ts.tv_usec = usec;
+	record.assetLength = strlen(asset) + 1;
+	record.payloadLength = strlen(payload) + 1;
+	block.append((const char *)&record, sizeof(record));
+	block.append(asset, record.assetLength);
+	block.append(payload, record.payloadLength);
+}
+
+static string binaryBlock()
+{
+	RDSFetchHeader header;
+	header.magic = RDS_FETCH_MAGIC;
+	header.count = 2;
+	string block((const char *)&header, sizeof(header));
+	// 2017-09-21 15:00:08.532958 and 2017-09-22 14:47:18.872708
+	appendBinaryReading(block, 1, "luxometer", 1506006008, 532958, 1506091638, 872708,
+			"{ \"lux\": 76204.524 }");
+	appendBinaryReading(block, 2, "luxometer", 1506006009, 329580, 1506091698, 727080,
+			"{ \"lux\": 76834.361 }");
+	return block;
+}
+
+TEST(ReadingSet, BinaryCount)
+{
+	string block = binaryBlock();
+	ReadingSet readingSet(block.data(), block.length());
+	ASSERT_EQ(2, readingSet.getCount());
+	ASSERT_EQ(2, readingSet.getLastId());
+}
+
+TEST(ReadingSet, BinaryMatchesJSON)
+{
+	string block = binaryBlock();
+	ReadingSet binarySet(block.data(), block.length());
+	ReadingSet jsonSet(input);
+	ASSERT_EQ(jsonSet.getCount(), binarySet.getCount());
+	for (unsigned int i = 0; i < jsonSet.getCount(); i++)
+	{
+		ASSERT_EQ(jsonSet[i]->getId(), binarySet[i]->getId());
+		ASSERT_EQ(jsonSet[i]->getAssetName(), binarySet[i]->getAssetName());
+		ASSERT_EQ(jsonSet[i]->getAssetDateUserTime(), binarySet[i]->getAssetDateUserTime());
+		ASSERT_EQ(jsonSet[i]->getAssetDateTime(), binarySet[i]->getAssetDateTime());
+		ASSERT_EQ(jsonSet[i]->getDatapointsJSON(), binarySet[i]->getDatapointsJSON());
+	}
+}
+
+TEST(ReadingSet, BinaryInvalidPayload)
+{
+	RDSFetchHeader header;
+	header.magic = RDS_FETCH_MAGIC;
+	header.count = 1;
+	string block((const char *)&header, sizeof(header));
+	appendBinaryReading(block, 7, "bad", 1506006008, 0, 1506006008, 0, "not json");
+	ReadingSet readingSet(block.data(), block.length());
+	ASSERT_EQ(1, readingSet.getCount());
+	ASSERT_EQ(readingSet[0]->getAssetName(), "error_invalid_reading_bad");
+}
+
+TEST(ReadingSet, BinaryEmpty)
+{
+	RDSFetchHeader header;
+	header.magic = RDS_FETCH_MAGIC;
+	header.count = 0;
+	ReadingSet readingSet((const char *)&header, sizeof(header));
+	ASSERT_EQ(0, readingSet.getCount());
+	ASSERT_EQ(0, readingSet.getLastId());
+}
+
+TEST(ReadingSet, BinaryMalformed)
+{
+	string block = binaryBlock();
+	ReadingSetException *ex = NULL;
+	try {
+		ReadingSet readingSet(block.data(), block.length() - 4);
+	} catch (ReadingSetException *e) {
+		ex = e;
+	}
+	ASSERT_NE(ex, (ReadingSetException *)NULL);
+	delete ex;
+
+	ex = NULL;
+	block[0] = 'X';
+	try {
+		ReadingSet readingSet(block.data(), block.length());
+	} catch (ReadingSetException *e) {
+		ex = e;
+	}
+	ASSERT_NE(ex, (ReadingSetException *)NULL);
+	delete ex;
+}
+
+TEST(ReadingSet, BinaryUnterminated)
+{
+	string block = binaryBlock();
+	// Overwrite the terminator of the payload of the last reading
+	block[block.length() - 1] = '}';
+	ReadingSetException *ex = NULL;
+	try {
+		ReadingSet readingSet(block.data(), block.length());
+	} catch (ReadingSetException *e) {
+		ex = e;
+	}
+	ASSERT_NE(ex, (ReadingSetException *)NULL);
+	delete ex;
+}
@@ -260,3 +260,111 @@ string	json("{ \"count\" : 1, \"rows\" : [ { \"json\" : { \"j1\" : \"test\" }, \
 	const rapidjson::Value *v = value->getJSON();
 	ASSERT_EQ(strcmp((*v)["j1"].GetString(), "test"), 0);
 }
+
+TEST(ResultSetTest, ColumnsLayoutRowCount)
+{
+string	json("{ \"count\" : 2, \"rows\" : [ { \"c1\" : 1, \"c2\" : \"a\" }, { \"c1\" : 2, \"c2\" : \"b\" } ] }");
+
+	ResultSet result(json, ResultSet::Columns);
+	ASSERT_EQ(result.layout(), ResultSet::Columns);
+	ASSERT_EQ(result.rowCount(), 2);
+	ASSERT_EQ(result.columnCount(), 2);
+	ASSERT_EQ(result.columnType("c2"), STRING_COLUMN);
+}
+
+TEST(ResultSetTest, ColumnsLayoutViews)
+{
+string	json("{ \"count\" : 3, \"rows\" : [ "
+		"{ \"i\" : 1, \"n\" : 1.5, \"s\" : \"one\", \"b\" : true, \"j\" : { \"k\" : 1 } }, "
+		"{ \"i\" : 2, \"n\" : 2.5, \"s\" : \"two\", \"b\" : false, \"j\" : { \"k\" : 2 } }, "
+		"{ \"i\" : 3, \"n\" : 3.5, \"s\" : \"three\", \"b\" : true, \"j\" : { \"k\" : 3 } } ] }");
+
+	ResultSet result(json, ResultSet::Columns);
+	const ResultSet::ColumnView& i = result.column("i");
+	const ResultSet::ColumnView& n = result.column(1);
+	const ResultSet::ColumnView& s = result.column("s");
+	const ResultSet::ColumnView& b = result.column("b");
+	const ResultSet::ColumnView& j = result.column("j");
+	ASSERT_EQ(i.size(), 3);
+	ASSERT_EQ(i.getType(), INT_COLUMN);
+	ASSERT_EQ(n.getType(), NUMBER_COLUMN);
+	ASSERT_EQ(j.getType(), JSON_COLUMN);
+	for (unsigned int row = 0; row < 3; row++)
+	{
+		ASSERT_EQ(i.getInteger(row), row + 1);
+		ASSERT_EQ(n.getNumber(row), row + 1.5);
+		ASSERT_EQ(j.getJSON(row)->operator[]("k").GetInt(), row + 1);
+	}
+	ASSERT_STREQ(s.getString(2), "three");
+	ASSERT_STREQ(b.getString(1), "false");
+	ASSERT_EQ(&result.column("i"), &i);
+}
+
+TEST(ResultSetTest, ColumnsLayoutMemberOrderAndNulls)
+{
+string	json("{ \"count\" : 3, \"rows\" : [ { \"c1\" : 1, \"c2\" : \"a\" }, "
+		"{ \"c2\" : \"b\", \"c1\" : 2 }, { \"c1\" : null } ] }");
+
+	ResultSet result(json, ResultSet::Columns);
+	const ResultSet::ColumnView& c1 = result.column("c1");
+	const ResultSet::ColumnView& c2 = result.column("c2");
+	ASSERT_EQ(c1.getInteger(1), 2);
+	ASSERT_STREQ(c2.getString(1), "b");
+	ASSERT_TRUE(c1.isNull(2));
+	ASSERT_TRUE(c2.isNull(2));
+	ASSERT_FALSE(c2.isNull(0));
+	try {
+		c2.getString(2);
+		FAIL() << "Expected an incorrect type exception";
+	} catch (ResultIncorrectTypeException *e) {
+		delete e;
+	}
+	try {
+		c1.getInteger(3);
+		FAIL() << "Expected a no more rows exception";
+	} catch (ResultNoMoreRowsException *e) {
+		delete e;
+	}
+}
+
+TEST(ResultSetTest, ColumnsLayoutRowAPI)
+{
+string	json("{ \"count\" : 3, \"rows\" : [ { \"c1\" : 1, \"json\" : { \"j1\" : \"test\" } }, "
+		"{ \"c1\" : 2, \"json\" : {} }, { \"c1\" : 3, \"json\" : {} } ] }");
+
+	ResultSet result(json, ResultSet::Columns);
+	ASSERT_EQ(result.column("c1").getInteger(0), 1);
+	int i = 1;
+	ResultSet::RowIterator rowIter = result.firstRow();
+	ASSERT_EQ(strcmp((*(*rowIter)->getColumn("json")->getJSON())["j1"].GetString(), "test"), 0);
+	while (result.hasNextRow(rowIter))
+	{
+		i++;
+		rowIter = result.nextRow(rowIter);
+		ASSERT_EQ(i, (*rowIter)->getColumn("c1")->getInteger());
+	}
+	ASSERT_EQ(i, 3);
+	ASSERT_EQ(result[2]->getColumn(0)->getInteger(), 3);
+}
+
+TEST(ResultSetTest, ColumnsLayoutNoRows)
+{
+string	json("{ \"count\" : 0, \"rows\" : [  ] }");
+
+	ResultSet result(json, ResultSet::Columns);
+	ASSERT_EQ(result.rowCount(), 0);
+	ASSERT_EQ(result.columnCount(), 0);
+}
+
+TEST(ResultSetTest, RowsLayoutHasNoViews)
+{
+string	json("{ \"count\" : 1, \"rows\" : [ { \"c1\" : 1 } ] }");
+
+	ResultSet result(json);
+	try {
+		result.column(0);
+		FAIL() << "Expected a result exception";
+	} catch (ResultException *e) {
+		delete e;
+	}
+}
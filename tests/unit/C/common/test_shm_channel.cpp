@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <reading_shm.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <string>
+
+using namespace std;
+
+TEST(ShmChannel, EmptyRing)
+{
+	ShmChannel channel;
+	ASSERT_TRUE(channel.create());
+	ASSERT_EQ(channel.request()->peek(), (ShmMessage *)NULL);
+	ASSERT_EQ(channel.response()->peek(), (ShmMessage *)NULL);
+}
+
+TEST(ShmChannel, MessageNotVisibleUntilCommit)
+{
+	ShmChannel channel;
+	ASSERT_TRUE(channel.create());
+	char *payload = (char *)channel.request()->reserve(ShmFetch, 6);
+	ASSERT_NE(payload, (char *)NULL);
+	memcpy(payload, "hello", 6);
+	ASSERT_EQ(channel.request()->peek(), (ShmMessage *)NULL);
+	channel.request()->commit();
+	ShmMessage *msg = channel.request()->peek();
+	ASSERT_NE(msg, (ShmMessage *)NULL);
+	ASSERT_EQ(msg->type, (uint32_t)ShmFetch);
+	ASSERT_EQ(msg->length, 6);
+	ASSERT_STREQ((char *)(msg + 1), "hello");
+	channel.request()->release();
+	ASSERT_EQ(channel.request()->peek(), (ShmMessage *)NULL);
+}
+
+TEST(ShmChannel, Wraparound)
+{
+	ShmChannel channel;
+	ASSERT_TRUE(channel.create());
+	ShmRing *ring = channel.request();
+	// Messages that do not divide the ring exactly force padding at the end
+	uint32_t length = SHM_RING_SIZE / 3 + 100;
+	for (int i = 0; i < 20; i++)
+	{
+		char *payload = (char *)ring->reserve(ShmAppend, length);
+		ASSERT_NE(payload, (char *)NULL);
+		memset(payload, 'a' + i, length);
+		ring->commit();
+		ShmMessage *msg = ring->peek();
+		ASSERT_NE(msg, (ShmMessage *)NULL);
+		ASSERT_EQ(msg->type, (uint32_t)ShmAppend);
+		ASSERT_EQ(msg->length, length);
+		ASSERT_EQ(((char *)(msg + 1))[0], 'a' + i);
+		ASSERT_EQ(((char *)(msg + 1))[length - 1], 'a' + i);
+		ring->release();
+	}
+}
+
+TEST(ShmChannel, Full)
+{
+	ShmChannel channel;
+	ASSERT_TRUE(channel.create());
+	ShmRing *ring = channel.request();
+	ASSERT_EQ(ring->reserve(ShmAppend, SHM_RING_SIZE), (void *)NULL);
+	ASSERT_NE(ring->reserve(ShmAppend, SHM_RING_SIZE / 2), (void *)NULL);
+	ring->commit();
+	ASSERT_EQ(ring->reserve(ShmAppend, SHM_RING_SIZE / 2), (void *)NULL);
+	ASSERT_NE(ring->peek(), (ShmMessage *)NULL);
+	ring->release();
+	ASSERT_NE(ring->reserve(ShmAppend, SHM_RING_SIZE / 2), (void *)NULL);
+}
+
+TEST(ShmChannel, PassDescriptors)
+{
+	int sv[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+	ShmChannel server;
+	ASSERT_TRUE(server.create());
+	ASSERT_TRUE(server.sendDescriptors(sv[0]));
+
+	int memfd, requestfd, responsefd;
+	ASSERT_TRUE(ShmChannel::receiveDescriptors(sv[1], &memfd, &requestfd, &responsefd));
+	ShmChannel client;
+	ASSERT_TRUE(client.attach(memfd, requestfd, responsefd));
+
+	// Request from the client to the server
+	ShmFetchRequest *req = (ShmFetchRequest *)client.request()->reserve(ShmFetch, sizeof(ShmFetchRequest));
+	ASSERT_NE(req, (ShmFetchRequest *)NULL);
+	req->id = 1234;
+	req->count = 100;
+	client.request()->commit();
+	client.signal(client.requestEvent());
+	ASSERT_TRUE(server.wait(server.requestEvent(), 1000));
+	ShmMessage *msg = server.request()->peek();
+	ASSERT_NE(msg, (ShmMessage *)NULL);
+	ASSERT_EQ(((ShmFetchRequest *)(msg + 1))->id, 1234);
+	ASSERT_EQ(((ShmFetchRequest *)(msg + 1))->count, 100);
+	server.request()->release();
+
+	// Response from the server to the client
+	ShmResult *result = (ShmResult *)server.response()->reserve(ShmAppendResult, sizeof(ShmResult));
+	ASSERT_NE(result, (ShmResult *)NULL);
+	result->status = 0;
+	server.response()->commit();
+	server.signal(server.responseEvent());
+	ASSERT_TRUE(client.wait(client.responseEvent(), 1000));
+	msg = client.response()->peek();
+	ASSERT_NE(msg, (ShmMessage *)NULL);
+	ASSERT_EQ(msg->type, (uint32_t)ShmAppendResult);
+	client.response()->release();
+
+	// Nothing further has been signalled
+	ASSERT_FALSE(client.wait(client.responseEvent(), 0));
+	close(sv[0]);
+	close(sv[1]);
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <statistics_accumulator.h>
+#include <storage_client.h>
+#include <server_http.hpp>
+#include <rapidjson/document.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+TEST(StatisticsAccumulatorTest, Coalesce)
+{
+	StatisticsAccumulator stats(NULL);
+	ASSERT_EQ(stats.pending(), 0);
+	stats.increment("READINGS", 10);
+	stats.increment("READINGS", 5);
+	stats.increment("DISCARDED");
+	ASSERT_EQ(stats.pending(), 16);
+}
+
+TEST(StatisticsAccumulatorTest, RetainOnFailure)
+{
+	StatisticsAccumulator stats(NULL);
+	stats.increment("READINGS", 10);
+	ASSERT_FALSE(stats.flush());
+	ASSERT_EQ(stats.pending(), 10);
+	stats.increment("READINGS", 2);
+	ASSERT_EQ(stats.pending(), 12);
+}
+
+TEST(StatisticsAccumulatorTest, EmptyFlush)
+{
+	StatisticsAccumulator stats(NULL);
+	ASSERT_TRUE(stats.flush());
+}
+
+TEST(StatisticsAccumulatorTest, StartStop)
+{
+	StatisticsAccumulator stats(NULL);
+	stats.setFlushInterval(1);
+	stats.setFlushCount(100);
+	stats.start();
+	stats.increment("READINGS", 50);
+	stats.stop();
+	ASSERT_EQ(stats.pending(), 50);
+}
+
+/**
+ * A storage service that records the updates of the statistics table
+ * made by the accumulator. Started once for all tests.
+ */
+class StatisticsStorage {
+	public:
+		using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+		static StatisticsStorage *getInstance()
+		{
+			static StatisticsStorage *instance = new StatisticsStorage();
+			return instance;
+		};
+		unsigned short	port() { return m_server.getLocalPort(); };
+		void		reset(bool fail)
+		{
+			lock_guard<mutex> guard(m_mutex);
+			m_fail = fail;
+			m_updates.clear();
+		};
+		vector<string>	updates()
+		{
+			lock_guard<mutex> guard(m_mutex);
+			return m_updates;
+		};
+	private:
+		StatisticsStorage() : m_fail(false)
+		{
+			m_server.config.port = 0;
+			m_server.resource["^/storage/schema/fledge/table/statistics$"]["PUT"] =
+				[this](shared_ptr<HttpServer::Response> response,
+					shared_ptr<HttpServer::Request> request) {
+				bool fail;
+				{
+					lock_guard<mutex> guard(m_mutex);
+					m_updates.push_back(request->content.string());
+					fail = m_fail;
+				}
+				string payload = fail ? "{ \"message\" : \"failed\" }"
+						: "{ \"response\" : \"updated\", \"rows_affected\" : 1 }";
+				*response << "HTTP/1.1 " << (fail ? "400 Bad Request" : "200 OK")
+					<< "\r\nContent-Length: " << payload.length() << "\r\n\r\n" << payload;
+			};
+			m_thread = thread([this]() { m_server.start(); });
+			for (int i = 0; i < 500 && m_server.getLocalPort() == 0; i++)
+				this_thread::sleep_for(chrono::milliseconds(10));
+		};
+		HttpServer	m_server;
+		thread		m_thread;
+		mutex		m_mutex;
+		bool		m_fail;
+		vector<string>	m_updates;
+};
+
+TEST(StatisticsAccumulatorTest, UpdatePayload)
+{
+	StatisticsStorage *storage = StatisticsStorage::getInstance();
+	ASSERT_NE(storage->port(), 0);
+	storage->reset(false);
+	StorageClient client("localhost", storage->port());
+	StatisticsAccumulator stats(&client);
+	stats.increment("READINGS", 10);
+	stats.increment("READINGS", 5);
+	stats.increment("DISCARDED", 3000000000UL);
+	ASSERT_TRUE(stats.flush());
+	ASSERT_EQ(stats.pending(), 0);
+
+	// A single update of all the counters
+	vector<string> updates = storage->updates();
+	ASSERT_EQ(updates.size(), 1);
+	rapidjson::Document doc;
+	doc.Parse(updates[0].c_str());
+	ASSERT_FALSE(doc.HasParseError());
+	ASSERT_TRUE(doc["updates"].IsArray());
+	ASSERT_EQ(doc["updates"].Size(), 2);
+	map<string, int64_t> increments;
+	for (auto& update : doc["updates"].GetArray())
+	{
+		ASSERT_STREQ(update["where"]["column"].GetString(), "key");
+		ASSERT_STREQ(update["where"]["condition"].GetString(), "=");
+		const rapidjson::Value& expression = update["expressions"][0];
+		ASSERT_STREQ(expression["column"].GetString(), "value");
+		ASSERT_STREQ(expression["operator"].GetString(), "+");
+		increments[update["where"]["value"].GetString()] = expression["value"].GetInt64();
+	}
+	ASSERT_EQ(increments["READINGS"], 15);
+	ASSERT_EQ(increments["DISCARDED"], 3000000000L);
+
+	// Nothing is written if there are no increments
+	ASSERT_TRUE(stats.flush());
+	ASSERT_EQ(storage->updates().size(), 1);
+}
+
+TEST(StatisticsAccumulatorTest, FailureBackoff)
+{
+	StatisticsStorage *storage = StatisticsStorage::getInstance();
+	ASSERT_NE(storage->port(), 0);
+	storage->reset(true);
+	StorageClient client("localhost", storage->port());
+	StatisticsAccumulator stats(&client);
+	stats.setFlushInterval(60);
+	stats.setFlushCount(10);
+	stats.start();
+	stats.increment("READINGS", 20);
+	for (int i = 0; i < 100 && storage->updates().empty(); i++)
+		this_thread::sleep_for(chrono::milliseconds(10));
+	ASSERT_EQ(storage->updates().size(), 1);
+
+	// The failed flush is not retried until the flush interval expires,
+	// even though the flush count is still exceeded
+	stats.increment("READINGS", 20);
+	this_thread::sleep_for(chrono::milliseconds(100));
+	ASSERT_EQ(storage->updates().size(), 1);
+	ASSERT_EQ(stats.pending(), 40);
+
+	// Once the storage recovers the increments are written on stop
+	storage->reset(false);
+	stats.stop();
+	ASSERT_EQ(stats.pending(), 0);
+	vector<string> updates = storage->updates();
+	ASSERT_EQ(updates.size(), 1);
+	ASSERT_NE(updates[0].find("40"), string::npos);
+}
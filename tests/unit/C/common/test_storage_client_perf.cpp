@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <storage_client.h>
+#include <http_client_pool.h>
+#include <server_http.hpp>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+
+/*
+ * Tests of the pool of HTTP clients used by the storage client and a
+ * microbenchmark of small queryTable calls from 1 to 16 threads.
+ */
+
+#define BENCHMARK_CALLS	4000
+
+/**
+ * A storage service that answers every table query with a single row
+ */
+class QueryServer {
+	public:
+		QueryServer()
+		{
+			m_server.config.port = 0;
+			m_server.config.thread_pool_size = 4;
+			m_server.resource["^/storage/schema/([A-Za-z_]*)/table/([A-Za-z_]*)/query$"]["PUT"] =
+				[](shared_ptr<HttpServer::Response> response, shared_ptr<HttpServer::Request>) {
+					response->write("{\"count\":1,\"rows\":[{\"key\":\"READINGS\",\"value\":100}]}");
+				};
+			promise<unsigned short> started;
+			m_thread = thread([this, &started]() {
+				m_server.start([&started](unsigned short port) { started.set_value(port); });
+			});
+			m_port = started.get_future().get();
+		};
+		~QueryServer()
+		{
+			m_server.stop();
+			m_thread.join();
+		};
+		unsigned short	port() const { return m_port; };
+	private:
+		HttpServer	m_server;
+		thread		m_thread;
+		unsigned short	m_port;
+};
+
+TEST(HttpClientPool, ClientPerThread)
+{
+	shared_ptr<HttpClientPool> pool = HttpClientPool::create("localhost:1");
+	HttpClient *mine = pool->client();
+	ASSERT_EQ(pool->client(), mine);
+	HttpClient *other = NULL;
+	thread t([&pool, &other]() { other = pool->client(); });
+	t.join();
+	ASSERT_NE(other, mine);
+	// The client of the thread that exited is available for reuse
+	ASSERT_EQ(pool->idle(), 1);
+	HttpClient *reused = NULL;
+	thread t2([&pool, &reused]() { reused = pool->client(); });
+	t2.join();
+	ASSERT_EQ(reused, other);
+	ASSERT_EQ(pool->size(), 2);
+}
+
+TEST(HttpClientPool, Bounded)
+{
+	shared_ptr<HttpClientPool> pool = HttpClientPool::create("localhost:1");
+	vector<thread> threads;
+	atomic<int> ready(0);
+	atomic<bool> release(false);
+	for (int i = 0; i < HTTP_CLIENT_POOL_SIZE * 2; i++)
+	{
+		threads.push_back(thread([&pool, &ready, &release]() {
+			pool->client();
+			ready++;
+			while (!release)
+				this_thread::yield();
+		}));
+	}
+	while (ready < HTTP_CLIENT_POOL_SIZE * 2)
+		this_thread::yield();
+	ASSERT_EQ(pool->size(), HTTP_CLIENT_POOL_SIZE * 2);
+	release = true;
+	for (auto& t : threads)
+		t.join();
+	ASSERT_EQ(pool->idle(), HTTP_CLIENT_POOL_SIZE);
+	ASSERT_EQ(pool->size(), HTTP_CLIENT_POOL_SIZE);
+}
+
+TEST(HttpClientPool, SequenceContinues)
+{
+	shared_ptr<HttpClientPool> pool = HttpClientPool::create("localhost:1");
+	int last = 0;
+	thread t([&pool, &last]() {
+		for (int i = 0; i < 5; i++)
+			last = pool->nextSequence();
+	});
+	t.join();
+	ASSERT_EQ(last, 5);
+	// A later thread may reuse the thread id, its sequence must not restart
+	int next = 0;
+	thread t2([&pool, &next]() { next = pool->nextSequence(); });
+	t2.join();
+	ASSERT_GT(next, last);
+}
+
+TEST(HttpClientPool, Remove)
+{
+	shared_ptr<HttpClientPool> pool = HttpClientPool::create("localhost:1");
+	ASSERT_FALSE(pool->remove());
+	pool->client();
+	ASSERT_TRUE(pool->remove());
+	ASSERT_EQ(pool->size(), 0);
+}
+
+TEST(StorageClientBench, QueryTable)
+{
+	// Only benchmark on the first iteration
+	static bool done = false;
+	if (done)
+		GTEST_SKIP();
+	done = true;
+
+	QueryServer server;
+	StorageClient client("localhost", server.port());
+	for (int threads = 1; threads <= 16; threads *= 2)
+	{
+		atomic<int> failed(0);
+		vector<thread> workers;
+		auto start = steady_clock::now();
+		for (int i = 0; i < threads; i++)
+		{
+			workers.push_back(thread([&client, &failed, threads]() {
+				Query query(new Where("key", Equals, "READINGS"));
+				for (int j = 0; j < BENCHMARK_CALLS / threads; j++)
+				{
+					try {
+						ResultSet *result = client.queryTable("statistics", query);
+						if (!result || result->rowCount() != 1)
+							failed++;
+						delete result;
+					} catch (exception&) {
+						failed++;
+					}
+				}
+			}));
+		}
+		for (auto& t : workers)
+			t.join();
+		double elapsed = duration<double>(steady_clock::now() - start).count();
+		cout << "[ BENCH    ] queryTable " << threads << " threads: "
+			<< (int)(BENCHMARK_CALLS / elapsed) << " calls per second" << endl;
+		ASSERT_EQ(failed, 0);
+	}
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <storage_query_stream.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A single shot HTTP server that sends a canned response to the first
+ * request it receives
+ */
+class CannedServer {
+	public:
+		CannedServer(const string& response) : m_response(response)
+		{
+			m_socket = socket(AF_INET, SOCK_STREAM, 0);
+			struct sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			bind(m_socket, (struct sockaddr *)&addr, sizeof(addr));
+			socklen_t len = sizeof(addr);
+			getsockname(m_socket, (struct sockaddr *)&addr, &len);
+			m_port = ntohs(addr.sin_port);
+			listen(m_socket, 1);
+			m_thread = thread(&CannedServer::serve, this);
+		};
+		~CannedServer()
+		{
+			m_thread.join();
+			close(m_socket);
+		};
+		unsigned short	port() const { return m_port; };
+		const string&	request() const { return m_request; };
+	private:
+		void	serve()
+		{
+			int conn = accept(m_socket, NULL, NULL);
+			char buf[1024];
+			ssize_t n;
+			while ((n = recv(conn, buf, sizeof(buf), 0)) > 0)
+			{
+				m_request.append(buf, n);
+				size_t end = m_request.find("\r\n\r\n");
+				if (end != string::npos && m_request.find("}", end) != string::npos)
+					break;
+			}
+			send(conn, m_response.c_str(), m_response.length(), MSG_NOSIGNAL);
+			close(conn);
+		};
+		string		m_response;
+		string		m_request;
+		int		m_socket;
+		unsigned short	m_port;
+		thread		m_thread;
+};
+
+static bool collect(void *data, const rapidjson::Value& row)
+{
+	vector<string> *ids = (vector<string> *)data;
+	ids->push_back(row["id"].IsString() ? row["id"].GetString() : to_string(row["id"].GetInt()));
+	return true;
+}
+
+static bool firstOnly(void *data, const rapidjson::Value& row)
+{
+	collect(data, row);
+	return false;
+}
+
+TEST(StorageQueryStream, Chunked)
+{
+	// A row is split across chunks, as it may be when sent by the storage service
+	CannedServer server("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+			"Content-type: application/json\r\n\r\n"
+			"13\r\n{\"rows\":[{\"id\":1,\"v\r\n"
+			"28\r\n\":{\"a\":[1,2]}},{\"id\":2,\"v\":\"x\"},{\"id\":3}\r\n"
+			"c\r\n],\"count\":3}\r\n"
+			"0\r\n\r\n");
+	StorageQueryStream stream("localhost", server.port());
+	vector<string> ids;
+	long rows = stream.query("PUT", "/storage/table/log/query?stream=true", "{}", collect, &ids);
+	ASSERT_EQ(rows, 3);
+	ASSERT_EQ(ids.size(), 3);
+	ASSERT_EQ(ids[0], "1");
+	ASSERT_EQ(ids[2], "3");
+	ASSERT_NE(server.request().find("PUT /storage/table/log/query?stream=true HTTP/1.1"), string::npos);
+}
+
+TEST(StorageQueryStream, ContentLength)
+{
+	string body = "{\"count\":2,\"rows\":[{\"id\":\"a\"},{\"id\":\"b\"}]}";
+	CannedServer server("HTTP/1.1 200 OK\r\nContent-Length: " + to_string(body.length())
+			+ "\r\n\r\n" + body);
+	StorageQueryStream stream("localhost", server.port());
+	vector<string> ids;
+	ASSERT_EQ(stream.query("PUT", "/storage/reading/query", "{}", collect, &ids), 2);
+	ASSERT_EQ(ids[1], "b");
+}
+
+TEST(StorageQueryStream, Abandon)
+{
+	string body = "{\"rows\":[{\"id\":1},{\"id\":2}],\"count\":2}";
+	CannedServer server("HTTP/1.1 200 OK\r\nContent-Length: " + to_string(body.length())
+			+ "\r\n\r\n" + body);
+	StorageQueryStream stream("localhost", server.port());
+	vector<string> ids;
+	ASSERT_EQ(stream.query("PUT", "/storage/reading/query", "{}", firstOnly, &ids), 1);
+	ASSERT_EQ(ids.size(), 1);
+}
+
+TEST(StorageQueryStream, ErrorStatus)
+{
+	string body = "{\"entryPoint\":\"retrieve\",\"message\":\"bad query\",\"retryable\":false}";
+	CannedServer server("HTTP/1.1 400 Bad Request\r\nContent-Length: " + to_string(body.length())
+			+ "\r\n\r\n" + body);
+	StorageQueryStream stream("localhost", server.port());
+	vector<string> ids;
+	ASSERT_EQ(stream.query("PUT", "/storage/table/log/query?stream=true", "{}", collect, &ids), -1);
+	ASSERT_EQ(stream.getStatus().compare(0, 3, "400"), 0);
+	ASSERT_EQ(stream.getBody(), body);
+	ASSERT_EQ(ids.size(), 0);
+}
@@ -227,3 +227,107 @@ TEST(TestAround, Extract)
 	s = StringAround(longString, 5);
 	EXPECT_STREQ(s.c_str(), "not shownpreamble123This part is after t");
 }
+
+TEST(TestFormatNumber, Integers)
+{
+	char buf[NUMBER_BUFFER_LEN];
+
+	ASSERT_EQ(FormatLong(buf, 0), 1);
+	EXPECT_STREQ(buf, "0");
+	ASSERT_EQ(FormatLong(buf, -1234567), 8);
+	EXPECT_STREQ(buf, "-1234567");
+	FormatLong(buf, LONG_MIN);
+	EXPECT_STREQ(buf, to_string(LONG_MIN).c_str());
+	FormatUnsignedLong(buf, ULONG_MAX);
+	EXPECT_STREQ(buf, to_string(ULONG_MAX).c_str());
+	ASSERT_EQ(FormatUnsignedLong(buf, 42, 6), 6);
+	EXPECT_STREQ(buf, "000042");
+}
+
+TEST(TestFormatNumber, Doubles)
+{
+	char buf[NUMBER_BUFFER_LEN + 320];
+	vector<pair<double, string>> trimmed = {
+		{ 0.0, "0.0" },
+		{ 5.0, "5.0" },
+		{ -5.0, "-5.0" },
+		{ 1.5, "1.5" },
+		{ -0.25, "-0.25" },
+		{ 3.14159265358979, "3.1415926536" },
+		{ 1e20, "100000000000000000000.0" }
+	};
+
+	for (auto& t : trimmed)
+	{
+		FormatDouble(buf, sizeof(buf), t.first, 10);
+		EXPECT_STREQ(buf, t.second.c_str());
+	}
+
+	char expected[NUMBER_BUFFER_LEN + 320];
+	for (double d : { 0.0, 12.0, -7.125, 123456.789, 1e300 })
+	{
+		snprintf(expected, sizeof(expected), "%f", d);
+		FormatDouble(buf, sizeof(buf), d, 6, false);
+		EXPECT_STREQ(buf, expected);
+	}
+}
+
+TEST(TestStringEscape, Scan)
+{
+	// Place the character at every offset either side of the vector block sizes
+	for (size_t length = 0; length < 80; length++)
+	{
+		string s(length, 'a');
+		ASSERT_EQ(StringScan(s.data(), length, '"', '\\'), length);
+		for (size_t i = 0; i < length; i++)
+		{
+			string t = s;
+			t[i] = '\\';
+			ASSERT_EQ(StringScan(t.data(), length, '"', '\\'), i);
+			t[length - 1] = '"';
+			ASSERT_EQ(StringScan(t.data(), length, '"', '\\'), i);
+		}
+	}
+}
+
+TEST(TestStringEscape, Quotes)
+{
+	string out;
+	StringAppendEscapedQuotes(out, "no quotes here");
+	ASSERT_EQ(out, "no quotes here");
+	out = "x";
+	StringAppendEscapedQuotes(out, R"(a "quoted" value)");
+	ASSERT_EQ(out, R"(xa \"quoted\" value)");
+	out.clear();
+	StringAppendEscapedQuotes(out, R"(already \"escaped\" and \\"not\\")");
+	ASSERT_EQ(out, R"(already \"escaped\" and \\\"not\\\")");
+	out.clear();
+	string longer = string(40, 'a') + "\"" + string(40, 'b') + "\\\"";
+	StringAppendEscapedQuotes(out, longer);
+	ASSERT_EQ(out, string(40, 'a') + "\\\"" + string(40, 'b') + "\\\"");
+}
+
+TEST(TestStringEscape, QuotesInPlace)
+{
+	string s = "no quotes here";
+	StringEscapeQuotes(s);
+	ASSERT_EQ(s, "no quotes here");
+	s = R"("start \"escaped\" "")";
+	StringEscapeQuotes(s);
+	ASSERT_EQ(s, R"(\"start \"escaped\" \"\")");
+}
+
+TEST(TestStringEscape, JSON)
+{
+	ASSERT_EQ(StringEscapeJSON("plain"), "plain");
+	ASSERT_EQ(StringEscapeJSON(R"(a\b"c")"), R"(a\\b\"c\")");
+	string longer = string(33, 'x') + "\\" + string(17, 'y') + "\"";
+	ASSERT_EQ(StringEscapeJSON(longer), string(33, 'x') + "\\\\" + string(17, 'y') + "\\\"");
+}
+
+TEST(TestStringEscape, SQL)
+{
+	ASSERT_EQ(StringEscapeSQL("plain"), "plain");
+	ASSERT_EQ(StringEscapeSQL("it's 'quoted'"), "it''s ''quoted''");
+	ASSERT_EQ(StringEscapeSQL("'"), "''");
+}
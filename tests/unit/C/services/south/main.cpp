@@ -0,0 +1,10 @@
+#include <gtest/gtest.h>
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+
+    testing::GTEST_FLAG(repeat) = 100;
+    testing::GTEST_FLAG(shuffle) = true;
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <adaptive_buffering.h>
+
+/*
+ * Tests of the adaptive buffering controller of the south service
+ */
+
+static void configure(AdaptiveBuffering& buffering, unsigned int threshold, long timeout)
+{
+	buffering.setThreshold(threshold);
+	buffering.setTimeout(timeout);
+	buffering.reset();
+}
+
+TEST(AdaptiveBuffering, StartsAtConfiguration)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	ASSERT_EQ(buffering.batchSize(), 100);
+	ASSERT_EQ(buffering.flushInterval(), 1000);
+	ASSERT_EQ(buffering.appendTime(), 0);
+}
+
+TEST(AdaptiveBuffering, GrowsWithBacklog)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(100, 10, 50, true);
+	ASSERT_EQ(buffering.batchSize(), 112);
+	buffering.update(112, 10, 50, true);
+	ASSERT_EQ(buffering.batchSize(), 126);
+}
+
+TEST(AdaptiveBuffering, GrowthLimited)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	for (int i = 0; i < 100; i++)
+		buffering.update(buffering.batchSize(), 10, 50, true);
+	ASSERT_EQ(buffering.batchSize(), 100 * ADAPTIVE_MAX_FACTOR);
+}
+
+TEST(AdaptiveBuffering, NoGrowthWithoutBacklog)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(100, 10, 50, false);
+	ASSERT_EQ(buffering.batchSize(), 100);
+}
+
+TEST(AdaptiveBuffering, NoGrowthForPartialBlock)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(60, 10, 50, true);
+	ASSERT_EQ(buffering.batchSize(), 100);
+}
+
+TEST(AdaptiveBuffering, NoGrowthWithoutHeadroom)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	// Within the latency target but beyond half of it
+	buffering.update(100, 10, 600, true);
+	ASSERT_EQ(buffering.batchSize(), 100);
+}
+
+TEST(AdaptiveBuffering, ShrinksOnHighLatency)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(100, 100, 950, true);
+	ASSERT_EQ(buffering.batchSize(), 75);
+	buffering.update(75, 100, 950, true);
+	ASSERT_EQ(buffering.batchSize(), 56);
+}
+
+TEST(AdaptiveBuffering, ShrinkLimited)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	for (int i = 0; i < 100; i++)
+		buffering.update(buffering.batchSize(), 100, 2000, false);
+	ASSERT_EQ(buffering.batchSize(), ADAPTIVE_MIN_BATCH);
+
+	// A threshold below the minimum is never grown past
+	configure(buffering, 4, 1000);
+	buffering.update(4, 100, 2000, false);
+	ASSERT_EQ(buffering.batchSize(), 4);
+}
+
+TEST(AdaptiveBuffering, RecoversAfterShrink)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	for (int i = 0; i < 10; i++)
+		buffering.update(buffering.batchSize(), 100, 2000, false);
+	unsigned int shrunk = buffering.batchSize();
+	ASSERT_LT(shrunk, 100);
+	buffering.update(shrunk, 10, 50, true);
+	ASSERT_GT(buffering.batchSize(), shrunk);
+}
+
+TEST(AdaptiveBuffering, FlushIntervalAllowsForAppend)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(100, 100, 50, false);
+	ASSERT_EQ(buffering.appendTime(), 100);
+	ASSERT_EQ(buffering.flushInterval(), 800);
+
+	// The append time is smoothed
+	buffering.update(100, 500, 50, false);
+	ASSERT_EQ(buffering.appendTime(), 200);
+	ASSERT_EQ(buffering.flushInterval(), 600);
+
+	// Never less than the minimum flush interval
+	buffering.update(100, 5000, 50, false);
+	ASSERT_EQ(buffering.flushInterval(), ADAPTIVE_MIN_FLUSH);
+}
+
+TEST(AdaptiveBuffering, Reset)
+{
+	AdaptiveBuffering buffering;
+	configure(buffering, 100, 1000);
+	buffering.update(100, 100, 50, true);
+	buffering.reset();
+	ASSERT_EQ(buffering.batchSize(), 100);
+	ASSERT_EQ(buffering.flushInterval(), 1000);
+	ASSERT_EQ(buffering.appendTime(), 0);
+}
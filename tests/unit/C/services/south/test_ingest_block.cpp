@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <ingest.h>
+#include <management_client.h>
+#include <asset_tracking.h>
+#include <perfmonitors.h>
+#include <server_http.hpp>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+/*
+ * Tests of the blocks of readings committed by async south plugins.
+ * A stub storage and management API counts the readings appended and
+ * records the rows created in the statistics table.
+ */
+
+class IngestStorage {
+	public:
+		using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+		static IngestStorage *getInstance()
+		{
+			static IngestStorage *instance = new IngestStorage();
+			return instance;
+		};
+		unsigned short	port() { return m_server.getLocalPort(); };
+		int		appended() { return m_appended; };
+		bool		created(const string& key)
+				{
+					lock_guard<mutex> guard(m_mutex);
+					return m_created.find("\"" + key + "\"") != string::npos;
+				};
+	private:
+		IngestStorage() : m_appended(0)
+		{
+			m_server.config.port = 0;
+			m_server.resource["^/storage/reading$"]["POST"] =
+				[this](shared_ptr<HttpServer::Response> response,
+					shared_ptr<HttpServer::Request> request) {
+				string content = request->content.string();
+				int count = 0;
+				for (size_t pos = content.find("\"asset_code\""); pos != string::npos;
+						pos = content.find("\"asset_code\"", pos + 1))
+					count++;
+				m_appended += count;
+				string payload = "{ \"response\" : \"appended\", \"readings_added\" : "
+						+ to_string(count) + " }";
+				*response << "HTTP/1.1 200 OK\r\nContent-Length: " << payload.length()
+					<< "\r\n\r\n" << payload;
+			};
+			m_server.resource["^/fledge/track"]["GET"] =
+				[](shared_ptr<HttpServer::Response> response,
+					shared_ptr<HttpServer::Request>) {
+				string payload = "{ \"track\" : [] }";
+				*response << "HTTP/1.1 200 OK\r\nContent-Length: " << payload.length()
+					<< "\r\n\r\n" << payload;
+			};
+			m_server.resource["^/storage/schema/fledge/table/statistics/query$"]["PUT"] =
+				[](shared_ptr<HttpServer::Response> response,
+					shared_ptr<HttpServer::Request>) {
+				string payload = "{ \"count\" : 0, \"rows\" : [] }";
+				*response << "HTTP/1.1 200 OK\r\nContent-Length: " << payload.length()
+					<< "\r\n\r\n" << payload;
+			};
+			m_server.resource["^/storage/schema/fledge/table/statistics$"]["POST"] =
+				[this](shared_ptr<HttpServer::Response> response,
+					shared_ptr<HttpServer::Request> request) {
+				{
+					lock_guard<mutex> guard(m_mutex);
+					m_created += request->content.string();
+				}
+				string payload = "{ \"response\" : \"inserted\", \"rows_affected\" : 1 }";
+				*response << "HTTP/1.1 200 OK\r\nContent-Length: " << payload.length()
+					<< "\r\n\r\n" << payload;
+			};
+			m_thread = thread([this]() { m_server.start(); });
+			for (int i = 0; i < 500 && m_server.getLocalPort() == 0; i++)
+				this_thread::sleep_for(chrono::milliseconds(10));
+		};
+		HttpServer	m_server;
+		thread		m_thread;
+		atomic<int>	m_appended;
+		mutex		m_mutex;
+		string		m_created;	// Payloads of the statistics rows created
+};
+
+static vector<Reading *> *fillBlock(Ingest& ingest, int count)
+{
+	vector<Reading *> *block = ingest.reserveBlock(count);
+	for (int i = 0; i < count; i++)
+	{
+		DatapointValue value((long) i);
+		block->push_back(new Reading("block", new Datapoint("count", value)));
+	}
+	return block;
+}
+
+class IngestBlock : public ::testing::Test {
+	protected:
+		void SetUp()
+		{
+			IngestStorage *storage = IngestStorage::getInstance();
+			ASSERT_NE(storage->port(), 0);
+			m_management = new ManagementClient("localhost", storage->port());
+			m_tracker = new AssetTracker(m_management, "blocktest");
+			m_storage = new StorageClient("localhost", storage->port());
+			m_monitor = new PerformanceMonitor("blocktest", m_storage);
+			m_ingest = new Ingest(*m_storage, "blocktest", "stub", m_management);
+			m_ingest->setPerfMon(m_monitor);
+			m_ingest->setTimeout(60000);
+			m_ingest->setThreshold(10);
+		}
+		void TearDown()
+		{
+			if (m_ingest)
+			{
+				// The ingest thread must be running to delete the ingest
+				m_ingest->start(10, 10);
+				delete m_ingest;
+			}
+			delete m_monitor;
+			delete m_storage;
+			delete m_tracker;
+			delete m_management;
+		}
+		/**
+		 * Start the ingest thread with a short timeout and wait for
+		 * it to append the committed readings
+		 *
+		 * @param expected	The number of readings expected
+		 * @return int		The number of readings appended
+		 */
+		int	appendAll(int expected)
+		{
+			IngestStorage *storage = IngestStorage::getInstance();
+			int before = storage->appended();
+			m_ingest->start(10, 10);
+			for (int i = 0; i < 500 && storage->appended() - before < expected; i++)
+				this_thread::sleep_for(chrono::milliseconds(10));
+			// Allow time for any readings that are appended twice
+			this_thread::sleep_for(chrono::milliseconds(50));
+			delete m_ingest;
+			m_ingest = NULL;
+			return storage->appended() - before;
+		}
+		ManagementClient	*m_management;
+		AssetTracker		*m_tracker;
+		StorageClient		*m_storage;
+		PerformanceMonitor	*m_monitor;
+		Ingest			*m_ingest;
+};
+
+TEST_F(IngestBlock, ReservedBlockIsEmpty)
+{
+	vector<Reading *> *block = m_ingest->reserveBlock(20);
+	ASSERT_TRUE(block->empty());
+	ASSERT_GE(block->capacity(), 20);
+	m_ingest->commitBlock(block);
+	ASSERT_EQ(appendAll(0), 0);
+}
+
+TEST_F(IngestBlock, AppendedToQueue)
+{
+	m_ingest->commitBlock(fillBlock(*m_ingest, 3));
+	ASSERT_EQ(m_ingest->queueLength(), 3);
+	m_ingest->commitBlock(fillBlock(*m_ingest, 3));
+	ASSERT_EQ(m_ingest->queueLength(), 6);
+
+	// The block released by the second commit holds no readings
+	vector<Reading *> *block = m_ingest->reserveBlock(3);
+	ASSERT_TRUE(block->empty());
+	m_ingest->commitBlock(block);
+
+	ASSERT_EQ(appendAll(6), 6);
+}
+
+TEST_F(IngestBlock, BatchFull)
+{
+	m_ingest->commitBlock(fillBlock(*m_ingest, 6));
+	m_ingest->commitBlock(fillBlock(*m_ingest, 5));
+	// One full queue and nothing left in the current queue
+	ASSERT_EQ(m_ingest->queueLength(), 10);
+	m_ingest->commitBlock(fillBlock(*m_ingest, 2));
+	ASSERT_EQ(m_ingest->queueLength(), 12);
+
+	// Every reading is appended once
+	ASSERT_EQ(appendAll(13), 13);
+}
+
+/**
+ * Start an ingest with a statistics option and wait for the rows of
+ * the statistics it defines to be created
+ *
+ * @param service	The name of the service
+ * @param option	The statistics option
+ */
+static void startStatistics(const string& service, const string& option)
+{
+	IngestStorage *storage = IngestStorage::getInstance();
+	ManagementClient management("localhost", storage->port());
+	AssetTracker tracker(&management, service);
+	StorageClient client("localhost", storage->port());
+	Ingest *ingest = new Ingest(client, service, "stub", &management);
+	ingest->setStatistics(option);
+	ingest->start(10, 10);
+	for (int i = 0; i < 100 && !storage->created(service + INGEST_SUFFIX); i++)
+		this_thread::sleep_for(chrono::milliseconds(10));
+	delete ingest;
+}
+
+TEST(IngestStatistics, ServiceRowCreated)
+{
+	startStatistics("statsboth", "per asset & service");
+	ASSERT_TRUE(IngestStorage::getInstance()->created("statsboth" INGEST_SUFFIX));
+	startStatistics("statsservice", "per service");
+	ASSERT_TRUE(IngestStorage::getInstance()->created("statsservice" INGEST_SUFFIX));
+}
+
+TEST(IngestStatistics, NoServiceRowPerAsset)
+{
+	startStatistics("statsasset", "per asset");
+	ASSERT_FALSE(IngestStorage::getInstance()->created("statsasset" INGEST_SUFFIX));
+}
@@ -0,0 +1,269 @@
+/*
+ * Fledge storage service unit tests.
+ *
+ * Copyright (c) 2024 Dianomic Systems Inc.
+ *
+ * Released under the Apache 2.0 Licence
+ */
+#include <plugin_api.h>
+#include <reading_stream.h>
+#include <result_stream.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * A stub storage plugin that counts the readings appended to it.
+ * Readings with the asset code "fail" cause the append to fail and
+ * those with the asset code "skip" are not appended.
+ * Streamed queries of a table return STUB_STREAM_ROWS rows, other than
+ * for the table "fail" which fails and the table "hold" which is held
+ * along with appends. Queries that are not streamed return
+ * STUB_RETRIEVE_ROWS rows. A statistics history purge moves the limit
+ * number of rows, or fails if the age is zero. Built with STUB_BASIC the
+ * optional statistics history entry points are not implemented. Appends
+ * may be held, to allow further appends to queue behind them, until they
+ * are released.
+ */
+#define STUB_STREAM_ROWS	1000
+#define STUB_STREAM_BATCH	100
+#define STUB_RETRIEVE_ROWS	3
+
+extern "C" {
+
+static PLUGIN_INFORMATION info = {
+	"stub",			// Name
+	"1.0.0",		// Version
+	SP_READINGS,		// Flags
+	PLUGIN_TYPE_STORAGE,	// Type
+	"1.0.0",		// Interface version
+	"{}"			// Default configuration
+};
+
+static PLUGIN_ERROR lastError = { (char *)"Append failed", (char *)"append", false };
+
+static std::atomic<int> streamReadings(0);
+static std::atomic<int> appendCalls(0);
+static std::atomic<int> appendReadings(0);
+static std::atomic<int> heldStreams(0);
+static std::atomic<int> statisticsHistoryCalls(0);
+static std::atomic<int> purgeAge(0);
+static std::atomic<int> purgeLimit(0);
+static std::mutex holdMutex;
+static std::condition_variable holdCv;
+static bool held = false;
+static std::string lastAppend;
+
+PLUGIN_INFORMATION *plugin_info()
+{
+	return &info;
+}
+
+PLUGIN_HANDLE plugin_init()
+{
+	return &info;
+}
+
+int plugin_reading_append(PLUGIN_HANDLE handle, const char *readings)
+{
+	(void)handle;
+	std::unique_lock<std::mutex> lock(holdMutex);
+	appendCalls++;
+	lastAppend = readings;
+	holdCv.wait(lock, []() { return !held; });
+	if (strstr(readings, "\"fail\""))
+		return -1;
+	int count = 0;
+	for (const char *p = readings; (p = strstr(p, "\"asset_code\"")) != NULL; p++)
+		count++;
+	for (const char *p = readings; (p = strstr(p, "\"skip\"")) != NULL; p++)
+		count--;
+	appendReadings += count;
+	return count;
+}
+
+int plugin_readingStream(PLUGIN_HANDLE handle, ReadingStream **readings, bool commit)
+{
+	(void)handle;
+	(void)commit;
+	int count = 0;
+	for (int i = 0; readings[i]; i++)
+	{
+		if (strcmp(readings[i]->assetCode, "fail") == 0)
+			return -1;
+		count++;
+	}
+	streamReadings += count;
+	return count;
+}
+
+bool plugin_common_retrieve_stream(PLUGIN_HANDLE handle, const char *schema, const char *table,
+		const char *query, RESULT_STREAM_CB callback, void *data)
+{
+	(void)handle;
+	(void)schema;
+	(void)query;
+	if (strcmp(table, "fail") == 0)
+		return false;
+	if (strcmp(table, "hold") == 0)
+	{
+		std::unique_lock<std::mutex> lock(holdMutex);
+		heldStreams++;
+		holdCv.wait(lock, []() { return !held; });
+		heldStreams--;
+	}
+	std::string rows;
+	for (int i = 0; i < STUB_STREAM_ROWS; i++)
+	{
+		if (!rows.empty())
+			rows += ",";
+		rows += "{\"id\":" + std::to_string(i) + "}";
+		if ((i + 1) % STUB_STREAM_BATCH == 0)
+		{
+			if (!(*callback)(data, rows.c_str(), rows.length(), STUB_STREAM_BATCH))
+				return false;
+			rows.clear();
+		}
+	}
+	return true;
+}
+
+char *plugin_common_retrieve(PLUGIN_HANDLE handle, const char *schema, const char *table, const char *query)
+{
+	(void)handle;
+	(void)schema;
+	(void)table;
+	(void)query;
+	std::string result = "{\"count\":" + std::to_string(STUB_RETRIEVE_ROWS) + ",\"rows\":[";
+	for (int i = 0; i < STUB_RETRIEVE_ROWS; i++)
+	{
+		if (i)
+			result += ",";
+		result += "{\"id\":" + std::to_string(i) + "}";
+	}
+	result += "]}";
+	return strdup(result.c_str());
+}
+
+#ifndef STUB_BASIC
+int plugin_statistics_history(PLUGIN_HANDLE handle)
+{
+	(void)handle;
+	statisticsHistoryCalls++;
+	return STUB_RETRIEVE_ROWS;
+}
+
+int plugin_statistics_history_purge(PLUGIN_HANDLE handle, unsigned long age, unsigned int limit)
+{
+	(void)handle;
+	purgeAge = (int)age;
+	purgeLimit = (int)limit;
+	if (age == 0)
+		return -1;
+	return (int)limit;
+}
+#endif
+
+PLUGIN_ERROR *plugin_last_error(PLUGIN_HANDLE handle)
+{
+	(void)handle;
+	return &lastError;
+}
+
+bool plugin_shutdown(PLUGIN_HANDLE handle)
+{
+	(void)handle;
+	return true;
+}
+
+/**
+ * The number of readings appended via plugin_readingStream
+ */
+int stub_stream_readings()
+{
+	return streamReadings;
+}
+
+/**
+ * The number of calls to plugin_statistics_history
+ */
+int stub_statistics_history()
+{
+	return statisticsHistoryCalls;
+}
+
+/**
+ * The age passed to the last plugin_statistics_history_purge
+ */
+int stub_purge_age()
+{
+	return purgeAge;
+}
+
+/**
+ * The limit passed to the last plugin_statistics_history_purge
+ */
+int stub_purge_limit()
+{
+	return purgeLimit;
+}
+
+/**
+ * The number of streamed queries of the table "hold" that are held
+ */
+int stub_held_streams()
+{
+	return heldStreams;
+}
+
+/**
+ * The number of calls to plugin_reading_append
+ */
+int stub_append_calls()
+{
+	return appendCalls;
+}
+
+/**
+ * The number of readings appended via plugin_reading_append
+ */
+int stub_append_readings()
+{
+	return appendReadings;
+}
+
+/**
+ * Hold calls to plugin_reading_append until they are released
+ */
+int stub_hold()
+{
+	std::lock_guard<std::mutex> guard(holdMutex);
+	held = true;
+	return 0;
+}
+
+/**
+ * Release the held calls to plugin_reading_append
+ */
+int stub_release()
+{
+	{
+		std::lock_guard<std::mutex> guard(holdMutex);
+		held = false;
+	}
+	holdCv.notify_all();
+	return 0;
+}
+
+/**
+ * The payload of the last call to plugin_reading_append
+ */
+const char *stub_last_append()
+{
+	std::lock_guard<std::mutex> guard(holdMutex);
+	return lastAppend.c_str();
+}
+
+};
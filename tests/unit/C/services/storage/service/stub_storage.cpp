@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "stub_storage.h"
+#include <storage_api.h>
+#include <storage_plugin.h>
+#include <management_api.h>
+#include <plugin_manager.h>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+
+using namespace std;
+
+static PLUGIN_HANDLE	stubHandle = NULL;
+static StoragePlugin	*plugin = NULL;
+static StoragePlugin	*basicPlugin = NULL;
+static unsigned short	storagePort = 0;
+
+/**
+ * Start the storage API with the stub storage plugin, once for all tests
+ */
+unsigned short startStorage()
+{
+	if (storagePort)
+		return storagePort;
+	setenv("FLEDGE_PLUGIN_PATH", STUB_PLUGIN_PATH, 1);
+	new ManagementApi("storage-test", 0);
+	StorageApi *api = new StorageApi(0, 2, 2);
+	api->initResources();
+	stubHandle = PluginManager::getInstance()->loadPlugin("stub", PLUGIN_TYPE_STORAGE);
+	if (!stubHandle)
+		return 0;
+	plugin = new StoragePlugin("stub", stubHandle);
+	api->setPlugin(plugin);
+	api->start();
+	for (int i = 0; i < 500 && storagePort == 0; i++)
+	{
+		this_thread::sleep_for(chrono::milliseconds(10));
+		storagePort = api->getListenerPort();
+	}
+	return storagePort;
+}
+
+/**
+ * Call one of the counters of the stub plugin
+ */
+int stubCounter(const char *name)
+{
+	int (*counter)() = (int (*)())PluginManager::getInstance()->resolveSymbol(stubHandle, name);
+	return counter ? counter() : -1;
+}
+
+/**
+ * The stub storage plugin used by the storage API
+ */
+StoragePlugin *stubPlugin()
+{
+	return plugin;
+}
+
+/**
+ * Have the storage API use the stub plugin built without the optional
+ * entry points, or return to the stub plugin
+ *
+ * @param basic	Use the stub plugin without the optional entry points
+ */
+void useBasicPlugin(bool basic)
+{
+	if (basic && !basicPlugin)
+	{
+		PLUGIN_HANDLE handle = PluginManager::getInstance()->loadPlugin("stubbasic", PLUGIN_TYPE_STORAGE);
+		if (handle)
+			basicPlugin = new StoragePlugin("stubbasic", handle);
+	}
+	StorageApi::getInstance()->setPlugin(basic && basicPlugin ? basicPlugin : plugin);
+}
+
+/**
+ * The payload of the last append to the stub plugin
+ */
+string stubLastAppend()
+{
+	const char *(*last)() = (const char *(*)())PluginManager::getInstance()->resolveSymbol(stubHandle, "stub_last_append");
+	return last ? string(last()) : string();
+}
@@ -0,0 +1,32 @@
+#ifndef _STUB_STORAGE_H
+#define _STUB_STORAGE_H
+#include <storage_plugin.h>
+#include <string>
+
+/*
+ * Run the storage API with the stub storage plugin in the test process,
+ * once for all tests. Returns the port of the storage API.
+ */
+unsigned short startStorage();
+
+/*
+ * Call one of the counters of the stub plugin
+ */
+int stubCounter(const char *name);
+
+/*
+ * The stub storage plugin used by the storage API
+ */
+StoragePlugin *stubPlugin();
+
+/*
+ * Have the storage API use the stub plugin built without the optional
+ * entry points, or return to the stub plugin
+ */
+void useBasicPlugin(bool basic);
+
+/*
+ * The payload of the last append to the stub plugin
+ */
+std::string stubLastAppend();
+#endif
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "stub_storage.h"
+#include <append_group.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+/*
+ * Tests of the group commit of reading appends to the stub storage
+ * plugin. The stub plugin is held while appending a first request so
+ * that the following requests queue behind it and form a group when
+ * the plugin is released.
+ */
+
+static shared_ptr<string> makePayload(const string& asset, int count)
+{
+	string payload = "{\"readings\":[";
+	for (int i = 0; i < count; i++)
+	{
+		if (i)
+			payload += ",";
+		payload += "{\"asset_code\":\"" + asset + "\",\"user_ts\":\"2024-01-01 00:00:00.000000\","
+			"\"reading\":{\"count\":" + to_string(i) + "}}";
+	}
+	payload += "]}";
+	return make_shared<string>(payload);
+}
+
+/**
+ * The results of the appends, in the order they complete
+ */
+class Results {
+	public:
+		AppendGroupCommit::Completion	completion(int request)
+		{
+			return [this, request](int rval, const shared_ptr<string>&) {
+				lock_guard<mutex> guard(m_mutex);
+				m_requests.push_back(request);
+				m_results.push_back(rval);
+				m_cv.notify_all();
+			};
+		};
+		bool	wait(size_t count)
+		{
+			unique_lock<mutex> lock(m_mutex);
+			return m_cv.wait_for(lock, chrono::seconds(5), [this, count]() { return m_results.size() >= count; });
+		};
+		vector<int>	m_requests;
+		vector<int>	m_results;
+	private:
+		mutex			m_mutex;
+		condition_variable	m_cv;
+};
+
+class AppendGroup : public ::testing::Test {
+	protected:
+		void SetUp()
+		{
+			ASSERT_NE(startStorage(), 0);
+			m_group.start(stubPlugin());
+		}
+		void TearDown()
+		{
+			stubCounter("stub_release");
+			m_group.stop();
+		}
+		/**
+		 * Append a request and wait for the stub plugin to hold it
+		 */
+		void holdFirst(Results& results)
+		{
+			stubCounter("stub_hold");
+			int calls = stubCounter("stub_append_calls");
+			ASSERT_TRUE(m_group.append(makePayload("first", 1), false, results.completion(0)));
+			for (int i = 0; i < 500 && stubCounter("stub_append_calls") == calls; i++)
+				this_thread::sleep_for(chrono::milliseconds(10));
+			ASSERT_EQ(stubCounter("stub_append_calls"), calls + 1);
+		}
+		AppendGroupCommit	m_group;
+};
+
+TEST_F(AppendGroup, Combined)
+{
+	Results results;
+	holdFirst(results);
+	int calls = stubCounter("stub_append_calls");
+	int readings = stubCounter("stub_append_readings");
+	ASSERT_TRUE(m_group.append(makePayload("one", 2), false, results.completion(1)));
+	ASSERT_TRUE(m_group.append(makePayload("two", 3), false, results.completion(2)));
+	ASSERT_TRUE(m_group.append(makePayload("three", 1), false, results.completion(3)));
+	stubCounter("stub_release");
+	ASSERT_TRUE(results.wait(4));
+
+	// The queued requests were appended in a single call
+	ASSERT_EQ(stubCounter("stub_append_calls"), calls + 1);
+	ASSERT_EQ(stubCounter("stub_append_readings"), readings + 1 + 6);
+	string last = stubLastAppend();
+	ASSERT_NE(last.find("\"one\""), string::npos);
+	ASSERT_NE(last.find("\"two\""), string::npos);
+	ASSERT_NE(last.find("\"three\""), string::npos);
+
+	ASSERT_EQ(results.m_requests, vector<int>({ 0, 1, 2, 3 }));
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 2, 3, 1 }));
+}
+
+TEST_F(AppendGroup, CombinedFailure)
+{
+	Results results;
+	holdFirst(results);
+	int calls = stubCounter("stub_append_calls");
+	int readings = stubCounter("stub_append_readings");
+	ASSERT_TRUE(m_group.append(makePayload("one", 2), false, results.completion(1)));
+	ASSERT_TRUE(m_group.append(makePayload("fail", 1), false, results.completion(2)));
+	ASSERT_TRUE(m_group.append(makePayload("three", 1), false, results.completion(3)));
+	stubCounter("stub_release");
+	ASSERT_TRUE(results.wait(4));
+
+	// The combined append failed and the requests were appended individually
+	ASSERT_EQ(stubCounter("stub_append_calls"), calls + 1 + 3);
+	ASSERT_EQ(stubCounter("stub_append_readings"), readings + 1 + 3);
+
+	// Only the request that caused the failure failed
+	ASSERT_EQ(results.m_requests, vector<int>({ 0, 1, 2, 3 }));
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 2, -1, 1 }));
+}
+
+TEST_F(AppendGroup, CombinedPartial)
+{
+	Results results;
+	holdFirst(results);
+	ASSERT_TRUE(m_group.append(makePayload("one", 2), false, results.completion(1)));
+	ASSERT_TRUE(m_group.append(makePayload("skip", 2), false, results.completion(2)));
+	ASSERT_TRUE(m_group.append(makePayload("three", 1), false, results.completion(3)));
+	stubCounter("stub_release");
+	ASSERT_TRUE(results.wait(4));
+
+	// The plugin appended three of the five readings, they are
+	// reported against the requests in the order they were queued
+	ASSERT_EQ(results.m_requests, vector<int>({ 0, 1, 2, 3 }));
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 2, 1, 0 }));
+}
+
+TEST_F(AppendGroup, NotCombinable)
+{
+	Results results;
+	holdFirst(results);
+	int calls = stubCounter("stub_append_calls");
+	ASSERT_TRUE(m_group.append(makePayload("one", 1), false, results.completion(1)));
+	shared_ptr<string> other = make_shared<string>("{\"readings\":[{\"asset_code\":\"two\"}],\"other\":1}");
+	ASSERT_TRUE(m_group.append(other, false, results.completion(2)));
+	ASSERT_TRUE(m_group.append(makePayload("three", 1), false, results.completion(3)));
+	stubCounter("stub_release");
+	ASSERT_TRUE(results.wait(4));
+
+	// The payload that can not be combined splits the queue into three appends
+	ASSERT_EQ(stubCounter("stub_append_calls"), calls + 3);
+	ASSERT_EQ(stubLastAppend().find("\"two\""), string::npos);
+	ASSERT_EQ(results.m_requests, vector<int>({ 0, 1, 2, 3 }));
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 1, 1, 1 }));
+}
+
+TEST_F(AppendGroup, SizeLimit)
+{
+	m_group.setLimits(0, 4);
+	Results results;
+	holdFirst(results);
+	int calls = stubCounter("stub_append_calls");
+	int readings = stubCounter("stub_append_readings");
+	for (int i = 1; i <= 4; i++)
+	{
+		ASSERT_TRUE(m_group.append(makePayload("limit", 2), false, results.completion(i)));
+	}
+	stubCounter("stub_release");
+	ASSERT_TRUE(results.wait(5));
+
+	// No more than four readings are combined in a group
+	ASSERT_EQ(stubCounter("stub_append_calls"), calls + 2);
+	ASSERT_EQ(stubCounter("stub_append_readings"), readings + 1 + 8);
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 2, 2, 2, 2 }));
+}
+
+TEST_F(AppendGroup, StopDrainsQueue)
+{
+	Results results;
+	holdFirst(results);
+	ASSERT_TRUE(m_group.append(makePayload("one", 1), false, results.completion(1)));
+	ASSERT_TRUE(m_group.append(makePayload("two", 1), false, results.completion(2)));
+
+	thread stopper([this]() { m_group.stop(); });
+	this_thread::sleep_for(chrono::milliseconds(50));
+	stubCounter("stub_release");
+	stopper.join();
+
+	// The queued requests were committed before the stop completed
+	ASSERT_EQ(results.m_requests, vector<int>({ 0, 1, 2 }));
+	ASSERT_EQ(results.m_results, vector<int>({ 1, 1, 1 }));
+
+	// Appends are refused once stopped
+	ASSERT_FALSE(m_group.append(makePayload("late", 1), false, results.completion(3)));
+}
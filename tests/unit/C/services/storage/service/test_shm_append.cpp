@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "stub_storage.h"
+#include <storage_client.h>
+#include <reading.h>
+#include <server_http.hpp>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+/*
+ * End to end tests of the append of readings via the shared memory
+ * channel. A storage service, with the stub storage plugin, is run in
+ * the test process and readings are appended with the StorageClient.
+ */
+
+static unsigned short	storagePort = 0;
+
+static vector<Reading *> makeReadings(const string& asset, int count)
+{
+	vector<Reading *> readings;
+	for (int i = 0; i < count; i++)
+	{
+		DatapointValue value((long) i);
+		readings.push_back(new Reading(asset, new Datapoint("count", value)));
+	}
+	return readings;
+}
+
+static void deleteReadings(vector<Reading *>& readings)
+{
+	for (auto reading : readings)
+		delete reading;
+	readings.clear();
+}
+
+class ShmAppend : public ::testing::Test {
+	protected:
+		void SetUp()
+		{
+			storagePort = startStorage();
+			ASSERT_NE(storagePort, 0);
+		}
+};
+
+TEST_F(ShmAppend, AppendedByPlugin)
+{
+	StorageClient client("localhost", storagePort);
+	client.setSharedMemory(true);
+	vector<Reading *> readings = makeReadings("shmtest", 10);
+
+	int before = stubCounter("stub_stream_readings");
+	int httpBefore = stubCounter("stub_append_calls");
+	ASSERT_TRUE(client.readingAppend(readings));
+	ASSERT_FALSE(client.lastAppendIndeterminate());
+	ASSERT_EQ(stubCounter("stub_stream_readings"), before + 10);
+	// The readings were not sent via the HTTP interface
+	ASSERT_EQ(stubCounter("stub_append_calls"), httpBefore);
+	deleteReadings(readings);
+}
+
+TEST_F(ShmAppend, DisabledByDefault)
+{
+	// One client for all repeats, as the storage service discards HTTP
+	// appends that repeat the sequence numbers of a thread
+	static StorageClient httpClient("localhost", storagePort);
+	StorageClient& client = httpClient;
+	client.setSharedMemory(false);
+	vector<Reading *> readings = makeReadings("shmtest", 4);
+
+	int before = stubCounter("stub_stream_readings");
+	int httpBefore = stubCounter("stub_append_calls");
+	ASSERT_TRUE(client.readingAppend(readings));
+	// The readings were sent via the HTTP interface
+	ASSERT_EQ(stubCounter("stub_stream_readings"), before);
+	ASSERT_EQ(stubCounter("stub_append_calls"), httpBefore + 1);
+
+	// Disabling the channel once open reverts to the HTTP interface
+	client.setSharedMemory(true);
+	ASSERT_TRUE(client.readingAppend(readings));
+	ASSERT_EQ(stubCounter("stub_stream_readings"), before + 4);
+	client.setSharedMemory(false);
+	ASSERT_TRUE(client.readingAppend(readings));
+	ASSERT_EQ(stubCounter("stub_stream_readings"), before + 4);
+	ASSERT_EQ(stubCounter("stub_append_calls"), httpBefore + 2);
+	deleteReadings(readings);
+}
+
+TEST_F(ShmAppend, PluginFailure)
+{
+	StorageClient client("localhost", storagePort);
+	client.setSharedMemory(true);
+	vector<Reading *> readings = makeReadings("fail", 2);
+
+	int before = stubCounter("stub_stream_readings");
+	ASSERT_FALSE(client.readingAppend(readings));
+	// The storage service responded, the readings may be resent
+	ASSERT_FALSE(client.lastAppendIndeterminate());
+	ASSERT_EQ(stubCounter("stub_stream_readings"), before);
+	deleteReadings(readings);
+}
+
+TEST_F(ShmAppend, NotifiesRegistry)
+{
+	using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+	HttpServer server;
+	mutex mtx;
+	condition_variable cv;
+	string notified;
+
+	server.config.port = 0;
+	server.resource["^/notify$"]["POST"] = [&](shared_ptr<HttpServer::Response> response,
+						shared_ptr<HttpServer::Request> request) {
+		{
+			lock_guard<mutex> guard(mtx);
+			notified += request->content.string();
+		}
+		cv.notify_all();
+		*response << "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+	};
+	thread serverThread([&server]() { server.start(); });
+	unsigned short port = 0;
+	for (int i = 0; i < 500 && port == 0; i++)
+	{
+		this_thread::sleep_for(chrono::milliseconds(10));
+		port = server.getLocalPort();
+	}
+	ASSERT_NE(port, 0);
+
+	StorageClient client("localhost", storagePort);
+	client.setSharedMemory(true);
+	string url = "http://localhost:" + to_string(port) + "/notify";
+	ASSERT_TRUE(client.registerAssetNotification("shmnotify", url));
+
+	vector<Reading *> readings = makeReadings("shmnotify", 3);
+	ASSERT_TRUE(client.readingAppend(readings));
+	deleteReadings(readings);
+
+	{
+		unique_lock<mutex> lock(mtx);
+		cv.wait_for(lock, chrono::seconds(5), [&notified]() {
+				return notified.find("shmnotify") != string::npos; });
+		ASSERT_NE(notified.find("shmnotify"), string::npos);
+	}
+
+	client.unregisterAssetNotification("shmnotify", url);
+	server.stop();
+	serverThread.join();
+}
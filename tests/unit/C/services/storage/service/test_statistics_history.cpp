@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "stub_storage.h"
+#include <storage_client.h>
+#include <server_http.hpp>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+/*
+ * Tests of the statistics history operations of the storage service,
+ * with and without support for them in the storage plugin.
+ */
+
+class StatisticsHistory : public ::testing::Test {
+	protected:
+		void SetUp()
+		{
+			m_port = startStorage();
+			ASSERT_NE(m_port, 0);
+		}
+		void TearDown()
+		{
+			useBasicPlugin(false);
+		}
+		unsigned short	m_port;
+};
+
+TEST_F(StatisticsHistory, Snapshot)
+{
+	StorageClient client("localhost", m_port);
+	int calls = stubCounter("stub_statistics_history");
+	ASSERT_EQ(client.statisticsHistory(), 3);
+	ASSERT_EQ(stubCounter("stub_statistics_history"), calls + 1);
+}
+
+TEST_F(StatisticsHistory, NotSupported)
+{
+	useBasicPlugin(true);
+	StorageClient client("localhost", m_port);
+	int calls = stubCounter("stub_statistics_history");
+	// The caller falls back to the common table operations
+	ASSERT_EQ(client.statisticsHistory(), -1);
+	ASSERT_EQ(stubCounter("stub_statistics_history"), calls);
+}
+
+TEST_F(StatisticsHistory, NotifiesInterest)
+{
+	using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
+	HttpServer server;
+	mutex mtx;
+	condition_variable cv;
+	string notified;
+
+	server.config.port = 0;
+	server.resource["^/notify$"]["POST"] = [&](shared_ptr<HttpServer::Response> response,
+						shared_ptr<HttpServer::Request> request) {
+		{
+			lock_guard<mutex> guard(mtx);
+			notified += request->content.string();
+		}
+		cv.notify_all();
+		*response << "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+	};
+	thread serverThread([&server]() { server.start(); });
+	unsigned short port = 0;
+	for (int i = 0; i < 500 && port == 0; i++)
+	{
+		this_thread::sleep_for(chrono::milliseconds(10));
+		port = server.getLocalPort();
+	}
+	ASSERT_NE(port, 0);
+
+	StorageClient client("localhost", m_port);
+	string url = "http://localhost:" + to_string(port) + "/notify";
+	vector<string> keyValues;
+	ASSERT_TRUE(client.registerTableNotification("statistics_history", "", keyValues, "insert", url));
+
+	ASSERT_EQ(client.statisticsHistory(), 3);
+
+	{
+		unique_lock<mutex> lock(mtx);
+		cv.wait_for(lock, chrono::seconds(5), [&notified]() {
+				return notified.find("inserts") != string::npos; });
+		// The rows read back from the plugin are sent as an insert
+		ASSERT_NE(notified.find("\"inserts\":[{\"id\":0}"), string::npos);
+	}
+
+	client.unregisterTableNotification("statistics_history", "", keyValues, "insert", url);
+	server.stop();
+	serverThread.join();
+}
+
+TEST_F(StatisticsHistory, Purge)
+{
+	StorageClient client("localhost", m_port);
+	ASSERT_EQ(client.statisticsHistoryPurge(86400, 50), 50);
+	ASSERT_EQ(stubCounter("stub_purge_age"), 86400);
+	ASSERT_EQ(stubCounter("stub_purge_limit"), 50);
+}
+
+TEST_F(StatisticsHistory, PurgeFailure)
+{
+	StorageClient client("localhost", m_port);
+	// The stub plugin fails a purge of all the history
+	ASSERT_EQ(client.statisticsHistoryPurge(0, 50), -1);
+	// A limit of zero is refused before the plugin is called
+	ASSERT_EQ(client.statisticsHistoryPurge(3600, 0), -1);
+	ASSERT_EQ(stubCounter("stub_purge_age"), 0);
+}
+
+TEST_F(StatisticsHistory, PurgeNotSupported)
+{
+	useBasicPlugin(true);
+	StorageClient client("localhost", m_port);
+	int age = stubCounter("stub_purge_age");
+	// The caller falls back to the common table operations
+	ASSERT_EQ(client.statisticsHistoryPurge(7200, 50), -1);
+	ASSERT_EQ(stubCounter("stub_purge_age"), age);
+}
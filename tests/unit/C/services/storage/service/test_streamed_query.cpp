@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "stub_storage.h"
+#include <storage_client.h>
+#include <storage_api.h>
+#include <query.h>
+#include <where.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+/*
+ * End to end tests of queries whose results are streamed by the storage
+ * service and received row by row by the StorageClient.
+ */
+
+class StreamedQuery : public ::testing::Test {
+	protected:
+		void SetUp()
+		{
+			m_port = startStorage();
+			ASSERT_NE(m_port, 0);
+		}
+		unsigned short	m_port;
+};
+
+struct Rows {
+	Rows() : count(0), ordered(true), limit(-1) {};
+	long	count;
+	bool	ordered;
+	long	limit;
+};
+
+static bool countRow(void *data, const rapidjson::Value& row)
+{
+	Rows *rows = (Rows *)data;
+	if (!row.HasMember("id") || row["id"].GetInt64() != rows->count)
+		rows->ordered = false;
+	rows->count++;
+	return rows->limit < 0 || rows->count < rows->limit;
+}
+
+TEST_F(StreamedQuery, AllRows)
+{
+	StorageClient client("localhost", m_port);
+	Query query(new Where("id", GreaterThan, "0"));
+	Rows rows;
+	ASSERT_EQ(client.queryTableRows("test", query, countRow, &rows), 1000);
+	ASSERT_EQ(rows.count, 1000);
+	ASSERT_TRUE(rows.ordered);
+}
+
+TEST_F(StreamedQuery, Abandoned)
+{
+	StorageClient client("localhost", m_port);
+	Query query(new Where("id", GreaterThan, "0"));
+	Rows rows;
+	rows.limit = 150;
+	ASSERT_EQ(client.queryTableRows("test", query, countRow, &rows), 150);
+	ASSERT_TRUE(rows.ordered);
+}
+
+TEST_F(StreamedQuery, Failure)
+{
+	StorageClient client("localhost", m_port);
+	Query query(new Where("id", GreaterThan, "0"));
+	Rows rows;
+	ASSERT_EQ(client.queryTableRows("fail", query, countRow, &rows), -1);
+	ASSERT_EQ(rows.count, 0);
+}
+
+TEST_F(StreamedQuery, PoolBusy)
+{
+	// An abandoned stream of an earlier test may still hold a thread
+	for (int i = 0; i < 500 && StorageApi::getInstance()->activeStreams() > 0; i++)
+		this_thread::sleep_for(chrono::milliseconds(10));
+	ASSERT_EQ(StorageApi::getInstance()->activeStreams(), 0U);
+
+	stubCounter("stub_hold");
+	vector<thread> streams;
+	vector<long> counts(STREAM_QUERY_POOL, 0);
+	for (unsigned int i = 0; i < STREAM_QUERY_POOL; i++)
+	{
+		streams.push_back(thread([this, &counts, i]() {
+			StorageClient client("localhost", m_port);
+			Query query(new Where("id", GreaterThan, "0"));
+			Rows rows;
+			counts[i] = client.queryTableRows("hold", query, countRow, &rows);
+		}));
+	}
+	for (int i = 0; i < 500 && stubCounter("stub_held_streams") < (int)STREAM_QUERY_POOL; i++)
+		this_thread::sleep_for(chrono::milliseconds(10));
+	EXPECT_EQ(stubCounter("stub_held_streams"), (int)STREAM_QUERY_POOL);
+
+	// With the streamed query threads busy the result is not streamed
+	StorageClient client("localhost", m_port);
+	Query query(new Where("id", GreaterThan, "0"));
+	Rows rows;
+	EXPECT_EQ(client.queryTableRows("test", query, countRow, &rows), 3);
+	EXPECT_TRUE(rows.ordered);
+
+	stubCounter("stub_release");
+	for (auto& stream : streams)
+		stream.join();
+	for (auto count : counts)
+		ASSERT_EQ(count, 1000);
+
+	// Once the streams complete results are streamed again
+	Rows streamed;
+	ASSERT_EQ(client.queryTableRows("test", query, countRow, &streamed), 1000);
+}